@@ -0,0 +1,69 @@
+#include "barycentric.hpp"
+#include "bench.hpp"
+#include "geometry.hpp"
+#include <random>
+#include <vector>
+
+BENCHMARK(barycentric)
+{
+    std::mt19937 gen(40);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    const Point3d a = {0.0f, 0.0f, 0.0f}, b = {1.0f, 0.2f, 0.1f},
+                  c = {0.3f, 1.0f, -0.2f};
+    const BarycentricTriangle tri(a, b, c);
+    std::vector<size_t> sizes = {1000, 100000, 10000000};
+    if (benchLarge())
+        sizes.push_back(100000000);
+
+    for (size_t n : sizes)
+    {
+        std::vector<Point3d> pts(n), uvw(n);
+        for (auto &p : pts)
+            p = {u(gen), u(gen), u(gen)};
+        const int repeats = n >= 10000000 ? 3 : 20;
+        std::printf(" n = %zu\n", n);
+
+        double s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    barycentric1(a, b, c, pts[i], uvw[i].x, uvw[i].y, uvw[i].z);
+                doNotOptimize(uvw.data());
+            },
+            repeats);
+        report("barycentric1", n, s, "points");
+
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    barycentric2(a, b, c, pts[i], uvw[i].x, uvw[i].y, uvw[i].z);
+                doNotOptimize(uvw.data());
+            },
+            repeats);
+        report("barycentric2 (projected areas)", n, s, "points");
+
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    tri.coordinates(pts[i], uvw[i].x, uvw[i].y, uvw[i].z);
+                doNotOptimize(uvw.data());
+            },
+            repeats);
+        report("prepared triangle, per point", n, s, "points");
+
+        s = timeIt(
+            [&]() {
+                tri.coordinates(pts, uvw);
+                doNotOptimize(uvw.data());
+            },
+            repeats);
+        report("prepared triangle, batch", n, s, "points");
+
+        s = timeIt(
+            [&]() {
+                tri.coordinates(pts, uvw, true);
+                doNotOptimize(uvw.data());
+            },
+            repeats);
+        report("prepared triangle, parallel batch", n, s, "points");
+    }
+}
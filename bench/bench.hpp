@@ -0,0 +1,71 @@
+#ifndef BENCH_HPP_INCLUDED
+#define BENCH_HPP_INCLUDED
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Minimal benchmark registry. Every BENCHMARK(name) body runs once when
+// selected on the command line and prints its own numbers through report().
+
+struct Benchmark
+{
+    const char *name;
+    void (*run)();
+};
+
+std::vector<Benchmark> &benchmarks();
+
+// Set by --large: benchmarks add their biggest (slow, memory hungry) sizes.
+bool benchLarge();
+
+struct BenchRegistrar
+{
+    BenchRegistrar(const char *name, void (*run)())
+    {
+        benchmarks().push_back({name, run});
+    }
+};
+
+#define BENCHMARK(name)                                                        \
+    static void name();                                                        \
+    static BenchRegistrar name##_registrar(#name, name);                       \
+    static void name()
+
+// Keep the compiler from optimising away a result.
+template<typename T>
+inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Best wall time of f() over 'repeats' runs, in seconds.
+template<typename F>
+double timeIt(F &&f, int repeats = 5)
+{
+    double best = 1e300;
+    for (int i = 0; i < repeats; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> d =
+            std::chrono::steady_clock::now() - start;
+        best = d.count() < best ? d.count() : best;
+    }
+    return best;
+}
+
+// Print the time per run and the throughput in 'unit' per second.
+inline void report(const char *label,
+                   double items,
+                   double seconds,
+                   const char *unit)
+{
+    std::printf("  %-40s %10.3f ms %12.2f M%s/s\n",
+                label,
+                seconds * 1e3,
+                items / seconds * 1e-6,
+                unit);
+}
+
+#endif
@@ -0,0 +1,51 @@
+#include "bench.hpp"
+#include "bounding_sphere.hpp"
+#include <random>
+#include <vector>
+
+BENCHMARK(bounding_sphere)
+{
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    std::vector<size_t> sizes = {1000, 100000, 1000000};
+    if (benchLarge())
+        sizes.push_back(10000000);
+
+    struct Builder
+    {
+        const char *label;
+        Sphere (*build)(std::span<const Point3d>);
+    };
+    const Builder builders[] = {
+        {"distant points", sphereFromDistantPoints},
+        {"ritter", ritterSphere},
+        {"ritter, 8 iterations",
+         [](std::span<const Point3d> p) { return ritterIterative(p); }},
+        {"welzl (exact)", welzlSphere}};
+
+    for (const char *cloud : {"uniform cube", "gaussian"})
+        for (size_t n : sizes)
+        {
+            std::vector<Point3d> pts(n);
+            for (auto &p : pts)
+                p = cloud[0] == 'u' ? Point3d(u(gen), u(gen), u(gen))
+                                    : Point3d(g(gen), g(gen), g(gen));
+            const int repeats = n >= 1000000 ? 3 : 20;
+            std::printf(" %s, n = %zu\n", cloud, n);
+
+            const float exact = welzlSphere(pts).r;
+            for (const Builder &b : builders)
+            {
+                Sphere s;
+                double t = timeIt(
+                    [&]() {
+                        s = b.build(pts);
+                        doNotOptimize(s);
+                    },
+                    repeats);
+                report(b.label, n, t, "points");
+                std::printf("    radius / minimum %33.4f\n", s.r / exact);
+            }
+        }
+}
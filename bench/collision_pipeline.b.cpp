@@ -0,0 +1,96 @@
+#include "bench.hpp"
+#include "bvh.hpp"
+#include "collision_pipeline.hpp"
+#include "geometry.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+// The pipeline against the same stages glued by hand from single-box
+// calls: refit one box at a time, query the BVH and test each candidate
+// pair as it comes, pushing hits into a fresh vector.
+BENCHMARK(collision_pipeline)
+{
+    std::mt19937 gen(50);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::vector<size_t> sizes = {1000, 100000};
+    if (benchLarge())
+        sizes.push_back(1000000);
+
+    for (size_t n : sizes)
+    {
+        // About ten objects in reach of each.
+        const float extent = std::cbrt(float(n)) * 1.6f;
+        std::vector<OBB3d> shapes(n);
+        std::vector<Transform3d> xf(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            OBB3d &s = shapes[i];
+            s.c = {0.0f, 0.0f, 0.0f};
+            s.u[0] = {1.0f, 0.0f, 0.0f};
+            s.u[1] = {0.0f, 1.0f, 0.0f};
+            s.u[2] = {0.0f, 0.0f, 1.0f};
+            for (float &e : s.e)
+                e = 0.2f + 0.6f * u(gen);
+            // Rotations about z.
+            const float a = 6.2831853f * u(gen);
+            const float c = std::cos(a), sn = std::sin(a);
+            const float m[3][3] = {{c, -sn, 0.0f}, {sn, c, 0.0f}, {0, 0, 1}};
+            for (int r = 0; r < 3; ++r)
+                for (int k = 0; k < 3; ++k)
+                    xf[i].m[r][k] = m[r][k];
+            for (float &t : xf[i].t)
+                t = extent * u(gen);
+        }
+        std::printf(" n = %zu\n", n);
+
+        CollisionPipeline pipeline;
+        size_t contacts = 0;
+        double s = timeIt(
+            [&]() {
+                contacts = pipeline.run(shapes, xf).size();
+                doNotOptimize(contacts);
+            },
+            5);
+        std::printf("  %zu candidates, %zu contacts\n",
+                    pipeline.candidateCount(),
+                    contacts);
+        report("CollisionPipeline::run", n, s, "objects");
+
+        s = timeIt(
+            [&]() {
+                std::vector<OBB3d> world(n);
+                std::vector<AABB3d> boxes(n);
+                for (size_t i = 0; i < n; ++i)
+                {
+                    const OBB3d &sh = shapes[i];
+                    OBB3d &w = world[i];
+                    w = sh;
+                    w.c = {xf[i].t[0], xf[i].t[1], xf[i].t[2]};
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const float *v = &sh.u[k].x;
+                        float r[3];
+                        for (int a = 0; a < 3; ++a)
+                            r[a] = xf[i].m[a][0] * v[0] +
+                                   xf[i].m[a][1] * v[1] +
+                                   xf[i].m[a][2] * v[2];
+                        w.u[k] = {r[0], r[1], r[2]};
+                    }
+                    const AABB3d local = {sh.c, {sh.e[0], sh.e[1], sh.e[2]}};
+                    UpdateAABB(local, xf[i].m, xf[i].t, boxes[i]);
+                }
+                BVH tree;
+                tree.buildLinear(boxes);
+                std::vector<std::pair<uint32_t, uint32_t>> pairs;
+                for (uint32_t i = 0; i < n; ++i)
+                    tree.query(boxes[i], [&](uint32_t j) {
+                        if (j > i && intersection(world[i], world[j]))
+                            pairs.emplace_back(i, j);
+                    });
+                doNotOptimize(pairs.data());
+            },
+            5);
+        report("hand-glued single-pair calls", n, s, "objects");
+    }
+}
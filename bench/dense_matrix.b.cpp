@@ -0,0 +1,106 @@
+#include "bench.hpp"
+#include "dense_matrix.hpp"
+#include <random>
+#include <vector>
+
+// The i-j-k loop of the fixed-size mult() template, over runtime sizes.
+static void naiveMult(const DenseMatrix<float> &a,
+                      const DenseMatrix<float> &b,
+                      DenseMatrix<float> &c)
+{
+    c.resize(a.rows(), b.cols());
+    for (size_t i = 0; i < a.rows(); ++i)
+        for (size_t j = 0; j < b.cols(); ++j)
+        {
+            float sum = 0.0f;
+            for (size_t k = 0; k < a.cols(); ++k)
+                sum += a[i][k] * b[k][j];
+            c[i][j] = sum;
+        }
+}
+
+BENCHMARK(dense_matrix)
+{
+    std::mt19937 gen(46);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<size_t> sizes = {64, 256, 1024};
+    if (benchLarge())
+        sizes.push_back(2048);
+
+    for (size_t n : sizes)
+    {
+        DenseMatrix<float> a(n, n), b(n, n), c;
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = 0; j < n; ++j)
+            {
+                a[i][j] = u(gen);
+                b[i][j] = u(gen);
+            }
+        const double flops = 2.0 * double(n) * double(n) * double(n);
+        const int repeats = n >= 1024 ? 2 : 10;
+        std::printf(" n = %zu\n", n);
+
+        double s;
+        if (n <= 1024)
+        {
+            s = timeIt(
+                [&]() {
+                    naiveMult(a, b, c);
+                    doNotOptimize(c.data());
+                },
+                repeats);
+            report("naive i-j-k", flops, s, "flop");
+        }
+
+        s = timeIt(
+            [&]() {
+                mult(a, b, c);
+                doNotOptimize(c.data());
+            },
+            repeats);
+        report("blocked", flops, s, "flop");
+
+        s = timeIt(
+            [&]() {
+                mult(a, b, c, true);
+                doNotOptimize(c.data());
+            },
+            repeats);
+        report("blocked, parallel", flops, s, "flop");
+
+        // Factorizations of a diagonally dominant copy of a, which is
+        // nonsingular, and of its symmetric part, which is also positive
+        // definite; each does about a third (LU) or a sixth (Cholesky) of
+        // the work of the product.
+        DenseMatrix<float> f(n, n), g(n, n);
+        std::vector<size_t> pivot;
+        for (bool parallel : {false, true})
+        {
+            s = timeIt(
+                [&]() {
+                    for (size_t i = 0; i < n; ++i)
+                        for (size_t j = 0; j < n; ++j)
+                            f[i][j] = a[i][j] + (i == j ? float(n) : 0.0f);
+                    luDecompose(f, pivot, parallel);
+                    doNotOptimize(f.data());
+                },
+                repeats);
+            report(parallel ? "LU, parallel" : "LU", flops / 3, s, "flop");
+
+            s = timeIt(
+                [&]() {
+                    for (size_t i = 0; i < n; ++i)
+                        for (size_t j = 0; j < n; ++j)
+                            g[i][j] = a[i][j] + a[j][i] +
+                                      (i == j ? float(2 * n) : 0.0f);
+                    cholesky(g, parallel);
+                    doNotOptimize(g.data());
+                },
+                repeats);
+            report(parallel ? "Cholesky, parallel" : "Cholesky",
+                   flops / 6,
+                   s,
+                   "flop");
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#include "bench.hpp"
+#include "bounding_sphere.hpp"
+#include "geometry.hpp"
+#include "obb.hpp"
+#include "simd.hpp"
+#include <random>
+#include <vector>
+
+// The kernels with AVX-512 paths, run at every level the CPU supports.
+BENCHMARK(dispatch)
+{
+    std::mt19937 gen(48);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<size_t> sizes = {10000, 1000000};
+    if (benchLarge())
+        sizes.push_back(10000000);
+
+    for (size_t n : sizes)
+    {
+        std::vector<Point3d> p(n);
+        for (auto &q : p)
+            q = {u(gen), u(gen), u(gen)};
+        std::vector<OBB3d> a(n / 4), b(n / 4);
+        for (auto *boxes : {&a, &b})
+            for (auto &box : *boxes)
+            {
+                box.c = {u(gen) * 3.0f, u(gen) * 3.0f, u(gen) * 3.0f};
+                box.u[0] = {1.0f, 0.0f, 0.0f};
+                box.u[1] = {0.0f, 1.0f, 0.0f};
+                box.u[2] = {0.0f, 0.0f, 1.0f};
+                box.e[0] = box.e[1] = box.e[2] = 1.0f;
+            }
+        std::vector<uint8_t> hit(a.size());
+        std::printf(" n = %zu\n", n);
+
+        const SimdLevel saved = simdLevel();
+        for (SimdLevel level :
+             {SimdLevel::Scalar, SimdLevel::Avx2, SimdLevel::Avx512})
+        {
+            if (level > cpuSimdLevel())
+                continue;
+            setSimdLevel(level);
+            std::printf(" %s\n", simdLevelName(level));
+
+            double s = timeIt(
+                [&]() {
+                    ExtremalPoints e = extremalPoints(p);
+                    doNotOptimize(e);
+                },
+                10);
+            report("extremalPoints", n, s, "points");
+
+            s = timeIt(
+                [&]() {
+                    Sphere sphere = ritterSphere(p);
+                    doNotOptimize(sphere);
+                },
+                10);
+            report("ritterSphere", n, s, "points");
+
+            s = timeIt(
+                [&]() {
+                    intersection(a, b, hit);
+                    doNotOptimize(hit.data());
+                },
+                10);
+            report("OBB pairs", a.size(), s, "pairs");
+        }
+        setSimdLevel(saved);
+    }
+}
@@ -0,0 +1,51 @@
+#include "bench.hpp"
+#include "geometry.hpp"
+#include <random>
+#include <vector>
+
+BENCHMARK(extremal_points)
+{
+    std::mt19937 gen(2);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<size_t> sizes = {1000, 100000, 1000000};
+    if (benchLarge())
+        sizes.push_back(10000000);
+
+    for (size_t n : sizes)
+    {
+        std::vector<Point3d> pts(n);
+        for (auto &p : pts)
+            p = {u(gen), u(gen), u(gen)};
+        const int repeats = n >= 1000000 ? 5 : 50;
+        std::printf(" n = %zu\n", n);
+
+        // The loop mostSeparatePointsOnAABB used to run.
+        double s = timeIt(
+            [&]() {
+                int lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+                for (size_t i = 1; i < n; ++i)
+                {
+                    const float *p = &pts[i].x;
+                    for (int a = 0; a < 3; ++a)
+                    {
+                        if (p[a] < (&pts[lo[a]].x)[a])
+                            lo[a] = int(i);
+                        if (p[a] > (&pts[hi[a]].x)[a])
+                            hi[a] = int(i);
+                    }
+                }
+                doNotOptimize(lo);
+                doNotOptimize(hi);
+            },
+            repeats);
+        report("scalar loop", n, s, "points");
+
+        s = timeIt(
+            [&]() {
+                ExtremalPoints e = extremalPoints(pts);
+                doNotOptimize(e);
+            },
+            repeats);
+        report("extremalPoints", n, s, "points");
+    }
+}
@@ -0,0 +1,98 @@
+#include "bench.hpp"
+#include "geometry.hpp"
+#include "gjk.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+BENCHMARK(gjk)
+{
+    std::mt19937 gen(38);
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    const int frames = benchLarge() ? 10000 : 1000;
+
+    for (size_t n : {16, 64, 512})
+    {
+        // Two round hulls, one sliding past the other a frame at a time
+        std::vector<Point3d> a(n), b(n), moved(n);
+        for (auto *pts : {&a, &b})
+            for (auto &p : *pts)
+            {
+                p = {g(gen), g(gen), g(gen)};
+                normalize(p, p);
+            }
+        auto place = [&](int frame) {
+            const float t = 6.0f * frame / frames - 3.0f;
+            const Point3d off = {t, 1.2f + 0.2f * std::sin(t), 0.3f};
+            for (size_t i = 0; i < n; ++i)
+                moved[i] = {b[i].x + off.x, b[i].y + off.y, b[i].z + off.z};
+        };
+        const ConvexShape sa(a), sb(moved);
+        std::printf(" %zu vertices each, %d frames\n", n, frames);
+
+        double s = timeIt(
+            [&]() {
+                float sum = 0.0f;
+                for (int frame = 0; frame < frames; ++frame)
+                {
+                    place(frame);
+                    float best = 1e30f;
+                    for (const Point3d &p : a)
+                        for (const Point3d &q : moved)
+                        {
+                            const Point3d d = p - q;
+                            best = std::min(best, dotProd(d, d));
+                        }
+                    sum += best;
+                }
+                doNotOptimize(sum);
+            },
+            3);
+        report("vertex pairs", frames, s, "queries");
+
+        Point3d pa, pb;
+        s = timeIt(
+            [&]() {
+                float sum = 0.0f;
+                for (int frame = 0; frame < frames; ++frame)
+                {
+                    place(frame);
+                    sum += gjkDistance(sa, sb, pa, pb);
+                }
+                doNotOptimize(sum);
+            },
+            3);
+        report("gjk distance, cold", frames, s, "queries");
+
+        s = timeIt(
+            [&]() {
+                GjkSimplex cache;
+                float sum = 0.0f;
+                for (int frame = 0; frame < frames; ++frame)
+                {
+                    place(frame);
+                    sum += gjkDistance(sa, sb, pa, pb, &cache);
+                }
+                doNotOptimize(sum);
+            },
+            3);
+        report("gjk distance, warm", frames, s, "queries");
+
+        s = timeIt(
+            [&]() {
+                GjkSimplex cache;
+                float sum = 0.0f, depth;
+                Point3d nrm;
+                for (int frame = 0; frame < frames; ++frame)
+                {
+                    place(frame);
+                    if (epaPenetration(sa, sb, depth, nrm, pa, pb, &cache))
+                        sum += depth;
+                }
+                doNotOptimize(sum);
+            },
+            3);
+        report("epa penetration, warm", frames, s, "queries");
+    }
+}
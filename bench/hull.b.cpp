@@ -0,0 +1,55 @@
+#include "bench.hpp"
+#include "hull.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+BENCHMARK(convex_hull)
+{
+    std::mt19937 gen(36);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    std::vector<size_t> sizes = {1000000, 10000000};
+    if (benchLarge())
+        sizes.push_back(100000000);
+
+    for (size_t n : sizes)
+    {
+        const int repeats = n >= 10000000 ? 1 : 3;
+        for (const char *dist : {"uniform", "gaussian", "circle"})
+        {
+            std::vector<Point2d> pts(n);
+            for (auto &p : pts)
+            {
+                if (dist[0] == 'u')
+                    p = {u(gen), u(gen)};
+                else if (dist[0] == 'g')
+                    p = {g(gen), g(gen)};
+                else
+                {
+                    const float t = 3.14159265f * u(gen);
+                    p = {std::cos(t), std::sin(t)};
+                }
+            }
+            std::printf(" n = %zu, %s\n", n, dist);
+
+            double s = timeIt(
+                [&]() {
+                    auto h = convexHull(pts);
+                    doNotOptimize(h);
+                },
+                repeats);
+            report("monotone chain", n, s, "points");
+
+            // quickHull works in place, so the copy is part of the cost.
+            s = timeIt(
+                [&]() {
+                    std::vector<Point2d> q = pts;
+                    size_t h = quickHull(q);
+                    doNotOptimize(h);
+                },
+                repeats);
+            report("quickHull", n, s, "points");
+        }
+    }
+}
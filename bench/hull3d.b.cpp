@@ -0,0 +1,60 @@
+#include "bench.hpp"
+#include "geometry.hpp"
+#include "hull3d.hpp"
+#include <random>
+#include <vector>
+
+BENCHMARK(convex_hull_3d)
+{
+    std::mt19937 gen(37);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    std::vector<size_t> sizes = {10000, 100000, 1000000};
+    if (benchLarge())
+        sizes.push_back(10000000);
+
+    for (size_t n : sizes)
+    {
+        const int repeats = n >= 1000000 ? 3 : 20;
+        for (const char *dist : {"cube", "gaussian", "sphere"})
+        {
+            std::vector<Point3d> pts(n);
+            for (auto &p : pts)
+            {
+                if (dist[0] == 'c')
+                    p = {u(gen), u(gen), u(gen)};
+                else if (dist[0] == 'g')
+                    p = {g(gen), g(gen), g(gen)};
+                else
+                {
+                    p = {g(gen), g(gen), g(gen)};
+                    normalize(p, p);
+                }
+            }
+            ConvexHull3d hull;
+            hull.build(pts);
+            std::printf(" n = %zu, %s, %zu vertices\n",
+                        n,
+                        dist,
+                        hull.vertices().size());
+
+            double s = timeIt(
+                [&]() {
+                    ConvexHull3d fresh;
+                    fresh.build(pts);
+                    doNotOptimize(fresh.triangles().data());
+                },
+                repeats);
+            report("new builder", n, s, "points");
+
+            // Pools and scratch space are already large enough.
+            s = timeIt(
+                [&]() {
+                    hull.build(pts);
+                    doNotOptimize(hull.triangles().data());
+                },
+                repeats);
+            report("reused builder", n, s, "points");
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#include "bench.hpp"
+#include "dense_matrix.hpp"
+#include "geometry.hpp"
+#include "math_utils.hpp"
+#include <random>
+#include <vector>
+
+BENCHMARK(inverse)
+{
+    std::mt19937 gen(47);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<size_t> sizes = {1000, 100000, 1000000};
+    if (benchLarge())
+        sizes.push_back(10000000);
+
+    for (size_t n : sizes)
+    {
+        std::vector<Matrix33> a(n), ainv(n);
+        std::vector<Matrix44> b(n), binv(n);
+        std::vector<float> det(n);
+        for (size_t k = 0; k < n; ++k)
+        {
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    a[k][i][j] = u(gen) + (i == j ? 3.0f : 0.0f);
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j)
+                    b[k].m[i][j] = u(gen) + (i == j ? 4.0f : 0.0f);
+        }
+        const int repeats = n >= 1000000 ? 3 : 20;
+        std::printf(" n = %zu\n", n);
+
+        double s = timeIt(
+            [&]() {
+                for (size_t k = 0; k < n; ++k)
+                {
+                    float m[3][3], inv[3][3] = {};
+                    for (int i = 0; i < 3; ++i)
+                        for (int j = 0; j < 3; ++j)
+                            m[i][j] = a[k][i][j];
+                    inverse(m, inv);
+                    for (int i = 0; i < 3; ++i)
+                        for (int j = 0; j < 3; ++j)
+                            ainv[k][i][j] = inv[i][j];
+                }
+                doNotOptimize(ainv.data());
+            },
+            repeats);
+        report("3x3 inverse() template, per matrix", n, s, "matrices");
+
+        s = timeIt(
+            [&]() {
+                inverse(a, ainv, det);
+                doNotOptimize(ainv.data());
+            },
+            repeats);
+        report("3x3 batch", n, s, "matrices");
+
+        s = timeIt(
+            [&]() {
+                inverse(a, ainv, det, true);
+                doNotOptimize(ainv.data());
+            },
+            repeats);
+        report("3x3 batch, parallel", n, s, "matrices");
+
+        if (n <= 100000)
+        {
+            s = timeIt(
+                [&]() {
+                    DenseMatrix<float> lu(4, 4), x(4, 4);
+                    std::vector<size_t> pivot;
+                    for (size_t k = 0; k < n; ++k)
+                    {
+                        for (int i = 0; i < 4; ++i)
+                            for (int j = 0; j < 4; ++j)
+                            {
+                                lu[i][j] = b[k].m[i][j];
+                                x[i][j] = float(i == j);
+                            }
+                        luDecompose(lu, pivot);
+                        luSolve(lu, pivot, x);
+                        for (int i = 0; i < 4; ++i)
+                            for (int j = 0; j < 4; ++j)
+                                binv[k].m[i][j] = x[i][j];
+                    }
+                    doNotOptimize(binv.data());
+                },
+                repeats);
+            report("4x4 through dense LU, per matrix", n, s, "matrices");
+        }
+
+        s = timeIt(
+            [&]() {
+                inverse(b, binv, det);
+                doNotOptimize(binv.data());
+            },
+            repeats);
+        report("4x4 batch", n, s, "matrices");
+
+        s = timeIt(
+            [&]() {
+                inverse(b, binv, det, true);
+                doNotOptimize(binv.data());
+            },
+            repeats);
+        report("4x4 batch, parallel", n, s, "matrices");
+    }
+}
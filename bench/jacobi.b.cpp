@@ -0,0 +1,56 @@
+#include "bench.hpp"
+#include "geometry.hpp"
+#include <random>
+#include <vector>
+
+BENCHMARK(jacobi)
+{
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<size_t> sizes = {1000, 100000};
+    if (benchLarge())
+        sizes.push_back(1000000);
+
+    for (size_t n : sizes)
+    {
+        // Covariance-like symmetric positive semidefinite matrices
+        std::vector<Matrix33> a(n), v(n);
+        std::vector<Point3d> e(n);
+        for (auto &m : a)
+        {
+            Matrix33 b;
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    b[i][j] = u(gen);
+            m = b.transpose() * b;
+        }
+        const int repeats = n >= 100000 ? 5 : 50;
+        std::printf(" n = %zu\n", n);
+
+        double s = timeIt(
+            [&]() {
+                float d[3];
+                for (size_t i = 0; i < n; ++i)
+                    Jacobi(a[i], v[i], d);
+                doNotOptimize(v.data());
+            },
+            repeats);
+        report("single-matrix calls", n, s, "matrices");
+
+        s = timeIt(
+            [&]() {
+                Jacobi(a, v, e);
+                doNotOptimize(v.data());
+            },
+            repeats);
+        report("batch", n, s, "matrices");
+
+        s = timeIt(
+            [&]() {
+                Jacobi(a, v, e, true);
+                doNotOptimize(v.data());
+            },
+            repeats);
+        report("batch, parallel", n, s, "matrices");
+    }
+}
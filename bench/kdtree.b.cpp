@@ -0,0 +1,80 @@
+#include "bench.hpp"
+#include "geometry.hpp"
+#include "kdtree.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+BENCHMARK(kdtree)
+{
+    std::mt19937 gen(41);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<size_t> sizes = {10000, 100000, 1000000};
+    if (benchLarge())
+        sizes.push_back(10000000);
+    const int k = 8;
+
+    for (size_t n : sizes)
+    {
+        std::vector<Point3d> pts(n);
+        for (auto &p : pts)
+            p = {u(gen), u(gen), u(gen)};
+        // Every point a query, as in per-frame proximity between points
+        const size_t queries = std::min<size_t>(n, 100000);
+        std::printf(" n = %zu, %zu queries\n", n, queries);
+
+        KdTree<Point3d> tree;
+        double s = timeIt([&]() { tree.build(pts); }, 5);
+        report("build", n, s, "points");
+
+        std::vector<KdNeighbor> out(k);
+        s = timeIt(
+            [&]() {
+                float sum = 0.0f;
+                for (size_t i = 0; i < queries; ++i)
+                {
+                    tree.nearest(pts[i], out);
+                    sum += out[k - 1].dist2;
+                }
+                doNotOptimize(sum);
+            },
+            3);
+        report("8 nearest", queries, s, "queries");
+
+        // Radius holding about 8 points on average
+        const float r = std::cbrt(8.0f * 8.0f / (4.19f * n));
+        std::vector<uint32_t> found;
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < queries; ++i)
+                {
+                    found.clear();
+                    tree.radius(pts[i], r, found);
+                }
+                doNotOptimize(found.data());
+            },
+            3);
+        report("radius", queries, s, "queries");
+
+        if (n > 100000)
+            continue;
+        // The brute force scan it replaces, over a sample of the queries
+        const size_t sample = 1000;
+        const double brute = timeIt(
+            [&]() {
+                uint32_t hits = 0;
+                for (size_t i = 0; i < sample; ++i)
+                    for (const Point3d &p : pts)
+                    {
+                        const Point3d d = p - pts[i];
+                        hits += dotProd(d, d) <= r * r;
+                    }
+                doNotOptimize(hits);
+            },
+            3);
+        std::printf("  brute force radius: %.1f us per query, %.0fx slower\n",
+                    brute / sample * 1e6,
+                    brute / sample / (s / queries));
+    }
+}
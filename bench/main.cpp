@@ -0,0 +1,37 @@
+#include "bench.hpp"
+#include <cstring>
+#include <string>
+
+std::vector<Benchmark> &benchmarks()
+{
+    static std::vector<Benchmark> all;
+    return all;
+}
+
+static bool large = false;
+
+bool benchLarge()
+{
+    return large;
+}
+
+// Usage: allbench [--large] [name-filter]
+int main(int argc, char **argv)
+{
+    const char *filter = "";
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--large") == 0)
+            large = true;
+        else
+            filter = argv[i];
+    }
+    for (const auto &b : benchmarks())
+    {
+        if (std::string(b.name).find(filter) == std::string::npos)
+            continue;
+        std::printf("%s\n", b.name);
+        b.run();
+    }
+    return 0;
+}
@@ -0,0 +1,319 @@
+#include "bench.hpp"
+#include "geometry.hpp"
+#include "math_utils.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// The vector core as it was before it moved into math_utils.hpp: opaque
+// calls the loops below cannot inline or vectorize through.
+namespace
+{
+[[gnu::noinline]] float outOfLineDot(const Point3d &u, const Point3d &v)
+{
+    return dotProd(u, v);
+}
+
+[[gnu::noinline]] Point3d outOfLineCross(const Point3d &u, const Point3d &v)
+{
+    return crossProd(u, v);
+}
+
+[[gnu::noinline]] void outOfLineNormalize(const Point3d &v, Point3d &n)
+{
+    normalize(v, n);
+}
+
+[[gnu::noinline]] Point3d outOfLineSub(const Point3d &a, const Point3d &b)
+{
+    return a - b;
+}
+
+// The scalar, out of line Matrix33 product the SSE one replaced.
+[[gnu::noinline]] Matrix33 scalarProduct(const Matrix33 &a, const Matrix33 &b)
+{
+    Matrix33 c;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            c[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j];
+    return c;
+}
+
+// mult() as it was before it went through the expression layer.
+template<typename T, size_t R1, size_t C1, size_t C2>
+void loopMult(const T (&s1)[R1][C1], const T (&s2)[C1][C2], T (&trg)[R1][C2])
+{
+    for (size_t i = 0; i < R1; ++i)
+        for (size_t j = 0; j < C2; ++j)
+        {
+            trg[i][j] = 0;
+            for (size_t k = 0; k < C1; ++k)
+                trg[i][j] += s1[i][k] * s2[k][j];
+        }
+}
+
+// J^T a J over n pairs, step by step through temporaries and in one fused
+// expression.
+template<size_t N>
+void similarity(size_t n)
+{
+    using M = float[N][N];
+    std::mt19937 gen(44);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<M> j(n), a(n), d(n);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t r = 0; r < N; ++r)
+            for (size_t c = 0; c < N; ++c)
+            {
+                j[i][r][c] = u(gen);
+                a[i][r][c] = u(gen);
+            }
+    const int repeats = n >= 1000000 ? 3 : 20;
+    char label[64];
+
+    double s = timeIt(
+        [&]() {
+            for (size_t i = 0; i < n; ++i)
+            {
+                M t, ja;
+                transpose(&j[i][0][0], &t[0][0], int(N), int(N));
+                loopMult(t, a[i], ja);
+                loopMult(ja, j[i], d[i]);
+            }
+            doNotOptimize(d.data());
+        },
+        repeats);
+    std::snprintf(label, sizeof(label), "%zux%zu J^T a J, temporaries", N, N);
+    report(label, n, s, "products");
+
+    s = timeIt(
+        [&]() {
+            for (size_t i = 0; i < n; ++i)
+                assign(d[i], transposed(expr(j[i])) * expr(a[i]) * expr(j[i]));
+            doNotOptimize(d.data());
+        },
+        repeats);
+    std::snprintf(label, sizeof(label), "%zux%zu J^T a J, expression", N, N);
+    report(label, n, s, "products");
+}
+} // namespace
+
+BENCHMARK(math)
+{
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<size_t> sizes = {1000, 100000, 10000000};
+    if (benchLarge())
+        sizes.push_back(100000000);
+
+    for (size_t n : sizes)
+    {
+        std::vector<Point3d> a(n), b(n), out(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            a[i] = {u(gen), u(gen), u(gen)};
+            b[i] = {u(gen), u(gen), u(gen)};
+        }
+        const int repeats = n >= 10000000 ? 3 : 20;
+        std::printf(" n = %zu\n", n);
+
+        float sum = 0.0f;
+        double s = timeIt(
+            [&]() {
+                sum = 0.0f;
+                for (size_t i = 0; i < n; ++i)
+                    sum += outOfLineDot(a[i], b[i]);
+                doNotOptimize(sum);
+            },
+            repeats);
+        report("dotProd sum, out of line", n, s, "pairs");
+
+        s = timeIt(
+            [&]() {
+                sum = 0.0f;
+                for (size_t i = 0; i < n; ++i)
+                    sum += dotProd(a[i], b[i]);
+                doNotOptimize(sum);
+            },
+            repeats);
+        report("dotProd sum, inline", n, s, "pairs");
+
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = outOfLineCross(a[i], b[i]);
+                doNotOptimize(out.data());
+            },
+            repeats);
+        report("crossProd, out of line", n, s, "pairs");
+
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = crossProd(a[i], b[i]);
+                doNotOptimize(out.data());
+            },
+            repeats);
+        report("crossProd, inline", n, s, "pairs");
+
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    outOfLineNormalize(a[i], out[i]);
+                doNotOptimize(out.data());
+            },
+            repeats);
+        report("normalize, out of line", n, s, "vectors");
+
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    normalize(a[i], out[i]);
+                doNotOptimize(out.data());
+            },
+            repeats);
+        report("normalize, inline", n, s, "vectors");
+
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = outOfLineSub(a[i], b[i]);
+                doNotOptimize(out.data());
+            },
+            repeats);
+        report("operator-, out of line", n, s, "pairs");
+
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = a[i] - b[i];
+                doNotOptimize(out.data());
+            },
+            repeats);
+        report("operator-, inline", n, s, "pairs");
+    }
+}
+
+BENCHMARK(matrix33)
+{
+    std::mt19937 gen(43);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<size_t> sizes = {1000, 100000, 10000000};
+    if (benchLarge())
+        sizes.push_back(100000000);
+
+    Matrix33 m;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            m[i][j] = u(gen);
+
+    for (size_t n : sizes)
+    {
+        std::vector<Point3d> pts(n), out(n);
+        for (auto &p : pts)
+            p = {u(gen), u(gen), u(gen)};
+        std::vector<Matrix33> mats(std::min<size_t>(n, 1000000)), prod(mats);
+        for (auto &a : mats)
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    a[i][j] = u(gen);
+        const int repeats = n >= 10000000 ? 3 : 20;
+        std::printf(" n = %zu\n", n);
+
+        double s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < mats.size(); ++i)
+                    prod[i] = scalarProduct(mats[i].transpose(), m);
+                doNotOptimize(prod.data());
+            },
+            repeats);
+        report("A^T * B, scalar out of line", mats.size(), s, "products");
+
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < mats.size(); ++i)
+                    prod[i] = transposeMul(mats[i], m);
+                doNotOptimize(prod.data());
+            },
+            repeats);
+        report("A^T * B, transposeMul", mats.size(), s, "products");
+
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = m * pts[i];
+                doNotOptimize(out.data());
+            },
+            repeats);
+        report("m * p, per point", n, s, "points");
+
+        s = timeIt(
+            [&]() {
+                transformPoints(m, pts, out);
+                doNotOptimize(out.data());
+            },
+            repeats);
+        report("transformPoints", n, s, "points");
+
+        s = timeIt(
+            [&]() {
+                transformPoints(m, pts, out, true);
+                doNotOptimize(out.data());
+            },
+            repeats);
+        report("transformPoints, parallel", n, s, "points");
+    }
+}
+
+BENCHMARK(expressions)
+{
+    std::vector<size_t> sizes = {1000, 100000, 1000000};
+    if (benchLarge())
+        sizes.push_back(10000000);
+
+    for (size_t n : sizes)
+    {
+        std::printf(" n = %zu\n", n);
+        similarity<3>(n);
+        similarity<4>(n);
+
+        std::mt19937 gen(45);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::vector<Point3d> a(n), b(n), c(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            a[i] = {u(gen), u(gen), u(gen)};
+            b[i] = {u(gen), u(gen), u(gen)};
+            c[i] = {u(gen), u(gen), u(gen)};
+        }
+        const auto *pa = reinterpret_cast<const float(*)[3]>(a.data());
+        const auto *pb = reinterpret_cast<const float(*)[3]>(b.data());
+        const auto *pc = reinterpret_cast<const float(*)[3]>(c.data());
+        const int repeats = n >= 1000000 ? 3 : 20;
+        float sum = 0.0f;
+
+        double s = timeIt(
+            [&]() {
+                sum = 0.0f;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    float d[3];
+                    subArray(pb[i], pa[i], d);
+                    sum += dotProdArray(d, pc[i]);
+                }
+                doNotOptimize(sum);
+            },
+            repeats);
+        report("(b - a) . c, temporaries", n, s, "triples");
+
+        s = timeIt(
+            [&]() {
+                sum = 0.0f;
+                for (size_t i = 0; i < n; ++i)
+                    sum += dot(expr(pb[i]) - expr(pa[i]), expr(pc[i]));
+                doNotOptimize(sum);
+            },
+            repeats);
+        report("(b - a) . c, expression", n, s, "triples");
+    }
+}
@@ -0,0 +1,96 @@
+#include "bench.hpp"
+#include "geometry.hpp"
+#include "obb.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+BENCHMARK(obb)
+{
+    std::mt19937 gen(6);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    std::vector<size_t> sizes = {1000, 100000, 1000000};
+    if (benchLarge())
+        sizes.push_back(10000000);
+
+    auto randomBox = [&]() {
+        OBB3d b;
+        Point3d x = {g(gen), g(gen), g(gen)}, y = {g(gen), g(gen), g(gen)};
+        normalize(x, b.u[0]);
+        normalize(crossProd(b.u[0], y), b.u[1]);
+        b.u[2] = crossProd(b.u[0], b.u[1]);
+        b.c = {4 * u(gen), 4 * u(gen), 4 * u(gen)};
+        for (float &e : b.e)
+            e = 1.5f + u(gen);
+        return b;
+    };
+
+    for (size_t n : sizes)
+    {
+        std::vector<OBB3d> a(n), b(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            a[i] = randomBox();
+            b[i] = randomBox();
+        }
+        std::vector<uint8_t> hit(n);
+        const int repeats = n >= 1000000 ? 5 : 50;
+        std::printf(" SAT, n = %zu pairs\n", n);
+
+        double s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    hit[i] = intersection(a[i], b[i]);
+                doNotOptimize(hit.data());
+            },
+            repeats);
+        report("single-pair calls", n, s, "pairs");
+
+        s = timeIt(
+            [&]() {
+                intersection(a, b, hit);
+                doNotOptimize(hit.data());
+            },
+            repeats);
+        report("batch", n, s, "pairs");
+
+        s = timeIt(
+            [&]() {
+                intersection(a, b, hit, true);
+                doNotOptimize(hit.data());
+            },
+            repeats);
+        report("batch, parallel", n, s, "pairs");
+    }
+
+    for (size_t n : sizes)
+    {
+        // An elongated, tilted cloud
+        std::vector<Point3d> pts(n);
+        for (auto &p : pts)
+        {
+            const float x = 4 * g(gen), y = g(gen), z = 0.3f * g(gen);
+            p = {x + y, x - y + z, z - 0.5f * x};
+        }
+        const int repeats = n >= 1000000 ? 3 : 20;
+        std::printf(" fit, n = %zu points\n", n);
+        OBB3d box;
+        double s = timeIt(
+            [&]() {
+                box = obbFromPoints(pts);
+                doNotOptimize(box);
+            },
+            repeats);
+        report("covariance", n, s, "points");
+        std::printf("    volume %37.4f\n", 8 * box.e[0] * box.e[1] * box.e[2]);
+        s = timeIt(
+            [&]() {
+                box = obbFromPoints(pts, true);
+                doNotOptimize(box);
+            },
+            repeats);
+        report("covariance + hull refinement", n, s, "points");
+        std::printf("    volume %37.4f\n", 8 * box.e[0] * box.e[1] * box.e[2]);
+    }
+}
@@ -0,0 +1,102 @@
+#include "bench.hpp"
+#include "bvh.hpp"
+#include "geometry.hpp"
+#include "ray.hpp"
+#include <bit>
+#include <random>
+#include <vector>
+
+BENCHMARK(ray_packets)
+{
+    std::mt19937 gen(39);
+    std::uniform_real_distribution<float> pos(-50.0f, 50.0f), off(-1.0f, 1.0f);
+    const size_t nTris = benchLarge() ? 1000000 : 100000;
+    std::vector<Triangle3d> tris(nTris);
+    for (auto &t : tris)
+    {
+        const Point3d c = {pos(gen), pos(gen), pos(gen)};
+        t.a = {c.x + off(gen), c.y + off(gen), c.z + off(gen)};
+        t.b = {c.x + off(gen), c.y + off(gen), c.z + off(gen)};
+        t.c = {c.x + off(gen), c.y + off(gen), c.z + off(gen)};
+    }
+    BVH bvh;
+    bvh.build(tris);
+
+    // Coherent rays: a pinhole camera with 8-ray rows of adjacent pixels
+    const int side = 512;
+    std::vector<Ray> rays;
+    rays.reserve(side * side);
+    for (int y = 0; y < side; ++y)
+        for (int x = 0; x < side; ++x)
+            rays.push_back({{0.0f, 0.0f, -120.0f},
+                            {(x - side / 2) / float(side) * 0.8f,
+                             (y - side / 2) / float(side) * 0.8f,
+                             1.0f}});
+    const float tmax = 1000.0f;
+    std::printf(" %zu triangles, %zu camera rays\n", nTris, rays.size());
+
+    const AABB3d box = {{0.0f, 0.0f, 0.0f}, {20.0f, 20.0f, 20.0f}};
+    double s = timeIt([&]() {
+        uint32_t hits = 0;
+        float t;
+        for (const Ray &r : rays)
+            hits += intersection(r, box, tmax, t);
+        doNotOptimize(hits);
+    });
+    report("single ray vs box", rays.size(), s, "rays");
+
+    std::vector<RayPacket> packets;
+    for (size_t i = 0; i < rays.size(); i += RayPacket::WIDTH)
+        packets.emplace_back(std::span(rays).subspan(i, RayPacket::WIDTH),
+                             tmax);
+    s = timeIt([&]() {
+        uint32_t hits = 0;
+        float t[RayPacket::WIDTH];
+        for (const RayPacket &p : packets)
+            hits += std::popcount(intersection(p, box, t));
+        doNotOptimize(hits);
+    });
+    report("packet vs box", rays.size(), s, "rays");
+
+    s = timeIt([&]() {
+        uint32_t hits = 0;
+        float t, u, v;
+        for (const Ray &r : rays)
+            hits += intersection(r, tris[0], tmax, t, u, v);
+        doNotOptimize(hits);
+    });
+    report("single ray vs triangle", rays.size(), s, "rays");
+
+    s = timeIt([&]() {
+        uint32_t hits = 0;
+        float t[RayPacket::WIDTH], u[RayPacket::WIDTH], v[RayPacket::WIDTH];
+        for (const RayPacket &p : packets)
+            hits += std::popcount(intersection(p, tris[0], t, u, v));
+        doNotOptimize(hits);
+    });
+    report("packet vs triangle", rays.size(), s, "rays");
+
+    // Nearest triangle through the BVH, one ray at a time and by packets
+    s = timeIt(
+        [&]() {
+            uint32_t hits = 0, index[RayPacket::WIDTH];
+            for (size_t i = 0; i < rays.size(); ++i)
+            {
+                RayPacket p(std::span<const Ray>(&rays[i], 1), tmax);
+                hits += bvh.closestHit(tris, p, index);
+            }
+            doNotOptimize(hits);
+        },
+        3);
+    report("bvh closest triangle, single rays", rays.size(), s, "rays");
+
+    s = timeIt(
+        [&]() {
+            uint32_t hits = 0, index[RayPacket::WIDTH];
+            for (RayPacket p : packets)
+                hits += std::popcount(bvh.closestHit(tris, p, index));
+            doNotOptimize(hits);
+        },
+        3);
+    report("bvh closest triangle, packets", rays.size(), s, "rays");
+}
@@ -0,0 +1,84 @@
+#include "bench.hpp"
+#include "scheduler.hpp"
+#include <cmath>
+#include <thread>
+#include <vector>
+
+// The pool against a thread per chunk per call, on loops short enough that
+// starting threads dominates, and on reductions.
+BENCHMARK(scheduler)
+{
+    Scheduler &s = Scheduler::global();
+    const unsigned threads = s.threads();
+    std::printf(" threads = %u\n", threads);
+
+    auto body = [](std::vector<float> &v, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i)
+            v[i] = std::sqrt(v[i] * 1.0001f + 1.0f);
+    };
+
+    for (size_t n : {size_t(1000), size_t(100000), size_t(10000000)})
+    {
+        std::vector<float> v(n, 1.0f);
+        std::printf(" n = %zu\n", n);
+
+        double t = timeIt(
+            [&]() {
+                const size_t step = (n + threads - 1) / threads;
+                std::vector<std::thread> pool;
+                for (size_t b = step; b < n; b += step)
+                    pool.emplace_back(
+                        [&, b]() { body(v, b, std::min(n, b + step)); });
+                body(v, 0, std::min(n, step));
+                for (auto &th : pool)
+                    th.join();
+                doNotOptimize(v.data());
+            },
+            10);
+        report("threads per call", n, t, "items");
+
+        t = timeIt(
+            [&]() {
+                s.parallelFor(
+                    0, n, [&](size_t b, size_t e) { body(v, b, e); });
+                doNotOptimize(v.data());
+            },
+            10);
+        report("Scheduler::parallelFor", n, t, "items");
+
+        t = timeIt(
+            [&]() {
+                double sum = s.parallelReduce(
+                    0,
+                    n,
+                    0.0,
+                    [&](size_t b, size_t e) {
+                        double part = 0.0;
+                        for (size_t i = b; i < e; ++i)
+                            part += v[i];
+                        return part;
+                    },
+                    [](double a, double b) { return a + b; });
+                doNotOptimize(sum);
+            },
+            10);
+        report("Scheduler::parallelReduce", n, t, "items");
+    }
+
+    // Fork-join overhead: a task per call.
+    auto fib = [&](auto &&self, int k) -> long {
+        if (k < 2)
+            return k;
+        long a = 0, b = 0;
+        s.invoke([&]() { a = self(self, k - 1); },
+                 [&]() { b = self(self, k - 2); });
+        return a + b;
+    };
+    const double t = timeIt(
+        [&]() {
+            long f = fib(fib, 25);
+            doNotOptimize(f);
+        },
+        5);
+    report("Scheduler::invoke fib(25)", 242785, t, "tasks");
+}
@@ -0,0 +1,72 @@
+#include "bench.hpp"
+#include "math_utils.hpp"
+#include <vector>
+
+// The row by row loop transpose() used to be.
+static void naiveTranspose(const float *src, float *dst, int rows, int cols)
+{
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < cols; ++j)
+            dst[size_t(j) * rows + i] = src[size_t(i) * cols + j];
+}
+
+BENCHMARK(transpose)
+{
+    std::vector<int> sizes = {64, 256, 1024, 4096};
+    if (benchLarge())
+    {
+        sizes.push_back(8192);
+        sizes.push_back(16384);
+    }
+
+    for (int n : sizes)
+    {
+        const size_t count = size_t(n) * n;
+        std::vector<float> src(count), dst(count);
+        for (size_t i = 0; i < count; ++i)
+            src[i] = float(i);
+        const int repeats = n >= 4096 ? 3 : 20;
+        std::printf(" n = %d\n", n);
+
+        double s = timeIt(
+            [&]() {
+                naiveTranspose(src.data(), dst.data(), n, n);
+                doNotOptimize(dst.data());
+            },
+            repeats);
+        report("row by row", count, s, "elements");
+
+        s = timeIt(
+            [&]() {
+                transpose(src.data(), dst.data(), n, n);
+                doNotOptimize(dst.data());
+            },
+            repeats);
+        report("recursive, SIMD tiles", count, s, "elements");
+
+        s = timeIt(
+            [&]() {
+                transposeInPlace(src.data(), n);
+                doNotOptimize(src.data());
+            },
+            repeats);
+        report("in place", count, s, "elements");
+
+        // A tall matrix, the shape where row by row strides hurt most
+        s = timeIt(
+            [&]() {
+                naiveTranspose(src.data(), dst.data(), n * n / 16, 16);
+                doNotOptimize(dst.data());
+            },
+            repeats);
+        report("row by row, n^2/16 x 16", count, s, "elements");
+
+        s = timeIt(
+            [&]() {
+                transpose(src.data(), dst.data(), n * n / 16, 16);
+                doNotOptimize(dst.data());
+            },
+            repeats);
+        report("recursive, n^2/16 x 16", count, s, "elements");
+    }
+}
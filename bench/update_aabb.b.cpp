@@ -0,0 +1,80 @@
+#include "bench.hpp"
+#include "geometry.hpp"
+#include <random>
+#include <vector>
+
+BENCHMARK(update_aabb)
+{
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<size_t> sizes = {1000, 100000, 1000000};
+    if (benchLarge())
+        sizes.push_back(10000000);
+
+    for (size_t n : sizes)
+    {
+        std::vector<AABB3d> local(n), world(n);
+        std::vector<Transform3d> xf(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            local[i] = {{u(gen), u(gen), u(gen)}, {1 + u(gen), 1, 1}};
+            for (auto &row : xf[i].m)
+                for (auto &v : row)
+                    v = u(gen);
+            xf[i].t[0] = xf[i].t[1] = xf[i].t[2] = u(gen);
+        }
+        const Transform3d &shared = xf[0];
+        const int repeats = n >= 1000000 ? 5 : 50;
+        std::printf(" n = %zu\n", n);
+
+        double s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    UpdateAABB(local[i], shared.m, shared.t, world[i]);
+                doNotOptimize(world.data());
+            },
+            repeats);
+        report("single-box calls, shared transform", n, s, "boxes");
+
+        s = timeIt(
+            [&]() {
+                UpdateAABB(local, shared.m, shared.t, world);
+                doNotOptimize(world.data());
+            },
+            repeats);
+        report("batch, shared transform", n, s, "boxes");
+
+        s = timeIt(
+            [&]() {
+                UpdateAABB(local, shared.m, shared.t, world, true);
+                doNotOptimize(world.data());
+            },
+            repeats);
+        report("batch, shared transform, parallel", n, s, "boxes");
+
+        s = timeIt(
+            [&]() {
+                for (size_t i = 0; i < n; ++i)
+                    UpdateAABB(local[i], xf[i].m, xf[i].t, world[i]);
+                doNotOptimize(world.data());
+            },
+            repeats);
+        report("single-box calls, per-box transform", n, s, "boxes");
+
+        s = timeIt(
+            [&]() {
+                UpdateAABB(local, xf, world);
+                doNotOptimize(world.data());
+            },
+            repeats);
+        report("batch, per-box transform", n, s, "boxes");
+
+        s = timeIt(
+            [&]() {
+                UpdateAABB(local, xf, world, true);
+                doNotOptimize(world.data());
+            },
+            repeats);
+        report("batch, per-box transform, parallel", n, s, "boxes");
+    }
+}
@@ -0,0 +1,185 @@
+#include "geometry.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include <cassert>
+#include <cmath>
+
+// Batches below this size are not worth handing to other threads.
+static constexpr size_t PARALLEL_GRAIN = 1 << 14;
+
+static void updateShared(const AABB3d *a,
+                         const float m[3][3],
+                         const float t[3],
+                         AABB3d *b,
+                         size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        UpdateAABB(a[i], m, t, b[i]);
+}
+
+static void updatePerBox(const AABB3d *a,
+                         const Transform3d *xf,
+                         AABB3d *b,
+                         size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        UpdateAABB(a[i], xf[i].m, xf[i].t, b[i]);
+}
+
+#ifdef GEOMETRY_X86
+
+// Gather component 'k' of eight consecutive records 'stride' floats apart.
+GEOMETRY_AVX2 static inline __m256 gather(const float *base,
+                                          __m256i stride,
+                                          int k)
+{
+    return _mm256_i32gather_ps(base + k, stride, 4);
+}
+
+GEOMETRY_AVX2 static inline __m256 absps(__m256 v)
+{
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+}
+
+// Lanes hold the boxes in SoA form: c[k] and r[k] are component k of eight
+// boxes. Writes the transformed boxes back as AoS.
+GEOMETRY_AVX2 static inline void transformLanes(const __m256 (&m)[3][3],
+                                                const __m256 (&am)[3][3],
+                                                const __m256 (&t)[3],
+                                                const __m256 (&c)[3],
+                                                const __m256 (&r)[3],
+                                                AABB3d *b)
+{
+    alignas(32) float out[6][8];
+    for (int i = 0; i < 3; ++i)
+    {
+        __m256 bc = _mm256_fmadd_ps(m[i][0], c[0], t[i]);
+        bc = _mm256_fmadd_ps(m[i][1], c[1], bc);
+        bc = _mm256_fmadd_ps(m[i][2], c[2], bc);
+        __m256 br = _mm256_mul_ps(am[i][0], r[0]);
+        br = _mm256_fmadd_ps(am[i][1], r[1], br);
+        br = _mm256_fmadd_ps(am[i][2], r[2], br);
+        _mm256_store_ps(out[i], bc);
+        _mm256_store_ps(out[3 + i], br);
+    }
+    for (int l = 0; l < 8; ++l)
+        b[l] = {{out[0][l], out[1][l], out[2][l]},
+                {out[3][l], out[4][l], out[5][l]}};
+}
+
+GEOMETRY_AVX2 static void updateSharedAvx2(const AABB3d *a,
+                                           const float m[3][3],
+                                           const float t[3],
+                                           AABB3d *b,
+                                           size_t n)
+{
+    static_assert(sizeof(AABB3d) == 6 * sizeof(float));
+    __m256 vm[3][3], vam[3][3], vt[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        vt[i] = _mm256_set1_ps(t[i]);
+        for (int j = 0; j < 3; ++j)
+        {
+            vm[i][j] = _mm256_set1_ps(m[i][j]);
+            vam[i][j] = _mm256_set1_ps(std::abs(m[i][j]));
+        }
+    }
+    const __m256i stride = _mm256_setr_epi32(0, 6, 12, 18, 24, 30, 36, 42);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const float *base = &a[i].c.x;
+        const __m256 c[3] = {gather(base, stride, 0),
+                             gather(base, stride, 1),
+                             gather(base, stride, 2)};
+        const __m256 r[3] = {gather(base, stride, 3),
+                             gather(base, stride, 4),
+                             gather(base, stride, 5)};
+        transformLanes(vm, vam, vt, c, r, b + i);
+    }
+    updateShared(a + i, m, t, b + i, n - i);
+}
+
+GEOMETRY_AVX2 static void updatePerBoxAvx2(const AABB3d *a,
+                                           const Transform3d *xf,
+                                           AABB3d *b,
+                                           size_t n)
+{
+    static_assert(sizeof(Transform3d) == 12 * sizeof(float));
+    const __m256i boxStride =
+        _mm256_setr_epi32(0, 6, 12, 18, 24, 30, 36, 42);
+    const __m256i xfStride =
+        _mm256_setr_epi32(0, 12, 24, 36, 48, 60, 72, 84);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const float *base = &a[i].c.x;
+        const float *xbase = &xf[i].m[0][0];
+        __m256 m[3][3], am[3][3], t[3];
+        for (int r = 0; r < 3; ++r)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                m[r][k] = gather(xbase, xfStride, 3 * r + k);
+                am[r][k] = absps(m[r][k]);
+            }
+            t[r] = gather(xbase, xfStride, 9 + r);
+        }
+        const __m256 c[3] = {gather(base, boxStride, 0),
+                             gather(base, boxStride, 1),
+                             gather(base, boxStride, 2)};
+        const __m256 r[3] = {gather(base, boxStride, 3),
+                             gather(base, boxStride, 4),
+                             gather(base, boxStride, 5)};
+        transformLanes(m, am, t, c, r, b + i);
+    }
+    updatePerBox(a + i, xf + i, b + i, n - i);
+}
+
+#endif
+
+template<typename F>
+static void run(size_t n, bool parallel, F &&kernel)
+{
+    if (parallel)
+        parallelFor(n, PARALLEL_GRAIN, kernel);
+    else
+        kernel(size_t(0), n);
+}
+
+void UpdateAABB(std::span<const AABB3d> a,
+                const float m[3][3],
+                const float t[3],
+                std::span<AABB3d> b,
+                bool parallel)
+{
+    assert(a.size() == b.size());
+    run(a.size(), parallel, [&](size_t begin, size_t end) {
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+            return updateSharedAvx2(
+                a.data() + begin, m, t, b.data() + begin, end - begin);
+#endif
+        updateShared(a.data() + begin, m, t, b.data() + begin, end - begin);
+    });
+}
+
+void UpdateAABB(std::span<const AABB3d> a,
+                std::span<const Transform3d> xf,
+                std::span<AABB3d> b,
+                bool parallel)
+{
+    assert(a.size() == b.size() && a.size() == xf.size());
+    run(a.size(), parallel, [&](size_t begin, size_t end) {
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+            return updatePerBoxAvx2(
+                a.data() + begin, xf.data() + begin, b.data() + begin,
+                end - begin);
+#endif
+        updatePerBox(
+            a.data() + begin, xf.data() + begin, b.data() + begin, end - begin);
+    });
+}
@@ -0,0 +1,99 @@
+#include "barycentric.hpp"
+#include "geometry.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include <cassert>
+
+// Batches below this size are not worth handing to other threads.
+static constexpr size_t PARALLEL_GRAIN = 1 << 15;
+
+BarycentricTriangle::BarycentricTriangle(const Point3d &a,
+                                         const Point3d &b,
+                                         const Point3d &c)
+    : a_(a)
+{
+    // barycentric1()'s v = (d11 * d20 - d01 * d21) / denom with d20 and d21
+    // expanded, and likewise for w
+    const Point3d v0 = b - a, v1 = c - a;
+    const float d00 = dotProd(v0, v0);
+    const float d01 = dotProd(v0, v1);
+    const float d11 = dotProd(v1, v1);
+    const float inv = 1.0f / (d00 * d11 - d01 * d01);
+    ev_ = {(d11 * v0.x - d01 * v1.x) * inv,
+           (d11 * v0.y - d01 * v1.y) * inv,
+           (d11 * v0.z - d01 * v1.z) * inv};
+    ew_ = {(d00 * v1.x - d01 * v0.x) * inv,
+           (d00 * v1.y - d01 * v0.y) * inv,
+           (d00 * v1.z - d01 * v0.z) * inv};
+}
+
+void BarycentricTriangle::coordinates(const Point3d &p,
+                                      float &u,
+                                      float &v,
+                                      float &w) const
+{
+    const Point3d d = p - a_;
+    v = dotProd(d, ev_);
+    w = dotProd(d, ew_);
+    u = 1.0f - v - w;
+}
+
+#ifdef GEOMETRY_X86
+
+GEOMETRY_AVX2 static void coordinatesAvx2(const Point3d &a,
+                                          const Point3d &ev,
+                                          const Point3d &ew,
+                                          const Point3d *p,
+                                          Point3d *uvw,
+                                          size_t n)
+{
+    static_assert(sizeof(Point3d) == 3 * sizeof(float));
+    const __m256 ax = _mm256_set1_ps(a.x), ay = _mm256_set1_ps(a.y),
+                 az = _mm256_set1_ps(a.z);
+    const __m256 evx = _mm256_set1_ps(ev.x), evy = _mm256_set1_ps(ev.y),
+                 evz = _mm256_set1_ps(ev.z);
+    const __m256 ewx = _mm256_set1_ps(ew.x), ewy = _mm256_set1_ps(ew.y),
+                 ewz = _mm256_set1_ps(ew.z);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for (size_t i = 0; i < n; i += 8)
+    {
+        __m256 x, y, z;
+        loadXYZ8(&p[i].x, x, y, z);
+        x = _mm256_sub_ps(x, ax);
+        y = _mm256_sub_ps(y, ay);
+        z = _mm256_sub_ps(z, az);
+        const __m256 v = _mm256_fmadd_ps(
+            z, evz, _mm256_fmadd_ps(y, evy, _mm256_mul_ps(x, evx)));
+        const __m256 w = _mm256_fmadd_ps(
+            z, ewz, _mm256_fmadd_ps(y, ewy, _mm256_mul_ps(x, ewx)));
+        const __m256 u = _mm256_sub_ps(_mm256_sub_ps(one, v), w);
+        storeXYZ8(&uvw[i].x, u, v, w);
+    }
+}
+
+#endif
+
+void BarycentricTriangle::coordinates(std::span<const Point3d> p,
+                                      std::span<Point3d> uvw,
+                                      bool parallel) const
+{
+    assert(p.size() == uvw.size());
+    auto kernel = [&](size_t begin, size_t end) {
+        size_t i = begin;
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+        {
+            const size_t n = (end - begin) & ~size_t(7);
+            coordinatesAvx2(a_, ev_, ew_, p.data() + begin, uvw.data() + begin,
+                            n);
+            i += n;
+        }
+#endif
+        for (; i < end; ++i)
+            coordinates(p[i], uvw[i].x, uvw[i].y, uvw[i].z);
+    };
+    if (parallel)
+        parallelFor(p.size(), PARALLEL_GRAIN, kernel);
+    else
+        kernel(size_t(0), p.size());
+}
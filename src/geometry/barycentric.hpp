@@ -0,0 +1,38 @@
+#ifndef BARYCENTRIC_HPP_INCLUDED
+#define BARYCENTRIC_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include <span>
+
+// Triangle abc prepared for the barycentric coordinates of many points.
+// barycentric1() solves the same 2x2 system on every call; here its dot
+// products and determinant are folded into two vectors once, leaving two
+// dot products per point. Points off the plane of the triangle get the
+// coordinates of their projection onto it.
+class BarycentricTriangle
+{
+public:
+    BarycentricTriangle(const Point3d &a, const Point3d &b, const Point3d &c);
+    explicit BarycentricTriangle(const Triangle3d &t)
+        : BarycentricTriangle(t.a, t.b, t.c)
+    {
+    }
+
+    // Weights u of a, v of b and w of c: p = u * a + v * b + w * c.
+    void coordinates(const Point3d &p, float &u, float &v, float &w) const;
+
+    // uvw[i] = (u, v, w) of p[i]. Eight points at a time go through AVX2
+    // when the CPU has it; 'parallel' also splits large batches across
+    // threads.
+    void coordinates(std::span<const Point3d> p,
+                     std::span<Point3d> uvw,
+                     bool parallel = false) const;
+
+private:
+    Point3d a_;
+    // v = dot(p - a, ev_), w = dot(p - a, ew_)
+    Point3d ev_;
+    Point3d ew_;
+};
+
+#endif
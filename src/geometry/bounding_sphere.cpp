@@ -0,0 +1,343 @@
+#include "bounding_sphere.hpp"
+#include "geometry.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <random>
+#include <vector>
+
+// Inputs smaller than this are filtered by one thread.
+static constexpr size_t PARALLEL_THRESHOLD = 1 << 17;
+// Relative slack on the squared radius in the exact builder's tests.
+static constexpr float WELZL_EPSILON = 1e-5f;
+static constexpr unsigned SHUFFLE_SEED = 0x5eed;
+
+void sphereOfSphereAndPt(Sphere &s, const Point3d &p)
+{
+    // Compute squared distance between point and sphere center
+    Point3d d = p - s.c;
+    float dist2 = dotProd(d, d);
+    // Only update s if point p is outside it
+    if (dist2 > s.r * s.r)
+    {
+        float dist = std::sqrt(dist2);
+        float newRadius = (s.r + dist) * 0.5f;
+        float k = (newRadius - s.r) / dist;
+        s.r = newRadius;
+        s.c = {s.c.x + d.x * k, s.c.y + d.y * k, s.c.z + d.z * k};
+    }
+}
+
+static size_t firstOutsideScalar(const Point3d *pt,
+                                 size_t begin,
+                                 size_t end,
+                                 const Point3d &c,
+                                 float r2)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        const float dx = pt[i].x - c.x;
+        const float dy = pt[i].y - c.y;
+        const float dz = pt[i].z - c.z;
+        if (dx * dx + dy * dy + dz * dz > r2)
+            return i;
+    }
+    return end;
+}
+
+#ifdef GEOMETRY_X86
+
+GEOMETRY_AVX2 static size_t firstOutsideAvx2(const Point3d *pt,
+                                             size_t begin,
+                                             size_t end,
+                                             const Point3d &c,
+                                             float r2)
+{
+    static_assert(sizeof(Point3d) == 3 * sizeof(float));
+    const __m256 cx = _mm256_set1_ps(c.x);
+    const __m256 cy = _mm256_set1_ps(c.y);
+    const __m256 cz = _mm256_set1_ps(c.z);
+    const __m256 limit = _mm256_set1_ps(r2);
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 x, y, z;
+        loadXYZ8(&pt[i].x, x, y, z);
+        x = _mm256_sub_ps(x, cx);
+        y = _mm256_sub_ps(y, cy);
+        z = _mm256_sub_ps(z, cz);
+        __m256 d2 = _mm256_mul_ps(x, x);
+        d2 = _mm256_fmadd_ps(y, y, d2);
+        d2 = _mm256_fmadd_ps(z, z, d2);
+        const int mask =
+            _mm256_movemask_ps(_mm256_cmp_ps(d2, limit, _CMP_GT_OQ));
+        if (mask != 0)
+            return i + std::countr_zero(unsigned(mask));
+    }
+    return firstOutsideScalar(pt, i, end, c, r2);
+}
+
+GEOMETRY_AVX512 static size_t firstOutsideAvx512(const Point3d *pt,
+                                                 size_t begin,
+                                                 size_t end,
+                                                 const Point3d &c,
+                                                 float r2)
+{
+    const __m512 cx = _mm512_set1_ps(c.x);
+    const __m512 cy = _mm512_set1_ps(c.y);
+    const __m512 cz = _mm512_set1_ps(c.z);
+    const __m512 limit = _mm512_set1_ps(r2);
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16)
+    {
+        __m512 x, y, z;
+        loadXYZ16(&pt[i].x, x, y, z);
+        x = _mm512_sub_ps(x, cx);
+        y = _mm512_sub_ps(y, cy);
+        z = _mm512_sub_ps(z, cz);
+        __m512 d2 = _mm512_mul_ps(x, x);
+        d2 = _mm512_fmadd_ps(y, y, d2);
+        d2 = _mm512_fmadd_ps(z, z, d2);
+        const __mmask16 mask = _mm512_cmp_ps_mask(d2, limit, _CMP_GT_OQ);
+        if (mask != 0)
+            return i + std::countr_zero(unsigned(mask));
+    }
+    return firstOutsideAvx2(pt, i, end, c, r2);
+}
+
+#endif
+
+// Index of the first point in [begin, end) farther than sqrt(r2) from 'c',
+// or 'end'.
+static size_t firstOutside(const Point3d *pt,
+                           size_t begin,
+                           size_t end,
+                           const Point3d &c,
+                           float r2)
+{
+#ifdef GEOMETRY_X86
+    if (cpuHasAvx512())
+        return firstOutsideAvx512(pt, begin, end, c, r2);
+    if (cpuHasAvx2())
+        return firstOutsideAvx2(pt, begin, end, c, r2);
+#endif
+    return firstOutsideScalar(pt, begin, end, c, r2);
+}
+
+// Indices of the points outside 's', in increasing order.
+static std::vector<uint32_t> pointsOutside(std::span<const Point3d> pt,
+                                           const Sphere &s)
+{
+    const size_t n = pt.size();
+    const float r2 = s.r * s.r;
+    auto collect = [&](size_t begin, size_t end, std::vector<uint32_t> &out) {
+        size_t i = firstOutside(pt.data(), begin, end, s.c, r2);
+        while (i < end)
+        {
+            out.push_back(static_cast<uint32_t>(i));
+            i = firstOutside(pt.data(), i + 1, end, s.c, r2);
+        }
+    };
+
+    // Each chunk fills its own list; concatenating them keeps the order.
+    const size_t chunks = n >= PARALLEL_THRESHOLD ? parallelism() : 1;
+    const size_t step = (n + chunks - 1) / chunks;
+    std::vector<std::vector<uint32_t>> parts(chunks);
+    parallelFor(chunks, 1, [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; ++c)
+            collect(c * step, std::min(n, (c + 1) * step), parts[c]);
+    });
+    for (size_t c = 1; c < chunks; ++c)
+        parts[0].insert(parts[0].end(), parts[c].begin(), parts[c].end());
+    return std::move(parts[0]);
+}
+
+Sphere sphereFromDistantPoints(std::span<const Point3d> pt)
+{
+    if (pt.empty())
+        return {{0.0f, 0.0f, 0.0f}, 0.0f};
+    // Find the most separated point pair defining the encompassing AABB
+    int min, max;
+    mostSeparatePointsOnAABB(min, max, pt);
+    // Set up sphere to just encompass these two points
+    const Point3d &a = pt[min], &b = pt[max];
+    Sphere s;
+    s.c = {(a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f};
+    s.r = std::sqrt(dotProd(b - s.c, b - s.c));
+    return s;
+}
+
+Sphere ritterSphere(std::span<const Point3d> pt)
+{
+    // Get sphere encompassing two approximately most distant points
+    Sphere s = sphereFromDistantPoints(pt);
+    // Grow sphere to include all points. Growing never uncovers a point, so
+    // only those outside the initial sphere can make a difference.
+    for (uint32_t i : pointsOutside(pt, s))
+        sphereOfSphereAndPt(s, pt[i]);
+    return s;
+}
+
+Sphere ritterIterative(std::span<const Point3d> pt, int iterations)
+{
+    Sphere s = ritterSphere(pt);
+    Sphere s2 = s;
+    std::mt19937 gen(SHUFFLE_SEED);
+    for (int k = 0; k < iterations; ++k)
+    {
+        // Shrink the sphere somewhat to make it an underestimate (not bound)
+        s2.r *= 0.95f;
+        // Make sphere bound data again, visiting the points in random order
+        std::vector<uint32_t> order = pointsOutside(pt, s2);
+        std::shuffle(order.begin(), order.end(), gen);
+        for (uint32_t i : order)
+            sphereOfSphereAndPt(s2, pt[i]);
+        // Update s whenever a tighter sphere is found
+        if (s2.r < s.r)
+            s = s2;
+    }
+    return s;
+}
+
+namespace
+{
+// Support spheres are solved in double precision, relative to their first
+// point.
+struct Vec3
+{
+    double x, y, z;
+};
+
+Vec3 sub(const Point3d &a, const Point3d &b)
+{
+    return {double(a.x) - b.x, double(a.y) - b.y, double(a.z) - b.z};
+}
+
+double dot(const Vec3 &a, const Vec3 &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Vec3 cross(const Vec3 &a, const Vec3 &b)
+{
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+            a.x * b.y - a.y * b.x};
+}
+
+// Sphere centered at a + o. The radius is measured from the rounded center
+// to every support point so that none of them ends up outside.
+Sphere supportSphere(const Point3d &a,
+                     const Vec3 &o,
+                     std::initializer_list<Point3d> support)
+{
+    Sphere s;
+    s.c = {float(a.x + o.x), float(a.y + o.y), float(a.z + o.z)};
+    double r2 = 0.0;
+    for (const Point3d &p : support)
+    {
+        const Vec3 d = sub(p, s.c);
+        r2 = std::max(r2, dot(d, d));
+    }
+    s.r = float(std::sqrt(r2));
+    return s;
+}
+
+Sphere sphere2(const Point3d &a, const Point3d &b)
+{
+    const Vec3 ab = sub(b, a);
+    return supportSphere(a, {ab.x * 0.5, ab.y * 0.5, ab.z * 0.5}, {a, b});
+}
+
+// Smallest sphere through a, b and c: its center lies in their plane.
+Sphere sphere3(const Point3d &a, const Point3d &b, const Point3d &c)
+{
+    const Vec3 ab = sub(b, a), ac = sub(c, a);
+    const Vec3 n = cross(ab, ac);
+    const double nn = dot(n, n);
+    const double ab2 = dot(ab, ab), ac2 = dot(ac, ac);
+    if (nn <= 1e-12 * ab2 * ac2)
+    {
+        // Collinear: the two farthest apart points span the sphere
+        const Vec3 bc = sub(c, b);
+        if (ab2 >= ac2 && ab2 >= dot(bc, bc))
+            return sphere2(a, b);
+        return ac2 >= dot(bc, bc) ? sphere2(a, c) : sphere2(b, c);
+    }
+    const Vec3 u = cross(n, ab), v = cross(ac, n);
+    const double k = 0.5 / nn;
+    return supportSphere(a,
+                         {(ac2 * u.x + ab2 * v.x) * k,
+                          (ac2 * u.y + ab2 * v.y) * k,
+                          (ac2 * u.z + ab2 * v.z) * k},
+                         {a, b, c});
+}
+
+// Sphere through a, b, c and d. Returns false if they are coplanar.
+bool sphere4(const Point3d &a,
+             const Point3d &b,
+             const Point3d &c,
+             const Point3d &d,
+             Sphere &s)
+{
+    const Vec3 ab = sub(b, a), ac = sub(c, a), ad = sub(d, a);
+    const Vec3 cd = cross(ac, ad), db = cross(ad, ab), bc = cross(ab, ac);
+    const double det = dot(ab, cd);
+    const double ab2 = dot(ab, ab), ac2 = dot(ac, ac), ad2 = dot(ad, ad);
+    if (det * det <= 1e-18 * ab2 * ac2 * ad2)
+        return false;
+    const double k = 0.5 / det;
+    s = supportSphere(a,
+                      {(ab2 * cd.x + ac2 * db.x + ad2 * bc.x) * k,
+                       (ab2 * cd.y + ac2 * db.y + ad2 * bc.y) * k,
+                       (ab2 * cd.z + ac2 * db.z + ad2 * bc.z) * k},
+                      {a, b, c, d});
+    return true;
+}
+} // namespace
+
+Sphere welzlSphere(std::span<const Point3d> pt)
+{
+    if (pt.empty())
+        return {{0.0f, 0.0f, 0.0f}, 0.0f};
+
+    // A random order gives the expected linear running time.
+    std::vector<Point3d> p(pt.begin(), pt.end());
+    std::shuffle(p.begin(), p.end(), std::mt19937(SHUFFLE_SEED));
+    const Point3d *q = p.data();
+
+    Sphere s = {q[0], 0.0f};
+    auto next = [&](size_t begin, size_t end) {
+        return firstOutside(
+            q, begin, end, s.c, s.r * s.r * (1.0f + WELZL_EPSILON));
+    };
+
+    // Each level fixes one more point on the boundary and restarts the scan
+    // over the points before it.
+    const size_t n = p.size();
+    for (size_t i = 1; (i = next(i, n)) < n; ++i)
+    {
+        s = {q[i], 0.0f};
+        for (size_t j = 0; (j = next(j, i)) < i; ++j)
+        {
+            s = sphere2(q[i], q[j]);
+            for (size_t k = 0; (k = next(k, j)) < j; ++k)
+            {
+                s = sphere3(q[i], q[j], q[k]);
+                for (size_t l = 0; (l = next(l, k)) < k; ++l)
+                {
+                    // Coplanar supports only happen through rounding; grow
+                    // the sphere instead.
+                    if (!sphere4(q[i], q[j], q[k], q[l], s))
+                        sphereOfSphereAndPt(s, q[l]);
+                }
+            }
+        }
+    }
+    // Cover the points that passed with the slack.
+    s.r *= std::sqrt(1.0f + WELZL_EPSILON);
+    return s;
+}
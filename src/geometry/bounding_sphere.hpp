@@ -0,0 +1,34 @@
+#ifndef BOUNDING_SPHERE_HPP_INCLUDED
+#define BOUNDING_SPHERE_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include <span>
+
+// Bounding spheres of point sets, from fastest and loosest to exact. All of
+// them return a zero radius sphere at the origin for an empty span.
+
+// Grow 's' just enough to also enclose 'p'.
+void sphereOfSphereAndPt(Sphere &s, const Point3d &p);
+
+// Sphere spanned by the two most separated of the points extremal along
+// x, y and z. Usually misses some points.
+Sphere sphereFromDistantPoints(std::span<const Point3d> pt);
+
+// Ritter's sphere: sphereFromDistantPoints() grown to enclose every point
+// in turn, typically a few percent larger than the minimum sphere. The
+// points outside the initial sphere are found by a SIMD pass, split across
+// threads for large inputs; the result is that of the sequential pass.
+Sphere ritterSphere(std::span<const Point3d> pt);
+
+// Ritter's sphere refined by repeatedly shrinking it by 5% and growing it
+// again over the points in random order, keeping the smallest sphere seen.
+// Deterministic: the order is drawn from a fixed seed.
+Sphere ritterIterative(std::span<const Point3d> pt, int iterations = 8);
+
+// Minimum enclosing sphere, by Welzl's randomized incremental algorithm in
+// its iterative form. Expected linear time; the containment tests are SIMD
+// scans. The radius carries a relative slack of about 1e-5 to absorb
+// rounding.
+Sphere welzlSphere(std::span<const Point3d> pt);
+
+#endif
@@ -0,0 +1,443 @@
+#include "bvh.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+
+namespace
+{
+
+struct Bounds
+{
+    float min[3] = {std::numeric_limits<float>::max(),
+                    std::numeric_limits<float>::max(),
+                    std::numeric_limits<float>::max()};
+    float max[3] = {-std::numeric_limits<float>::max(),
+                    -std::numeric_limits<float>::max(),
+                    -std::numeric_limits<float>::max()};
+
+    void grow(const float (&mn)[3], const float (&mx)[3])
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            min[i] = std::min(min[i], mn[i]);
+            max[i] = std::max(max[i], mx[i]);
+        }
+    }
+
+    void grow(const Point3d &p)
+    {
+        const float v[3] = {p.x, p.y, p.z};
+        grow(v, v);
+    }
+
+    void grow(const AABB3d &b)
+    {
+        const float mn[3] = {b.c.x - b.r[0], b.c.y - b.r[1], b.c.z - b.r[2]};
+        const float mx[3] = {b.c.x + b.r[0], b.c.y + b.r[1], b.c.z + b.r[2]};
+        grow(mn, mx);
+    }
+
+    void grow(const Bounds &b)
+    {
+        grow(b.min, b.max);
+    }
+
+    float area() const
+    {
+        float e[3] = {max[0] - min[0], max[1] - min[1], max[2] - min[2]};
+        if (e[0] < 0.0f)
+            return 0.0f;
+        return e[0] * e[1] + e[1] * e[2] + e[2] * e[0];
+    }
+};
+
+struct Bin
+{
+    Bounds bounds;
+    uint32_t count = 0;
+};
+
+struct Binning
+{
+    Bin bins[3][BVH::BINS];
+
+    void merge(const Binning &o)
+    {
+        for (int a = 0; a < 3; ++a)
+            for (int b = 0; b < BVH::BINS; ++b)
+            {
+                bins[a][b].bounds.grow(o.bins[a][b].bounds);
+                bins[a][b].count += o.bins[a][b].count;
+            }
+    }
+};
+
+// Ranges smaller than this are processed by a single thread.
+constexpr uint32_t PARALLEL_THRESHOLD = 1 << 16;
+
+// SAH cost of visiting a node, relative to testing one primitive.
+constexpr float TRAVERSAL_COST = 1.0f;
+
+float coord(const Point3d &p, int axis)
+{
+    return (&p.x)[axis];
+}
+
+} // namespace
+
+void BVH::build(std::span<const AABB3d> boxes)
+{
+    const auto n = static_cast<uint32_t>(boxes.size());
+    nodes_.clear();
+    prims_.assign(boxes.begin(), boxes.end());
+    indices_.resize(n);
+    if (n == 0)
+        return;
+
+    centroids_.resize(n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        indices_[i] = i;
+        centroids_[i] = boxes[i].c;
+    }
+
+    // A binary tree with n leaves has at most 2n - 1 nodes.
+    nodes_.resize(2 * size_t(n) - 1);
+    nodes_[0].leftFirst = 0;
+    nodes_[0].count = n;
+    nodesUsed_ = 1;
+    subdivide(0, 0);
+    nodes_.resize(nodesUsed_);
+
+    // Store primitives in leaf order so that leaves scan contiguous memory.
+    for (uint32_t i = 0; i < n; ++i)
+        prims_[i] = boxes[indices_[i]];
+    centroids_.clear();
+    centroids_.shrink_to_fit();
+}
+
+void BVH::build(std::span<const Sphere> spheres)
+{
+    std::vector<AABB3d> boxes(spheres.size());
+    for (size_t i = 0; i < spheres.size(); ++i)
+        boxes[i] = {spheres[i].c, {spheres[i].r, spheres[i].r, spheres[i].r}};
+    build(boxes);
+}
+
+void BVH::build(std::span<const Triangle3d> triangles)
+{
+    std::vector<AABB3d> boxes(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+        Bounds b;
+        b.grow(triangles[i].a);
+        b.grow(triangles[i].b);
+        b.grow(triangles[i].c);
+        for (int k = 0; k < 3; ++k)
+        {
+            (&boxes[i].c.x)[k] = 0.5f * (b.min[k] + b.max[k]);
+            boxes[i].r[k] = 0.5f * (b.max[k] - b.min[k]);
+        }
+    }
+    build(boxes);
+}
+
+void BVH::subdivide(uint32_t nodeIdx, int depth)
+{
+    BVHNode &node = nodes_[nodeIdx];
+    const uint32_t first = node.leftFirst;
+    const uint32_t count = node.count;
+
+    // Node bounds and centroid bounds in one pass over the range.
+    auto gatherBounds = [&](uint32_t b, uint32_t e, Bounds &nb, Bounds &cb) {
+        for (uint32_t i = b; i < e; ++i)
+        {
+            nb.grow(prims_[indices_[i]]);
+            cb.grow(centroids_[indices_[i]]);
+        }
+    };
+    Bounds nodeBounds, centroidBounds;
+    if (count >= PARALLEL_THRESHOLD)
+    {
+        std::vector<Bounds> nb(parallelism()), cb(parallelism());
+        std::atomic<size_t> slot{0};
+        parallelFor(count, PARALLEL_THRESHOLD, [&](size_t b, size_t e) {
+            auto s = slot++;
+            gatherBounds(first + b, first + e, nb[s], cb[s]);
+        });
+        for (size_t s = 0; s < slot; ++s)
+        {
+            nodeBounds.grow(nb[s]);
+            centroidBounds.grow(cb[s]);
+        }
+    }
+    else
+    {
+        gatherBounds(first, first + count, nodeBounds, centroidBounds);
+    }
+    std::copy(nodeBounds.min, nodeBounds.min + 3, node.min);
+    std::copy(nodeBounds.max, nodeBounds.max + 3, node.max);
+
+    if (count <= 1)
+        return;
+
+    // Bin the centroids along every axis and sweep the bin boundaries for
+    // the cheapest split.
+    float scale[3];
+    for (int a = 0; a < 3; ++a)
+    {
+        float extent = centroidBounds.max[a] - centroidBounds.min[a];
+        scale[a] = extent > 0.0f ? BINS / extent : 0.0f;
+    }
+    auto binOf = [&](const Point3d &c, int a) {
+        int b = static_cast<int>((coord(c, a) - centroidBounds.min[a]) *
+                                 scale[a]);
+        return std::min(b, BINS - 1);
+    };
+    auto binRange = [&](uint32_t b, uint32_t e, Binning &out) {
+        for (uint32_t i = b; i < e; ++i)
+        {
+            const auto &c = centroids_[indices_[i]];
+            for (int a = 0; a < 3; ++a)
+            {
+                if (scale[a] == 0.0f)
+                    continue;
+                auto &bin = out.bins[a][binOf(c, a)];
+                bin.bounds.grow(prims_[indices_[i]]);
+                ++bin.count;
+            }
+        }
+    };
+    Binning binning;
+    if (count >= PARALLEL_THRESHOLD)
+    {
+        std::vector<Binning> partial(parallelism());
+        std::atomic<size_t> slot{0};
+        parallelFor(count, PARALLEL_THRESHOLD, [&](size_t b, size_t e) {
+            binRange(first + b, first + e, partial[slot++]);
+        });
+        for (size_t s = 0; s < slot; ++s)
+            binning.merge(partial[s]);
+    }
+    else
+    {
+        binRange(first, first + count, binning);
+    }
+
+    int bestAxis = -1, bestSplit = 0;
+    float bestCost = std::numeric_limits<float>::max();
+    for (int a = 0; a < 3; ++a)
+    {
+        if (scale[a] == 0.0f)
+            continue;
+        const Bin *bins = binning.bins[a];
+        float leftArea[BINS - 1];
+        uint32_t leftCount[BINS - 1];
+        Bounds box;
+        uint32_t sum = 0;
+        for (int i = 0; i < BINS - 1; ++i)
+        {
+            box.grow(bins[i].bounds);
+            sum += bins[i].count;
+            leftArea[i] = box.area();
+            leftCount[i] = sum;
+        }
+        box = Bounds{};
+        sum = 0;
+        for (int i = BINS - 1; i > 0; --i)
+        {
+            box.grow(bins[i].bounds);
+            sum += bins[i].count;
+            float cost = leftCount[i - 1] * leftArea[i - 1] + sum * box.area();
+            if (leftCount[i - 1] > 0 && sum > 0 && cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = a;
+                bestSplit = i;
+            }
+        }
+    }
+
+    uint32_t mid;
+    // Cost of a leaf vs. one traversal step plus the children's expected
+    // intersection work, both in units of the node's surface area.
+    const float leafCost = count * nodeBounds.area();
+    bestCost += TRAVERSAL_COST * nodeBounds.area();
+    // Deep trees are split at the median so traversal stacks stay bounded.
+    const bool forceMedian = depth >= 64 || bestAxis < 0;
+    if (forceMedian)
+    {
+        if (count <= MAX_LEAF_SIZE && bestAxis < 0)
+            return;
+        int axis = 0;
+        for (int a = 1; a < 3; ++a)
+            if (nodeBounds.max[a] - nodeBounds.min[a] >
+                nodeBounds.max[axis] - nodeBounds.min[axis])
+                axis = a;
+        mid = first + count / 2;
+        std::nth_element(indices_.begin() + first,
+                         indices_.begin() + mid,
+                         indices_.begin() + first + count,
+                         [&](uint32_t l, uint32_t r) {
+                             return coord(centroids_[l], axis) <
+                                    coord(centroids_[r], axis);
+                         });
+    }
+    else
+    {
+        if (bestCost >= leafCost && count <= MAX_LEAF_SIZE)
+            return;
+        auto *it = std::partition(indices_.data() + first,
+                                  indices_.data() + first + count,
+                                  [&](uint32_t i) {
+                                      return binOf(centroids_[i], bestAxis) <
+                                             bestSplit;
+                                  });
+        mid = static_cast<uint32_t>(it - indices_.data());
+    }
+
+    // Children are allocated as a pair; concurrent subtrees share the
+    // counter.
+    const uint32_t left = std::atomic_ref<uint32_t>(nodesUsed_).fetch_add(2);
+    nodes_[left].leftFirst = first;
+    nodes_[left].count = mid - first;
+    nodes_[left + 1].leftFirst = mid;
+    nodes_[left + 1].count = first + count - mid;
+    node.leftFirst = left;
+    node.count = 0;
+
+    const bool spawn = count >= PARALLEL_THRESHOLD &&
+                       (1u << std::min(depth, 31)) < parallelism();
+    if (spawn)
+    {
+        parallelInvoke([&]() { subdivide(left, depth + 1); },
+                       [&]() { subdivide(left + 1, depth + 1); });
+    }
+    else
+    {
+        subdivide(left, depth + 1);
+        subdivide(left + 1, depth + 1);
+    }
+}
+
+bool BVH::closestHit(const Ray &ray,
+                     float tmax,
+                     uint32_t &index,
+                     float &t) const
+{
+    if (nodes_.empty())
+        return false;
+    const InvRay r = prepare(ray);
+    bool hit = false;
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    float tnode;
+    if (!slab(r, nodes_[0].min, nodes_[0].max, tmax, tnode))
+        return false;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const BVHNode &n = nodes_[stack[--top]];
+        if (n.isLeaf())
+        {
+            for (uint32_t i = n.leftFirst; i < n.leftFirst + n.count; ++i)
+            {
+                const AABB3d &b = prims_[i];
+                const float mn[3] = {
+                    b.c.x - b.r[0], b.c.y - b.r[1], b.c.z - b.r[2]};
+                const float mx[3] = {
+                    b.c.x + b.r[0], b.c.y + b.r[1], b.c.z + b.r[2]};
+                float th;
+                if (slab(r, mn, mx, tmax, th))
+                {
+                    hit = true;
+                    tmax = th;
+                    index = indices_[i];
+                }
+            }
+            continue;
+        }
+        // Push the far child first so the near one is popped next.
+        float t0, t1;
+        bool h0 = slab(r, nodes_[n.leftFirst].min, nodes_[n.leftFirst].max,
+                       tmax, t0);
+        bool h1 = slab(r, nodes_[n.leftFirst + 1].min,
+                       nodes_[n.leftFirst + 1].max, tmax, t1);
+        if (h0 && h1)
+        {
+            const bool leftNear = t0 <= t1;
+            stack[top++] = leftNear ? n.leftFirst + 1 : n.leftFirst;
+            stack[top++] = leftNear ? n.leftFirst : n.leftFirst + 1;
+        }
+        else if (h0)
+        {
+            stack[top++] = n.leftFirst;
+        }
+        else if (h1)
+        {
+            stack[top++] = n.leftFirst + 1;
+        }
+    }
+    if (hit)
+        t = tmax;
+    return hit;
+}
+
+uint32_t BVH::closestHit(std::span<const Triangle3d> triangles,
+                         RayPacket &packet,
+                         uint32_t (&index)[RayPacket::WIDTH]) const
+{
+    if (nodes_.empty())
+        return 0;
+    uint32_t hits = 0;
+    float t[RayPacket::WIDTH], u[RayPacket::WIDTH], v[RayPacket::WIDTH];
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    if (intersection(packet, nodes_[0].min, nodes_[0].max, t) == 0)
+        return 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const BVHNode &n = nodes_[stack[--top]];
+        if (n.isLeaf())
+        {
+            for (uint32_t i = n.leftFirst; i < n.leftFirst + n.count; ++i)
+            {
+                const uint32_t j = indices_[i];
+                uint32_t mask = intersection(packet, triangles[j], t, u, v);
+                hits |= mask;
+                for (; mask; mask &= mask - 1)
+                {
+                    const int lane = std::countr_zero(mask);
+                    packet.tmax[lane] = t[lane];
+                    index[lane] = j;
+                }
+            }
+            continue;
+        }
+        // Near child first, judged by the lowest lane entering both
+        float t0[RayPacket::WIDTH], t1[RayPacket::WIDTH];
+        const BVHNode &c0 = nodes_[n.leftFirst], &c1 = nodes_[n.leftFirst + 1];
+        const uint32_t h0 = intersection(packet, c0.min, c0.max, t0);
+        const uint32_t h1 = intersection(packet, c1.min, c1.max, t1);
+        if (h0 && h1)
+        {
+            const uint32_t both = h0 & h1;
+            const int lane = std::countr_zero(both ? both : h0);
+            const bool leftNear = !both || t0[lane] <= t1[lane];
+            stack[top++] = leftNear ? n.leftFirst + 1 : n.leftFirst;
+            stack[top++] = leftNear ? n.leftFirst : n.leftFirst + 1;
+        }
+        else if (h0)
+        {
+            stack[top++] = n.leftFirst;
+        }
+        else if (h1)
+        {
+            stack[top++] = n.leftFirst + 1;
+        }
+    }
+    return hits;
+}
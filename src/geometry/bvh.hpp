@@ -0,0 +1,259 @@
+#ifndef BVH_HPP_INCLUDED
+#define BVH_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include "geometry.hpp"
+#include "ray.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+// 32-byte flattened node, two per cache line. Interior nodes keep their
+// children side by side at 'leftFirst' and 'leftFirst + 1'; leaves reference
+// the primitive range [leftFirst, leftFirst + count).
+struct alignas(32) BVHNode
+{
+    float min[3];
+    uint32_t leftFirst;
+    float max[3];
+    uint32_t count;
+
+    bool isLeaf() const
+    {
+        return count > 0;
+    }
+};
+
+static_assert(sizeof(BVHNode) == 32, "BVHNode must stay 32 bytes");
+
+// Static bounding volume hierarchy over a set of AABBs, built top-down with
+// a binned surface area heuristic. Queries report the index of every
+// primitive (in the span given to build()) whose box passes the test.
+class BVH
+{
+public:
+    static constexpr int BINS = 16;
+    static constexpr uint32_t MAX_LEAF_SIZE = 4;
+
+    void build(std::span<const AABB3d> boxes);
+    // Spheres are stored by their bounding boxes. Callers needing an exact
+    // sphere test run it on the reported candidates.
+    void build(std::span<const Sphere> spheres);
+    // Triangles are stored by their bounding boxes too.
+    void build(std::span<const Triangle3d> triangles);
+    // Linear BVH: sort the primitives along a Morton curve through their
+    // centers and emit every interior node independently (Karras 2012).
+    // Much faster to build than the SAH tree, but with looser nodes and one
+    // primitive per leaf. 'mortonBits' is 30 or 63.
+    void buildLinear(std::span<const AABB3d> boxes, int mortonBits = 30);
+
+    bool empty() const
+    {
+        return indices_.empty();
+    }
+
+    size_t size() const
+    {
+        return indices_.size();
+    }
+
+    std::span<const BVHNode> nodes() const
+    {
+        return nodes_;
+    }
+
+    // Calls f(index) for every primitive overlapping 'box'.
+    template<typename F>
+    void query(const AABB3d &box, F &&f) const;
+
+    // Calls f(index) for every primitive containing 'p'.
+    template<typename F>
+    void query(const Point3d &p, F &&f) const;
+
+    // Calls f(index, t) for every primitive whose box the ray enters at some
+    // t in [0, tmax]. Primitives are visited in no particular order.
+    template<typename F>
+    void raycast(const Ray &ray, float tmax, F &&f) const;
+
+    // Nearest primitive box hit by the ray within [0, tmax]. Children are
+    // visited front to back so that far subtrees are culled early.
+    bool closestHit(const Ray &ray,
+                    float tmax,
+                    uint32_t &index,
+                    float &t) const;
+
+    // Packet versions: one traversal serves all rays of the packet, a node
+    // being skipped once none of them enters it. Calls f(index, mask) for
+    // every primitive whose box some ray enters within its tmax, bit i of
+    // 'mask' standing for lane i.
+    template<typename F>
+    void raycast(const RayPacket &packet, F &&f) const;
+
+    // For a tree built from 'triangles': the nearest triangle each ray of
+    // the packet hits. Lanes that hit get their tmax shrunk to the hit and
+    // their index set; returns the mask of these lanes.
+    uint32_t closestHit(std::span<const Triangle3d> triangles,
+                        RayPacket &packet,
+                        uint32_t (&index)[RayPacket::WIDTH]) const;
+
+private:
+    static constexpr int STACK_SIZE = 128;
+
+    struct InvRay
+    {
+        float o[3];
+        float inv[3];
+    };
+
+    static InvRay prepare(const Ray &ray);
+    static bool slab(const InvRay &r,
+                     const float (&mn)[3],
+                     const float (&mx)[3],
+                     float tmax,
+                     float &tenter);
+
+    static bool overlaps(const BVHNode &n,
+                         const float (&mn)[3],
+                         const float (&mx)[3])
+    {
+        return n.min[0] <= mx[0] && n.max[0] >= mn[0] && n.min[1] <= mx[1] &&
+               n.max[1] >= mn[1] && n.min[2] <= mx[2] && n.max[2] >= mn[2];
+    }
+
+    void subdivide(uint32_t node, int depth);
+
+    std::vector<BVHNode> nodes_;
+    // Primitive boxes stored in leaf order, and their original indices.
+    std::vector<AABB3d> prims_;
+    std::vector<uint32_t> indices_;
+    // Build-time scratch.
+    std::vector<Point3d> centroids_;
+    uint32_t nodesUsed_ = 0;
+};
+
+inline BVH::InvRay BVH::prepare(const Ray &ray)
+{
+    // IEEE division gives +-inf for axis-parallel rays, which the slab test
+    // below handles without special cases.
+    return {{ray.o.x, ray.o.y, ray.o.z},
+            {1.0f / ray.d.x, 1.0f / ray.d.y, 1.0f / ray.d.z}};
+}
+
+inline bool BVH::slab(const InvRay &r,
+                      const float (&mn)[3],
+                      const float (&mx)[3],
+                      float tmax,
+                      float &tenter)
+{
+    float tmin = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        float t1 = (mn[i] - r.o[i]) * r.inv[i];
+        float t2 = (mx[i] - r.o[i]) * r.inv[i];
+        // NaN (0 * inf) comparisons fall through and keep the slab open.
+        tmin = std::max(tmin, std::min(t1, t2));
+        tmax = std::min(tmax, std::max(t1, t2));
+    }
+    tenter = tmin;
+    return tmin <= tmax;
+}
+
+template<typename F>
+void BVH::query(const AABB3d &box, F &&f) const
+{
+    if (nodes_.empty())
+        return;
+    const float mn[3] = {
+        box.c.x - box.r[0], box.c.y - box.r[1], box.c.z - box.r[2]};
+    const float mx[3] = {
+        box.c.x + box.r[0], box.c.y + box.r[1], box.c.z + box.r[2]};
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const BVHNode &n = nodes_[stack[--top]];
+        if (!overlaps(n, mn, mx))
+            continue;
+        if (n.isLeaf())
+        {
+            for (uint32_t i = n.leftFirst; i < n.leftFirst + n.count; ++i)
+                if (intersection(prims_[i], box))
+                    f(indices_[i]);
+            continue;
+        }
+        stack[top++] = n.leftFirst + 1;
+        stack[top++] = n.leftFirst;
+    }
+}
+
+template<typename F>
+void BVH::query(const Point3d &p, F &&f) const
+{
+    query(AABB3d{p, {0.0f, 0.0f, 0.0f}}, std::forward<F>(f));
+}
+
+template<typename F>
+void BVH::raycast(const Ray &ray, float tmax, F &&f) const
+{
+    if (nodes_.empty())
+        return;
+    const InvRay r = prepare(ray);
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    float t;
+    while (top > 0)
+    {
+        const BVHNode &n = nodes_[stack[--top]];
+        if (!slab(r, n.min, n.max, tmax, t))
+            continue;
+        if (n.isLeaf())
+        {
+            for (uint32_t i = n.leftFirst; i < n.leftFirst + n.count; ++i)
+            {
+                const AABB3d &b = prims_[i];
+                const float mn[3] = {
+                    b.c.x - b.r[0], b.c.y - b.r[1], b.c.z - b.r[2]};
+                const float mx[3] = {
+                    b.c.x + b.r[0], b.c.y + b.r[1], b.c.z + b.r[2]};
+                if (slab(r, mn, mx, tmax, t))
+                    f(indices_[i], t);
+            }
+            continue;
+        }
+        stack[top++] = n.leftFirst + 1;
+        stack[top++] = n.leftFirst;
+    }
+}
+
+template<typename F>
+void BVH::raycast(const RayPacket &packet, F &&f) const
+{
+    if (nodes_.empty())
+        return;
+    float t[RayPacket::WIDTH];
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const BVHNode &n = nodes_[stack[--top]];
+        if (intersection(packet, n.min, n.max, t) == 0)
+            continue;
+        if (n.isLeaf())
+        {
+            for (uint32_t i = n.leftFirst; i < n.leftFirst + n.count; ++i)
+                if (const uint32_t mask = intersection(packet, prims_[i], t))
+                    f(indices_[i], mask);
+            continue;
+        }
+        stack[top++] = n.leftFirst + 1;
+        stack[top++] = n.leftFirst;
+    }
+}
+
+#endif
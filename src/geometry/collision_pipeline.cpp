@@ -0,0 +1,137 @@
+#include "collision_pipeline.hpp"
+#include "geometry.hpp"
+#include "obb.hpp"
+#include "scheduler.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// Boxes handed to each thread at least when placing them in the world.
+static constexpr size_t REFIT_GRAIN = 1 << 12;
+
+static Point3d rotate(const float m[3][3], const Point3d &p)
+{
+    return {m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z,
+            m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z,
+            m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z};
+}
+
+// The box in its object's frame bounded by an AABB of that frame.
+static AABB3d localBox(const OBB3d &s)
+{
+    AABB3d b{s.c, {0.0f, 0.0f, 0.0f}};
+    for (int a = 0; a < 3; ++a)
+        for (int k = 0; k < 3; ++k)
+            b.r[a] += std::abs((&s.u[k].x)[a]) * s.e[k];
+    return b;
+}
+
+void CollisionPipeline::findContacts(size_t begin, size_t end, size_t block)
+{
+    std::vector<ContactPair> &out = blockContacts_[block];
+    out.clear();
+    size_t candidates = 0;
+
+    ScratchBuffer<OBB3d> a(BATCH), b(BATCH);
+    ScratchBuffer<ContactPair> ids(BATCH);
+    ScratchBuffer<uint8_t> hit(BATCH);
+    size_t count = 0;
+
+    auto flush = [&]() {
+        intersection(std::span<const OBB3d>(a.data(), count),
+                     std::span<const OBB3d>(b.data(), count),
+                     std::span<uint8_t>(hit.data(), count));
+        for (size_t k = 0; k < count; ++k)
+            if (hit[k])
+                out.push_back(ids[k]);
+        candidates += count;
+        count = 0;
+    };
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        const auto ia = static_cast<uint32_t>(i);
+        tree_.query(worldBoxes_[i], [&](uint32_t j) {
+            // Each pair once, from its lower index.
+            if (j <= ia)
+                return;
+            a[count] = world_[ia];
+            b[count] = world_[j];
+            ids[count] = {ia, j};
+            if (++count == BATCH)
+                flush();
+        });
+    }
+    if (count > 0)
+        flush();
+
+    // The tree reports candidates in no particular order.
+    std::sort(out.begin(), out.end(), [](ContactPair x, ContactPair y) {
+        return x.a != y.a ? x.a < y.a : x.b < y.b;
+    });
+    blockCandidates_[block] = candidates;
+}
+
+std::span<const ContactPair>
+CollisionPipeline::run(std::span<const OBB3d> shapes,
+                       std::span<const Transform3d> xf)
+{
+    assert(shapes.size() == xf.size());
+    const size_t n = shapes.size();
+    Scheduler &s = Scheduler::global();
+
+    // Refit.
+    localBoxes_.resize(n);
+    worldBoxes_.resize(n);
+    world_.resize(n);
+    s.parallelFor(
+        0,
+        n,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+            {
+                const OBB3d &sh = shapes[i];
+                OBB3d &w = world_[i];
+                w.c = rotate(xf[i].m, sh.c);
+                w.c = {w.c.x + xf[i].t[0],
+                       w.c.y + xf[i].t[1],
+                       w.c.z + xf[i].t[2]};
+                for (int k = 0; k < 3; ++k)
+                {
+                    w.u[k] = rotate(xf[i].m, sh.u[k]);
+                    w.e[k] = sh.e[k];
+                }
+                localBoxes_[i] = localBox(sh);
+            }
+        },
+        REFIT_GRAIN);
+    UpdateAABB(localBoxes_, xf, worldBoxes_, true);
+
+    // Broadphase structure.
+    tree_.buildLinear(worldBoxes_);
+
+    // Broadphase, midphase and narrowphase, block by block.
+    const size_t blocks = (n + BLOCK - 1) / BLOCK;
+    if (blockContacts_.size() < blocks)
+        blockContacts_.resize(blocks);
+    blockCandidates_.assign(blocks, 0);
+    s.parallelFor(
+        0,
+        blocks,
+        [&](size_t first, size_t last) {
+            for (size_t k = first; k < last; ++k)
+                findContacts(k * BLOCK, std::min(n, (k + 1) * BLOCK), k);
+        },
+        1);
+
+    contacts_.clear();
+    candidates_ = 0;
+    for (size_t k = 0; k < blocks; ++k)
+    {
+        contacts_.insert(contacts_.end(),
+                         blockContacts_[k].begin(),
+                         blockContacts_[k].end());
+        candidates_ += blockCandidates_[k];
+    }
+    return contacts_;
+}
@@ -0,0 +1,80 @@
+#ifndef COLLISION_PIPELINE_HPP_INCLUDED
+#define COLLISION_PIPELINE_HPP_INCLUDED
+
+#include "bvh.hpp"
+#include "geom_structs.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Two objects whose boxes intersect, a < b.
+struct ContactPair
+{
+    uint32_t a;
+    uint32_t b;
+};
+
+// Every intersecting pair among moving oriented boxes, in four stages:
+//  1. refit: the boxes are placed in the world and their AABBs updated with
+//     the batched UpdateAABB(),
+//  2. broadphase: a linear BVH over the world AABBs is queried with each
+//     object's AABB,
+//  3. midphase: the candidate pairs are gathered into contiguous batches of
+//     BATCH boxes,
+//  4. narrowphase: each batch goes through the SIMD intersection() of OBB
+//     spans and the hits are emitted.
+// Objects are split into blocks of BLOCK, and every block runs stages 2 to
+// 4 as one task on Scheduler::global(), so a block's candidates are tested
+// while they are in cache and one block's narrowphase overlaps other
+// blocks' broadphase on other threads. Batches live in per-thread scratch
+// arenas and every buffer is kept from one run to the next, so a run at a
+// steady object count does not allocate outside building the BVH.
+class CollisionPipeline
+{
+public:
+    static constexpr size_t BLOCK = 256;
+    static constexpr size_t BATCH = 256;
+
+    // Box i is shapes[i] in its object's frame, placed in the world by
+    // xf[i], whose m must be a rotation. Returns the intersecting pairs in
+    // order of a, then of b; valid until the next run().
+    std::span<const ContactPair> run(std::span<const OBB3d> shapes,
+                                     std::span<const Transform3d> xf);
+
+    std::span<const ContactPair> contacts() const
+    {
+        return contacts_;
+    }
+
+    // Pairs that passed the broadphase in the last run.
+    size_t candidateCount() const
+    {
+        return candidates_;
+    }
+
+    // The world boxes of the last run.
+    std::span<const OBB3d> worldShapes() const
+    {
+        return world_;
+    }
+
+    std::span<const AABB3d> worldBoxes() const
+    {
+        return worldBoxes_;
+    }
+
+private:
+    // Stages 2 to 4 for objects [begin, end).
+    void findContacts(size_t begin, size_t end, size_t block);
+
+    std::vector<AABB3d> localBoxes_;
+    std::vector<AABB3d> worldBoxes_;
+    std::vector<OBB3d> world_;
+    BVH tree_;
+    std::vector<std::vector<ContactPair>> blockContacts_;
+    std::vector<size_t> blockCandidates_;
+    std::vector<ContactPair> contacts_;
+    size_t candidates_ = 0;
+};
+
+#endif
@@ -0,0 +1,433 @@
+#include "dense_matrix.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// The product follows the usual blocked GEMM scheme. For each KC-deep slice
+// of the inner dimension, an NC-wide panel of b is packed into NR-wide
+// strips and an MC-tall block of a into MR-tall strips, both laid out in the
+// order the micro-kernel reads them. The micro-kernel then accumulates an
+// MR x NR tile of c in registers across the whole slice. MC * KC elements
+// of a fit in L2 and KC * NR of b in L1.
+namespace
+{
+template<typename T>
+struct Blocking;
+
+template<>
+struct Blocking<float>
+{
+    static constexpr size_t MR = 6, NR = 16, KC = 256, MC = 120, NC = 2048;
+};
+
+template<>
+struct Blocking<double>
+{
+    static constexpr size_t MR = 6, NR = 8, KC = 256, MC = 60, NC = 1024;
+};
+
+template<typename T>
+using Kernel = void (*)(size_t kc, const T *a, const T *b, T *c, size_t ldc);
+
+// c[MR][NR] (row stride ldc) += a * b over kc packed steps.
+template<typename T>
+void kernelScalar(size_t kc, const T *a, const T *b, T *c, size_t ldc)
+{
+    constexpr size_t MR = Blocking<T>::MR, NR = Blocking<T>::NR;
+    T acc[MR][NR] = {};
+    for (size_t k = 0; k < kc; ++k, a += MR, b += NR)
+        for (size_t i = 0; i < MR; ++i)
+            for (size_t j = 0; j < NR; ++j)
+                acc[i][j] += a[i] * b[j];
+    for (size_t i = 0; i < MR; ++i)
+        for (size_t j = 0; j < NR; ++j)
+            c[i * ldc + j] += acc[i][j];
+}
+
+#ifdef GEOMETRY_X86
+
+// Twelve accumulators: six rows of two registers each.
+GEOMETRY_AVX2 void
+kernelAvx2(size_t kc, const float *a, const float *b, float *c, size_t ldc)
+{
+    __m256 acc[6][2];
+    for (auto &row : acc)
+        row[0] = row[1] = _mm256_setzero_ps();
+    for (size_t k = 0; k < kc; ++k, a += 6, b += 16)
+    {
+        const __m256 b0 = _mm256_loadu_ps(b), b1 = _mm256_loadu_ps(b + 8);
+        for (int i = 0; i < 6; ++i)
+        {
+            const __m256 ai = _mm256_broadcast_ss(a + i);
+            acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+        }
+    }
+    for (int i = 0; i < 6; ++i)
+    {
+        float *ci = c + i * ldc;
+        _mm256_storeu_ps(ci, _mm256_add_ps(_mm256_loadu_ps(ci), acc[i][0]));
+        _mm256_storeu_ps(ci + 8,
+                         _mm256_add_ps(_mm256_loadu_ps(ci + 8), acc[i][1]));
+    }
+}
+
+GEOMETRY_AVX2 void
+kernelAvx2(size_t kc, const double *a, const double *b, double *c, size_t ldc)
+{
+    __m256d acc[6][2];
+    for (auto &row : acc)
+        row[0] = row[1] = _mm256_setzero_pd();
+    for (size_t k = 0; k < kc; ++k, a += 6, b += 8)
+    {
+        const __m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+        for (int i = 0; i < 6; ++i)
+        {
+            const __m256d ai = _mm256_broadcast_sd(a + i);
+            acc[i][0] = _mm256_fmadd_pd(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_pd(ai, b1, acc[i][1]);
+        }
+    }
+    for (int i = 0; i < 6; ++i)
+    {
+        double *ci = c + i * ldc;
+        _mm256_storeu_pd(ci, _mm256_add_pd(_mm256_loadu_pd(ci), acc[i][0]));
+        _mm256_storeu_pd(ci + 4,
+                         _mm256_add_pd(_mm256_loadu_pd(ci + 4), acc[i][1]));
+    }
+}
+
+#endif
+
+// Pack the mc x kc block a (row stride lda) into MR-tall strips, each
+// stored column by column and multiplied by 'scale', the last strip padded
+// with zeros.
+template<typename T>
+void packA(const T *a, size_t lda, size_t mc, size_t kc, T scale, T *out)
+{
+    constexpr size_t MR = Blocking<T>::MR;
+    for (size_t ir = 0; ir < mc; ir += MR)
+    {
+        const size_t mr = std::min(MR, mc - ir);
+        for (size_t k = 0; k < kc; ++k, out += MR)
+        {
+            size_t i = 0;
+            for (; i < mr; ++i)
+                out[i] = scale * a[(ir + i) * lda + k];
+            for (; i < MR; ++i)
+                out[i] = T(0);
+        }
+    }
+}
+
+// Pack the kc x nc block b (row stride ldb), or the transpose of the
+// nc x kc block at b, into NR-wide strips, each stored row by row, the
+// last strip padded with zeros.
+template<typename T>
+void packB(const T *b, size_t ldb, bool trans, size_t kc, size_t nc, T *out)
+{
+    constexpr size_t NR = Blocking<T>::NR;
+    for (size_t jr = 0; jr < nc; jr += NR)
+    {
+        const size_t nr = std::min(NR, nc - jr);
+        for (size_t k = 0; k < kc; ++k, out += NR)
+        {
+            size_t j = 0;
+            if (trans)
+                for (; j < nr; ++j)
+                    out[j] = b[(jr + j) * ldb + k];
+            else
+                for (; j < nr; ++j)
+                    out[j] = b[k * ldb + jr + j];
+            for (; j < NR; ++j)
+                out[j] = T(0);
+        }
+    }
+}
+
+// The MC x NC block of c at (i0, j0) += packed a * packed b. Edge tiles go
+// through a scratch tile so the kernel always works on full MR x NR tiles.
+template<typename T>
+void macroKernel(Kernel<T> kernel,
+                 size_t mc,
+                 size_t nc,
+                 size_t kc,
+                 const T *pa,
+                 const T *pb,
+                 T *c,
+                 size_t ldc)
+{
+    constexpr size_t MR = Blocking<T>::MR, NR = Blocking<T>::NR;
+    for (size_t jr = 0; jr < nc; jr += NR)
+    {
+        const size_t nr = std::min(NR, nc - jr);
+        for (size_t ir = 0; ir < mc; ir += MR)
+        {
+            const size_t mr = std::min(MR, mc - ir);
+            const T *a = pa + ir * kc, *b = pb + jr * kc;
+            T *tile = c + ir * ldc + jr;
+            if (mr == MR && nr == NR)
+            {
+                kernel(kc, a, b, tile, ldc);
+                continue;
+            }
+            T edge[MR * NR] = {};
+            kernel(kc, a, b, edge, NR);
+            for (size_t i = 0; i < mr; ++i)
+                for (size_t j = 0; j < nr; ++j)
+                    tile[i * ldc + j] += edge[i * NR + j];
+        }
+    }
+}
+
+// c += scale * a * b for the m x k block a, the k x n block b (or, with
+// transB, the transpose of the n x k block b) and the m x n block c, each
+// given by its first element and row stride.
+template<typename T>
+void gemm(size_t m,
+          size_t n,
+          size_t k,
+          T scale,
+          const T *a,
+          size_t lda,
+          const T *b,
+          size_t ldb,
+          bool transB,
+          T *c,
+          size_t ldc,
+          bool parallel)
+{
+    using B = Blocking<T>;
+    if (m == 0 || n == 0 || k == 0)
+        return;
+
+    Kernel<T> kernel = kernelScalar<T>;
+#ifdef GEOMETRY_X86
+    if (cpuHasAvx2())
+        kernel = kernelAvx2;
+#endif
+
+    const size_t panel = std::min(B::NC, (n + B::NR - 1) / B::NR * B::NR);
+    std::vector<T> pb(B::KC * panel);
+    const size_t blocks = (m + B::MC - 1) / B::MC;
+    for (size_t jc = 0; jc < n; jc += B::NC)
+    {
+        const size_t nc = std::min(B::NC, n - jc);
+        for (size_t pc = 0; pc < k; pc += B::KC)
+        {
+            const size_t kc = std::min(B::KC, k - pc);
+            packB(transB ? b + jc * ldb + pc : b + pc * ldb + jc,
+                  ldb,
+                  transB,
+                  kc,
+                  nc,
+                  pb.data());
+            // Each task packs its own blocks of a; they write disjoint rows
+            // of c.
+            auto rows = [&](size_t first, size_t last) {
+                std::vector<T> pa(B::MC * kc);
+                for (size_t blk = first; blk < last; ++blk)
+                {
+                    const size_t ic = blk * B::MC;
+                    const size_t mc = std::min(B::MC, m - ic);
+                    packA(a + ic * lda + pc, lda, mc, kc, scale, pa.data());
+                    macroKernel(kernel, mc, nc, kc, pa.data(), pb.data(),
+                                c + ic * ldc + jc, ldc);
+                }
+            };
+            if (parallel)
+                parallelFor(blocks, 1, rows);
+            else
+                rows(0, blocks);
+        }
+    }
+}
+} // namespace
+
+template<typename T>
+void mult(const DenseMatrix<T> &a,
+          const DenseMatrix<T> &b,
+          DenseMatrix<T> &c,
+          bool parallel)
+{
+    assert(a.cols() == b.rows());
+    assert(&c != &a && &c != &b);
+    c.resize(a.rows(), b.cols());
+    gemm(a.rows(), b.cols(), a.cols(), T(1), a.data(), a.cols(), b.data(),
+         b.cols(), false, c.data(), c.cols(), parallel);
+}
+
+// Columns per panel of the blocked factorizations: the panel is factored
+// by plain loops and the rest of the matrix updated through gemm().
+static constexpr size_t FACTOR_BLOCK = 64;
+
+template<typename T>
+bool luDecompose(DenseMatrix<T> &a, std::vector<size_t> &pivot, bool parallel)
+{
+    assert(a.rows() == a.cols());
+    const size_t n = a.rows();
+    pivot.resize(n);
+    for (size_t j0 = 0; j0 < n; j0 += FACTOR_BLOCK)
+    {
+        const size_t jb = std::min(FACTOR_BLOCK, n - j0), j1 = j0 + jb;
+        // Factor the panel of columns [j0, j1), swapping whole rows
+        for (size_t j = j0; j < j1; ++j)
+        {
+            size_t p = j;
+            for (size_t i = j + 1; i < n; ++i)
+                if (std::abs(a[i][j]) > std::abs(a[p][j]))
+                    p = i;
+            pivot[j] = p;
+            if (a[p][j] == T(0))
+                return false;
+            if (p != j)
+                std::swap_ranges(a[j], a[j] + n, a[p]);
+            const T inv = T(1) / a[j][j];
+            for (size_t i = j + 1; i < n; ++i)
+            {
+                const T l = a[i][j] *= inv;
+                for (size_t k = j + 1; k < j1; ++k)
+                    a[i][k] -= l * a[j][k];
+            }
+        }
+        if (j1 == n)
+            break;
+        // U12 = L11^-1 A12, then A22 -= L21 U12
+        for (size_t i = j0 + 1; i < j1; ++i)
+            for (size_t k = j0; k < i; ++k)
+            {
+                const T l = a[i][k];
+                for (size_t c = j1; c < n; ++c)
+                    a[i][c] -= l * a[k][c];
+            }
+        gemm(n - j1, n - j1, jb, T(-1), a[j1] + j0, n, a[j0] + j1, n, false,
+             a[j1] + j1, n, parallel);
+    }
+    return true;
+}
+
+template<typename T>
+void luSolve(const DenseMatrix<T> &lu,
+             const std::vector<size_t> &pivot,
+             DenseMatrix<T> &b)
+{
+    assert(lu.rows() == b.rows());
+    const size_t n = lu.rows(), m = b.cols();
+    for (size_t i = 0; i < n; ++i)
+        if (pivot[i] != i)
+            std::swap_ranges(b[i], b[i] + m, b[pivot[i]]);
+    // L y = P b, then U x = y, a row of b at a time
+    for (size_t i = 0; i < n; ++i)
+        for (size_t k = 0; k < i; ++k)
+        {
+            const T l = lu[i][k];
+            for (size_t c = 0; c < m; ++c)
+                b[i][c] -= l * b[k][c];
+        }
+    for (size_t i = n; i-- > 0;)
+    {
+        for (size_t k = i + 1; k < n; ++k)
+        {
+            const T u = lu[i][k];
+            for (size_t c = 0; c < m; ++c)
+                b[i][c] -= u * b[k][c];
+        }
+        const T inv = T(1) / lu[i][i];
+        for (size_t c = 0; c < m; ++c)
+            b[i][c] *= inv;
+    }
+}
+
+template<typename T>
+bool cholesky(DenseMatrix<T> &a, bool parallel)
+{
+    assert(a.rows() == a.cols());
+    const size_t n = a.rows();
+    for (size_t j0 = 0; j0 < n; j0 += FACTOR_BLOCK)
+    {
+        const size_t jb = std::min(FACTOR_BLOCK, n - j0), j1 = j0 + jb;
+        // Factor the diagonal block and solve the panel below it against
+        // its transpose, column by column
+        for (size_t j = j0; j < j1; ++j)
+        {
+            T d = a[j][j];
+            for (size_t k = j0; k < j; ++k)
+                d -= a[j][k] * a[j][k];
+            if (!(d > T(0)))
+                return false;
+            a[j][j] = std::sqrt(d);
+            const T inv = T(1) / a[j][j];
+            for (size_t i = j + 1; i < n; ++i)
+            {
+                T v = a[i][j];
+                for (size_t k = j0; k < j; ++k)
+                    v -= a[i][k] * a[j][k];
+                a[i][j] = v * inv;
+            }
+        }
+        // A22 -= L21 L21^T, one block column of the lower triangle at a time
+        for (size_t c0 = j1; c0 < n; c0 += FACTOR_BLOCK)
+        {
+            const size_t cb = std::min(FACTOR_BLOCK, n - c0);
+            gemm(n - c0, cb, jb, T(-1), a[c0] + j0, n, a[c0] + j0, n, true,
+                 a[c0] + c0, n, parallel);
+        }
+    }
+    return true;
+}
+
+template<typename T>
+void choleskySolve(const DenseMatrix<T> &l, DenseMatrix<T> &b)
+{
+    assert(l.rows() == b.rows());
+    const size_t n = l.rows(), m = b.cols();
+    // L y = b, then L^T x = y
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t k = 0; k < i; ++k)
+        {
+            const T v = l[i][k];
+            for (size_t c = 0; c < m; ++c)
+                b[i][c] -= v * b[k][c];
+        }
+        const T inv = T(1) / l[i][i];
+        for (size_t c = 0; c < m; ++c)
+            b[i][c] *= inv;
+    }
+    for (size_t i = n; i-- > 0;)
+    {
+        const T inv = T(1) / l[i][i];
+        for (size_t c = 0; c < m; ++c)
+            b[i][c] *= inv;
+        for (size_t k = 0; k < i; ++k)
+        {
+            const T v = l[i][k];
+            for (size_t c = 0; c < m; ++c)
+                b[k][c] -= v * b[i][c];
+        }
+    }
+}
+
+template void mult(const DenseMatrix<float> &,
+                   const DenseMatrix<float> &,
+                   DenseMatrix<float> &,
+                   bool);
+template void mult(const DenseMatrix<double> &,
+                   const DenseMatrix<double> &,
+                   DenseMatrix<double> &,
+                   bool);
+template bool luDecompose(DenseMatrix<float> &, std::vector<size_t> &, bool);
+template bool luDecompose(DenseMatrix<double> &, std::vector<size_t> &, bool);
+template void luSolve(const DenseMatrix<float> &,
+                      const std::vector<size_t> &,
+                      DenseMatrix<float> &);
+template void luSolve(const DenseMatrix<double> &,
+                      const std::vector<size_t> &,
+                      DenseMatrix<double> &);
+template bool cholesky(DenseMatrix<float> &, bool);
+template bool cholesky(DenseMatrix<double> &, bool);
+template void choleskySolve(const DenseMatrix<float> &, DenseMatrix<float> &);
+template void choleskySolve(const DenseMatrix<double> &,
+                            DenseMatrix<double> &);
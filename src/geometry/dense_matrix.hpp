@@ -0,0 +1,133 @@
+#ifndef DENSE_MATRIX_HPP_INCLUDED
+#define DENSE_MATRIX_HPP_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+// Row-major matrix of runtime size, for the large products of covariance
+// and least-squares work where the fixed-size templates of math_utils.hpp
+// don't apply. Elements start at zero.
+template<typename T>
+class DenseMatrix
+{
+public:
+    DenseMatrix() = default;
+
+    DenseMatrix(size_t rows, size_t cols)
+        : rows_(rows), cols_(cols), data_(rows * cols)
+    {
+    }
+
+    size_t rows() const
+    {
+        return rows_;
+    }
+
+    size_t cols() const
+    {
+        return cols_;
+    }
+
+    // returns the pointer of the requested row.
+    T *operator[](size_t row)
+    {
+        return &data_[row * cols_];
+    }
+
+    const T *operator[](size_t row) const
+    {
+        return &data_[row * cols_];
+    }
+
+    T *data()
+    {
+        return data_.data();
+    }
+
+    const T *data() const
+    {
+        return data_.data();
+    }
+
+    // Change the shape, setting every element to zero.
+    void resize(size_t rows, size_t cols)
+    {
+        rows_ = rows;
+        cols_ = cols;
+        data_.assign(rows * cols, T(0));
+    }
+
+private:
+    size_t rows_ = 0;
+    size_t cols_ = 0;
+    std::vector<T> data_;
+};
+
+// c = a * b, with c resized to fit. Blocked so that a panel of b stays in
+// the last level cache and a block of a in L2 while a register-tiled
+// micro-kernel, AVX2 when the CPU has it, sweeps them; 'parallel' spreads
+// the blocks of a across threads. c must not be a or b.
+template<typename T>
+void mult(const DenseMatrix<T> &a,
+          const DenseMatrix<T> &b,
+          DenseMatrix<T> &c,
+          bool parallel = false);
+
+// In-place LU factorization with partial pivoting, P a = L U: afterwards
+// a holds U on and above the diagonal and the unit lower triangular L
+// below it, and pivot[i] is the row swapped with row i at step i. Panels
+// of columns are factored directly and the rest of the matrix updated as
+// a blocked product. Returns false, leaving a part-factored, if a is
+// singular.
+template<typename T>
+bool luDecompose(DenseMatrix<T> &a,
+                 std::vector<size_t> &pivot,
+                 bool parallel = false);
+
+// Overwrite the columns of b with the solutions x of a x = b, given the
+// factors of a from luDecompose().
+template<typename T>
+void luSolve(const DenseMatrix<T> &lu,
+             const std::vector<size_t> &pivot,
+             DenseMatrix<T> &b);
+
+// In-place Cholesky factorization a = L L^T of a symmetric positive
+// definite matrix, blocked like luDecompose(). Only the lower triangle of a
+// is read and L replaces it; the strict upper triangle is left as scratch.
+// Returns false if a is not positive definite.
+template<typename T>
+bool cholesky(DenseMatrix<T> &a, bool parallel = false);
+
+// Overwrite the columns of b with the solutions x of a x = b, given the
+// factor L of a from cholesky().
+template<typename T>
+void choleskySolve(const DenseMatrix<T> &l, DenseMatrix<T> &b);
+
+extern template void mult(const DenseMatrix<float> &,
+                          const DenseMatrix<float> &,
+                          DenseMatrix<float> &,
+                          bool);
+extern template void mult(const DenseMatrix<double> &,
+                          const DenseMatrix<double> &,
+                          DenseMatrix<double> &,
+                          bool);
+extern template bool luDecompose(DenseMatrix<float> &,
+                                 std::vector<size_t> &,
+                                 bool);
+extern template bool luDecompose(DenseMatrix<double> &,
+                                 std::vector<size_t> &,
+                                 bool);
+extern template void luSolve(const DenseMatrix<float> &,
+                             const std::vector<size_t> &,
+                             DenseMatrix<float> &);
+extern template void luSolve(const DenseMatrix<double> &,
+                             const std::vector<size_t> &,
+                             DenseMatrix<double> &);
+extern template bool cholesky(DenseMatrix<float> &, bool);
+extern template bool cholesky(DenseMatrix<double> &, bool);
+extern template void choleskySolve(const DenseMatrix<float> &,
+                                   DenseMatrix<float> &);
+extern template void choleskySolve(const DenseMatrix<double> &,
+                                   DenseMatrix<double> &);
+
+#endif
@@ -0,0 +1,443 @@
+#include "dynamic_tree.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static AABB3d combine(const AABB3d &a, const AABB3d &b)
+{
+    const float *ac = &a.c.x;
+    const float *bc = &b.c.x;
+    AABB3d r;
+    float *rc = &r.c.x;
+    for (int i = 0; i < 3; ++i)
+    {
+        float lo = std::min(ac[i] - a.r[i], bc[i] - b.r[i]);
+        float hi = std::max(ac[i] + a.r[i], bc[i] + b.r[i]);
+        rc[i] = 0.5f * (lo + hi);
+        r.r[i] = 0.5f * (hi - lo);
+    }
+    return r;
+}
+
+// Does 'a' enclose 'b'? The center/radius form loses an ulp or so in
+// combine(), which the tolerance absorbs.
+static bool contains(const AABB3d &a, const AABB3d &b)
+{
+    const float *ac = &a.c.x;
+    const float *bc = &b.c.x;
+    for (int i = 0; i < 3; ++i)
+    {
+        const float eps = 4.0f * std::numeric_limits<float>::epsilon() *
+                          (std::abs(ac[i]) + a.r[i]);
+        if (ac[i] - a.r[i] > bc[i] - b.r[i] + eps)
+            return false;
+        if (ac[i] + a.r[i] + eps < bc[i] + b.r[i])
+            return false;
+    }
+    return true;
+}
+
+// Surface area up to a constant factor.
+static float area(const AABB3d &a)
+{
+    return a.r[0] * a.r[1] + a.r[1] * a.r[2] + a.r[2] * a.r[0];
+}
+
+static AABB3d enlarge(AABB3d a, float margin)
+{
+    a.r[0] += margin;
+    a.r[1] += margin;
+    a.r[2] += margin;
+    return a;
+}
+
+DynamicAABBTree::DynamicAABBTree(float margin) : margin_(margin) {}
+
+int DynamicAABBTree::allocateNode()
+{
+    if (freeList_ == NULL_NODE)
+    {
+        // Grow the pool and thread the new nodes onto the free list.
+        const int oldCapacity = static_cast<int>(nodes_.size());
+        const int newCapacity = std::max(16, oldCapacity * 2);
+        nodes_.resize(newCapacity);
+        for (int i = oldCapacity; i < newCapacity; ++i)
+        {
+            nodes_[i].next = i + 1 < newCapacity ? i + 1 : NULL_NODE;
+            nodes_[i].height = -1;
+        }
+        freeList_ = oldCapacity;
+    }
+    const int id = freeList_;
+    TreeNode &n = nodes_[id];
+    freeList_ = n.next;
+    n.parent = NULL_NODE;
+    n.child1 = NULL_NODE;
+    n.child2 = NULL_NODE;
+    n.height = 0;
+    n.userData = 0;
+    ++nodeCount_;
+    return id;
+}
+
+void DynamicAABBTree::freeNode(int node)
+{
+    nodes_[node].next = freeList_;
+    nodes_[node].height = -1;
+    freeList_ = node;
+    --nodeCount_;
+}
+
+int DynamicAABBTree::createProxy(const AABB3d &box, uint32_t userData)
+{
+    const int id = allocateNode();
+    nodes_[id].box = enlarge(box, margin_);
+    nodes_[id].userData = userData;
+    insertLeaf(id);
+    return id;
+}
+
+void DynamicAABBTree::destroyProxy(int proxy)
+{
+    assert(nodes_[proxy].isLeaf());
+    removeLeaf(proxy);
+    freeNode(proxy);
+    // A pending refit may still reference the proxy.
+    std::erase(dirty_, proxy);
+}
+
+bool DynamicAABBTree::moveProxy(int proxy,
+                                const AABB3d &box,
+                                const Point3d &displacement)
+{
+    assert(nodes_[proxy].isLeaf());
+    const AABB3d &treeBox = nodes_[proxy].box;
+    if (contains(treeBox, box))
+    {
+        // Keep the proxy unless its fat box has become much larger than
+        // needed, which would produce too many false positives.
+        AABB3d huge = enlarge(box, 4.0f * margin_);
+        if (contains(huge, treeBox))
+            return false;
+    }
+
+    // Predict motion: stretch the box by the displacement, i.e. move the
+    // bound on the side of travel by d.
+    AABB3d fat = enlarge(box, margin_);
+    const float *d = &displacement.x;
+    float *c = &fat.c.x;
+    for (int i = 0; i < 3; ++i)
+    {
+        c[i] += 0.5f * d[i];
+        fat.r[i] += 0.5f * std::abs(d[i]);
+    }
+
+    removeLeaf(proxy);
+    nodes_[proxy].box = fat;
+    insertLeaf(proxy);
+    return true;
+}
+
+void DynamicAABBTree::updateProxy(int proxy,
+                                  const AABB3d &local,
+                                  const float m[3][3],
+                                  const float t[3])
+{
+    assert(nodes_[proxy].isLeaf());
+    AABB3d world;
+    UpdateAABB(local, m, t, world);
+    TreeNode &leaf = nodes_[proxy];
+    if (contains(leaf.box, world))
+        return;
+    leaf.box = enlarge(world, margin_);
+    dirty_.push_back(proxy);
+}
+
+void DynamicAABBTree::refit()
+{
+    for (int leaf : dirty_)
+    {
+        // Walk up while the parent no longer encloses the grown child. Once
+        // it does, every further ancestor does too.
+        int child = leaf;
+        int p = nodes_[leaf].parent;
+        while (p != NULL_NODE && !contains(nodes_[p].box, nodes_[child].box))
+        {
+            TreeNode &n = nodes_[p];
+            n.box = combine(nodes_[n.child1].box, nodes_[n.child2].box);
+            child = p;
+            p = n.parent;
+        }
+    }
+    dirty_.clear();
+}
+
+void DynamicAABBTree::insertLeaf(int leaf)
+{
+    if (root_ == NULL_NODE)
+    {
+        root_ = leaf;
+        nodes_[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Find the best sibling by descending towards the child whose enlarged
+    // area grows least, accounting for the growth inherited by ancestors.
+    const AABB3d leafBox = nodes_[leaf].box;
+    int index = root_;
+    while (!nodes_[index].isLeaf())
+    {
+        const int child1 = nodes_[index].child1;
+        const int child2 = nodes_[index].child2;
+
+        const float a = area(nodes_[index].box);
+        const float combinedArea = area(combine(nodes_[index].box, leafBox));
+
+        // Cost of creating a new parent for this node and the new leaf.
+        const float cost = 2.0f * combinedArea;
+        // Minimum cost of pushing the leaf further down the tree.
+        const float inheritanceCost = 2.0f * (combinedArea - a);
+
+        auto descendCost = [&](int child) {
+            const AABB3d &cb = nodes_[child].box;
+            const float grown = area(combine(leafBox, cb));
+            if (nodes_[child].isLeaf())
+                return grown + inheritanceCost;
+            return grown - area(cb) + inheritanceCost;
+        };
+        const float cost1 = descendCost(child1);
+        const float cost2 = descendCost(child2);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+        index = cost1 < cost2 ? child1 : child2;
+    }
+    const int sibling = index;
+
+    // Create a new parent for the sibling and the leaf.
+    const int oldParent = nodes_[sibling].parent;
+    const int newParent = allocateNode();
+    nodes_[newParent].parent = oldParent;
+    nodes_[newParent].box = combine(leafBox, nodes_[sibling].box);
+    nodes_[newParent].height = nodes_[sibling].height + 1;
+    nodes_[newParent].child1 = sibling;
+    nodes_[newParent].child2 = leaf;
+    nodes_[sibling].parent = newParent;
+    nodes_[leaf].parent = newParent;
+
+    if (oldParent != NULL_NODE)
+    {
+        if (nodes_[oldParent].child1 == sibling)
+            nodes_[oldParent].child1 = newParent;
+        else
+            nodes_[oldParent].child2 = newParent;
+    }
+    else
+    {
+        root_ = newParent;
+    }
+
+    // Walk back up fixing heights and boxes.
+    index = nodes_[leaf].parent;
+    while (index != NULL_NODE)
+    {
+        index = balance(index);
+        TreeNode &n = nodes_[index];
+        n.height = 1 + std::max(nodes_[n.child1].height,
+                                nodes_[n.child2].height);
+        n.box = combine(nodes_[n.child1].box, nodes_[n.child2].box);
+        index = n.parent;
+    }
+}
+
+void DynamicAABBTree::removeLeaf(int leaf)
+{
+    if (leaf == root_)
+    {
+        root_ = NULL_NODE;
+        return;
+    }
+
+    const int parent = nodes_[leaf].parent;
+    const int grandParent = nodes_[parent].parent;
+    const int sibling = nodes_[parent].child1 == leaf ? nodes_[parent].child2
+                                                      : nodes_[parent].child1;
+
+    if (grandParent == NULL_NODE)
+    {
+        root_ = sibling;
+        nodes_[sibling].parent = NULL_NODE;
+        freeNode(parent);
+        return;
+    }
+
+    // Replace the parent by the sibling and refit the ancestors.
+    if (nodes_[grandParent].child1 == parent)
+        nodes_[grandParent].child1 = sibling;
+    else
+        nodes_[grandParent].child2 = sibling;
+    nodes_[sibling].parent = grandParent;
+    freeNode(parent);
+
+    int index = grandParent;
+    while (index != NULL_NODE)
+    {
+        index = balance(index);
+        TreeNode &n = nodes_[index];
+        n.box = combine(nodes_[n.child1].box, nodes_[n.child2].box);
+        n.height = 1 + std::max(nodes_[n.child1].height,
+                                nodes_[n.child2].height);
+        index = n.parent;
+    }
+}
+
+// Perform a left or right rotation if node A is imbalanced and return the
+// index of the node now at its position. A's children are B and C, B's
+// are D and E, and C's are F and G.
+int DynamicAABBTree::balance(int iA)
+{
+    TreeNode &A = nodes_[iA];
+    if (A.isLeaf() || A.height < 2)
+        return iA;
+
+    const int iB = A.child1;
+    const int iC = A.child2;
+    TreeNode &B = nodes_[iB];
+    TreeNode &C = nodes_[iC];
+
+    const int diff = C.height - B.height;
+
+    // Rotate C up
+    if (diff > 1)
+    {
+        const int iF = C.child1;
+        const int iG = C.child2;
+        TreeNode &F = nodes_[iF];
+        TreeNode &G = nodes_[iG];
+
+        // Swap A and C
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+
+        // A's old parent should point to C
+        if (C.parent != NULL_NODE)
+        {
+            if (nodes_[C.parent].child1 == iA)
+                nodes_[C.parent].child1 = iC;
+            else
+                nodes_[C.parent].child2 = iC;
+        }
+        else
+        {
+            root_ = iC;
+        }
+
+        // Rotate
+        if (F.height > G.height)
+        {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            A.box = combine(B.box, G.box);
+            C.box = combine(A.box, F.box);
+            A.height = 1 + std::max(B.height, G.height);
+            C.height = 1 + std::max(A.height, F.height);
+        }
+        else
+        {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            A.box = combine(B.box, F.box);
+            C.box = combine(A.box, G.box);
+            A.height = 1 + std::max(B.height, F.height);
+            C.height = 1 + std::max(A.height, G.height);
+        }
+        return iC;
+    }
+
+    // Rotate B up
+    if (diff < -1)
+    {
+        const int iD = B.child1;
+        const int iE = B.child2;
+        TreeNode &D = nodes_[iD];
+        TreeNode &E = nodes_[iE];
+
+        // Swap A and B
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+
+        // A's old parent should point to B
+        if (B.parent != NULL_NODE)
+        {
+            if (nodes_[B.parent].child1 == iA)
+                nodes_[B.parent].child1 = iB;
+            else
+                nodes_[B.parent].child2 = iB;
+        }
+        else
+        {
+            root_ = iB;
+        }
+
+        // Rotate
+        if (D.height > E.height)
+        {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            A.box = combine(C.box, E.box);
+            B.box = combine(A.box, D.box);
+            A.height = 1 + std::max(C.height, E.height);
+            B.height = 1 + std::max(A.height, D.height);
+        }
+        else
+        {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            A.box = combine(C.box, D.box);
+            B.box = combine(A.box, E.box);
+            A.height = 1 + std::max(C.height, D.height);
+            B.height = 1 + std::max(A.height, E.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+bool DynamicAABBTree::validate() const
+{
+    if (root_ == NULL_NODE)
+        return nodeCount_ == 0;
+    if (nodes_[root_].parent != NULL_NODE)
+        return false;
+    if (!validate(root_))
+        return false;
+
+    int freeCount = 0;
+    for (int i = freeList_; i != NULL_NODE; i = nodes_[i].next)
+        ++freeCount;
+    return nodeCount_ + freeCount == static_cast<int>(nodes_.size());
+}
+
+bool DynamicAABBTree::validate(int index) const
+{
+    const TreeNode &n = nodes_[index];
+    if (n.isLeaf())
+        return n.child2 == NULL_NODE && n.height == 0;
+
+    const TreeNode &c1 = nodes_[n.child1];
+    const TreeNode &c2 = nodes_[n.child2];
+    if (c1.parent != index || c2.parent != index)
+        return false;
+    if (n.height != 1 + std::max(c1.height, c2.height))
+        return false;
+    if (!contains(n.box, c1.box) || !contains(n.box, c2.box))
+        return false;
+    return validate(n.child1) && validate(n.child2);
+}
@@ -0,0 +1,133 @@
+#ifndef DYNAMIC_TREE_HPP_INCLUDED
+#define DYNAMIC_TREE_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include "geometry.hpp"
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Node of the dynamic tree. Leaves hold a user proxy, interior nodes the
+// union of their two children. Free nodes are chained through 'next'.
+struct TreeNode
+{
+    AABB3d box;
+    uint32_t userData;
+    union
+    {
+        int parent;
+        int next;
+    };
+    int child1;
+    int child2;
+    // Leaves have height 0, free nodes -1.
+    int height;
+
+    bool isLeaf() const
+    {
+        return child1 == -1;
+    }
+};
+
+// Incrementally updated AABB hierarchy for moving objects. Leaves store
+// "fat" boxes enlarged by a margin, so small motions don't touch the tree,
+// and the tree is kept balanced with AVL style rotations. All nodes live in
+// one pooled array and proxies are node indices.
+class DynamicAABBTree
+{
+public:
+    static constexpr int NULL_NODE = -1;
+
+    explicit DynamicAABBTree(float margin = 0.1f);
+
+    // Insert a box and return its proxy id.
+    int createProxy(const AABB3d &box, uint32_t userData);
+    void destroyProxy(int proxy);
+
+    // Move a proxy to 'box'. The fat box is extended in the direction of
+    // 'displacement' to anticipate further motion. Returns true if the proxy
+    // had to be reinserted.
+    bool moveProxy(int proxy, const AABB3d &box, const Point3d &displacement);
+
+    // Transform the object-space box 'local' of a proxy by (m, t). If the
+    // result escapes the fat box the leaf is enlarged in place and queued
+    // for the next refit(); the tree shape is left untouched. Queries are
+    // only exact after refit() has run.
+    void updateProxy(int proxy,
+                     const AABB3d &local,
+                     const float m[3][3],
+                     const float t[3]);
+
+    // Propagate the leaves grown by updateProxy() up to the root.
+    void refit();
+
+    uint32_t userData(int proxy) const
+    {
+        return nodes_[proxy].userData;
+    }
+
+    const AABB3d &fatAABB(int proxy) const
+    {
+        return nodes_[proxy].box;
+    }
+
+    int height() const
+    {
+        return root_ == NULL_NODE ? 0 : nodes_[root_].height;
+    }
+
+    int proxyCount() const
+    {
+        return (nodeCount_ + 1) / 2;
+    }
+
+    // Calls f(proxy) for every proxy whose fat box overlaps 'box'.
+    template<typename F>
+    void query(const AABB3d &box, F &&f) const;
+
+    // Check links, heights and containment of the whole tree.
+    bool validate() const;
+private:
+    static constexpr int STACK_SIZE = 256;
+
+    int allocateNode();
+    void freeNode(int node);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    int balance(int node);
+    bool validate(int node) const;
+
+    float margin_;
+    int root_ = NULL_NODE;
+    int freeList_ = NULL_NODE;
+    int nodeCount_ = 0;
+    std::vector<TreeNode> nodes_;
+    std::vector<int> dirty_;
+};
+
+template<typename F>
+void DynamicAABBTree::query(const AABB3d &box, F &&f) const
+{
+    if (root_ == NULL_NODE)
+        return;
+    // Rotations keep the height logarithmic, so a fixed stack suffices.
+    int stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = root_;
+    while (top > 0)
+    {
+        const TreeNode &n = nodes_[stack[--top]];
+        if (!intersection(n.box, box))
+            continue;
+        if (n.isLeaf())
+        {
+            f(static_cast<int>(&n - nodes_.data()));
+            continue;
+        }
+        assert(top + 2 <= STACK_SIZE);
+        stack[top++] = n.child1;
+        stack[top++] = n.child2;
+    }
+}
+
+#endif
@@ -0,0 +1,245 @@
+#include "geometry.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include <limits>
+
+// Points handed to each thread at least.
+static constexpr size_t PARALLEL_GRAIN = 1 << 16;
+
+// Running extremes of a range: values and the indices they came from.
+struct Extremes
+{
+    float lo[3] = {std::numeric_limits<float>::max(),
+                   std::numeric_limits<float>::max(),
+                   std::numeric_limits<float>::max()};
+    float hi[3] = {-std::numeric_limits<float>::max(),
+                   -std::numeric_limits<float>::max(),
+                   -std::numeric_limits<float>::max()};
+    int ilo[3] = {-1, -1, -1};
+    int ihi[3] = {-1, -1, -1};
+
+    // Fold in candidates; on equal values the lower index wins.
+    void takeLo(int axis, float v, int i)
+    {
+        if (ilo[axis] < 0 || v < lo[axis] || (v == lo[axis] && i < ilo[axis]))
+        {
+            lo[axis] = v;
+            ilo[axis] = i;
+        }
+    }
+
+    void takeHi(int axis, float v, int i)
+    {
+        if (ihi[axis] < 0 || v > hi[axis] || (v == hi[axis] && i < ihi[axis]))
+        {
+            hi[axis] = v;
+            ihi[axis] = i;
+        }
+    }
+
+    void merge(const Extremes &o)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            if (o.ilo[a] >= 0)
+                takeLo(a, o.lo[a], o.ilo[a]);
+            if (o.ihi[a] >= 0)
+                takeHi(a, o.hi[a], o.ihi[a]);
+        }
+    }
+};
+
+static void scanScalar(const Point3d *pt, int begin, int end, Extremes &e)
+{
+    for (int i = begin; i < end; ++i)
+    {
+        // Strict compares keep the first of equal values.
+        const float *p = &pt[i].x;
+        for (int a = 0; a < 3; ++a)
+        {
+            if (p[a] < e.lo[a] || e.ilo[a] < 0)
+            {
+                e.lo[a] = p[a];
+                e.ilo[a] = i;
+            }
+            if (p[a] > e.hi[a] || e.ihi[a] < 0)
+            {
+                e.hi[a] = p[a];
+                e.ihi[a] = i;
+            }
+        }
+    }
+}
+
+#ifdef GEOMETRY_X86
+
+GEOMETRY_AVX2 static void scanAvx2(const Point3d *pt,
+                                   int begin,
+                                   int end,
+                                   Extremes &e)
+{
+    static_assert(sizeof(Point3d) == 3 * sizeof(float));
+    if (end - begin < 8)
+        return scanScalar(pt, begin, end, e);
+
+    // Per lane extremes and their indices, updated with masks only.
+    __m256 lo[3], hi[3];
+    __m256i ilo[3], ihi[3];
+    __m256i idx = _mm256_add_epi32(_mm256_set1_epi32(begin),
+                                   _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    loadXYZ8(&pt[begin].x, lo[0], lo[1], lo[2]);
+    for (int a = 0; a < 3; ++a)
+    {
+        hi[a] = lo[a];
+        ilo[a] = ihi[a] = idx;
+    }
+
+    const __m256i eight = _mm256_set1_epi32(8);
+    int i = begin + 8;
+    for (; i + 8 <= end; i += 8)
+    {
+        idx = _mm256_add_epi32(idx, eight);
+        __m256 v[3];
+        loadXYZ8(&pt[i].x, v[0], v[1], v[2]);
+        for (int a = 0; a < 3; ++a)
+        {
+            const __m256 lt = _mm256_cmp_ps(v[a], lo[a], _CMP_LT_OQ);
+            const __m256 gt = _mm256_cmp_ps(v[a], hi[a], _CMP_GT_OQ);
+            lo[a] = _mm256_blendv_ps(lo[a], v[a], lt);
+            hi[a] = _mm256_blendv_ps(hi[a], v[a], gt);
+            ilo[a] = _mm256_castps_si256(_mm256_blendv_ps(
+                _mm256_castsi256_ps(ilo[a]), _mm256_castsi256_ps(idx), lt));
+            ihi[a] = _mm256_castps_si256(_mm256_blendv_ps(
+                _mm256_castsi256_ps(ihi[a]), _mm256_castsi256_ps(idx), gt));
+        }
+    }
+
+    // Reduce across lanes, then finish the tail.
+    alignas(32) float vlo[8], vhi[8];
+    alignas(32) int jlo[8], jhi[8];
+    for (int a = 0; a < 3; ++a)
+    {
+        _mm256_store_ps(vlo, lo[a]);
+        _mm256_store_ps(vhi, hi[a]);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(jlo), ilo[a]);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(jhi), ihi[a]);
+        for (int l = 0; l < 8; ++l)
+        {
+            e.takeLo(a, vlo[l], jlo[l]);
+            e.takeHi(a, vhi[l], jhi[l]);
+        }
+    }
+    Extremes tail;
+    scanScalar(pt, i, end, tail);
+    e.merge(tail);
+}
+
+// scanAvx2() sixteen lanes wide, with the compares kept in mask registers.
+GEOMETRY_AVX512 static void scanAvx512(const Point3d *pt,
+                                       int begin,
+                                       int end,
+                                       Extremes &e)
+{
+    if (end - begin < 16)
+        return scanAvx2(pt, begin, end, e);
+
+    __m512 lo[3], hi[3];
+    __m512i ilo[3], ihi[3];
+    __m512i idx = _mm512_add_epi32(
+        _mm512_set1_epi32(begin),
+        _mm512_setr_epi32(
+            0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+    loadXYZ16(&pt[begin].x, lo[0], lo[1], lo[2]);
+    for (int a = 0; a < 3; ++a)
+    {
+        hi[a] = lo[a];
+        ilo[a] = ihi[a] = idx;
+    }
+
+    const __m512i sixteen = _mm512_set1_epi32(16);
+    int i = begin + 16;
+    for (; i + 16 <= end; i += 16)
+    {
+        idx = _mm512_add_epi32(idx, sixteen);
+        __m512 v[3];
+        loadXYZ16(&pt[i].x, v[0], v[1], v[2]);
+        for (int a = 0; a < 3; ++a)
+        {
+            const __mmask16 lt = _mm512_cmp_ps_mask(v[a], lo[a], _CMP_LT_OQ);
+            const __mmask16 gt = _mm512_cmp_ps_mask(v[a], hi[a], _CMP_GT_OQ);
+            lo[a] = _mm512_mask_blend_ps(lt, lo[a], v[a]);
+            hi[a] = _mm512_mask_blend_ps(gt, hi[a], v[a]);
+            ilo[a] = _mm512_mask_blend_epi32(lt, ilo[a], idx);
+            ihi[a] = _mm512_mask_blend_epi32(gt, ihi[a], idx);
+        }
+    }
+
+    alignas(64) float vlo[16], vhi[16];
+    alignas(64) int jlo[16], jhi[16];
+    for (int a = 0; a < 3; ++a)
+    {
+        _mm512_store_ps(vlo, lo[a]);
+        _mm512_store_ps(vhi, hi[a]);
+        _mm512_store_si512(jlo, ilo[a]);
+        _mm512_store_si512(jhi, ihi[a]);
+        for (int l = 0; l < 16; ++l)
+        {
+            e.takeLo(a, vlo[l], jlo[l]);
+            e.takeHi(a, vhi[l], jhi[l]);
+        }
+    }
+    Extremes tail;
+    scanScalar(pt, i, end, tail);
+    e.merge(tail);
+}
+
+#endif
+
+static void scan(const Point3d *pt, int begin, int end, Extremes &e)
+{
+#ifdef GEOMETRY_X86
+    if (cpuHasAvx512())
+        return scanAvx512(pt, begin, end, e);
+    if (cpuHasAvx2())
+        return scanAvx2(pt, begin, end, e);
+#endif
+    scanScalar(pt, begin, end, e);
+}
+
+ExtremalPoints extremalPoints(std::span<const Point3d> pt)
+{
+    const int n = static_cast<int>(pt.size());
+    Extremes e;
+    if (n >= int(2 * PARALLEL_GRAIN))
+    {
+        e = Scheduler::global().parallelReduce(
+            size_t(0),
+            pt.size(),
+            Extremes(),
+            [&](size_t b, size_t en) {
+                Extremes part;
+                scan(pt.data(), int(b), int(en), part);
+                return part;
+            },
+            [](Extremes a, const Extremes &b) {
+                a.merge(b);
+                return a;
+            },
+            PARALLEL_GRAIN);
+    }
+    else
+    {
+        scan(pt.data(), 0, n, e);
+    }
+
+    ExtremalPoints r;
+    float *c = &r.box.c.x;
+    for (int a = 0; a < 3; ++a)
+    {
+        r.min[a] = e.ilo[a];
+        r.max[a] = e.ihi[a];
+        c[a] = n > 0 ? 0.5f * (e.lo[a] + e.hi[a]) : 0.0f;
+        r.box.r[a] = n > 0 ? 0.5f * (e.hi[a] - e.lo[a]) : 0.0f;
+    }
+    return r;
+}
@@ -1,26 +1,38 @@
 #include "geom_structs.hpp"
+#include "math_utils.hpp"
+#include "simd.hpp"
 #include <cmath>
 
+Matrix33 Matrix33::transpose() const
+{
+    Matrix33 trg;
+#ifdef GEOMETRY_SSE
+    __m128 r0 = _mm_load_ps(m), r1 = _mm_load_ps(m + 4),
+           r2 = _mm_load_ps(m + 8), r3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_store_ps(trg.m, r0);
+    _mm_store_ps(trg.m + 4, r1);
+    _mm_store_ps(trg.m + 8, r2);
+#else
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            trg.m[j * 4 + i] = m[i * 4 + j];
+#endif
+    return trg;
+}
+
 bool Matrix33::isdiagonal() const
 {
-    if (std::abs(m[1]) > 1e-4)
-        return false;
-    if (std::abs(m[2]) > 1e-4)
-        return false;
-    if (std::abs(m[3]) > 1e-4)
-        return false;
-    if (std::abs(m[5]) > 1e-4)
-        return false;
-    if (std::abs(m[6]) > 1e-4)
-        return false;
-    if (std::abs(m[7]) > 1e-4)
-        return false;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            if (i != j && std::abs((*this)[i][j]) > 1e-4)
+                return false;
     return true;
 }
 
 bool Matrix33::isorthogonal() const
 {
-    auto identity = transpose() * (*this);
+    auto identity = transposeMul(*this, *this);
     for (int i = 0; i < 3; ++i)
         for (int j = 0; j < 3; ++j)
             if (std::fabs(identity[i][j] - (i == j ? 1.0f : 0.0f)) > 1e-4)
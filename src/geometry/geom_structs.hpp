@@ -7,8 +7,8 @@ struct Point2d
     float y;
 
     Point2d() = default;
-    Point2d(float x, float y) : x(x), y(y) {}
-    Point2d(float *arr) : x(arr[0]), y(arr[1]) {}
+    constexpr Point2d(float x, float y) : x(x), y(y) {}
+    constexpr Point2d(float *arr) : x(arr[0]), y(arr[1]) {}
 };
 
 struct Point3d
@@ -18,8 +18,8 @@ struct Point3d
     float z;
 
     Point3d() = default;
-    Point3d(float x, float y, float z) : x(x), y(y), z(z) {}
-    Point3d(float *arr) : x(arr[0]), y(arr[1]), z(arr[2]) {}
+    constexpr Point3d(float x, float y, float z) : x(x), y(y), z(z) {}
+    constexpr Point3d(float *arr) : x(arr[0]), y(arr[1]), z(arr[2]) {}
 };
 
 // region R = {(x, y, z) | |c.x-x|<=rx, |c.y-y|<=ry, |c.z-z|<=rz }
@@ -37,41 +37,80 @@ struct Sphere
     float r;
 };
 
+// Region R = { x | x = c + r * u[0] + s * u[1] + t * u[2] },
+// |r| <= e[0], |s| <= e[1], |t| <= e[2]; the axes u are orthonormal.
+struct OBB3d
+{
+    Point3d c;
+    Point3d u[3];
+    float e[3];
+};
+
+// Affine map x -> m * x + t
+struct Transform3d
+{
+    float m[3][3];
+    float t[3];
+};
+
+// Row-major 4x4 matrix, such as a homogeneous transform.
+struct Matrix44
+{
+    float m[4][4];
+};
+
+// Plane P = { X | dot(n, X) = d }, n is unit length
+struct Plane
+{
+    Point3d n;
+    float d;
+};
+
+// Convex region bounded by six planes whose normals point inwards.
+struct Frustum
+{
+    Plane planes[6];
+};
+
+// Half line R(t) = o + t * d, t >= 0
+struct Ray
+{
+    Point3d o;
+    Point3d d;
+};
+
+// Triangle abc, front facing where a, b, c run counterclockwise.
+struct Triangle3d
+{
+    Point3d a;
+    Point3d b;
+    Point3d c;
+};
+
+// 3x3 matrix stored as rows padded to four floats, so that the kernels can
+// load a row, operator[](i), as one SSE register. The padding lanes are
+// always zero.
 class Matrix33
 {
 public:
     // returns the pointer of the requested row.
     float *operator[](int row)
     {
-        return &m[row * 3];
+        return &m[row * 4];
     }
 
     const float *operator[](int row) const
     {
-        return &m[row * 3];
+        return &m[row * 4];
     }
 
-    Matrix33 transpose() const
-    {
-        Matrix33 trg;
-        trg.m[0 * 3 + 0] = m[0 * 3 + 0];
-        trg.m[1 * 3 + 0] = m[0 * 3 + 1];
-        trg.m[2 * 3 + 0] = m[0 * 3 + 2];
-        trg.m[0 * 3 + 1] = m[1 * 3 + 0];
-        trg.m[1 * 3 + 1] = m[1 * 3 + 1];
-        trg.m[2 * 3 + 1] = m[1 * 3 + 2];
-        trg.m[0 * 3 + 2] = m[2 * 3 + 0];
-        trg.m[1 * 3 + 2] = m[2 * 3 + 1];
-        trg.m[2 * 3 + 2] = m[2 * 3 + 2];
-        return trg;
-    }
+    Matrix33 transpose() const;
 
     bool isorthogonal() const;
     bool isdiagonal() const;
 
-    friend Matrix33 operator*(const Matrix33 &a, const Matrix33 &b);
 private:
-    float m[9] = {0.};
+    alignas(16) float m[12] = {0.};
 };
 
 
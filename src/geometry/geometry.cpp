@@ -1,35 +1,6 @@
 #include "geometry.hpp"
 #include "math_utils.hpp"
-
-float triaArea(float x1, float y1, float x2, float y2, float x3, float y3)
-{
-    return (x1 - x2) * (y2 - y3) - (x2 - x3) * (y1 - y2);
-}
-
-Point3d operator-(const Point3d &a, const Point3d &b)
-{
-    return {a.x - b.x, a.y - b.y, a.z - b.z};
-}
-
-Point2d operator-(const Point2d &a, const Point2d &b)
-{
-    return {a.x - b.x, a.y - b.y};
-}
-
-Matrix33 operator*(const Matrix33 &a, const Matrix33 &b)
-{
-    Matrix33 trg;
-    trg.m[0] = 0.f;
-    trg.m[1] = 0.f;
-    trg.m[2] = 0.f;
-    trg.m[3] = 0.f;
-    trg.m[4] = 0.f;
-    trg.m[5] = 0.f;
-    trg.m[6] = 0.f;
-    trg.m[7] = 0.f;
-    trg.m[8] = 0.f;
-    return trg;
-}
+#include <limits>
 
 bool intersection(const AABB3d a, const AABB3d &b)
 {
@@ -51,45 +22,138 @@ bool intersection(const Sphere &a, const Sphere &b)
     return dist2 <= radiusSum * radiusSum;
 }
 
+bool intersection(const Sphere &s, const AABB3d &b)
+{
+    // Squared distance from the sphere center to the box
+    const float *c = &s.c.x;
+    const float *bc = &b.c.x;
+    float dist2 = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        float d = std::abs(c[i] - bc[i]) - b.r[i];
+        if (d > 0.0f)
+            dist2 += d * d;
+    }
+    return dist2 <= s.r * s.r;
+}
+
+bool behindPlane(const AABB3d &b, const Plane &p)
+{
+    // Projection radius of the box onto the plane normal
+    float r = b.r[0] * std::abs(p.n.x) + b.r[1] * std::abs(p.n.y) +
+              b.r[2] * std::abs(p.n.z);
+    float s = dotProd(p.n, b.c) - p.d;
+    return s < -r;
+}
+
+bool intersection(const Frustum &f, const AABB3d &b)
+{
+    for (const auto &p : f.planes)
+        if (behindPlane(b, p))
+            return false;
+    return true;
+}
+
+bool intersection(const OBB3d &a, const OBB3d &b)
+{
+    // Tolerance against arithmetic errors when two edges are near parallel
+    // and their cross product is close to the null vector
+    constexpr float EPSILON = 1e-6f;
+    float ra, rb;
+    float R[3][3], AbsR[3][3];
+
+    // Compute rotation matrix expressing b in a's coordinate frame
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            R[i][j] = dotProd(a.u[i], b.u[j]);
+
+    // Compute translation vector t, bring it into a's coordinate frame
+    const Point3d d = b.c - a.c;
+    const float t[3] = {dotProd(d, a.u[0]), dotProd(d, a.u[1]),
+                        dotProd(d, a.u[2])};
+
+    // Compute common subexpressions
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            AbsR[i][j] = std::abs(R[i][j]) + EPSILON;
+
+    // Test axes L = A0, L = A1, L = A2
+    for (int i = 0; i < 3; ++i)
+    {
+        ra = a.e[i];
+        rb = b.e[0] * AbsR[i][0] + b.e[1] * AbsR[i][1] + b.e[2] * AbsR[i][2];
+        if (std::abs(t[i]) > ra + rb)
+            return false;
+    }
+
+    // Test axes L = B0, L = B1, L = B2
+    for (int i = 0; i < 3; ++i)
+    {
+        ra = a.e[0] * AbsR[0][i] + a.e[1] * AbsR[1][i] + a.e[2] * AbsR[2][i];
+        rb = b.e[i];
+        if (std::abs(t[0] * R[0][i] + t[1] * R[1][i] + t[2] * R[2][i]) >
+            ra + rb)
+            return false;
+    }
+
+    // Test axes L = Ai x Bj
+    for (int i = 0; i < 3; ++i)
+    {
+        const int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+        for (int j = 0; j < 3; ++j)
+        {
+            const int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+            ra = a.e[i1] * AbsR[i2][j] + a.e[i2] * AbsR[i1][j];
+            rb = b.e[j1] * AbsR[i][j2] + b.e[j2] * AbsR[i][j1];
+            if (std::abs(t[i2] * R[i1][j] - t[i1] * R[i2][j]) > ra + rb)
+                return false;
+        }
+    }
+
+    // Since no separating axis is found, the OBBs must be intersecting
+    return true;
+}
+
 // Transform AABB 'a' by the matrix 'm' and translation t,
 // find maximum extends, and store result into AABB b.
-void UpdateAABB(AABB3d a, float m[3][3], float t[3], AABB3d &b)
+void UpdateAABB(const AABB3d &a,
+                const float m[3][3],
+                const float t[3],
+                AABB3d &b)
 {
-    auto *bc = &b.c.x;
-    auto *ac = &a.c.x;
+    // Accumulate into a local so that 'b' may alias 'a'.
+    AABB3d r;
+    auto *rc = &r.c.x;
+    const auto *ac = &a.c.x;
     for (int i = 0; i < 3; ++i)
     {
-        bc[i] = t[i];
-        b.r[i] = 0.0f;
+        rc[i] = t[i];
+        r.r[i] = 0.0f;
         for (int j = 0; j < 3; ++j)
         {
-            bc[i] += m[i][j] * ac[j];
-            b.r[i] += std::abs(m[i][j]) * a.r[j];
+            rc[i] += m[i][j] * ac[j];
+            r.r[i] += std::abs(m[i][j]) * a.r[j];
         }
     }
+    b = r;
 }
 
 // Compute indices to the two most separated points of the (up to) six points
 // defining the AABB encompassing the point set. Return these as min and max.
-void mostSeparatePointsOnAABB(int &min, int &max, std::span<Point3d> pt)
+void mostSeparatePointsOnAABB(int &min,
+                              int &max,
+                              std::span<const Point3d> pt)
 {
-    // First find most extreme points along principal axes
-    int minx = 0, maxx = 0, miny = 0, maxy = 0, minz = 0, maxz = 0;
-    for (int i = 1; i < pt.size(); i++)
+    if (pt.empty())
     {
-        if (pt[i].x < pt[minx].x)
-            minx = i;
-        if (pt[i].x < pt[maxx].x)
-            maxx = i;
-        if (pt[i].y < pt[miny].y)
-            miny = i;
-        if (pt[i].y < pt[maxy].y)
-            maxy = i;
-        if (pt[i].z < pt[minz].z)
-            minz = i;
-        if (pt[i].z < pt[maxz].z)
-            maxz = i;
+        min = max = -1;
+        return;
     }
+    // First find most extreme points along principal axes
+    const ExtremalPoints e = extremalPoints(pt);
+    const int minx = e.min[0], maxx = e.max[0];
+    const int miny = e.min[1], maxy = e.max[1];
+    const int minz = e.min[2], maxz = e.max[2];
     // Compute the squared distances for the three pairs of points
     float dist2x = dotProd(pt[maxx] - pt[minx], pt[maxx] - pt[minx]);
     float dist2y = dotProd(pt[maxy] - pt[miny], pt[maxy] - pt[miny]);
@@ -141,46 +205,104 @@ void barycentric1(const Point3d &a,
     u = 1.0f - v - w;
 }
 
-size_t pointFarthestFromEdge(const Point2d &a,
-                             const Point2d &b,
-                             std::span<Point2d> points)
+void barycentric2(const Point3d &a,
+                  const Point3d &b,
+                  const Point3d &c,
+                  const Point3d &p,
+                  float &u,
+                  float &v,
+                  float &w)
 {
-    // Create edge vector and vector (counterclockwise) perpendicular to it
-    auto ba = b - a;
-    Point2d eperp{-ba.y, ba.x};
-    // Track index, 'distance' and 'rightmostness' of currenlty best point
-    int bestIndex = -1;
-    float maxVal = -std::numeric_limits<float>::max();
-    float rightMostVal = -std::numeric_limits<float>::max();
-    // Test all points to find the one farthest from edge ab on the left side
-    for (int i = 0; i < points.size(); ++i)
+    // Unnormalized triangle normal
+    const Point3d m = crossProd(b - a, c - a);
+    // Nominators and one-over-denominator for u and v ratios
+    float nu, nv, ood;
+    // Absolute components for determining projection plane
+    const float x = std::abs(m.x);
+    const float y = std::abs(m.y);
+    const float z = std::abs(m.z);
+    // Compute areas in plane of largest projection
+    if (x >= y && x >= z)
+    {
+        // x is largest, project to the yz plane
+        nu = triaArea(p.y, p.z, b.y, b.z, c.y, c.z); // Area of PBC in yz plane
+        nv = triaArea(p.y, p.z, c.y, c.z, a.y, a.z); // Area of PCA in yz plane
+        ood = 1.0f / m.x; // 1 / (2 * area of ABC in yz plane)
+    }
+    else if (y >= x && y >= z)
+    {
+        // y is largest, project to the xz plane
+        nu = triaArea(p.x, p.z, b.x, b.z, c.x, c.z);
+        nv = triaArea(p.x, p.z, c.x, c.z, a.x, a.z);
+        ood = 1.0f / -m.y;
+    }
+    else
     {
-        auto pia = points[i] - a;
+        // z is largest, project to the xy plane
+        nu = triaArea(p.x, p.y, b.x, b.y, c.x, c.y);
+        nv = triaArea(p.x, p.y, c.x, c.y, a.x, a.y);
+        ood = 1.0f / m.z;
+    }
+    u = nu * ood;
+    v = nv * ood;
+    w = 1.0f - u - v;
+}
 
-        float d =
-            dotProd(pia, eperp);    // d is proportionalto distance along eperp
-        float r = dotProd(pia, ba); // r is proportional to distance along ba
-        if (d > maxVal || (d == maxVal && r > rightMostVal))
-        {
-            bestIndex = i;
-            maxVal = d;
-            rightMostVal = r;
-        }
+Matrix33 covarianceMatrix(std::span<const Point3d> pt)
+{
+    Matrix33 cov;
+    if (pt.empty())
+        return cov;
+    // Accumulate in double: large float sums lose the small deviations
+    const double oon = 1.0 / double(pt.size());
+    double c[3] = {0.0, 0.0, 0.0};
+    for (const Point3d &p : pt)
+    {
+        c[0] += p.x;
+        c[1] += p.y;
+        c[2] += p.z;
+    }
+    for (double &v : c)
+        v *= oon;
+
+    // Compute covariance elements about the center of mass
+    double e00 = 0.0, e11 = 0.0, e22 = 0.0, e01 = 0.0, e02 = 0.0, e12 = 0.0;
+    for (const Point3d &p : pt)
+    {
+        const double x = p.x - c[0], y = p.y - c[1], z = p.z - c[2];
+        e00 += x * x;
+        e11 += y * y;
+        e22 += z * z;
+        e01 += x * y;
+        e02 += x * z;
+        e12 += y * z;
     }
-    return bestIndex;
+    // Fill in the covariance matrix elements
+    cov[0][0] = float(e00 * oon);
+    cov[1][1] = float(e11 * oon);
+    cov[2][2] = float(e22 * oon);
+    cov[0][1] = cov[1][0] = float(e01 * oon);
+    cov[0][2] = cov[2][0] = float(e02 * oon);
+    cov[1][2] = cov[2][1] = float(e12 * oon);
+    return cov;
 }
 
-// 2-by-2 Symmetric Schur decomposition. Given an n-by-n symmetric matrix
-// and indices p, q such that 1 <= p < q <= n, computes a sine-cosine pair
-// (s, c) that will serve to form a Jacobi rotation matrix.
+// 2-by-2 Symmetric Schur decomposition. Given the entries app, aqq and apq
+// of a symmetric matrix, computes a sine-cosine pair (s, c) that will serve
+// to form a Jacobi rotation matrix zeroing apq, and t = s / c.
 //
 // See Golub, Van Load, Matrix Computations, 3rd ed, p428
-static void SymSchur2(const Matrix33 &a, int p, int q, float &c, float &s)
+static void SymSchur2(float app,
+                      float aqq,
+                      float apq,
+                      float &c,
+                      float &s,
+                      float &t)
 {
-    if (std::abs(a[p][q]) > 0.0001f)
+    if (apq != 0.0f)
     {
-        float r = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
-        float t;
+        float r = (aqq - app) / (2.0f * apq);
+        // For huge r, r * r overflows and t correctly goes to zero.
         if (r >= 0.0f)
             t = 1.0f / (r + std::sqrt(1.0f + r * r));
         else
@@ -192,78 +314,63 @@ static void SymSchur2(const Matrix33 &a, int p, int q, float &c, float &s)
     {
         c = 1.0f;
         s = 0.0f;
+        t = 0.0f;
     }
 }
 
-// FIXME> NOT WORKING...TESTS ARE FAILING...
-void Jacobi(const Matrix33 &a, Matrix33 &v)
+void Jacobi(const Matrix33 &a, Matrix33 &v, float (&eigenvalues)[3])
 {
-    auto a_copied = a;
-    Matrix33 J, b, t;
-    float prevoff, c, s;
+    Matrix33 b = a;
     // Initialize v to identify matrix
     for (int i = 0; i < 3; ++i)
-    {
-        v[i][i] = 1.0f;
-    }
+        for (int j = 0; j < 3; ++j)
+            v[i][j] = i == j ? 1.0f : 0.0f;
 
     // Repeat for some maximum number of iterations
     constexpr int MAX_ITERATIONS = 50;
     for (int n = 0; n < MAX_ITERATIONS; ++n)
     {
-        // Find largest off-diagonal absolute element a[p][q]
+        // Find largest off-diagonal absolute element b[p][q]
         int p = 0, q = 1;
-        for (int i = 0; i < 3; ++i)
-        {
-            for (int j = 0; j < 3; ++j)
-            {
-                if (i == j)
-                    continue;
-                if (std::abs(a_copied[i][j]) > std::abs(a_copied[p][q]))
-                {
-                    p = i;
-                    q = j;
-                }
-            }
-        }
-
-        // Compute the Jacobi rotationmatrix J(p, q, theta)
-        // (This code can be optimized for the three different cases of rotation)
-        SymSchur2(a_copied, p, q, c, s);
-        for (int i = 0; i < 3; ++i)
+        if (std::abs(b[0][2]) > std::abs(b[p][q]))
+            q = 2;
+        if (std::abs(b[1][2]) > std::abs(b[p][q]))
         {
-            J[i][0] = J[i][1] = J[i][2] = 0.0f;
-            J[i][i] = 1.0f;
+            p = 1;
+            q = 2;
         }
-        J[p][p] = c;
-        J[p][q] = s;
-        J[q][p] = -s;
-        J[q][q] = c;
+        // Stop once it no longer registers against the diagonal
+        const float apq = b[p][q];
+        const float app = b[p][p], aqq = b[q][q];
+        if (std::abs(apq) <=
+            std::numeric_limits<float>::epsilon() * 0.5f *
+                (std::abs(app) + std::abs(aqq)))
+            break;
 
-        // Cumulate rotations into what will contain the eigenvectors
-        v = v * J;
-
-        // Make 'a' more diagonal, until just eigenvalues remain on diagonal
-        a_copied = (J.transpose() * a_copied) * J;
-
-        // Compute 'norm' of off-diagonal elements
-        float off = 0.0f;
-
-        for (int i = 0; i < 3; ++i)
+        // Apply the rotation J(p, q, theta) as b = J^T b J and v = v J,
+        // touching only rows and columns p and q
+        float c, s, t;
+        SymSchur2(app, aqq, apq, c, s, t);
+        const int r = 3 - p - q;
+        const float arp = b[r][p], arq = b[r][q];
+        b[p][p] = app - t * apq;
+        b[q][q] = aqq + t * apq;
+        b[p][q] = b[q][p] = 0.0f;
+        b[r][p] = b[p][r] = c * arp - s * arq;
+        b[r][q] = b[q][r] = s * arp + c * arq;
+        for (int k = 0; k < 3; ++k)
         {
-            for (int j = 0; j < 3; ++j)
-            {
-                if (i == j)
-                    continue;
-                off += a_copied[i][j] * a_copied[i][j];
-            }
+            const float vkp = v[k][p], vkq = v[k][q];
+            v[k][p] = c * vkp - s * vkq;
+            v[k][q] = s * vkp + c * vkq;
         }
-
-        /* off = sqrt(off); not needed for norm comparison */
-        // Stop when norm no longer decreasing
-        if (n > 2 && off >= prevoff)
-            return;
-
-        prevoff = off;
     }
-}
\ No newline at end of file
+    for (int i = 0; i < 3; ++i)
+        eigenvalues[i] = b[i][i];
+}
+
+void Jacobi(const Matrix33 &a, Matrix33 &v)
+{
+    float eigenvalues[3];
+    Jacobi(a, v, eigenvalues);
+}
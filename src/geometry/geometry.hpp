@@ -7,27 +7,111 @@
 #include <span>
 
 
-float triaArea(float x1, float y1, float x2, float y2, float x3, float y3);
-Point3d operator-(const Point3d &a, const Point3d &b);
-Point2d operator-(const Point2d &a, const Point2d &b);
 bool intersection(const AABB3d a, const AABB3d &b);
 bool intersection(const Sphere &a, const Sphere &b);
-Matrix33 operator*(const Matrix33 &a, const Matrix33 &b);
+bool intersection(const Sphere &s, const AABB3d &b);
+// Conservative: may report boxes outside but close to a frustum corner.
+bool intersection(const Frustum &f, const AABB3d &b);
+// Separating axis test over the 15 candidate axes: the 3 + 3 face normals
+// and the 9 pairwise edge cross products, cheapest first.
+bool intersection(const OBB3d &a, const OBB3d &b);
 
-void Jacobi(const Matrix33 &m, Matrix33 &v);
+// True if box 'b' lies entirely on the negative side of plane 'p'.
+bool behindPlane(const AABB3d &b, const Plane &p);
+
+// out[i] = m * p[i], eight points at a time through AVX2 when the CPU has
+// it; 'parallel' also splits large batches across threads. 'out' may be
+// 'p'.
+void transformPoints(const Matrix33 &m,
+                     std::span<const Point3d> p,
+                     std::span<Point3d> out,
+                     bool parallel = false);
+
+// Covariance matrix of the points about their mean.
+Matrix33 covarianceMatrix(std::span<const Point3d> pt);
+
+// Eigen decomposition of the symmetric matrix 'a' by Jacobi rotations:
+// a = v * diag(eigenvalues) * v^T, the columns of v being the unit
+// eigenvectors. The eigenvalues come in no particular order.
+void Jacobi(const Matrix33 &a, Matrix33 &v);
+void Jacobi(const Matrix33 &a, Matrix33 &v, float (&eigenvalues)[3]);
+
+// Batched Jacobi for many small problems, such as per-object covariance
+// matrices. Runs a fixed cyclic sweep order on eight matrices at a time
+// through AVX2 when the CPU has it, with eigenvalues[i].x, .y and .z going
+// with columns 0, 1 and 2 of v[i]. 'parallel' also splits large batches
+// across threads.
+void Jacobi(std::span<const Matrix33> a,
+            std::span<Matrix33> v,
+            std::span<Point3d> eigenvalues,
+            bool parallel = false);
+
+// Batched determinants and inverses of small matrices, such as per-object
+// transforms. Eight matrices at a time are transposed into one register per
+// element and run through the cofactor formulas in AVX2 when the CPU has
+// it; 'parallel' also splits large batches across threads. inv[i] is zero
+// where det[i] is, and 'inv' may be 'm'.
+void determinant(std::span<const Matrix33> m,
+                 std::span<float> det,
+                 bool parallel = false);
+void determinant(std::span<const Matrix44> m,
+                 std::span<float> det,
+                 bool parallel = false);
+void inverse(std::span<const Matrix33> m,
+             std::span<Matrix33> inv,
+             std::span<float> det,
+             bool parallel = false);
+void inverse(std::span<const Matrix44> m,
+             std::span<Matrix44> inv,
+             std::span<float> det,
+             bool parallel = false);
 
 // Transform AABB 'a' by the matrix 'm' and translation t,
 // find maximum extends, and store result into AABB b.
-void UpdateAABB(AABB3d a, float m[3][3], float t[3], AABB3d &b);
+void UpdateAABB(const AABB3d &a,
+                const float m[3][3],
+                const float t[3],
+                AABB3d &b);
+
+// Batched UpdateAABB: b[i] = a[i] transformed by one shared (m, t), or by
+// its own xf[i]. Eight boxes at a time go through AVX2 when the CPU has it;
+// 'parallel' also splits large batches across threads. 'b' may be 'a'.
+void UpdateAABB(std::span<const AABB3d> a,
+                const float m[3][3],
+                const float t[3],
+                std::span<AABB3d> b,
+                bool parallel = false);
+void UpdateAABB(std::span<const AABB3d> a,
+                std::span<const Transform3d> xf,
+                std::span<AABB3d> b,
+                bool parallel = false);
+
+// Indices of the points with the smallest and largest x, y and z (the
+// lowest index wins ties) together with the AABB of the points, from one
+// branchless SIMD pass that is split across threads for large inputs.
+// Indices are -1 for an empty span.
+struct ExtremalPoints
+{
+    int min[3];
+    int max[3];
+    AABB3d box;
+};
+
+ExtremalPoints extremalPoints(std::span<const Point3d> pt);
 
 // Compute indices to the two most separated points of the (up to) six points
 // defining the AABB encompassing the point set. Return these as min and max.
-void mostSeparatePointsOnAABB(int &min, int &max, std::span<Point3d> pt);
+void mostSeparatePointsOnAABB(int &min,
+                              int &max,
+                              std::span<const Point3d> pt);
 Point3d normal(const Point3d &a, const Point3d &b, const Point3d &c);
 
+// Index of the point farthest to the left of edge ab; among equally far
+// points the one farthest along ab, then the first one. SIMD, and split
+// across threads for large spans. Returns size_t(-1) for no points.
 size_t pointFarthestFromEdge(const Point2d &a,
                              const Point2d &b,
-                             std::span<Point2d> points);
+                             std::span<const Point2d> points);
 
 /*
 Pros:
@@ -55,52 +139,13 @@ Cons:
     Slightly more expensive (uses cross product, abs, area computations)
     Involves projection logic - a bit more code
 */
-template<typename T>
-void barycentric2(const T (&a)[3],
-                  const T (&b)[3],
-                  const T (&c)[3],
-                  const T (&p)[3],
+void barycentric2(const Point3d &a,
+                  const Point3d &b,
+                  const Point3d &c,
+                  const Point3d &p,
                   float &u,
                   float &v,
-                  float &w)
-{
-    T v0[3], v1[3], m[3];
-    sub(b, a, v0);
-    sub(c, a, v1);
-    // Unnormalized triangle normal
-    crossProd(v0, v1, m);
-    // Nominators and one-over-denominator for u and v ratios
-    float nu, nv, ood;
-    // Absolute components for determining projection plane
-    float x = std::abs(m.x);
-    float y = std::abs(m.y);
-    float z = std::abs(m.z);
-    // Compute areas in plane of largest projection
-    if (x >= y && x >= z)
-    {
-        // x is largest, project to the yz plane
-        nu = TriArea2D(p.y, p.z, b.y, b.z, c.y, c.z); // Area of PBC in yz plane
-        nv = TriArea2D(p.y, p.z, c.y, c.z, a.y, a.z); // Area of PCA in yz plane
-        ood = 1.0f / m.x; // 1 / (2 * area of ABC in yz plane)
-    }
-    else if (y >= x && y >= z)
-    {
-        // y is largest, project to the xz plane
-        nu = TriArea2D(p.x, p.z, b.x, b.z, c.x, c.z);
-        nv = TriArea2D(p.x, p.z, c.x, c.z, a.x, a.z);
-        ood = 1.0f / -m.y;
-    }
-    else
-    {
-        // z is largest, project to the xy plane
-        nu = TriArea2D(p.x, p.y, b.x, b.y, c.x, c.y);
-        nv = TriArea2D(p.x, p.y, c.x, c.y, a.x, a.y);
-        ood = 1.0f / m.z;
-    }
-    u = nu * ood;
-    v = nv * ood;
-    w = 1.0f - u - v;
-}
+                  float &w);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,654 @@
+#include "gjk.hpp"
+#include "geometry.hpp"
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+// Support point pairs a query evaluates at most.
+static constexpr int MAX_ITERATIONS = 64;
+// GJK and EPA stop once a new support point gets less than this fraction
+// closer to the answer.
+static constexpr double TOLERANCE = 1e-6;
+// Squared distances below this fraction of the squared size of the simplex
+// count as touching.
+static constexpr double TOUCHING = 1e-12;
+// EPA polytope capacity; a closed triangle mesh has 2V - 4 faces.
+static constexpr int EPA_MAX_VERTICES = MAX_ITERATIONS + 4;
+static constexpr int EPA_MAX_FACES = 2 * EPA_MAX_VERTICES;
+
+ConvexShape::ConvexShape(std::span<const Point3d> points)
+    : kind_(Kind::Points), points_{points.data(), points.size()}
+{
+    assert(!points.empty());
+}
+
+ConvexShape::ConvexShape(const Sphere &s) : kind_(Kind::Sphere), sphere_(s) {}
+
+ConvexShape::ConvexShape(const AABB3d &b) : kind_(Kind::AABB), aabb_(b) {}
+
+ConvexShape::ConvexShape(const OBB3d &b) : kind_(Kind::OBB), obb_(b) {}
+
+Point3d ConvexShape::support(const Point3d &d) const
+{
+    if (kind_ != Kind::Sphere)
+        return coreSupport(d);
+    const Point3d &c = sphere_.c;
+    const float len = magnitute(d);
+    if (len == 0.0f)
+        return {c.x + sphere_.r, c.y, c.z};
+    const float k = sphere_.r / len;
+    return {c.x + k * d.x, c.y + k * d.y, c.z + k * d.z};
+}
+
+float ConvexShape::margin() const
+{
+    return kind_ == Kind::Sphere ? sphere_.r : 0.0f;
+}
+
+Point3d ConvexShape::coreSupport(const Point3d &d) const
+{
+    switch (kind_)
+    {
+    case Kind::Points:
+    {
+        size_t best = 0;
+        float bestDot = dotProd(points_.data[0], d);
+        for (size_t i = 1; i < points_.size; ++i)
+        {
+            const float s = dotProd(points_.data[i], d);
+            if (s > bestDot)
+            {
+                bestDot = s;
+                best = i;
+            }
+        }
+        return points_.data[best];
+    }
+    case Kind::Sphere:
+        return sphere_.c;
+    case Kind::AABB:
+    {
+        const Point3d &c = aabb_.c;
+        return {c.x + (d.x >= 0.0f ? aabb_.r[0] : -aabb_.r[0]),
+                c.y + (d.y >= 0.0f ? aabb_.r[1] : -aabb_.r[1]),
+                c.z + (d.z >= 0.0f ? aabb_.r[2] : -aabb_.r[2])};
+    }
+    case Kind::OBB:
+    {
+        Point3d p = obb_.c;
+        for (int k = 0; k < 3; ++k)
+        {
+            const Point3d &u = obb_.u[k];
+            const float e = dotProd(d, u) >= 0.0f ? obb_.e[k] : -obb_.e[k];
+            p = {p.x + e * u.x, p.y + e * u.y, p.z + e * u.z};
+        }
+        return p;
+    }
+    }
+    return {};
+}
+
+namespace
+{
+// The simplex math runs in double: the Minkowski difference of nearby
+// shapes cancels most of the float precision of its points.
+struct Vec3
+{
+    double x, y, z;
+};
+
+Vec3 vec(const Point3d &p)
+{
+    return {p.x, p.y, p.z};
+}
+
+Point3d point(const Vec3 &v)
+{
+    return {float(v.x), float(v.y), float(v.z)};
+}
+
+Vec3 operator+(const Vec3 &a, const Vec3 &b)
+{
+    return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+Vec3 operator-(const Vec3 &a, const Vec3 &b)
+{
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+Vec3 operator*(double s, const Vec3 &a)
+{
+    return {s * a.x, s * a.y, s * a.z};
+}
+
+double dot(const Vec3 &a, const Vec3 &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Vec3 cross(const Vec3 &a, const Vec3 &b)
+{
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+            a.x * b.y - a.y * b.x};
+}
+
+// Point w = pa - pb of the Minkowski difference of the cores of a and b,
+// from the core support points pa of 'a' along d and pb of 'b' along -d.
+struct Vertex
+{
+    Vec3 w;
+    Vec3 a;
+    Vec3 b;
+    Point3d d;
+};
+
+Vertex supportVertex(const ConvexShape &a,
+                     const ConvexShape &b,
+                     const Point3d &d)
+{
+    const Vec3 pa = vec(a.coreSupport(d));
+    const Vec3 pb = vec(b.coreSupport({-d.x, -d.y, -d.z}));
+    return {pa - pb, pa, pb, d};
+}
+
+// Simplex with the barycentric weights of its point closest to the origin.
+struct Simplex
+{
+    Vertex v[4];
+    double lambda[4];
+    int count = 0;
+
+    double size2() const
+    {
+        double s = 0.0;
+        for (int i = 0; i < count; ++i)
+            s = std::max(s, dot(v[i].w, v[i].w));
+        return s;
+    }
+
+    // Append w unless it repeats a vertex.
+    bool add(const Vertex &w)
+    {
+        const double tiny = TOUCHING * std::max(size2(), dot(w.w, w.w));
+        for (int i = 0; i < count; ++i)
+        {
+            const Vec3 d = w.w - v[i].w;
+            if (dot(d, d) <= tiny)
+                return false;
+        }
+        v[count++] = w;
+        return true;
+    }
+
+    // Keep the n vertices idx with weights l.
+    void keep(int n, const int *idx, const double *l)
+    {
+        Vertex kept[4];
+        for (int k = 0; k < n; ++k)
+            kept[k] = v[idx[k]];
+        for (int k = 0; k < n; ++k)
+        {
+            v[k] = kept[k];
+            lambda[k] = l[k];
+        }
+        count = n;
+    }
+
+    Vec3 weighted(Vec3 Vertex::*member) const
+    {
+        Vec3 p = {0.0, 0.0, 0.0};
+        for (int i = 0; i < count; ++i)
+            p = p + lambda[i] * (v[i].*member);
+        return p;
+    }
+};
+
+// Closest point to the origin of triangle abc, as in Ericson's
+// ClosestPtPointTriangle: the feature it lies on, as vertex indices, and
+// their weights. Returns the number of vertices of the feature.
+int closestOnTriangle(const Vec3 &a,
+                      const Vec3 &b,
+                      const Vec3 &c,
+                      int idx[3],
+                      double l[3])
+{
+    const Vec3 ab = b - a, ac = c - a;
+    const double d1 = -dot(ab, a), d2 = -dot(ac, a);
+    if (d1 <= 0.0 && d2 <= 0.0)
+    {
+        idx[0] = 0, l[0] = 1.0;
+        return 1;
+    }
+    const double d3 = -dot(ab, b), d4 = -dot(ac, b);
+    if (d3 >= 0.0 && d4 <= d3)
+    {
+        idx[0] = 1, l[0] = 1.0;
+        return 1;
+    }
+    const double vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+    {
+        const double t = d1 / (d1 - d3);
+        idx[0] = 0, idx[1] = 1, l[0] = 1.0 - t, l[1] = t;
+        return 2;
+    }
+    const double d5 = -dot(ab, c), d6 = -dot(ac, c);
+    if (d6 >= 0.0 && d5 <= d6)
+    {
+        idx[0] = 2, l[0] = 1.0;
+        return 1;
+    }
+    const double vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+    {
+        const double t = d2 / (d2 - d6);
+        idx[0] = 0, idx[1] = 2, l[0] = 1.0 - t, l[1] = t;
+        return 2;
+    }
+    const double va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+    {
+        const double t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        idx[0] = 1, idx[1] = 2, l[0] = 1.0 - t, l[1] = t;
+        return 2;
+    }
+    const double denom = 1.0 / (va + vb + vc);
+    idx[0] = 0, idx[1] = 1, idx[2] = 2;
+    l[1] = vb * denom;
+    l[2] = vc * denom;
+    l[0] = 1.0 - l[1] - l[2];
+    return 3;
+}
+
+// Reduce the simplex to the smallest one holding its point closest to the
+// origin and return that point. Four vertices are left only when the
+// tetrahedron contains the origin.
+Vec3 closest(Simplex &s)
+{
+    if (s.count == 1)
+    {
+        s.lambda[0] = 1.0;
+    }
+    else if (s.count == 2)
+    {
+        const Vec3 ab = s.v[1].w - s.v[0].w;
+        const double t = -dot(s.v[0].w, ab), denom = dot(ab, ab);
+        const int first = 0, second = 1;
+        const double one = 1.0;
+        if (t <= 0.0)
+            s.keep(1, &first, &one);
+        else if (t >= denom)
+            s.keep(1, &second, &one);
+        else
+        {
+            s.lambda[1] = t / denom;
+            s.lambda[0] = 1.0 - s.lambda[1];
+        }
+    }
+    else if (s.count == 3)
+    {
+        int idx[3];
+        double l[3];
+        const int n = closestOnTriangle(s.v[0].w, s.v[1].w, s.v[2].w, idx, l);
+        s.keep(n, idx, l);
+    }
+    else
+    {
+        // Faces with the vertex opposite to them
+        static constexpr int FACES[4][4] = {
+            {0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+        bool inside = true;
+        double best = std::numeric_limits<double>::max();
+        int bestN = 0, bestIdx[3];
+        double bestL[3];
+        for (const auto &f : FACES)
+        {
+            const Vec3 &a = s.v[f[0]].w, &b = s.v[f[1]].w, &c = s.v[f[2]].w;
+            const Vec3 n = cross(b - a, c - a);
+            const double opposite = dot(n, s.v[f[3]].w - a);
+            const double origin = -dot(n, a);
+            // The origin is outside if it is across the face from the
+            // opposite vertex; a flat tetrahedron holds nothing
+            if (opposite != 0.0 && opposite * origin >= 0.0)
+                continue;
+            inside = false;
+            int idx[3];
+            double l[3];
+            const int m = closestOnTriangle(a, b, c, idx, l);
+            Vec3 p = {0.0, 0.0, 0.0};
+            for (int k = 0; k < m; ++k)
+                p = p + l[k] * s.v[f[idx[k]]].w;
+            if (dot(p, p) < best)
+            {
+                best = dot(p, p);
+                bestN = m;
+                for (int k = 0; k < m; ++k)
+                {
+                    bestIdx[k] = f[idx[k]];
+                    bestL[k] = l[k];
+                }
+            }
+        }
+        if (inside)
+            return {0.0, 0.0, 0.0};
+        s.keep(bestN, bestIdx, bestL);
+    }
+    return s.weighted(&Vertex::w);
+}
+
+// GJK on the cores from the cached simplex, or from scratch. Returns the
+// squared distance, or 0 for overlapping or touching cores; 's' is left
+// holding the closest point, or a simplex around the origin. It stops early,
+// returning more than separation squared, once a direction proves the cores
+// farther apart than that.
+double gjk(const ConvexShape &a,
+           const ConvexShape &b,
+           Simplex &s,
+           GjkSimplex *cache,
+           double separation = std::numeric_limits<double>::infinity())
+{
+    int iterations = 0;
+    s.count = 0;
+    if (cache)
+        for (int i = 0; i < cache->count; ++i, ++iterations)
+            s.add(supportVertex(a, b, cache->d[i]));
+    if (s.count == 0)
+    {
+        s.add(supportVertex(a, b, {1.0f, 0.0f, 0.0f}));
+        ++iterations;
+    }
+
+    double vv = std::numeric_limits<double>::max();
+    for (;;)
+    {
+        const Vec3 v = closest(s);
+        const double prev = vv;
+        vv = dot(v, v);
+        if (s.count == 4 || vv <= TOUCHING * s.size2())
+        {
+            vv = 0.0;
+            break;
+        }
+        // No progress means rounding has taken over
+        if (vv >= prev || iterations >= MAX_ITERATIONS)
+            break;
+        const Vertex w = supportVertex(a, b, point({-v.x, -v.y, -v.z}));
+        ++iterations;
+        const double vw = dot(v, w.w);
+        if (vw > separation * std::sqrt(vv))
+            break;
+        if (vv - vw <= TOLERANCE * vv || !s.add(w))
+            break;
+    }
+
+    if (cache)
+    {
+        cache->count = s.count;
+        for (int i = 0; i < s.count; ++i)
+            cache->d[i] = s.v[i].d;
+        cache->iterations = iterations;
+    }
+    return vv;
+}
+
+// Grow a simplex that touches the origin into a tetrahedron, looking for
+// support points off its line or plane. Fails for flat Minkowski
+// differences.
+bool tetrahedron(const ConvexShape &a, const ConvexShape &b, Simplex &s)
+{
+    static const Point3d AXES[6] = {{1, 0, 0},
+                                    {-1, 0, 0},
+                                    {0, 1, 0},
+                                    {0, -1, 0},
+                                    {0, 0, 1},
+                                    {0, 0, -1}};
+    while (s.count < 4)
+    {
+        const double size2 = s.size2();
+        const int before = s.count;
+        if (s.count == 1)
+        {
+            for (const Point3d &d : AXES)
+                if (s.add(supportVertex(a, b, d)))
+                    break;
+        }
+        else if (s.count == 2)
+        {
+            // Directions around the segment
+            const Vec3 u = s.v[1].w - s.v[0].w;
+            const Vec3 e = std::abs(u.x) <= std::abs(u.y) &&
+                                   std::abs(u.x) <= std::abs(u.z)
+                               ? Vec3{1, 0, 0}
+                               : std::abs(u.y) <= std::abs(u.z) ? Vec3{0, 1, 0}
+                                                                : Vec3{0, 0, 1};
+            const Vec3 d1 = cross(u, e), d2 = cross(u, d1);
+            const double uu = dot(u, u);
+            for (const Vec3 &d : {d1, d2, -1.0 * d1, -1.0 * d2})
+            {
+                const Vertex w = supportVertex(a, b, point(d));
+                const Vec3 off = cross(u, w.w - s.v[0].w);
+                if (dot(off, off) > TOUCHING * uu * size2 && s.add(w))
+                    break;
+            }
+        }
+        else
+        {
+            const Vec3 n = cross(s.v[1].w - s.v[0].w, s.v[2].w - s.v[0].w);
+            const double nn = dot(n, n);
+            for (const Vec3 &d : {n, -1.0 * n})
+            {
+                const Vertex w = supportVertex(a, b, point(d));
+                const double h = dot(n, w.w - s.v[0].w);
+                if (h * h > TOUCHING * nn * size2 && s.add(w))
+                    break;
+            }
+        }
+        if (s.count == before)
+            return false;
+    }
+    return true;
+}
+
+struct EpaFace
+{
+    int v[3];
+    Vec3 n;
+    double dist;
+    bool alive;
+};
+
+// Expanding polytope around the origin, in fixed storage.
+struct Polytope
+{
+    Vertex v[EPA_MAX_VERTICES];
+    EpaFace f[EPA_MAX_FACES];
+    int vertices = 0;
+    int faces = 0;
+
+    // Face with outward unit normal for counterclockwise i, j, k. Slivers
+    // get no normal and are never the nearest face.
+    bool addFace(int i, int j, int k)
+    {
+        int slot = 0;
+        while (slot < faces && f[slot].alive)
+            ++slot;
+        if (slot == EPA_MAX_FACES)
+            return false;
+        faces = std::max(faces, slot + 1);
+        EpaFace &face = f[slot];
+        face = {{i, j, k}, cross(v[j].w - v[i].w, v[k].w - v[i].w), 0.0, true};
+        const double len = std::sqrt(dot(face.n, face.n));
+        if (len > 0.0)
+        {
+            face.n = (1.0 / len) * face.n;
+            face.dist = dot(face.n, v[i].w);
+        }
+        else
+            face.dist = std::numeric_limits<double>::max();
+        return true;
+    }
+};
+
+// Move the closest or deepest core points ca and cb out to the surfaces
+// along the unit normal n from 'a' towards 'b'.
+void addMargins(const ConvexShape &a,
+                const ConvexShape &b,
+                const Vec3 &ca,
+                const Vec3 &cb,
+                const Vec3 &n,
+                Point3d &pa,
+                Point3d &pb)
+{
+    pa = point(ca + double(a.margin()) * n);
+    pb = point(cb - double(b.margin()) * n);
+}
+} // namespace
+
+bool gjkIntersect(const ConvexShape &a, const ConvexShape &b, GjkSimplex *cache)
+{
+    Simplex s;
+    const double margin = double(a.margin()) + b.margin();
+    return gjk(a, b, s, cache, margin) <= margin * margin;
+}
+
+float gjkDistance(const ConvexShape &a,
+                  const ConvexShape &b,
+                  Point3d &pa,
+                  Point3d &pb,
+                  GjkSimplex *cache)
+{
+    Simplex s;
+    const double vv = gjk(a, b, s, cache);
+    const double margin = double(a.margin()) + b.margin();
+    if (vv <= margin * margin)
+        return 0.0f;
+    const double d = std::sqrt(vv);
+    const Vec3 ca = s.weighted(&Vertex::a), cb = s.weighted(&Vertex::b);
+    addMargins(a, b, ca, cb, (1.0 / d) * (cb - ca), pa, pb);
+    return float(d - margin);
+}
+
+bool epaPenetration(const ConvexShape &a,
+                    const ConvexShape &b,
+                    float &depth,
+                    Point3d &n,
+                    Point3d &pa,
+                    Point3d &pb,
+                    GjkSimplex *cache)
+{
+    Simplex s;
+    const double vv = gjk(a, b, s, cache);
+    const double margin = double(a.margin()) + b.margin();
+    if (vv > margin * margin)
+        return false;
+    if (vv > 0.0)
+    {
+        // Only the margins overlap
+        const double d = std::sqrt(vv);
+        const Vec3 ca = s.weighted(&Vertex::a), cb = s.weighted(&Vertex::b);
+        const Vec3 nd = (1.0 / d) * (cb - ca);
+        depth = float(margin - d);
+        n = point(nd);
+        addMargins(a, b, ca, cb, nd, pa, pb);
+        return true;
+    }
+    if (!tetrahedron(a, b, s))
+    {
+        // Flat Minkowski difference: the cores only touch
+        closest(s);
+        Vec3 nd = {0.0, 0.0, 1.0};
+        if (s.count == 3)
+        {
+            const Vec3 nt = cross(s.v[1].w - s.v[0].w, s.v[2].w - s.v[0].w);
+            if (dot(nt, nt) > 0.0)
+                nd = (1.0 / std::sqrt(dot(nt, nt))) * nt;
+        }
+        const Vec3 c = s.weighted(&Vertex::a);
+        depth = float(margin);
+        n = point(nd);
+        addMargins(a, b, c, c, nd, pa, pb);
+        return true;
+    }
+    Polytope p;
+    for (int i = 0; i < 4; ++i)
+        p.v[i] = s.v[i];
+    p.vertices = 4;
+    // Orient the base away from the apex
+    if (dot(cross(p.v[1].w - p.v[0].w, p.v[2].w - p.v[0].w),
+            p.v[3].w - p.v[0].w) > 0.0)
+        std::swap(p.v[1], p.v[2]);
+    p.addFace(0, 1, 2);
+    p.addFace(0, 3, 1);
+    p.addFace(1, 3, 2);
+    p.addFace(2, 3, 0);
+
+    int nearest = 0;
+    for (int iteration = 0;; ++iteration)
+    {
+        nearest = -1;
+        for (int i = 0; i < p.faces; ++i)
+            if (p.f[i].alive &&
+                (nearest == -1 || p.f[i].dist < p.f[nearest].dist))
+                nearest = i;
+        const EpaFace &face = p.f[nearest];
+        if (iteration == MAX_ITERATIONS || p.vertices == EPA_MAX_VERTICES)
+            break;
+        const Vertex w = supportVertex(a, b, point(face.n));
+        if (dot(face.n, w.w) - face.dist <=
+            TOLERANCE * std::max(face.dist, std::sqrt(s.size2())))
+            break;
+
+        // Remove the faces w sees; their unshared edges are the horizon
+        std::pair<int, int> edges[3 * EPA_MAX_FACES];
+        int edgeCount = 0;
+        const Vec3 ww = w.w;
+        for (int i = 0; i < p.faces; ++i)
+        {
+            EpaFace &g = p.f[i];
+            if (!g.alive || dot(g.n, ww - p.v[g.v[0]].w) <= 0.0)
+                continue;
+            g.alive = false;
+            for (int k = 0; k < 3; ++k)
+            {
+                const int e0 = g.v[k], e1 = g.v[(k + 1) % 3];
+                int j = 0;
+                while (j < edgeCount &&
+                       !(edges[j].first == e1 && edges[j].second == e0))
+                    ++j;
+                if (j < edgeCount)
+                    edges[j] = edges[--edgeCount];
+                else
+                    edges[edgeCount++] = {e0, e1};
+            }
+        }
+        const int apex = p.vertices++;
+        p.v[apex] = w;
+        bool full = false;
+        for (int j = 0; j < edgeCount && !full; ++j)
+            full = !p.addFace(edges[j].first, edges[j].second, apex);
+        if (full)
+            break;
+    }
+
+    // Barycentric coordinates of the origin's projection onto the face
+    const EpaFace &face = p.f[nearest];
+    const Vertex &v0 = p.v[face.v[0]], &v1 = p.v[face.v[1]],
+                 &v2 = p.v[face.v[2]];
+    const Vec3 q = face.dist * face.n;
+    const Vec3 nt = cross(v1.w - v0.w, v2.w - v0.w);
+    const double area = dot(nt, nt);
+    double l1 = 1.0 / 3.0, l2 = 1.0 / 3.0;
+    if (area > 0.0)
+    {
+        l1 = dot(cross(q - v0.w, v2.w - v0.w), nt) / area;
+        l2 = dot(cross(v1.w - v0.w, q - v0.w), nt) / area;
+    }
+    const double l0 = 1.0 - l1 - l2;
+    depth = float(face.dist + margin);
+    n = point(face.n);
+    addMargins(a, b, l0 * v0.a + l1 * v1.a + l2 * v2.a,
+               l0 * v0.b + l1 * v1.b + l2 * v2.b, face.n, pa, pb);
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef GJK_HPP_INCLUDED
+#define GJK_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include <cstddef>
+#include <span>
+
+// Convex shape seen through its support mapping: the point of the shape
+// farthest along a direction. A span of points stands for its convex hull
+// and is referenced, not copied; the other shapes are copied. A shape is a
+// core swept by a ball of radius margin(); the queries run on the cores and
+// add the margins back, so a sphere is a point and converges in a step.
+class ConvexShape
+{
+public:
+    ConvexShape(std::span<const Point3d> points);
+    ConvexShape(const Sphere &s);
+    ConvexShape(const AABB3d &b);
+    ConvexShape(const OBB3d &b);
+
+    Point3d support(const Point3d &d) const;
+    Point3d coreSupport(const Point3d &d) const;
+    float margin() const;
+
+private:
+    enum class Kind
+    {
+        Points,
+        Sphere,
+        AABB,
+        OBB
+    };
+
+    Kind kind_;
+    union
+    {
+        struct
+        {
+            const Point3d *data;
+            size_t size;
+        } points_;
+        Sphere sphere_;
+        AABB3d aabb_;
+        OBB3d obb_;
+    };
+};
+
+// Simplex a GJK query ended on, kept as the directions its vertices were
+// found along. Keep one per shape pair and hand it to the next query: the
+// directions are re-evaluated on the moved shapes, which for small motions
+// starts the search next to the answer. A default constructed one starts
+// cold.
+struct GjkSimplex
+{
+    Point3d d[4];
+    int count = 0;
+    // Support point pairs evaluated by the last query.
+    int iterations = 0;
+};
+
+// True if the shapes overlap. Stops as soon as a separating direction turns
+// up, so it is cheaper than gjkDistance() for disjoint shapes.
+bool gjkIntersect(const ConvexShape &a,
+                  const ConvexShape &b,
+                  GjkSimplex *cache = nullptr);
+
+// Distance between the shapes by GJK and their closest points, pa on 'a'
+// and pb on 'b'. Returns 0, and leaves pa and pb unset, when they overlap.
+float gjkDistance(const ConvexShape &a,
+                  const ConvexShape &b,
+                  Point3d &pa,
+                  Point3d &pb,
+                  GjkSimplex *cache = nullptr);
+
+// Penetration of overlapping shapes: GJK finds a simplex around the origin
+// of the Minkowski difference a - b and EPA expands it to the face nearest
+// the origin. Stores the depth, the unit normal n pointing from 'a' towards
+// 'b', so that moving 'b' by depth * n separates them, and the deepest
+// points pa of 'a' and pb of 'b', pa - pb = depth * n. Returns false, and
+// leaves the outputs unset, when the shapes are apart.
+bool epaPenetration(const ConvexShape &a,
+                    const ConvexShape &b,
+                    float &depth,
+                    Point3d &n,
+                    Point3d &pa,
+                    Point3d &pb,
+                    GjkSimplex *cache = nullptr);
+
+#endif
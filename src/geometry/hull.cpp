@@ -0,0 +1,359 @@
+#include "hull.hpp"
+#include "geometry.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Subproblems at least this large run both halves concurrently.
+static constexpr size_t PARALLEL_THRESHOLD = 1 << 16;
+// Points handed to each thread at least by the farthest point scan.
+static constexpr size_t SCAN_GRAIN = 1 << 18;
+
+// Twice the signed area of (o, a, b), positive for a left turn.
+static float turn(const Point2d &o, const Point2d &a, const Point2d &b)
+{
+    return triaArea(o.x, o.y, a.x, a.y, b.x, b.y);
+}
+
+namespace
+{
+// Best candidate of a farthest point scan.
+struct Farthest
+{
+    float d = -std::numeric_limits<float>::max();
+    float r = -std::numeric_limits<float>::max();
+    size_t index = size_t(-1);
+
+    // Candidates of a later range only win by being strictly better; among
+    // lanes of one range the lower index breaks the tie.
+    bool better(float od, float orr) const
+    {
+        return od > d || (od == d && orr > r);
+    }
+
+    void merge(const Farthest &o)
+    {
+        if (o.index == size_t(-1))
+            return;
+        if (better(o.d, o.r) ||
+            (o.d == d && o.r == r && o.index < index))
+            *this = o;
+    }
+};
+} // namespace
+
+static void farthestScalar(const Point2d &a,
+                           const Point2d &ba,
+                           const Point2d &eperp,
+                           const Point2d *pt,
+                           size_t begin,
+                           size_t end,
+                           Farthest &best)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        auto pia = pt[i] - a;
+        float d = dotProd(pia, eperp); // proportional to distance along eperp
+        float r = dotProd(pia, ba); // proportional to distance along ba
+        if (best.better(d, r))
+            best = {d, r, i};
+    }
+}
+
+#ifdef GEOMETRY_X86
+
+GEOMETRY_AVX2 static void farthestAvx2(const Point2d &a,
+                                       const Point2d &ba,
+                                       const Point2d &eperp,
+                                       const Point2d *pt,
+                                       size_t begin,
+                                       size_t end,
+                                       Farthest &best)
+{
+    static_assert(sizeof(Point2d) == 2 * sizeof(float));
+    assert(end - begin < size_t(INT32_MAX));
+    const __m256 ax = _mm256_set1_ps(a.x), ay = _mm256_set1_ps(a.y);
+    const __m256 bx = _mm256_set1_ps(ba.x), by = _mm256_set1_ps(ba.y);
+    const __m256 ex = _mm256_set1_ps(eperp.x), ey = _mm256_set1_ps(eperp.y);
+
+    // Per lane best distance, rightmostness and index relative to 'begin'
+    __m256 bestD = _mm256_set1_ps(best.d), bestR = _mm256_set1_ps(best.r);
+    __m256i bestI = _mm256_set1_epi32(-1);
+    __m256i idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i eight = _mm256_set1_epi32(8);
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8, idx = _mm256_add_epi32(idx, eight))
+    {
+        __m256 x, y;
+        loadXY8(&pt[i].x, x, y);
+        x = _mm256_sub_ps(x, ax);
+        y = _mm256_sub_ps(y, ay);
+        const __m256 d =
+            _mm256_add_ps(_mm256_mul_ps(x, ex), _mm256_mul_ps(y, ey));
+        const __m256 r =
+            _mm256_add_ps(_mm256_mul_ps(x, bx), _mm256_mul_ps(y, by));
+        const __m256 better = _mm256_or_ps(
+            _mm256_cmp_ps(d, bestD, _CMP_GT_OQ),
+            _mm256_and_ps(_mm256_cmp_ps(d, bestD, _CMP_EQ_OQ),
+                          _mm256_cmp_ps(r, bestR, _CMP_GT_OQ)));
+        bestD = _mm256_blendv_ps(bestD, d, better);
+        bestR = _mm256_blendv_ps(bestR, r, better);
+        bestI = _mm256_castps_si256(_mm256_blendv_ps(
+            _mm256_castsi256_ps(bestI), _mm256_castsi256_ps(idx), better));
+    }
+
+    alignas(32) float vd[8], vr[8];
+    alignas(32) int32_t vi[8];
+    _mm256_store_ps(vd, bestD);
+    _mm256_store_ps(vr, bestR);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(vi), bestI);
+    for (int l = 0; l < 8; ++l)
+        if (vi[l] >= 0)
+            best.merge({vd[l], vr[l], begin + size_t(vi[l])});
+    farthestScalar(a, ba, eperp, pt, i, end, best);
+}
+
+#endif
+
+static void farthest(const Point2d &a,
+                     const Point2d &ba,
+                     const Point2d &eperp,
+                     const Point2d *pt,
+                     size_t begin,
+                     size_t end,
+                     Farthest &best)
+{
+#ifdef GEOMETRY_X86
+    if (cpuHasAvx2())
+        return farthestAvx2(a, ba, eperp, pt, begin, end, best);
+#endif
+    farthestScalar(a, ba, eperp, pt, begin, end, best);
+}
+
+size_t pointFarthestFromEdge(const Point2d &a,
+                             const Point2d &b,
+                             std::span<const Point2d> points)
+{
+    // Create edge vector and vector (counterclockwise) perpendicular to it
+    auto ba = b - a;
+    Point2d eperp{-ba.y, ba.x};
+    // Test all points to find the one farthest from edge ab on the left side
+    const size_t n = points.size();
+    Farthest best;
+    if (n < 2 * SCAN_GRAIN || parallelism() == 1)
+    {
+        farthest(a, ba, eperp, points.data(), 0, n, best);
+        return best.index;
+    }
+    // Quickhull calls this at every step: keep the partials off the heap.
+    const size_t chunks = parallelism();
+    const size_t step = (n + chunks - 1) / chunks;
+    ScratchBuffer<Farthest> partial(chunks);
+    std::fill(partial.begin(), partial.end(), Farthest());
+    parallelFor(chunks, 1, [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; ++c)
+            if (c * step < n)
+                farthest(a, ba, eperp, points.data(), c * step,
+                         std::min(n, (c + 1) * step), partial[c]);
+    });
+    for (const Farthest &f : partial)
+        best.merge(f);
+    return best.index;
+}
+
+// Hull vertices strictly between a and b for the points 's', which all lie
+// strictly to the right of a -> b. The vertices are moved to the front of
+// 's' in counterclockwise order and their count is returned; the rest of
+// 's' keeps the other points.
+static size_t hullRightOf(const Point2d &a,
+                          const Point2d &b,
+                          std::span<Point2d> s)
+{
+    if (s.empty())
+        return 0;
+    // The point farthest from the edge is a hull vertex
+    std::swap(s[0], s[pointFarthestFromEdge(b, a, s)]);
+    const Point2d c = s[0];
+
+    // [c | right of a -> c | right of c -> b | inside triangle acb]
+    auto rest = s.subspan(1);
+    auto mid = std::partition(rest.begin(), rest.end(), [&](const Point2d &p) {
+        return turn(a, c, p) < 0.0f;
+    });
+    auto last = std::partition(mid, rest.end(), [&](const Point2d &p) {
+        return turn(c, b, p) < 0.0f;
+    });
+    const size_t n1 = mid - rest.begin(), n2 = last - mid;
+    auto s1 = rest.first(n1), s2 = rest.subspan(n1, n2);
+    size_t h1, h2;
+    if (s.size() >= PARALLEL_THRESHOLD)
+    {
+        parallelInvoke([&]() { h1 = hullRightOf(a, c, s1); },
+                       [&]() { h2 = hullRightOf(c, b, s2); });
+    }
+    else
+    {
+        h1 = hullRightOf(a, c, s1);
+        h2 = hullRightOf(c, b, s2);
+    }
+
+    // Close the gaps to [hull(a, c) | c | hull(c, b)] with swaps only
+    std::rotate(s.begin(), s.begin() + 1, s.begin() + 1 + h1);
+    for (size_t k = 0; k < h2; ++k)
+        std::swap(s[1 + h1 + k], s[1 + n1 + k]);
+    return 1 + h1 + h2;
+}
+
+size_t quickHull(std::span<Point2d> pt)
+{
+    const size_t n = pt.size();
+    if (n < 2)
+        return n;
+
+    // The lowest and highest points in (x, y) order are hull vertices
+    auto less = [](const Point2d &p, const Point2d &q) {
+        return p.x < q.x || (p.x == q.x && p.y < q.y);
+    };
+    size_t lo = 0, hi = 0;
+    for (size_t i = 1; i < n; ++i)
+    {
+        if (less(pt[i], pt[lo]))
+            lo = i;
+        if (less(pt[hi], pt[i]))
+            hi = i;
+    }
+    std::swap(pt[0], pt[lo]);
+    if (lo == hi)
+        return 1;
+    std::swap(pt[n - 1], pt[hi == 0 ? lo : hi]);
+    const Point2d a = pt[0], b = pt[n - 1];
+
+    // [a | below ab | b | above ab | on the line through ab]
+    auto rest = pt.subspan(1, n - 2);
+    auto mid = std::partition(rest.begin(), rest.end(), [&](const Point2d &p) {
+        return turn(a, b, p) < 0.0f;
+    });
+    auto last = std::partition(mid, rest.end(), [&](const Point2d &p) {
+        return turn(a, b, p) > 0.0f;
+    });
+    const size_t nb = mid - rest.begin(), na = last - mid;
+    std::rotate(pt.begin() + 1 + nb, pt.end() - 1, pt.end());
+    auto below = pt.subspan(1, nb), above = pt.subspan(2 + nb, na);
+
+    // The lower chain runs from a to b, the upper one back to a
+    size_t hb, ha;
+    if (n >= PARALLEL_THRESHOLD)
+    {
+        parallelInvoke([&]() { hb = hullRightOf(a, b, below); },
+                       [&]() { ha = hullRightOf(b, a, above); });
+    }
+    else
+    {
+        hb = hullRightOf(a, b, below);
+        ha = hullRightOf(b, a, above);
+    }
+    std::swap(pt[1 + hb], pt[1 + nb]);
+    for (size_t k = 0; k < ha; ++k)
+        std::swap(pt[2 + hb + k], pt[2 + nb + k]);
+    return 2 + hb + ha;
+}
+
+std::vector<Point2d> convexHull(std::span<const Point2d> pt)
+{
+    std::vector<Point2d> p(pt.begin(), pt.end());
+    auto less = [](const Point2d &a, const Point2d &b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    };
+    auto equal = [](const Point2d &a, const Point2d &b) {
+        return a.x == b.x && a.y == b.y;
+    };
+    std::sort(p.begin(), p.end(), less);
+    p.erase(std::unique(p.begin(), p.end(), equal), p.end());
+    const size_t n = p.size();
+    if (n < 3)
+        return p;
+
+    // Lower hull left to right, then upper hull right to left. Each point
+    // pops the ones that would make a right turn or a straight line.
+    std::vector<Point2d> h(2 * n);
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        while (k >= 2 && turn(h[k - 2], h[k - 1], p[i]) <= 0.0f)
+            --k;
+        h[k++] = p[i];
+    }
+    for (size_t i = n - 1, lower = k + 1; i-- > 0;)
+    {
+        while (k >= lower && turn(h[k - 2], h[k - 1], p[i]) <= 0.0f)
+            --k;
+        h[k++] = p[i];
+    }
+    // The last point is the first one again.
+    h.resize(k - 1);
+    return h;
+}
+
+float minAreaRect(std::span<const Point2d> hull,
+                  Point2d &c,
+                  Point2d u[2],
+                  float e[2])
+{
+    const size_t n = hull.size();
+    c = n > 0 ? hull[0] : Point2d(0.0f, 0.0f);
+    u[0] = {1.0f, 0.0f};
+    u[1] = {0.0f, 1.0f};
+    e[0] = e[1] = 0.0f;
+    if (n < 2)
+        return 0.0f;
+
+    // For the edge starting at vertex i, j is the vertex farthest along the
+    // edge, k the one farthest from it and l the one farthest behind. They
+    // only ever advance as the edges turn, so a full turn is linear.
+    float best = std::numeric_limits<float>::max();
+    size_t j = 1, k = 1, l = 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const Point2d &p = hull[i];
+        Point2d d = hull[(i + 1) % n] - p;
+        const float len = std::sqrt(dotProd(d, d));
+        if (len == 0.0f)
+            continue;
+        d = {d.x / len, d.y / len};
+        const Point2d normal = {-d.y, d.x};
+        auto along = [&](size_t v) { return dotProd(hull[v] - p, d); };
+        auto across = [&](size_t v) { return dotProd(hull[v] - p, normal); };
+
+        while (along((j + 1) % n) > along(j))
+            j = (j + 1) % n;
+        if (i == 0)
+            k = j;
+        while (across((k + 1) % n) > across(k))
+            k = (k + 1) % n;
+        if (i == 0)
+            l = k;
+        while (along((l + 1) % n) < along(l))
+            l = (l + 1) % n;
+
+        const float lo = along(l), hi = along(j), height = across(k);
+        const float area = (hi - lo) * height;
+        if (area < best)
+        {
+            best = area;
+            const float mid = 0.5f * (lo + hi);
+            c = {p.x + d.x * mid + normal.x * 0.5f * height,
+                 p.y + d.y * mid + normal.y * 0.5f * height};
+            u[0] = d;
+            u[1] = normal;
+            e[0] = 0.5f * (hi - lo);
+            e[1] = 0.5f * height;
+        }
+    }
+    return best;
+}
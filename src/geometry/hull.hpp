@@ -0,0 +1,30 @@
+#ifndef HULL_HPP_INCLUDED
+#define HULL_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include <span>
+#include <vector>
+
+// Convex hull of 'pt' by Andrew's monotone chain: counterclockwise from the
+// lowest (x, y) point, without duplicate or collinear vertices.
+std::vector<Point2d> convexHull(std::span<const Point2d> pt);
+
+// Quickhull: the same hull as convexHull(), computed in place. 'pt' is
+// permuted so that it starts with the hull vertices, counterclockwise from
+// the lowest (x, y) point, and their count is returned. Each step splits
+// off the point farthest from an edge with pointFarthestFromEdge() and
+// partitions the remaining points around it; no memory is allocated beyond
+// the scan's per-thread results. Large inputs recurse on both sides
+// concurrently.
+size_t quickHull(std::span<Point2d> pt);
+
+// Minimum area rectangle enclosing the counterclockwise convex polygon
+// 'hull', found with rotating calipers in linear time. One side of the
+// rectangle is flush with a hull edge. Stores the center, the unit axes and
+// the half extents along them, and returns the area.
+float minAreaRect(std::span<const Point2d> hull,
+                  Point2d &c,
+                  Point2d u[2],
+                  float e[2]);
+
+#endif
@@ -0,0 +1,339 @@
+#include "hull3d.hpp"
+#include "geometry.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+int ConvexHull3d::allocateFace(int a, int b, int c)
+{
+    int f = freeFaces_;
+    if (f != -1)
+        freeFaces_ = faces_[f].conflict;
+    else
+    {
+        f = static_cast<int>(faces_.size());
+        faces_.emplace_back();
+    }
+    Face &face = faces_[f];
+    face.v[0] = a;
+    face.v[1] = b;
+    face.v[2] = c;
+    // In double the plane is near exact for float input, so the sign of a
+    // distance can be trusted down to well below epsilon.
+    const Point3d &pa = pt_[a], &pb = pt_[b], &pc = pt_[c];
+    const double u[3] = {double(pb.x) - pa.x,
+                         double(pb.y) - pa.y,
+                         double(pb.z) - pa.z};
+    const double v[3] = {double(pc.x) - pa.x,
+                         double(pc.y) - pa.y,
+                         double(pc.z) - pa.z};
+    double n[3] = {u[1] * v[2] - u[2] * v[1],
+                   u[2] * v[0] - u[0] * v[2],
+                   u[0] * v[1] - u[1] * v[0]};
+    const double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    for (int k = 0; k < 3; ++k)
+        face.n[k] = len > 0.0 ? n[k] / len : 0.0;
+    face.d = face.n[0] * pa.x + face.n[1] * pa.y + face.n[2] * pa.z;
+    face.conflict = -1;
+    face.farthest = -1;
+    face.farthestDist = 0.0;
+    face.mark = 0;
+    return f;
+}
+
+void ConvexHull3d::freeFace(int f)
+{
+    faces_[f].mark = -1;
+    faces_[f].conflict = freeFaces_;
+    freeFaces_ = f;
+}
+
+void ConvexHull3d::link(int e1, int e2)
+{
+    faces_[e1 / 3].twin[e1 % 3] = e2;
+    faces_[e2 / 3].twin[e2 % 3] = e1;
+}
+
+double ConvexHull3d::distance(int f, int p) const
+{
+    const Face &face = faces_[f];
+    const Point3d &q = pt_[p];
+    return face.n[0] * q.x + face.n[1] * q.y + face.n[2] * q.z - face.d;
+}
+
+void ConvexHull3d::addConflict(int f, int p)
+{
+    Face &face = faces_[f];
+    const double d = distance(f, p);
+    next_[p] = face.conflict;
+    face.conflict = p;
+    if (d > face.farthestDist)
+    {
+        face.farthest = p;
+        face.farthestDist = d;
+    }
+}
+
+bool ConvexHull3d::initialSimplex()
+{
+    const int n = static_cast<int>(pt_.size());
+    const AABB3d box = extremalPoints(pt_).box;
+    epsilon_ = 3.0f * FLT_EPSILON *
+               (std::abs(box.c.x) + box.r[0] + std::abs(box.c.y) + box.r[1] +
+                std::abs(box.c.z) + box.r[2]);
+
+    // The two most separated extreme points, the point farthest from the
+    // line through them and the point farthest from the plane of all three
+    int v[4];
+    mostSeparatePointsOnAABB(v[0], v[1], pt_);
+    const Point3d &p0 = pt_[v[0]];
+    const Point3d d01 = pt_[v[1]] - p0;
+    const float len = std::sqrt(dotProd(d01, d01));
+    if (len <= epsilon_)
+        return false;
+
+    float best = 0.0f;
+    v[2] = -1;
+    for (int i = 0; i < n; ++i)
+    {
+        const Point3d c = crossProd(pt_[i] - p0, d01);
+        const float d = dotProd(c, c);
+        if (d > best)
+        {
+            best = d;
+            v[2] = i;
+        }
+    }
+    if (v[2] == -1 || std::sqrt(best) / len <= epsilon_)
+        return false;
+
+    const Point3d n012 = normal(p0, pt_[v[1]], pt_[v[2]]);
+    best = 0.0f;
+    v[3] = -1;
+    for (int i = 0; i < n; ++i)
+    {
+        const float d = std::abs(dotProd(n012, pt_[i] - p0));
+        if (d > best)
+        {
+            best = d;
+            v[3] = i;
+        }
+    }
+    if (v[3] == -1 || best <= epsilon_)
+        return false;
+
+    // Orient the base so that the apex lies behind it
+    if (dotProd(n012, pt_[v[3]] - p0) > 0.0f)
+        std::swap(v[1], v[2]);
+    int f[4] = {allocateFace(v[0], v[1], v[2]),
+                allocateFace(v[0], v[3], v[1]),
+                allocateFace(v[1], v[3], v[2]),
+                allocateFace(v[2], v[3], v[0])};
+    for (int i = 0; i < 4; ++i)
+        for (int k = 0; k < 3; ++k)
+            for (int j = 0; j < 4; ++j)
+                for (int l = 0; l < 3; ++l)
+                    if (faces_[f[i]].v[k] == faces_[f[j]].v[(l + 1) % 3] &&
+                        faces_[f[i]].v[(k + 1) % 3] == faces_[f[j]].v[l])
+                        link(3 * f[i] + k, 3 * f[j] + l);
+
+    // Every point goes to the face it is farthest in front of, if any
+    for (int i = 0; i < n; ++i)
+    {
+        if (i == v[0] || i == v[1] || i == v[2] || i == v[3])
+            continue;
+        int bestFace = -1;
+        double bestDist = epsilon_;
+        for (int j = 0; j < 4; ++j)
+        {
+            const double d = distance(f[j], i);
+            if (d > bestDist)
+            {
+                bestDist = d;
+                bestFace = f[j];
+            }
+        }
+        if (bestFace != -1)
+            addConflict(bestFace, i);
+    }
+    for (int j = 0; j < 4; ++j)
+        if (faces_[f[j]].conflict != -1)
+            pending_.push_back(f[j]);
+    return true;
+}
+
+// Depth first search of the faces 'eye' sees, starting at the visible face
+// 'f'. Each face is left through the edge after the one it was entered by,
+// so the horizon edges come out in counterclockwise order. Returns false if
+// rounding made the visible faces anything but a disk, that is if the
+// horizon is not one simple loop.
+bool ConvexHull3d::findHorizon(int f, int eye)
+{
+    ++mark_;
+    visible_.clear();
+    horizon_.clear();
+    stack_.clear();
+    faces_[f].mark = mark_;
+    visible_.push_back(f);
+    // Face and 4 * first edge + edges done
+    stack_.push_back({f, 0});
+    while (!stack_.empty())
+    {
+        const int g = stack_.back().first;
+        const int state = stack_.back().second;
+        const int edges = stack_.size() == 1 ? 3 : 2;
+        if (state % 4 == edges)
+        {
+            stack_.pop_back();
+            continue;
+        }
+        ++stack_.back().second;
+        const int k = (state / 4 + state % 4) % 3;
+        const int e = faces_[g].twin[k];
+        const int h = e / 3;
+        if (faces_[h].mark == mark_)
+            continue;
+        if (distance(h, eye) > 0.0)
+        {
+            faces_[h].mark = mark_;
+            visible_.push_back(h);
+            stack_.push_back({h, 4 * ((e % 3 + 1) % 3)});
+        }
+        else
+            horizon_.push_back({faces_[g].v[k], faces_[g].v[(k + 1) % 3], e});
+    }
+
+    const size_t m = horizon_.size();
+    for (size_t i = 0; i < m; ++i)
+    {
+        if (horizon_[i].b != horizon_[(i + 1) % m].a ||
+            vertexMark_[horizon_[i].a] == mark_)
+            return false;
+        vertexMark_[horizon_[i].a] = mark_;
+    }
+    return true;
+}
+
+void ConvexHull3d::addPoint(int f)
+{
+    const int eye = faces_[f].farthest;
+    if (!findHorizon(f, eye))
+    {
+        // Drop the point rather than build a folded mesh
+        Face &face = faces_[f];
+        int *prev = &face.conflict;
+        while (*prev != eye)
+            prev = &next_[*prev];
+        *prev = next_[eye];
+        face.farthest = -1;
+        face.farthestDist = 0.0;
+        for (int p = face.conflict; p != -1; p = next_[p])
+        {
+            const double d = distance(f, p);
+            if (d > face.farthestDist)
+            {
+                face.farthest = p;
+                face.farthestDist = d;
+            }
+        }
+        if (face.conflict != -1)
+            pending_.push_back(f);
+        return;
+    }
+
+    // The points of the removed faces need new homes
+    orphans_.clear();
+    for (int g : visible_)
+    {
+        for (int p = faces_[g].conflict; p != -1; p = next_[p])
+            if (p != eye)
+                orphans_.push_back(p);
+        freeFace(g);
+    }
+
+    // Fan of new faces from the eye to the horizon
+    newFaces_.clear();
+    for (const HorizonEdge &h : horizon_)
+    {
+        const int g = allocateFace(h.a, h.b, eye);
+        link(3 * g, h.twin);
+        newFaces_.push_back(g);
+    }
+    const size_t m = newFaces_.size();
+    for (size_t i = 0; i < m; ++i)
+        link(3 * newFaces_[i] + 1, 3 * newFaces_[(i + 1) % m] + 2);
+
+    for (int p : orphans_)
+    {
+        int bestFace = -1;
+        double bestDist = epsilon_;
+        for (int g : newFaces_)
+        {
+            const double d = distance(g, p);
+            if (d > bestDist)
+            {
+                bestDist = d;
+                bestFace = g;
+            }
+        }
+        if (bestFace != -1)
+            addConflict(bestFace, p);
+    }
+    for (int g : newFaces_)
+        if (faces_[g].conflict != -1)
+            pending_.push_back(g);
+}
+
+void ConvexHull3d::output()
+{
+    for (const Face &face : faces_)
+    {
+        if (face.mark < 0)
+            continue;
+        HullTriangle t;
+        for (int k = 0; k < 3; ++k)
+        {
+            t.v[k] = face.v[k];
+            vertices_.push_back(face.v[k]);
+        }
+        t.plane.n = {float(face.n[0]), float(face.n[1]), float(face.n[2])};
+        t.plane.d = float(face.d);
+        triangles_.push_back(t);
+    }
+    std::sort(vertices_.begin(), vertices_.end());
+    vertices_.erase(std::unique(vertices_.begin(), vertices_.end()),
+                    vertices_.end());
+}
+
+bool ConvexHull3d::build(std::span<const Point3d> pt)
+{
+    pt_ = pt;
+    freeFaces_ = -1;
+    faces_.clear();
+    pending_.clear();
+    triangles_.clear();
+    vertices_.clear();
+    epsilon_ = 0.0f;
+    if (pt.size() < 4)
+        return false;
+    next_.assign(pt.size(), -1);
+    vertexMark_.assign(pt.size(), 0);
+    mark_ = 0;
+    if (!initialSimplex())
+    {
+        faces_.clear();
+        return false;
+    }
+
+    // Faces may have been freed, or reused and queued again, since they
+    // were queued; stale entries have no conflicts left.
+    while (!pending_.empty())
+    {
+        const int f = pending_.back();
+        pending_.pop_back();
+        if (faces_[f].mark >= 0 && faces_[f].conflict != -1)
+            addPoint(f);
+    }
+    output();
+    return true;
+}
@@ -0,0 +1,111 @@
+#ifndef HULL3D_HPP_INCLUDED
+#define HULL3D_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include <span>
+#include <utility>
+#include <vector>
+
+// Hull triangle: indices of its input points, counterclockwise seen from
+// outside, and its plane with the normal pointing outwards.
+struct HullTriangle
+{
+    int v[3];
+    Plane plane;
+};
+
+// 3D convex hull by Quickhull. Faces are triangles joined by half-edges and
+// every face keeps the points in front of it in a conflict list; each step
+// takes the farthest conflict point of a face, removes the faces it sees and
+// fans new faces from it to their horizon. Faces and half-edges live in one
+// pool with a free list and the conflict lists are chained through a per
+// point array, so after the first build of a given size no step allocates.
+//
+// Visibility is decided in double against planes through the face vertices,
+// which for float input is close to exact and keeps the mesh from folding.
+// A point only counts as outside a face when it is more than an epsilon
+// scaled to the extent of the input in front of it, so points within
+// epsilon of the hull may or may not end up as vertices and adjacent faces
+// may be coplanar.
+class ConvexHull3d
+{
+public:
+    // Build the hull of 'pt', replacing the previous one. Returns false, and
+    // leaves no faces, when the points are within epsilon of a plane.
+    bool build(std::span<const Point3d> pt);
+
+    const std::vector<HullTriangle> &triangles() const
+    {
+        return triangles_;
+    }
+
+    // Indices of the input points on the hull, ascending.
+    const std::vector<int> &vertices() const
+    {
+        return vertices_;
+    }
+
+    // Distance within which the last build treated points as coplanar.
+    float epsilon() const
+    {
+        return epsilon_;
+    }
+private:
+    // Half-edge k of face f is 3 * f + k and runs from v[k] to v[(k + 1) % 3].
+    // twin[k] is the opposite half-edge in the neighbouring face. Free faces
+    // are chained through 'conflict'.
+    struct Face
+    {
+        int v[3];
+        int twin[3];
+        // Unit normal and offset, in double: see allocateFace()
+        double n[3];
+        double d;
+        // Head of the conflict list, its farthest point and their distance.
+        int conflict;
+        int farthest;
+        double farthestDist;
+        // Search that found the face visible; -1 once the face is free.
+        int mark;
+    };
+
+    // Horizon edge: its vertices and the half-edge on the hidden side.
+    struct HorizonEdge
+    {
+        int a;
+        int b;
+        int twin;
+    };
+
+    int allocateFace(int a, int b, int c);
+    void freeFace(int f);
+    void link(int e1, int e2);
+    double distance(int f, int p) const;
+    void addConflict(int f, int p);
+    bool initialSimplex();
+    bool findHorizon(int f, int eye);
+    void addPoint(int f);
+    void output();
+
+    std::span<const Point3d> pt_;
+    float epsilon_ = 0.0f;
+    int freeFaces_ = -1;
+    int mark_ = 0;
+    std::vector<Face> faces_;
+    // Next point in the same conflict list.
+    std::vector<int> next_;
+    // Last search that put the point on the horizon.
+    std::vector<int> vertexMark_;
+    // Scratch space kept between steps and builds.
+    std::vector<int> pending_;
+    std::vector<int> visible_;
+    std::vector<int> orphans_;
+    std::vector<int> newFaces_;
+    std::vector<HorizonEdge> horizon_;
+    std::vector<std::pair<int, int>> stack_;
+
+    std::vector<HullTriangle> triangles_;
+    std::vector<int> vertices_;
+};
+
+#endif
@@ -0,0 +1,355 @@
+#include "geometry.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include <cassert>
+
+// Batches below this size are not worth handing to other threads.
+static constexpr size_t PARALLEL_GRAIN = 1 << 14;
+
+// The cofactor formulas are written once over V: float for the scalar path,
+// and __m256 for the AVX2 path through the compiler's vector operators, one
+// matrix per lane. Elements are numbered row by row. Results go through
+// references, as returning a vector type by value from a function without
+// AVX enabled would change its ABI.
+namespace
+{
+template<typename V>
+[[gnu::always_inline]] inline void
+adjugate3(const V (&a)[9], V (&b)[9], V &det)
+{
+    b[0] = a[4] * a[8] - a[5] * a[7];
+    b[1] = a[2] * a[7] - a[1] * a[8];
+    b[2] = a[1] * a[5] - a[2] * a[4];
+    b[3] = a[5] * a[6] - a[3] * a[8];
+    b[4] = a[0] * a[8] - a[2] * a[6];
+    b[5] = a[2] * a[3] - a[0] * a[5];
+    b[6] = a[3] * a[7] - a[4] * a[6];
+    b[7] = a[1] * a[6] - a[0] * a[7];
+    b[8] = a[0] * a[4] - a[1] * a[3];
+    det = a[0] * b[0] + a[1] * b[3] + a[2] * b[6];
+}
+
+// The 2x2 minors of the top two rows (s) and of the bottom two (c) give
+// both the determinant and every cofactor.
+template<typename V>
+[[gnu::always_inline]] inline void
+minors4(const V (&a)[16], V (&s)[6], V (&c)[6])
+{
+    s[0] = a[0] * a[5] - a[4] * a[1];
+    s[1] = a[0] * a[6] - a[4] * a[2];
+    s[2] = a[0] * a[7] - a[4] * a[3];
+    s[3] = a[1] * a[6] - a[5] * a[2];
+    s[4] = a[1] * a[7] - a[5] * a[3];
+    s[5] = a[2] * a[7] - a[6] * a[3];
+    c[0] = a[8] * a[13] - a[12] * a[9];
+    c[1] = a[8] * a[14] - a[12] * a[10];
+    c[2] = a[8] * a[15] - a[12] * a[11];
+    c[3] = a[9] * a[14] - a[13] * a[10];
+    c[4] = a[9] * a[15] - a[13] * a[11];
+    c[5] = a[10] * a[15] - a[14] * a[11];
+}
+
+template<typename V>
+[[gnu::always_inline]] inline void
+determinant4(const V (&s)[6], const V (&c)[6], V &det)
+{
+    det = s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] -
+          s[4] * c[1] + s[5] * c[0];
+}
+
+template<typename V>
+[[gnu::always_inline]] inline void
+adjugate4(const V (&a)[16], V (&b)[16], V &det)
+{
+    V s[6], c[6];
+    minors4(a, s, c);
+    b[0] = a[5] * c[5] - a[6] * c[4] + a[7] * c[3];
+    b[1] = a[2] * c[4] - a[1] * c[5] - a[3] * c[3];
+    b[2] = a[13] * s[5] - a[14] * s[4] + a[15] * s[3];
+    b[3] = a[10] * s[4] - a[9] * s[5] - a[11] * s[3];
+    b[4] = a[6] * c[2] - a[4] * c[5] - a[7] * c[1];
+    b[5] = a[0] * c[5] - a[2] * c[2] + a[3] * c[1];
+    b[6] = a[14] * s[2] - a[12] * s[5] - a[15] * s[1];
+    b[7] = a[8] * s[5] - a[10] * s[2] + a[11] * s[1];
+    b[8] = a[4] * c[4] - a[5] * c[2] + a[7] * c[0];
+    b[9] = a[1] * c[2] - a[0] * c[4] - a[3] * c[0];
+    b[10] = a[12] * s[4] - a[13] * s[2] + a[15] * s[0];
+    b[11] = a[9] * s[2] - a[8] * s[4] - a[11] * s[0];
+    b[12] = a[5] * c[1] - a[4] * c[3] - a[6] * c[0];
+    b[13] = a[0] * c[3] - a[1] * c[1] + a[2] * c[0];
+    b[14] = a[13] * s[1] - a[12] * s[3] - a[14] * s[0];
+    b[15] = a[8] * s[3] - a[9] * s[1] + a[10] * s[0];
+    determinant4(s, c, det);
+}
+
+void determinantScalar(const Matrix33 *m, float *det, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        const Matrix33 &a = m[i];
+        det[i] = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) +
+                 a[0][1] * (a[1][2] * a[2][0] - a[1][0] * a[2][2]) +
+                 a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    }
+}
+
+void determinantScalar(const Matrix44 *m, float *det, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        float s[6], c[6];
+        minors4(reinterpret_cast<const float(&)[16]>(m[i].m), s, c);
+        determinant4(s, c, det[i]);
+    }
+}
+
+void inverseScalar(const Matrix33 *m, Matrix33 *inv, float *det, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        float a[9], b[9];
+        for (int k = 0; k < 9; ++k)
+            a[k] = m[i][k / 3][k % 3];
+        adjugate3(a, b, det[i]);
+        const float scale = det[i] != 0.0f ? 1.0f / det[i] : 0.0f;
+        for (int k = 0; k < 9; ++k)
+            inv[i][k / 3][k % 3] = b[k] * scale;
+    }
+}
+
+void inverseScalar(const Matrix44 *m, Matrix44 *inv, float *det, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        float b[16];
+        adjugate4(reinterpret_cast<const float(&)[16]>(m[i].m), b, det[i]);
+        const float scale = det[i] != 0.0f ? 1.0f / det[i] : 0.0f;
+        for (int k = 0; k < 16; ++k)
+            inv[i].m[k / 4][k % 4] = b[k] * scale;
+    }
+}
+
+#ifdef GEOMETRY_X86
+
+// Eight Matrix33 to one register per element and back. The first two
+// padded rows of each matrix form an 8x8 block, the third row a 4x8 one.
+GEOMETRY_AVX2 inline void load33x8(const Matrix33 *m, __m256 (&a)[9])
+{
+    __m256 r[8], t[4];
+    for (int i = 0; i < 8; ++i)
+        r[i] = _mm256_loadu_ps(m[i][0]);
+    for (int i = 0; i < 4; ++i)
+        t[i] = _mm256_loadu2_m128(m[i + 4][2], m[i][2]);
+    transpose8x8(r);
+    transpose4x4Halves(t);
+    for (int k = 0; k < 3; ++k)
+    {
+        a[k] = r[k];
+        a[3 + k] = r[4 + k];
+        a[6 + k] = t[k];
+    }
+}
+
+GEOMETRY_AVX2 inline void store33x8(const __m256 (&b)[9], Matrix33 *m)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 r[8] = {b[0], b[1], b[2], zero, b[3], b[4], b[5], zero};
+    __m256 t[4] = {b[6], b[7], b[8], zero};
+    transpose8x8(r);
+    transpose4x4Halves(t);
+    for (int i = 0; i < 8; ++i)
+        _mm256_storeu_ps(m[i][0], r[i]);
+    for (int i = 0; i < 4; ++i)
+        _mm256_storeu2_m128(m[i + 4][2], m[i][2], t[i]);
+}
+
+// Eight Matrix44 to one register per element and back, as two 8x8 blocks.
+GEOMETRY_AVX2 inline void load44x8(const Matrix44 *m, __m256 (&a)[16])
+{
+    __m256 lo[8], hi[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        lo[i] = _mm256_loadu_ps(&m[i].m[0][0]);
+        hi[i] = _mm256_loadu_ps(&m[i].m[2][0]);
+    }
+    transpose8x8(lo);
+    transpose8x8(hi);
+    for (int k = 0; k < 8; ++k)
+    {
+        a[k] = lo[k];
+        a[8 + k] = hi[k];
+    }
+}
+
+GEOMETRY_AVX2 inline void store44x8(const __m256 (&b)[16], Matrix44 *m)
+{
+    __m256 lo[8], hi[8];
+    for (int k = 0; k < 8; ++k)
+    {
+        lo[k] = b[k];
+        hi[k] = b[8 + k];
+    }
+    transpose8x8(lo);
+    transpose8x8(hi);
+    for (int i = 0; i < 8; ++i)
+    {
+        _mm256_storeu_ps(&m[i].m[0][0], lo[i]);
+        _mm256_storeu_ps(&m[i].m[2][0], hi[i]);
+    }
+}
+
+// 1 / det, or 0 where det is 0.
+GEOMETRY_AVX2 inline __m256 inverseScale(__m256 det)
+{
+    const __m256 nonzero =
+        _mm256_cmp_ps(det, _mm256_setzero_ps(), _CMP_NEQ_OQ);
+    return _mm256_and_ps(_mm256_div_ps(_mm256_set1_ps(1.0f), det), nonzero);
+}
+
+GEOMETRY_AVX2 void determinantAvx2(const Matrix33 *m, float *det, size_t n)
+{
+    for (size_t i = 0; i < n; i += 8)
+    {
+        __m256 a[9], b[9], d;
+        load33x8(m + i, a);
+        adjugate3(a, b, d);
+        _mm256_storeu_ps(det + i, d);
+    }
+}
+
+GEOMETRY_AVX2 void determinantAvx2(const Matrix44 *m, float *det, size_t n)
+{
+    for (size_t i = 0; i < n; i += 8)
+    {
+        __m256 a[16], s[6], c[6], d;
+        load44x8(m + i, a);
+        minors4(a, s, c);
+        determinant4(s, c, d);
+        _mm256_storeu_ps(det + i, d);
+    }
+}
+
+GEOMETRY_AVX2 void
+inverseAvx2(const Matrix33 *m, Matrix33 *inv, float *det, size_t n)
+{
+    for (size_t i = 0; i < n; i += 8)
+    {
+        __m256 a[9], b[9], d;
+        load33x8(m + i, a);
+        adjugate3(a, b, d);
+        const __m256 scale = inverseScale(d);
+        for (__m256 &v : b)
+            v = _mm256_mul_ps(v, scale);
+        store33x8(b, inv + i);
+        _mm256_storeu_ps(det + i, d);
+    }
+}
+
+GEOMETRY_AVX2 void
+inverseAvx2(const Matrix44 *m, Matrix44 *inv, float *det, size_t n)
+{
+    for (size_t i = 0; i < n; i += 8)
+    {
+        __m256 a[16], b[16], d;
+        load44x8(m + i, a);
+        adjugate4(a, b, d);
+        const __m256 scale = inverseScale(d);
+        for (__m256 &v : b)
+            v = _mm256_mul_ps(v, scale);
+        store44x8(b, inv + i);
+        _mm256_storeu_ps(det + i, d);
+    }
+}
+
+#endif
+
+template<typename F>
+void run(size_t n, bool parallel, F &&kernel)
+{
+    if (parallel)
+        parallelFor(n, PARALLEL_GRAIN, kernel);
+    else
+        kernel(size_t(0), n);
+}
+} // namespace
+
+// Each kernel takes whole groups of eight through AVX2 when the CPU has it
+// and the rest through the scalar loop.
+
+void determinant(std::span<const Matrix33> m,
+                 std::span<float> det,
+                 bool parallel)
+{
+    assert(m.size() == det.size());
+    run(m.size(), parallel, [&](size_t begin, size_t end) {
+        size_t i = begin;
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+        {
+            const size_t n = (end - begin) & ~size_t(7);
+            determinantAvx2(m.data() + i, det.data() + i, n);
+            i += n;
+        }
+#endif
+        determinantScalar(m.data() + i, det.data() + i, end - i);
+    });
+}
+
+void determinant(std::span<const Matrix44> m,
+                 std::span<float> det,
+                 bool parallel)
+{
+    assert(m.size() == det.size());
+    run(m.size(), parallel, [&](size_t begin, size_t end) {
+        size_t i = begin;
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+        {
+            const size_t n = (end - begin) & ~size_t(7);
+            determinantAvx2(m.data() + i, det.data() + i, n);
+            i += n;
+        }
+#endif
+        determinantScalar(m.data() + i, det.data() + i, end - i);
+    });
+}
+
+void inverse(std::span<const Matrix33> m,
+             std::span<Matrix33> inv,
+             std::span<float> det,
+             bool parallel)
+{
+    assert(m.size() == inv.size() && m.size() == det.size());
+    run(m.size(), parallel, [&](size_t begin, size_t end) {
+        size_t i = begin;
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+        {
+            const size_t n = (end - begin) & ~size_t(7);
+            inverseAvx2(m.data() + i, inv.data() + i, det.data() + i, n);
+            i += n;
+        }
+#endif
+        inverseScalar(m.data() + i, inv.data() + i, det.data() + i, end - i);
+    });
+}
+
+void inverse(std::span<const Matrix44> m,
+             std::span<Matrix44> inv,
+             std::span<float> det,
+             bool parallel)
+{
+    assert(m.size() == inv.size() && m.size() == det.size());
+    run(m.size(), parallel, [&](size_t begin, size_t end) {
+        size_t i = begin;
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+        {
+            const size_t n = (end - begin) & ~size_t(7);
+            inverseAvx2(m.data() + i, inv.data() + i, det.data() + i, n);
+            i += n;
+        }
+#endif
+        inverseScalar(m.data() + i, inv.data() + i, det.data() + i, end - i);
+    });
+}
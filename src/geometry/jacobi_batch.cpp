@@ -0,0 +1,207 @@
+#include "geometry.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include <cassert>
+#include <cmath>
+
+// Batches below this size are not worth handing to other threads.
+static constexpr size_t PARALLEL_GRAIN = 1 << 12;
+// A sweep stops once every off-diagonal entry is this small relative to the
+// diagonal; cyclic Jacobi converges quadratically so this takes 3-5 sweeps.
+static constexpr float TOLERANCE = 1e-6f;
+static constexpr int MAX_SWEEPS = 10;
+
+// The symmetric matrix is kept as its diagonal d and its off-diagonal o,
+// where o[r] is the entry of the pair (p, q) not involving r. The rotation
+// zeroing o[r] only mixes the other two off-diagonal entries and columns p
+// and q of the eigenvectors w. The scalar and AVX2 kernels below perform
+// the same operations.
+static void rotate(float (&d)[3],
+                   float (&o)[3],
+                   float (&w)[3][3],
+                   int p,
+                   int q)
+{
+    const int r = 3 - p - q;
+    const float apq = o[r];
+    if (apq == 0.0f)
+        return;
+    const float rho = (d[q] - d[p]) / (2.0f * apq);
+    const float t = std::copysign(
+        1.0f / (std::abs(rho) + std::sqrt(1.0f + rho * rho)), rho);
+    const float c = 1.0f / std::sqrt(1.0f + t * t);
+    const float s = t * c;
+    d[p] -= t * apq;
+    d[q] += t * apq;
+    o[r] = 0.0f;
+    const float arp = o[q], arq = o[p];
+    o[q] = c * arp - s * arq;
+    o[p] = s * arp + c * arq;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float wkp = w[k][p], wkq = w[k][q];
+        w[k][p] = c * wkp - s * wkq;
+        w[k][q] = s * wkp + c * wkq;
+    }
+}
+
+static void jacobiCyclic(const Matrix33 *a,
+                         Matrix33 *v,
+                         Point3d *eigenvalues,
+                         size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        const Matrix33 &m = a[i];
+        float d[3] = {m[0][0], m[1][1], m[2][2]};
+        float o[3] = {m[1][2], m[0][2], m[0][1]};
+        float w[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+        for (int sweep = 0; sweep < MAX_SWEEPS; ++sweep)
+        {
+            const float off = o[0] * o[0] + o[1] * o[1] + o[2] * o[2];
+            const float diag = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            if (off <= TOLERANCE * TOLERANCE * diag)
+                break;
+            rotate(d, o, w, 0, 1);
+            rotate(d, o, w, 0, 2);
+            rotate(d, o, w, 1, 2);
+        }
+        for (int r = 0; r < 3; ++r)
+            for (int k = 0; k < 3; ++k)
+                v[i][r][k] = w[r][k];
+        eigenvalues[i] = {d[0], d[1], d[2]};
+    }
+}
+
+#ifdef GEOMETRY_X86
+
+// Gather entry 'k' of eight consecutive matrices.
+GEOMETRY_AVX2 static inline __m256 gather(const float *base,
+                                          __m256i stride,
+                                          int k)
+{
+    return _mm256_i32gather_ps(base + k, stride, 4);
+}
+
+GEOMETRY_AVX2 static inline void rotateLanes(__m256 (&d)[3],
+                                             __m256 (&o)[3],
+                                             __m256 (&w)[3][3],
+                                             int p,
+                                             int q)
+{
+    const int r = 3 - p - q;
+    const __m256 apq = o[r];
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 rho = _mm256_div_ps(_mm256_sub_ps(d[q], d[p]),
+                                     _mm256_add_ps(apq, apq));
+    __m256 t = _mm256_div_ps(
+        one,
+        _mm256_add_ps(_mm256_andnot_ps(sign, rho),
+                      _mm256_sqrt_ps(_mm256_fmadd_ps(rho, rho, one))));
+    t = _mm256_or_ps(t, _mm256_and_ps(rho, sign));
+    // Lanes with apq == 0 (rho infinite or NaN) don't rotate.
+    t = _mm256_and_ps(
+        t, _mm256_cmp_ps(apq, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+    const __m256 c =
+        _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_fmadd_ps(t, t, one)));
+    const __m256 s = _mm256_mul_ps(t, c);
+
+    d[p] = _mm256_fnmadd_ps(t, apq, d[p]);
+    d[q] = _mm256_fmadd_ps(t, apq, d[q]);
+    o[r] = _mm256_setzero_ps();
+    const __m256 arp = o[q], arq = o[p];
+    o[q] = _mm256_fmsub_ps(c, arp, _mm256_mul_ps(s, arq));
+    o[p] = _mm256_fmadd_ps(s, arp, _mm256_mul_ps(c, arq));
+    for (int k = 0; k < 3; ++k)
+    {
+        const __m256 wkp = w[k][p], wkq = w[k][q];
+        w[k][p] = _mm256_fmsub_ps(c, wkp, _mm256_mul_ps(s, wkq));
+        w[k][q] = _mm256_fmadd_ps(s, wkp, _mm256_mul_ps(c, wkq));
+    }
+}
+
+GEOMETRY_AVX2 static void jacobiAvx2(const Matrix33 *a,
+                                     Matrix33 *v,
+                                     Point3d *eigenvalues,
+                                     size_t n)
+{
+    static_assert(sizeof(Matrix33) == 12 * sizeof(float));
+    const __m256i stride = _mm256_setr_epi32(0, 12, 24, 36, 48, 60, 72, 84);
+    const __m256 tolerance = _mm256_set1_ps(TOLERANCE * TOLERANCE);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const float *base = a[i][0];
+        __m256 d[3] = {gather(base, stride, 0),
+                       gather(base, stride, 5),
+                       gather(base, stride, 10)};
+        __m256 o[3] = {gather(base, stride, 6),
+                       gather(base, stride, 2),
+                       gather(base, stride, 1)};
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+        __m256 w[3][3] = {{one, zero, zero}, {zero, one, zero},
+                          {zero, zero, one}};
+
+        for (int sweep = 0; sweep < MAX_SWEEPS; ++sweep)
+        {
+            __m256 off = _mm256_mul_ps(o[0], o[0]);
+            off = _mm256_fmadd_ps(o[1], o[1], off);
+            off = _mm256_fmadd_ps(o[2], o[2], off);
+            __m256 diag = _mm256_mul_ps(d[0], d[0]);
+            diag = _mm256_fmadd_ps(d[1], d[1], diag);
+            diag = _mm256_fmadd_ps(d[2], d[2], diag);
+            const __m256 done = _mm256_cmp_ps(
+                off, _mm256_mul_ps(tolerance, diag), _CMP_LE_OQ);
+            if (_mm256_movemask_ps(done) == 0xff)
+                break;
+            rotateLanes(d, o, w, 0, 1);
+            rotateLanes(d, o, w, 0, 2);
+            rotateLanes(d, o, w, 1, 2);
+        }
+
+        alignas(32) float out[12][8];
+        for (int r = 0; r < 3; ++r)
+        {
+            for (int k = 0; k < 3; ++k)
+                _mm256_store_ps(out[3 * r + k], w[r][k]);
+            _mm256_store_ps(out[9 + r], d[r]);
+        }
+        for (int l = 0; l < 8; ++l)
+        {
+            for (int r = 0; r < 3; ++r)
+                for (int k = 0; k < 3; ++k)
+                    v[i + l][r][k] = out[3 * r + k][l];
+            eigenvalues[i + l] = {out[9][l], out[10][l], out[11][l]};
+        }
+    }
+    jacobiCyclic(a + i, v + i, eigenvalues + i, n - i);
+}
+
+#endif
+
+void Jacobi(std::span<const Matrix33> a,
+            std::span<Matrix33> v,
+            std::span<Point3d> eigenvalues,
+            bool parallel)
+{
+    assert(a.size() == v.size() && a.size() == eigenvalues.size());
+    auto kernel = [&](size_t begin, size_t end) {
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+            return jacobiAvx2(a.data() + begin,
+                              v.data() + begin,
+                              eigenvalues.data() + begin,
+                              end - begin);
+#endif
+        jacobiCyclic(a.data() + begin,
+                     v.data() + begin,
+                     eigenvalues.data() + begin,
+                     end - begin);
+    };
+    if (parallel)
+        parallelFor(a.size(), PARALLEL_GRAIN, kernel);
+    else
+        kernel(size_t(0), a.size());
+}
@@ -0,0 +1,439 @@
+#include "kdtree.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+// Ranges at least this large build their halves in parallel.
+static constexpr size_t PARALLEL_THRESHOLD = 1 << 15;
+// Coordinate arrays run this far past the last point, so a leaf can always
+// be loaded eight lanes at a time.
+static constexpr size_t PADDING = 8;
+
+namespace
+{
+template<typename P>
+float coord(const P &p, int axis)
+{
+    return (&p.x)[axis];
+}
+
+// Left half of a range of n points
+size_t half(size_t n)
+{
+    return (n + 1) / 2;
+}
+
+// Lanes of a leaf block that hold points, of the n left in the leaf.
+uint32_t laneMask(size_t n)
+{
+    return n >= 8 ? 0xffu : (1u << n) - 1;
+}
+
+// Add a point to the 'count' nearest found so far, kept sorted in 'out';
+// when the list is full the point is known to beat its last entry.
+inline void insert(std::span<KdNeighbor> out,
+                   size_t &count,
+                   uint32_t index,
+                   float dist2)
+{
+    size_t i = count < out.size() ? count++ : out.size() - 1;
+    for (; i > 0 && out[i - 1].dist2 > dist2; --i)
+        out[i] = out[i - 1];
+    out[i] = {index, dist2};
+}
+
+inline float worst(std::span<const KdNeighbor> out, size_t count)
+{
+    return count < out.size() ? std::numeric_limits<float>::infinity()
+                              : out.back().dist2;
+}
+
+// Leaf scans over the points [b, e) of the coordinate arrays c.
+template<int D>
+void nearestLeaf(const float *const *c,
+                 const uint32_t *index,
+                 size_t b,
+                 size_t e,
+                 const float (&q)[D],
+                 std::span<KdNeighbor> out,
+                 size_t &count)
+{
+    for (size_t i = b; i < e; ++i)
+    {
+        float d2 = 0.0f;
+        for (int k = 0; k < D; ++k)
+            d2 += (c[k][i] - q[k]) * (c[k][i] - q[k]);
+        if (d2 < worst(out, count))
+            insert(out, count, index[i], d2);
+    }
+}
+
+template<int D>
+void radiusLeaf(const float *const *c,
+                const uint32_t *index,
+                size_t b,
+                size_t e,
+                const float (&q)[D],
+                float r2,
+                std::vector<uint32_t> &out)
+{
+    for (size_t i = b; i < e; ++i)
+    {
+        float d2 = 0.0f;
+        for (int k = 0; k < D; ++k)
+            d2 += (c[k][i] - q[k]) * (c[k][i] - q[k]);
+        if (d2 <= r2)
+            out.push_back(index[i]);
+    }
+}
+
+template<int D>
+void boxLeaf(const float *const *c,
+             const uint32_t *index,
+             size_t b,
+             size_t e,
+             const float (&mn)[D],
+             const float (&mx)[D],
+             std::vector<uint32_t> &out)
+{
+    for (size_t i = b; i < e; ++i)
+    {
+        bool inside = true;
+        for (int k = 0; k < D; ++k)
+            inside = inside && c[k][i] >= mn[k] && c[k][i] <= mx[k];
+        if (inside)
+            out.push_back(index[i]);
+    }
+}
+
+#ifdef GEOMETRY_X86
+
+template<int D>
+GEOMETRY_AVX2 inline __m256 distances8(const float *const *c,
+                                       size_t i,
+                                       const __m256 (&q)[D])
+{
+    __m256 d2 = _mm256_setzero_ps();
+    for (int k = 0; k < D; ++k)
+    {
+        const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(c[k] + i), q[k]);
+        d2 = _mm256_fmadd_ps(d, d, d2);
+    }
+    return d2;
+}
+
+template<int D>
+GEOMETRY_AVX2 void nearestLeafAvx2(const float *const *c,
+                                   const uint32_t *index,
+                                   size_t b,
+                                   size_t e,
+                                   const float (&q)[D],
+                                   std::span<KdNeighbor> out,
+                                   size_t &count)
+{
+    __m256 vq[D];
+    for (int k = 0; k < D; ++k)
+        vq[k] = _mm256_set1_ps(q[k]);
+    alignas(32) float d2[8];
+    for (size_t i = b; i < e; i += 8)
+    {
+        const __m256 d = distances8(c, i, vq);
+        uint32_t mask =
+            laneMask(e - i) &
+            uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(
+                d, _mm256_set1_ps(worst(out, count)), _CMP_LT_OQ)));
+        if (mask == 0)
+            continue;
+        _mm256_store_ps(d2, d);
+        for (; mask; mask &= mask - 1)
+        {
+            const int l = std::countr_zero(mask);
+            // Earlier lanes may have tightened the bound
+            if (d2[l] < worst(out, count))
+                insert(out, count, index[i + l], d2[l]);
+        }
+    }
+}
+
+template<int D>
+GEOMETRY_AVX2 void radiusLeafAvx2(const float *const *c,
+                                  const uint32_t *index,
+                                  size_t b,
+                                  size_t e,
+                                  const float (&q)[D],
+                                  float r2,
+                                  std::vector<uint32_t> &out)
+{
+    __m256 vq[D];
+    for (int k = 0; k < D; ++k)
+        vq[k] = _mm256_set1_ps(q[k]);
+    const __m256 vr2 = _mm256_set1_ps(r2);
+    for (size_t i = b; i < e; i += 8)
+    {
+        const __m256 d = distances8(c, i, vq);
+        uint32_t mask = laneMask(e - i) &
+                        uint32_t(_mm256_movemask_ps(
+                            _mm256_cmp_ps(d, vr2, _CMP_LE_OQ)));
+        for (; mask; mask &= mask - 1)
+            out.push_back(index[i + std::countr_zero(mask)]);
+    }
+}
+
+template<int D>
+GEOMETRY_AVX2 void boxLeafAvx2(const float *const *c,
+                               const uint32_t *index,
+                               size_t b,
+                               size_t e,
+                               const float (&mn)[D],
+                               const float (&mx)[D],
+                               std::vector<uint32_t> &out)
+{
+    for (size_t i = b; i < e; i += 8)
+    {
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int k = 0; k < D; ++k)
+        {
+            const __m256 v = _mm256_loadu_ps(c[k] + i);
+            inside = _mm256_and_ps(
+                inside,
+                _mm256_cmp_ps(v, _mm256_set1_ps(mn[k]), _CMP_GE_OQ));
+            inside = _mm256_and_ps(
+                inside,
+                _mm256_cmp_ps(v, _mm256_set1_ps(mx[k]), _CMP_LE_OQ));
+        }
+        uint32_t mask =
+            laneMask(e - i) & uint32_t(_mm256_movemask_ps(inside));
+        for (; mask; mask &= mask - 1)
+            out.push_back(index[i + std::countr_zero(mask)]);
+    }
+}
+
+#endif
+} // namespace
+
+template<typename P>
+void KdTree<P>::build(std::span<const P> points)
+{
+    const size_t n = points.size();
+    depth_ = 0;
+    // The largest range on a level has ceil(n / 2^level) points
+    while (((n + (size_t(1) << depth_) - 1) >> depth_) > LEAF_SIZE)
+        ++depth_;
+    const size_t inner = (size_t(1) << depth_) - 1;
+    split_.resize(inner);
+    axis_.resize(inner);
+    index_.resize(n);
+    for (int k = 0; k < DIM; ++k)
+        coords_[k].assign(n + PADDING, 0.0f);
+    if (n == 0)
+        return;
+
+    // The points are partitioned by value, next to their indices, so the
+    // median searches run over contiguous memory.
+    std::vector<Entry> entries(n);
+    P min = points[0], max = points[0];
+    for (size_t i = 0; i < n; ++i)
+    {
+        entries[i] = {points[i], static_cast<uint32_t>(i)};
+        for (int k = 0; k < DIM; ++k)
+        {
+            (&min.x)[k] = std::min((&min.x)[k], coord(points[i], k));
+            (&max.x)[k] = std::max((&max.x)[k], coord(points[i], k));
+        }
+    }
+    subdivide(entries, 0, 0, min, max);
+
+    parallelFor(n, PARALLEL_THRESHOLD, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i)
+        {
+            index_[i] = entries[i].index;
+            for (int k = 0; k < DIM; ++k)
+                coords_[k][i] = coord(entries[i].p, k);
+        }
+    });
+}
+
+template<typename P>
+void KdTree<P>::subdivide(std::span<Entry> entries,
+                          uint32_t node,
+                          int level,
+                          P min,
+                          P max)
+{
+    if (level == depth_)
+        return;
+    int axis = 0;
+    for (int k = 1; k < DIM; ++k)
+        if (coord(max, k) - coord(min, k) > coord(max, axis) - coord(min, axis))
+            axis = k;
+
+    const size_t m = half(entries.size());
+    std::nth_element(entries.begin(),
+                     entries.begin() + m,
+                     entries.end(),
+                     [axis](const Entry &a, const Entry &b) {
+                         return coord(a.p, axis) < coord(b.p, axis);
+                     });
+    const float split = coord(entries[m].p, axis);
+    split_[node] = split;
+    axis_[node] = static_cast<uint8_t>(axis);
+
+    P leftMax = max, rightMin = min;
+    (&leftMax.x)[axis] = split;
+    (&rightMin.x)[axis] = split;
+    const auto left = entries.first(m), right = entries.subspan(m);
+    const bool spawn = entries.size() >= PARALLEL_THRESHOLD &&
+                       (1u << std::min(level, 31)) < parallelism();
+    if (spawn)
+    {
+        parallelInvoke(
+            [&]() { subdivide(left, 2 * node + 1, level + 1, min, leftMax); },
+            [&]() {
+                subdivide(right, 2 * node + 2, level + 1, rightMin, max);
+            });
+    }
+    else
+    {
+        subdivide(left, 2 * node + 1, level + 1, min, leftMax);
+        subdivide(right, 2 * node + 2, level + 1, rightMin, max);
+    }
+}
+
+template<typename P>
+size_t KdTree<P>::nearest(const P &q, std::span<KdNeighbor> out) const
+{
+    size_t count = 0;
+    if (out.empty() || index_.empty())
+        return 0;
+    float v[DIM];
+    for (int k = 0; k < DIM; ++k)
+        v[k] = coord(q, k);
+    nearest(0, 0, 0, index_.size(), v, out, count);
+    return count;
+}
+
+// The left child holds coordinates <= split and the right one >= split.
+// The near side is searched first so the far one is usually culled.
+template<typename P>
+void KdTree<P>::nearest(uint32_t node,
+                        int level,
+                        size_t b,
+                        size_t e,
+                        const float (&q)[DIM],
+                        std::span<KdNeighbor> out,
+                        size_t &count) const
+{
+    if (level == depth_)
+    {
+        const float *c[DIM];
+        for (int k = 0; k < DIM; ++k)
+            c[k] = coords_[k].data();
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+            return nearestLeafAvx2<DIM>(c, index_.data(), b, e, q, out, count);
+#endif
+        return nearestLeaf<DIM>(c, index_.data(), b, e, q, out, count);
+    }
+    const size_t m = b + half(e - b);
+    const float d = q[axis_[node]] - split_[node];
+    if (d <= 0.0f)
+    {
+        nearest(2 * node + 1, level + 1, b, m, q, out, count);
+        if (d * d < worst(out, count))
+            nearest(2 * node + 2, level + 1, m, e, q, out, count);
+    }
+    else
+    {
+        nearest(2 * node + 2, level + 1, m, e, q, out, count);
+        if (d * d < worst(out, count))
+            nearest(2 * node + 1, level + 1, b, m, q, out, count);
+    }
+}
+
+template<typename P>
+void KdTree<P>::radius(const P &q, float r, std::vector<uint32_t> &out) const
+{
+    if (index_.empty() || r < 0.0f)
+        return;
+    float v[DIM];
+    for (int k = 0; k < DIM; ++k)
+        v[k] = coord(q, k);
+    radius(0, 0, 0, index_.size(), v, r, out);
+}
+
+template<typename P>
+void KdTree<P>::radius(uint32_t node,
+                       int level,
+                       size_t b,
+                       size_t e,
+                       const float (&q)[DIM],
+                       float r,
+                       std::vector<uint32_t> &out) const
+{
+    if (level == depth_)
+    {
+        const float *c[DIM];
+        for (int k = 0; k < DIM; ++k)
+            c[k] = coords_[k].data();
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+            return radiusLeafAvx2<DIM>(c, index_.data(), b, e, q, r * r, out);
+#endif
+        return radiusLeaf<DIM>(c, index_.data(), b, e, q, r * r, out);
+    }
+    const size_t m = b + half(e - b);
+    const float v = q[axis_[node]];
+    if (v - r <= split_[node])
+        radius(2 * node + 1, level + 1, b, m, q, r, out);
+    if (v + r >= split_[node])
+        radius(2 * node + 2, level + 1, m, e, q, r, out);
+}
+
+template<typename P>
+void KdTree<P>::box(const P &min,
+                    const P &max,
+                    std::vector<uint32_t> &out) const
+{
+    if (index_.empty())
+        return;
+    float mn[DIM], mx[DIM];
+    for (int k = 0; k < DIM; ++k)
+    {
+        mn[k] = coord(min, k);
+        mx[k] = coord(max, k);
+    }
+    box(0, 0, 0, index_.size(), mn, mx, out);
+}
+
+template<typename P>
+void KdTree<P>::box(uint32_t node,
+                    int level,
+                    size_t b,
+                    size_t e,
+                    const float (&mn)[DIM],
+                    const float (&mx)[DIM],
+                    std::vector<uint32_t> &out) const
+{
+    if (level == depth_)
+    {
+        const float *c[DIM];
+        for (int k = 0; k < DIM; ++k)
+            c[k] = coords_[k].data();
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+            return boxLeafAvx2<DIM>(c, index_.data(), b, e, mn, mx, out);
+#endif
+        return boxLeaf<DIM>(c, index_.data(), b, e, mn, mx, out);
+    }
+    const size_t m = b + half(e - b);
+    const int axis = axis_[node];
+    if (mn[axis] <= split_[node])
+        box(2 * node + 1, level + 1, b, m, mn, mx, out);
+    if (mx[axis] >= split_[node])
+        box(2 * node + 2, level + 1, m, e, mn, mx, out);
+}
+
+template class KdTree<Point2d>;
+template class KdTree<Point3d>;
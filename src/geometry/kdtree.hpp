@@ -0,0 +1,98 @@
+#ifndef KDTREE_HPP_INCLUDED
+#define KDTREE_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct KdNeighbor
+{
+    uint32_t index;
+    float dist2;
+};
+
+// Static k-d tree over 2D or 3D points. The tree is implicit: node i has
+// children 2i + 1 and 2i + 2 and splits its range of points at the middle,
+// the left half getting the odd point, so a node is just its split plane
+// and the ranges follow from the point count. All leaves are on one level
+// and hold up to LEAF_SIZE points, stored in leaf order as one array per
+// axis and scanned eight at a time through AVX2 when the CPU has it.
+// Queries report indices into the span given to build().
+template<typename P>
+class KdTree
+{
+public:
+    static constexpr size_t LEAF_SIZE = 16;
+
+    // Median splits along the widest axis of each node's box, the root's
+    // box being the bounds of the points; large ranges build their halves
+    // in parallel.
+    void build(std::span<const P> points);
+
+    size_t size() const
+    {
+        return index_.size();
+    }
+
+    // The out.size() points nearest to q, nearest first, as indices and
+    // squared distances. Returns how many were found, fewer than out.size()
+    // only when the tree holds fewer points.
+    size_t nearest(const P &q, std::span<KdNeighbor> out) const;
+
+    // Appends the index of every point within distance r of q.
+    void radius(const P &q, float r, std::vector<uint32_t> &out) const;
+
+    // Appends the index of every point p with min <= p <= max.
+    void box(const P &min, const P &max, std::vector<uint32_t> &out) const;
+
+private:
+    static constexpr int DIM = sizeof(P) / sizeof(float);
+
+    struct Entry
+    {
+        P p;
+        uint32_t index;
+    };
+
+    void subdivide(std::span<Entry> entries,
+                   uint32_t node,
+                   int level,
+                   P min,
+                   P max);
+    void nearest(uint32_t node,
+                 int level,
+                 size_t b,
+                 size_t e,
+                 const float (&q)[DIM],
+                 std::span<KdNeighbor> out,
+                 size_t &count) const;
+    void radius(uint32_t node,
+                int level,
+                size_t b,
+                size_t e,
+                const float (&q)[DIM],
+                float r,
+                std::vector<uint32_t> &out) const;
+    void box(uint32_t node,
+             int level,
+             size_t b,
+             size_t e,
+             const float (&mn)[DIM],
+             const float (&mx)[DIM],
+             std::vector<uint32_t> &out) const;
+
+    // Leaves are on this level; the root is level 0.
+    int depth_ = 0;
+    std::vector<float> split_;
+    std::vector<uint8_t> axis_;
+    // Point coordinates in leaf order, padded for full-width loads, and
+    // their original indices.
+    std::vector<float> coords_[DIM];
+    std::vector<uint32_t> index_;
+};
+
+extern template class KdTree<Point2d>;
+extern template class KdTree<Point3d>;
+
+#endif
@@ -0,0 +1,321 @@
+#include "lbvh.hpp"
+#include "bvh.hpp"
+#include "parallel.hpp"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+
+// Inputs smaller than this are sorted by one thread.
+static constexpr size_t PARALLEL_SORT_THRESHOLD = 1 << 16;
+// Indices handed to each thread at least, for the per-node passes.
+static constexpr size_t GRAIN = 4096;
+
+// Spread the low 10 bits of v so that two zero bits separate each of them.
+static uint32_t expandBits10(uint32_t v)
+{
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// Same for the low 21 bits of v.
+static uint64_t expandBits21(uint64_t v)
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8) & 0x100f00f00f00f00full;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+static uint32_t quantize(float v, float cells)
+{
+    return static_cast<uint32_t>(std::clamp(v * cells, 0.0f, cells - 1.0f));
+}
+
+uint32_t mortonCode30(float x, float y, float z)
+{
+    return expandBits10(quantize(x, 1024.0f)) << 2 |
+           expandBits10(quantize(y, 1024.0f)) << 1 |
+           expandBits10(quantize(z, 1024.0f));
+}
+
+uint64_t mortonCode63(float x, float y, float z)
+{
+    return expandBits21(quantize(x, 2097152.0f)) << 2 |
+           expandBits21(quantize(y, 2097152.0f)) << 1 |
+           expandBits21(quantize(z, 2097152.0f));
+}
+
+template<typename K>
+static void radixSortImpl(std::span<K> keys, std::span<uint32_t> values)
+{
+    assert(keys.size() == values.size());
+    const size_t n = keys.size();
+    if (n < 2)
+        return;
+
+    std::vector<K> keyBuffer(n);
+    std::vector<uint32_t> valueBuffer(n);
+    K *srcK = keys.data(), *dstK = keyBuffer.data();
+    uint32_t *srcV = values.data(), *dstV = valueBuffer.data();
+
+    // Each chunk gets its own histogram and its own range of output slots
+    // per digit, so the scatter needs no synchronisation and stays stable.
+    const size_t chunks = n >= PARALLEL_SORT_THRESHOLD ? parallelism() : 1;
+    const size_t step = (n + chunks - 1) / chunks;
+    std::vector<std::array<size_t, 256>> offsets(chunks);
+
+    for (unsigned shift = 0; shift < sizeof(K) * 8; shift += 8)
+    {
+        parallelFor(chunks, 1, [&](size_t cb, size_t ce) {
+            for (size_t c = cb; c < ce; ++c)
+            {
+                auto &h = offsets[c];
+                h.fill(0);
+                const size_t end = std::min(n, (c + 1) * step);
+                for (size_t i = c * step; i < end; ++i)
+                    ++h[(srcK[i] >> shift) & 0xff];
+            }
+        });
+
+        bool trivial = false;
+        size_t sum = 0;
+        for (int d = 0; d < 256; ++d)
+        {
+            const size_t digitStart = sum;
+            for (size_t c = 0; c < chunks; ++c)
+            {
+                const size_t count = offsets[c][d];
+                offsets[c][d] = sum;
+                sum += count;
+            }
+            trivial = trivial || sum - digitStart == n;
+        }
+        if (trivial)
+            continue;
+
+        parallelFor(chunks, 1, [&](size_t cb, size_t ce) {
+            for (size_t c = cb; c < ce; ++c)
+            {
+                auto &o = offsets[c];
+                const size_t end = std::min(n, (c + 1) * step);
+                for (size_t i = c * step; i < end; ++i)
+                {
+                    const size_t pos = o[(srcK[i] >> shift) & 0xff]++;
+                    dstK[pos] = srcK[i];
+                    dstV[pos] = srcV[i];
+                }
+            }
+        });
+        std::swap(srcK, dstK);
+        std::swap(srcV, dstV);
+    }
+
+    if (srcK != keys.data())
+    {
+        std::copy(srcK, srcK + n, keys.data());
+        std::copy(srcV, srcV + n, values.data());
+    }
+}
+
+void radixSort(std::span<uint32_t> keys, std::span<uint32_t> values)
+{
+    radixSortImpl(keys, values);
+}
+
+void radixSort(std::span<uint64_t> keys, std::span<uint32_t> values)
+{
+    radixSortImpl(keys, values);
+}
+
+// Emit the hierarchy over sorted 'keys'. Internal node i of Karras' scheme
+// stores its two children in slots 1 + 2i and 2 + 2i of 'nodes', which keeps
+// the sibling-pair layout of the SAH builder; the root is slot 0.
+template<typename K>
+static void emitHierarchy(std::span<const K> keys,
+                          std::span<BVHNode> nodes,
+                          std::vector<uint32_t> &internalSlot,
+                          std::vector<uint32_t> &leafSlot)
+{
+    const auto n = static_cast<int64_t>(keys.size());
+    constexpr int KEY_BITS = sizeof(K) * 8;
+
+    // Length of the common prefix of keys i and j, -1 out of range.
+    // Duplicate keys are told apart by their indices.
+    auto delta = [&](int64_t i, int64_t j) -> int {
+        if (j < 0 || j >= n)
+            return -1;
+        if (keys[i] == keys[j])
+            return KEY_BITS + std::countl_zero(uint64_t(i ^ j)) - 32;
+        return std::countl_zero(K(keys[i] ^ keys[j]));
+    };
+
+    parallelFor(n - 1, GRAIN, [&](size_t b, size_t e) {
+        for (int64_t i = b; i < int64_t(e); ++i)
+        {
+            // Direction of the range covered by node i.
+            const int d = delta(i, i + 1) > delta(i, i - 1) ? 1 : -1;
+
+            // Upper bound on the range length, then binary search the end.
+            const int deltaMin = delta(i, i - d);
+            int64_t lmax = 2;
+            while (delta(i, i + lmax * d) > deltaMin)
+                lmax *= 2;
+            int64_t l = 0;
+            for (int64_t t = lmax / 2; t >= 1; t /= 2)
+                if (delta(i, i + (l + t) * d) > deltaMin)
+                    l += t;
+            const int64_t j = i + l * d;
+
+            // Binary search the split position.
+            const int deltaNode = delta(i, j);
+            int64_t s = 0;
+            for (int64_t div = 2;; div *= 2)
+            {
+                const int64_t t = (l + div - 1) / div;
+                if (delta(i, i + (s + t) * d) > deltaNode)
+                    s += t;
+                if (t <= 1)
+                    break;
+            }
+            const int64_t gamma = i + s * d + std::min(d, 0);
+
+            const bool leftLeaf = std::min(i, j) == gamma;
+            const bool rightLeaf = std::max(i, j) == gamma + 1;
+            for (int k = 0; k < 2; ++k)
+            {
+                const auto slot = static_cast<uint32_t>(1 + 2 * i + k);
+                const auto child = static_cast<uint32_t>(gamma + k);
+                if (k == 0 ? leftLeaf : rightLeaf)
+                {
+                    nodes[slot].leftFirst = child;
+                    nodes[slot].count = 1;
+                    leafSlot[child] = slot;
+                }
+                else
+                {
+                    nodes[slot].leftFirst = 1 + 2 * child;
+                    nodes[slot].count = 0;
+                    internalSlot[child] = slot;
+                }
+            }
+        }
+    });
+}
+
+template<typename K>
+static void sortAndEmit(std::span<const Point3d> centers,
+                        const float (&lo)[3],
+                        const float (&scale)[3],
+                        K (*code)(float, float, float),
+                        std::span<uint32_t> order,
+                        std::span<BVHNode> nodes,
+                        std::vector<uint32_t> &internalSlot,
+                        std::vector<uint32_t> &leafSlot)
+{
+    std::vector<K> keys(centers.size());
+    parallelFor(centers.size(), GRAIN, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i)
+        {
+            const Point3d &c = centers[i];
+            keys[i] = code((c.x - lo[0]) * scale[0],
+                           (c.y - lo[1]) * scale[1],
+                           (c.z - lo[2]) * scale[2]);
+        }
+    });
+    radixSort(std::span<K>(keys), order);
+    emitHierarchy<K>(keys, nodes, internalSlot, leafSlot);
+}
+
+void BVH::buildLinear(std::span<const AABB3d> boxes, int mortonBits)
+{
+    assert(mortonBits == 30 || mortonBits == 63);
+    const auto n = static_cast<uint32_t>(boxes.size());
+    nodes_.clear();
+    indices_.resize(n);
+    prims_.resize(n);
+    if (n == 0)
+        return;
+
+    // Normalise the centers into the unit cube of their bounds.
+    std::vector<Point3d> centers(n);
+    float lo[3] = {boxes[0].c.x, boxes[0].c.y, boxes[0].c.z};
+    float hi[3] = {lo[0], lo[1], lo[2]};
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        centers[i] = boxes[i].c;
+        indices_[i] = i;
+        const float *c = &boxes[i].c.x;
+        for (int a = 0; a < 3; ++a)
+        {
+            lo[a] = std::min(lo[a], c[a]);
+            hi[a] = std::max(hi[a], c[a]);
+        }
+    }
+    float scale[3];
+    for (int a = 0; a < 3; ++a)
+        scale[a] = hi[a] > lo[a] ? 1.0f / (hi[a] - lo[a]) : 0.0f;
+
+    nodes_.resize(2 * size_t(n) - 1);
+    std::vector<uint32_t> internalSlot(n - 1), leafSlot(n);
+    if (n == 1)
+    {
+        nodes_[0].leftFirst = 0;
+        nodes_[0].count = 1;
+        leafSlot[0] = 0;
+    }
+    else
+    {
+        nodes_[0].leftFirst = 1;
+        nodes_[0].count = 0;
+        internalSlot[0] = 0;
+        if (mortonBits == 30)
+            sortAndEmit<uint32_t>(centers, lo, scale, mortonCode30, indices_,
+                                  nodes_, internalSlot, leafSlot);
+        else
+            sortAndEmit<uint64_t>(centers, lo, scale, mortonCode63, indices_,
+                                  nodes_, internalSlot, leafSlot);
+    }
+
+    // Fit the boxes bottom-up. The second child to arrive at a node computes
+    // its bounds and carries on towards the root, the first one stops.
+    std::vector<std::atomic<uint32_t>> arrivals(n - 1);
+    parallelFor(n, GRAIN, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i)
+        {
+            prims_[i] = boxes[indices_[i]];
+            BVHNode &leaf = nodes_[leafSlot[i]];
+            const AABB3d &p = prims_[i];
+            const float *c = &p.c.x;
+            for (int a = 0; a < 3; ++a)
+            {
+                leaf.min[a] = c[a] - p.r[a];
+                leaf.max[a] = c[a] + p.r[a];
+            }
+
+            uint32_t slot = leafSlot[i];
+            while (slot != 0)
+            {
+                const uint32_t parent = (slot - 1) / 2;
+                if (arrivals[parent].fetch_add(1, std::memory_order_acq_rel) ==
+                    0)
+                    break;
+                const BVHNode &l = nodes_[1 + 2 * parent];
+                const BVHNode &r = nodes_[2 + 2 * parent];
+                slot = internalSlot[parent];
+                BVHNode &node = nodes_[slot];
+                for (int a = 0; a < 3; ++a)
+                {
+                    node.min[a] = std::min(l.min[a], r.min[a]);
+                    node.max[a] = std::max(l.max[a], r.max[a]);
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,21 @@
+#ifndef LBVH_HPP_INCLUDED
+#define LBVH_HPP_INCLUDED
+
+#include <cstdint>
+#include <span>
+
+// Building blocks of BVH::buildLinear().
+
+// Interleave the bits of three coordinates in [0, 1] into a Morton code with
+// 10 bits per axis.
+uint32_t mortonCode30(float x, float y, float z);
+// Same with 21 bits per axis.
+uint64_t mortonCode63(float x, float y, float z);
+
+// Stable LSD radix sort of 'keys', permuting 'values' alongside. Digits are
+// 8 bits wide; passes over digits shared by all keys are skipped. Large
+// inputs are histogrammed and scattered in parallel.
+void radixSort(std::span<uint32_t> keys, std::span<uint32_t> values);
+void radixSort(std::span<uint64_t> keys, std::span<uint32_t> values);
+
+#endif
@@ -1,22 +1,143 @@
 #ifndef VECTOR_HPP_INCLUDED
 #define VECTOR_HPP_INCLUDED
 
+#include "geom_structs.hpp"
+#include "matrix_expr.hpp"
+#include "simd.hpp"
 #include <cmath>
 #include <stddef.h>
+#include <utility>
 
-struct Point3d;
-struct Point2d;
+// The vector core is defined here so that hot loops in other translation
+// units can inline, and vectorize, these calls without LTO.
+#if defined(__GNUC__)
+#define GEOMETRY_INLINE [[gnu::always_inline]] inline
+#else
+#define GEOMETRY_INLINE inline
+#endif
 
-float dotProd(const Point3d &u, const Point3d &v);
-float dotProd(const Point2d &u, const Point2d &v);
-Point3d crossProd(const Point3d &u, const Point3d &v);
-float magnitute(const Point3d &v);
-void normalize(const Point3d &v, Point3d &n);
+GEOMETRY_INLINE constexpr Point3d operator-(const Point3d &a,
+                                            const Point3d &b) noexcept
+{
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+GEOMETRY_INLINE constexpr Point2d operator-(const Point2d &a,
+                                            const Point2d &b) noexcept
+{
+    return {a.x - b.x, a.y - b.y};
+}
+
+GEOMETRY_INLINE constexpr float dotProd(const Point3d &u,
+                                        const Point3d &v) noexcept
+{
+    return u.x * v.x + u.y * v.y + u.z * v.z;
+}
+
+GEOMETRY_INLINE constexpr float dotProd(const Point2d &u,
+                                        const Point2d &v) noexcept
+{
+    return u.x * v.x + u.y * v.y;
+}
+
+GEOMETRY_INLINE constexpr Point3d crossProd(const Point3d &u,
+                                            const Point3d &v) noexcept
+{
+    // Five multiplications instead of six
+    const float t1 = u.x - u.y;
+    const float t2 = v.y + v.z;
+    const float t3 = u.x * v.z;
+    const float t4 = t1 * t2 - t3;
+    return {v.y * (t1 - u.z) - t4, u.z * v.x - t3, t4 - u.y * (v.x - t2)};
+}
+
+// Twice the signed area of triangle (x1, y1), (x2, y2), (x3, y3), positive
+// for counterclockwise order.
+GEOMETRY_INLINE constexpr float
+triaArea(float x1, float y1, float x2, float y2, float x3, float y3) noexcept
+{
+    return (x1 - x2) * (y2 - y3) - (x2 - x3) * (y1 - y2);
+}
+
+GEOMETRY_INLINE float magnitute(const Point3d &v) noexcept
+{
+    return std::sqrt(dotProd(v, v));
+}
+
+// The Matrix33 products work a row at a time: row i of a * b is the sum of
+// the rows of b weighted by row i of a.
+GEOMETRY_INLINE Matrix33 operator*(const Matrix33 &a,
+                                   const Matrix33 &b) noexcept
+{
+    Matrix33 c;
+#ifdef GEOMETRY_SSE
+    const __m128 b0 = _mm_load_ps(b[0]), b1 = _mm_load_ps(b[1]),
+                 b2 = _mm_load_ps(b[2]);
+    for (int i = 0; i < 3; ++i)
+    {
+        __m128 r = _mm_mul_ps(_mm_set1_ps(a[i][0]), b0);
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[i][1]), b1));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[i][2]), b2));
+        _mm_store_ps(c[i], r);
+    }
+#else
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            c[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j];
+#endif
+    return c;
+}
+
+// a^T * b without forming a^T: row i weights the rows of b by column i of
+// a.
+GEOMETRY_INLINE Matrix33 transposeMul(const Matrix33 &a,
+                                      const Matrix33 &b) noexcept
+{
+    Matrix33 c;
+#ifdef GEOMETRY_SSE
+    const __m128 b0 = _mm_load_ps(b[0]), b1 = _mm_load_ps(b[1]),
+                 b2 = _mm_load_ps(b[2]);
+    for (int i = 0; i < 3; ++i)
+    {
+        __m128 r = _mm_mul_ps(_mm_set1_ps(a[0][i]), b0);
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[1][i]), b1));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[2][i]), b2));
+        _mm_store_ps(c[i], r);
+    }
+#else
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            c[i][j] = a[0][i] * b[0][j] + a[1][i] * b[1][j] + a[2][i] * b[2][j];
+#endif
+    return c;
+}
+
+// m * v. A single product is three short dot products, which the compiler
+// schedules better than a horizontal SSE sum; batches of points go through
+// transformPoints().
+GEOMETRY_INLINE Point3d operator*(const Matrix33 &m, const Point3d &v) noexcept
+{
+    return {m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+            m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+            m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z};
+}
+
+// n = v / |v|; n is left unchanged for a zero vector.
+GEOMETRY_INLINE void normalize(const Point3d &v, Point3d &n) noexcept
+{
+    const float magn = magnitute(v);
+    if (magn != 0)
+    {
+        n.x = v.x / magn;
+        n.y = v.y / magn;
+        n.z = v.z / magn;
+    }
+}
 
 template<typename T, size_t N>
 void subArray(const T (&b)[N], const T (&a)[N], T (&trg)[N])
 {
-    for (int i = 0; i < N; ++i)
+    for (size_t i = 0; i < N; ++i)
     {
         trg[i] = b[i] - a[i];
     }
@@ -34,18 +155,123 @@ T dotProdArray(const T (&u)[N], const T (&v)[N])
 }
 
 
-template<typename T>
-void transpose(const T *src, T *dst, int rows, int cols)
+// Blocks with both sides at most this long are transposed directly; two of
+// them fit in L1 for elements of up to eight bytes.
+inline constexpr size_t TRANSPOSE_LEAF = 32;
+
+// Cache-oblivious transpose of the rows x cols block at src (row stride
+// ss) into dst (row stride ds): the longer side is halved until the block
+// is a leaf, whatever the cache sizes, and leaf(src, ss, dst, ds, rows,
+// cols) transposes it. Splits fall on multiples of eight so that vector
+// leaves see whole tiles.
+template<typename T, typename Leaf>
+void transposeRecursive(const T *src,
+                        size_t ss,
+                        T *dst,
+                        size_t ds,
+                        size_t rows,
+                        size_t cols,
+                        Leaf &&leaf)
 {
-    for (int i = 0; i < rows; ++i)
+    if (rows <= TRANSPOSE_LEAF && cols <= TRANSPOSE_LEAF)
+        return leaf(src, ss, dst, ds, rows, cols);
+    if (rows >= cols)
     {
-        for (int j = 0; j < cols; ++j)
-        {
-            dst[j * rows + i] = src[i * cols + j];
-        }
+        const size_t h = (rows / 2 + 7) & ~size_t(7);
+        transposeRecursive(src, ss, dst, ds, h, cols, leaf);
+        transposeRecursive(src + h * ss, ss, dst + h, ds, rows - h, cols, leaf);
+    }
+    else
+    {
+        const size_t h = (cols / 2 + 7) & ~size_t(7);
+        transposeRecursive(src, ss, dst, ds, rows, h, leaf);
+        transposeRecursive(src + h, ss, dst + h * ds, ds, rows, cols - h, leaf);
     }
 }
 
+// Swap the rows x cols block a (row stride ld) with the transpose of block
+// b, halving like transposeRecursive() down to swap(a, b, ld, rows, cols).
+template<typename T, typename Swap>
+void transposeSwapRecursive(T *a,
+                            T *b,
+                            size_t ld,
+                            size_t rows,
+                            size_t cols,
+                            Swap &&swap)
+{
+    if (rows <= TRANSPOSE_LEAF && cols <= TRANSPOSE_LEAF)
+        return swap(a, b, ld, rows, cols);
+    if (rows >= cols)
+    {
+        const size_t h = (rows / 2 + 7) & ~size_t(7);
+        transposeSwapRecursive(a, b, ld, h, cols, swap);
+        transposeSwapRecursive(a + h * ld, b + h, ld, rows - h, cols, swap);
+    }
+    else
+    {
+        const size_t h = (cols / 2 + 7) & ~size_t(7);
+        transposeSwapRecursive(a, b, ld, rows, h, swap);
+        transposeSwapRecursive(a + h, b + h * ld, ld, rows, cols - h, swap);
+    }
+}
+
+// In-place transpose of the n x n matrix m (row stride ld): the diagonal
+// quadrants transpose in place, down to diag(m, ld, n), and the
+// off-diagonal pair swap with each other.
+template<typename T, typename Diag, typename Swap>
+void transposeInPlaceRecursive(T *m,
+                               size_t ld,
+                               size_t n,
+                               Diag &&diag,
+                               Swap &&swap)
+{
+    if (n <= TRANSPOSE_LEAF)
+        return diag(m, ld, n);
+    const size_t h = (n / 2 + 7) & ~size_t(7);
+    transposeInPlaceRecursive(m, ld, h, diag, swap);
+    transposeInPlaceRecursive(m + h * ld + h, ld, n - h, diag, swap);
+    transposeSwapRecursive(m + h, m + h * ld, ld, h, n - h, swap);
+}
+
+// dst = src^T for the row-major rows x cols matrix src. float matrices go
+// through SIMD tile kernels (transpose.cpp).
+template<typename T>
+void transpose(const T *src, T *dst, int rows, int cols)
+{
+    transposeRecursive(
+        src,
+        size_t(cols),
+        dst,
+        size_t(rows),
+        size_t(rows),
+        size_t(cols),
+        [](const T *s, size_t ss, T *d, size_t ds, size_t r, size_t c) {
+            for (size_t i = 0; i < r; ++i)
+                for (size_t j = 0; j < c; ++j)
+                    d[j * ds + i] = s[i * ss + j];
+        });
+}
+
+// Transpose the row-major n x n matrix m in place.
+template<typename T>
+void transposeInPlace(T *m, int n)
+{
+    auto diag = [](T *a, size_t ld, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = i + 1; j < n; ++j)
+                std::swap(a[i * ld + j], a[j * ld + i]);
+    };
+    auto swap = [](T *a, T *b, size_t ld, size_t r, size_t c) {
+        for (size_t i = 0; i < r; ++i)
+            for (size_t j = 0; j < c; ++j)
+                std::swap(a[i * ld + j], b[j * ld + i]);
+    };
+    transposeInPlaceRecursive(m, size_t(n), size_t(n), diag, swap);
+}
+
+void transpose(const float *src, float *dst, int rows, int cols);
+void transposeInPlace(float *m, int n);
+
 template<typename T>
 bool diagonal(const T *src, int dim)
 {
@@ -80,17 +306,15 @@ bool identity(const T *src, int dim)
     return true;
 }
 
-// TODO this can be down faster.
-// Iterate only on the upper triangle values.
+// Compares each pair above the diagonal with its mirror once.
 template<typename T>
 bool symmetric(const T *src, int dim)
 {
-
     for (int i = 0; i < dim; ++i)
     {
-        for (int j = 0; j < dim; ++j)
+        for (int j = i + 1; j < dim; ++j)
         {
-            if (i != j && src[i][j] != src[j][i])
+            if (src[i][j] != src[j][i])
             {
                 return false;
             }
@@ -127,17 +351,7 @@ template<typename T, size_t R1, size_t C1, size_t R2, size_t C2>
 void mult(const T (&s1)[R1][C1], const T (&s2)[R2][C2], T (&trg)[R1][C2])
 {
     static_assert(C1 == R2, "Incompatible matrix dimensions");
-    for (int i = 0; i < R1; ++i)
-    {
-        for (int j = 0; j < C2; ++j)
-        {
-            trg[i][j] = 0;
-            for (int k = 0; k < C1; ++k)
-            {
-                trg[i][j] += s1[i][k] * s2[k][j];
-            }
-        }
-    }
+    assign(trg, expr(s1) * expr(s2));
 }
 
 template<typename T>
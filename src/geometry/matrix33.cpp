@@ -0,0 +1,58 @@
+#include "geometry.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include <cassert>
+
+// Batches below this size are not worth handing to other threads.
+static constexpr size_t PARALLEL_GRAIN = 1 << 15;
+
+#ifdef GEOMETRY_X86
+
+GEOMETRY_AVX2 static void
+transformAvx2(const Matrix33 &m, const Point3d *p, Point3d *out, size_t n)
+{
+    static_assert(sizeof(Point3d) == 3 * sizeof(float));
+    __m256 e[3][3];
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            e[i][j] = _mm256_set1_ps(m[i][j]);
+    for (size_t i = 0; i < n; i += 8)
+    {
+        __m256 x, y, z;
+        loadXYZ8(&p[i].x, x, y, z);
+        __m256 r[3];
+        for (int k = 0; k < 3; ++k)
+            r[k] = _mm256_fmadd_ps(
+                e[k][2],
+                z,
+                _mm256_fmadd_ps(e[k][1], y, _mm256_mul_ps(e[k][0], x)));
+        storeXYZ8(&out[i].x, r[0], r[1], r[2]);
+    }
+}
+
+#endif
+
+void transformPoints(const Matrix33 &m,
+                     std::span<const Point3d> p,
+                     std::span<Point3d> out,
+                     bool parallel)
+{
+    assert(p.size() == out.size());
+    auto kernel = [&](size_t begin, size_t end) {
+        size_t i = begin;
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx2())
+        {
+            const size_t n = (end - begin) & ~size_t(7);
+            transformAvx2(m, p.data() + begin, out.data() + begin, n);
+            i += n;
+        }
+#endif
+        for (; i < end; ++i)
+            out[i] = m * p[i];
+    };
+    if (parallel)
+        parallelFor(p.size(), PARALLEL_GRAIN, kernel);
+    else
+        kernel(size_t(0), p.size());
+}
@@ -0,0 +1,344 @@
+#ifndef MATRIX_EXPR_HPP_INCLUDED
+#define MATRIX_EXPR_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Expression templates over fixed-size matrices. Operators on expressions
+// only record what to compute; assign() then evaluates every element of the
+// whole expression in one loop, with no temporaries for sums, differences,
+// scalings or transposes. All sizes are compile-time constants, and loops
+// of up to EXPR_UNROLL iterations are expanded outright so that the
+// compiler sees straight-line code it can schedule and vectorize.
+//
+//     float j[3][3], a[3][3], d[3][3];
+//     assign(d, transposed(expr(j)) * expr(a) * expr(j));
+//
+// A product whose operand is itself a product evaluates that operand once,
+// as lazily it would be recomputed for every element. The target of
+// assign() may appear in sums, differences and scalings, where element
+// (i, j) only reads element (i, j), but not under transposed() or as an
+// operand of a product: these read elements the loop has already
+// overwritten. Wrap such a term in MatValue to evaluate it first:
+//
+//     assign(m, MatValue<float, 3, 3>(transposed(expr(m))));
+
+#if defined(__GNUC__)
+#define EXPR_INLINE [[gnu::always_inline]] inline
+#else
+#define EXPR_INLINE inline
+#endif
+
+inline constexpr size_t EXPR_UNROLL = 16;
+
+// Calls f(i) for i in [0, N), unrolled at compile time for small N.
+template<size_t N, typename F>
+EXPR_INLINE void exprFor(F &&f)
+{
+    if constexpr (N <= EXPR_UNROLL)
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (f(I), ...);
+        }(std::make_index_sequence<N>{});
+    else
+        for (size_t i = 0; i < N; ++i)
+            f(i);
+}
+
+template<typename E>
+struct MatExpr
+{
+    EXPR_INLINE const E &self() const
+    {
+        return static_cast<const E &>(*this);
+    }
+};
+
+// Leaf referring to an array, or to a vector as one column.
+template<typename T, size_t R, size_t C>
+struct MatRef : MatExpr<MatRef<T, R, C>>
+{
+    using value_type = T;
+    static constexpr size_t rows = R, cols = C;
+
+    explicit MatRef(const T *m) : m(m) {}
+
+    EXPR_INLINE T operator()(size_t i, size_t j) const
+    {
+        return m[i * C + j];
+    }
+
+    const T *m;
+};
+
+// Leaf referring to a Matrix33 through its padded rows.
+struct Matrix33Ref : MatExpr<Matrix33Ref>
+{
+    using value_type = float;
+    static constexpr size_t rows = 3, cols = 3;
+
+    explicit Matrix33Ref(const Matrix33 &m) : m(m) {}
+
+    EXPR_INLINE float operator()(size_t i, size_t j) const
+    {
+        return m[int(i)][j];
+    }
+
+    const Matrix33 &m;
+};
+
+template<typename T, size_t R, size_t C>
+MatRef<T, R, C> expr(const T (&m)[R][C])
+{
+    return MatRef<T, R, C>(&m[0][0]);
+}
+
+template<typename T, size_t N>
+MatRef<T, N, 1> expr(const T (&v)[N])
+{
+    return MatRef<T, N, 1>(v);
+}
+
+inline Matrix33Ref expr(const Matrix33 &m)
+{
+    return Matrix33Ref(m);
+}
+
+// Value holding an evaluated expression.
+template<typename T, size_t R, size_t C>
+struct MatValue : MatExpr<MatValue<T, R, C>>
+{
+    using value_type = T;
+    static constexpr size_t rows = R, cols = C;
+
+    template<typename E>
+    explicit MatValue(const MatExpr<E> &e);
+
+    EXPR_INLINE T operator()(size_t i, size_t j) const
+    {
+        return m[i][j];
+    }
+
+    T m[R][C];
+};
+
+template<typename A, typename B, typename Op>
+struct MatBinary : MatExpr<MatBinary<A, B, Op>>
+{
+    static_assert(A::rows == B::rows && A::cols == B::cols,
+                  "Incompatible matrix dimensions");
+    using value_type = typename A::value_type;
+    static constexpr size_t rows = A::rows, cols = A::cols;
+
+    MatBinary(const A &a, const B &b) : a(a), b(b) {}
+
+    EXPR_INLINE value_type operator()(size_t i, size_t j) const
+    {
+        return Op::apply(a(i, j), b(i, j));
+    }
+
+    A a;
+    B b;
+};
+
+struct ExprAdd
+{
+    template<typename T>
+    EXPR_INLINE static T apply(T x, T y)
+    {
+        return x + y;
+    }
+};
+
+struct ExprSub
+{
+    template<typename T>
+    EXPR_INLINE static T apply(T x, T y)
+    {
+        return x - y;
+    }
+};
+
+template<typename S, typename A>
+struct MatScaled : MatExpr<MatScaled<S, A>>
+{
+    using value_type = typename A::value_type;
+    static constexpr size_t rows = A::rows, cols = A::cols;
+
+    MatScaled(S s, const A &a) : s(s), a(a) {}
+
+    EXPR_INLINE value_type operator()(size_t i, size_t j) const
+    {
+        return s * a(i, j);
+    }
+
+    S s;
+    A a;
+};
+
+template<typename A>
+struct MatTransposed : MatExpr<MatTransposed<A>>
+{
+    using value_type = typename A::value_type;
+    static constexpr size_t rows = A::cols, cols = A::rows;
+
+    explicit MatTransposed(const A &a) : a(a) {}
+
+    EXPR_INLINE value_type operator()(size_t i, size_t j) const
+    {
+        return a(j, i);
+    }
+
+    A a;
+};
+
+template<typename A, typename B>
+struct MatProduct;
+
+template<typename E>
+struct ProductOperand
+{
+    using type = E;
+};
+
+template<typename A, typename B>
+struct ProductOperand<MatProduct<A, B>>
+{
+    using type = MatValue<typename A::value_type, A::rows, B::cols>;
+};
+
+template<typename A, typename B>
+struct MatProduct : MatExpr<MatProduct<A, B>>
+{
+    static_assert(A::cols == B::rows, "Incompatible matrix dimensions");
+    using value_type = typename A::value_type;
+    static constexpr size_t rows = A::rows, cols = B::cols;
+
+    MatProduct(const A &a, const B &b) : a(a), b(b) {}
+
+    EXPR_INLINE value_type operator()(size_t i, size_t j) const
+    {
+        value_type sum = a(i, 0) * b(0, j);
+        exprFor<A::cols - 1>([&](size_t k) {
+            sum += a(i, k + 1) * b(k + 1, j);
+        });
+        return sum;
+    }
+
+    typename ProductOperand<A>::type a;
+    typename ProductOperand<B>::type b;
+};
+
+template<typename A, typename B>
+MatBinary<A, B, ExprAdd> operator+(const MatExpr<A> &a, const MatExpr<B> &b)
+{
+    return {a.self(), b.self()};
+}
+
+template<typename A, typename B>
+MatBinary<A, B, ExprSub> operator-(const MatExpr<A> &a, const MatExpr<B> &b)
+{
+    return {a.self(), b.self()};
+}
+
+template<typename A, typename B>
+MatProduct<A, B> operator*(const MatExpr<A> &a, const MatExpr<B> &b)
+{
+    return {a.self(), b.self()};
+}
+
+template<typename S, typename A>
+    requires std::is_arithmetic_v<S>
+MatScaled<S, A> operator*(S s, const MatExpr<A> &a)
+{
+    return {s, a.self()};
+}
+
+template<typename A>
+MatTransposed<A> transposed(const MatExpr<A> &a)
+{
+    return MatTransposed<A>(a.self());
+}
+
+// Sum of the elementwise products of two same-shaped expressions; for
+// column vectors, their dot product.
+template<typename A, typename B>
+EXPR_INLINE typename A::value_type dot(const MatExpr<A> &a,
+                                       const MatExpr<B> &b)
+{
+    static_assert(A::rows == B::rows && A::cols == B::cols,
+                  "Incompatible matrix dimensions");
+    typename A::value_type sum = 0;
+    exprFor<A::rows * A::cols>([&](size_t n) {
+        sum += a.self()(n / A::cols, n % A::cols) *
+               b.self()(n / A::cols, n % A::cols);
+    });
+    return sum;
+}
+
+// Writes every element of 'e' through at(i, j). Element-wise expressions go
+// element by element; a product goes a row at a time, each row of the
+// result summing the rows of its right operand, so that the innermost loop
+// runs along rows and vectorizes.
+template<typename E, typename At>
+EXPR_INLINE void evaluate(const MatExpr<E> &e, At &&at)
+{
+    exprFor<E::rows * E::cols>([&](size_t n) {
+        at(n / E::cols, n % E::cols) = e.self()(n / E::cols, n % E::cols);
+    });
+}
+
+template<typename A, typename B, typename At>
+EXPR_INLINE void evaluate(const MatExpr<MatProduct<A, B>> &e, At &&at)
+{
+    const MatProduct<A, B> &p = e.self();
+    constexpr size_t C = MatProduct<A, B>::cols;
+    exprFor<A::rows>([&](size_t i) {
+        // Build the row in a local: the compiler cannot rule out that the
+        // target aliases an operand, and would reload operands after every
+        // store to it
+        typename MatProduct<A, B>::value_type row[C];
+        const auto ai0 = p.a(i, 0);
+        exprFor<C>([&](size_t j) { row[j] = ai0 * p.b(0, j); });
+        exprFor<A::cols - 1>([&](size_t k) {
+            const auto aik = p.a(i, k + 1);
+            exprFor<C>([&](size_t j) { row[j] += aik * p.b(k + 1, j); });
+        });
+        exprFor<C>([&](size_t j) { at(i, j) = row[j]; });
+    });
+}
+
+template<typename T, size_t R, size_t C, typename E>
+EXPR_INLINE void assign(T (&trg)[R][C], const MatExpr<E> &e)
+{
+    static_assert(E::rows == R && E::cols == C,
+                  "Incompatible matrix dimensions");
+    evaluate(e.self(), [&](size_t i, size_t j) -> T & { return trg[i][j]; });
+}
+
+template<typename T, size_t N, typename E>
+EXPR_INLINE void assign(T (&trg)[N], const MatExpr<E> &e)
+{
+    static_assert(E::rows == N && E::cols == 1,
+                  "Incompatible vector dimensions");
+    evaluate(e.self(), [&](size_t i, size_t) -> T & { return trg[i]; });
+}
+
+template<typename E>
+EXPR_INLINE void assign(Matrix33 &trg, const MatExpr<E> &e)
+{
+    static_assert(E::rows == 3 && E::cols == 3,
+                  "Incompatible matrix dimensions");
+    evaluate(e.self(),
+             [&](size_t i, size_t j) -> float & { return trg[int(i)][j]; });
+}
+
+template<typename T, size_t R, size_t C>
+template<typename E>
+MatValue<T, R, C>::MatValue(const MatExpr<E> &e)
+{
+    assign(m, e);
+}
+
+#endif
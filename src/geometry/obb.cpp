@@ -0,0 +1,397 @@
+#include "obb.hpp"
+#include "geometry.hpp"
+#include "hull.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Points handed to each thread at least when projecting onto the axes.
+static constexpr size_t PROJECT_GRAIN = 1 << 16;
+// Batches below this size are not worth handing to other threads.
+static constexpr size_t PARALLEL_GRAIN = 1 << 12;
+// Same tolerance as the single pair test.
+static constexpr float EPSILON = 1e-6f;
+
+// Extents of the points along the axes u.
+static void projectedRange(std::span<const Point3d> pt,
+                           const Point3d (&u)[3],
+                           float (&lo)[3],
+                           float (&hi)[3])
+{
+    const size_t n = pt.size();
+    const size_t chunks = n >= 2 * PROJECT_GRAIN ? parallelism() : 1;
+    const size_t step = (n + chunks - 1) / chunks;
+    std::vector<std::array<float, 6>> partial(chunks);
+    parallelFor(chunks, 1, [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; ++c)
+        {
+            float l[3], h[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                l[k] = std::numeric_limits<float>::max();
+                h[k] = -std::numeric_limits<float>::max();
+            }
+            const size_t end = std::min(n, (c + 1) * step);
+            for (size_t i = c * step; i < end; ++i)
+                for (int k = 0; k < 3; ++k)
+                {
+                    const float d = dotProd(pt[i], u[k]);
+                    l[k] = std::min(l[k], d);
+                    h[k] = std::max(h[k], d);
+                }
+            partial[c] = {l[0], l[1], l[2], h[0], h[1], h[2]};
+        }
+    });
+    for (int k = 0; k < 3; ++k)
+    {
+        lo[k] = std::numeric_limits<float>::max();
+        hi[k] = -std::numeric_limits<float>::max();
+        for (const auto &p : partial)
+        {
+            lo[k] = std::min(lo[k], p[k]);
+            hi[k] = std::max(hi[k], p[3 + k]);
+        }
+    }
+}
+
+static OBB3d boxAlong(std::span<const Point3d> pt, const Point3d (&u)[3])
+{
+    float lo[3], hi[3];
+    projectedRange(pt, u, lo, hi);
+    OBB3d box;
+    box.c = {0.0f, 0.0f, 0.0f};
+    for (int k = 0; k < 3; ++k)
+    {
+        const float mid = 0.5f * (lo[k] + hi[k]);
+        box.c = {box.c.x + mid * u[k].x,
+                 box.c.y + mid * u[k].y,
+                 box.c.z + mid * u[k].z};
+        box.u[k] = u[k];
+        box.e[k] = 0.5f * (hi[k] - lo[k]);
+    }
+    return box;
+}
+
+static float volume(const OBB3d &b)
+{
+    return b.e[0] * b.e[1] * b.e[2];
+}
+
+OBB3d obbFromPoints(std::span<const Point3d> pt, bool refine)
+{
+    if (pt.empty())
+        return {{0.0f, 0.0f, 0.0f},
+                {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+                {0.0f, 0.0f, 0.0f}};
+
+    // The eigenvectors of the covariance matrix are the principal axes.
+    Matrix33 v;
+    float eigenvalues[3];
+    Jacobi(covarianceMatrix(pt), v, eigenvalues);
+    Point3d u[3];
+    for (int k = 0; k < 3; ++k)
+        u[k] = {v[0][k], v[1][k], v[2][k]};
+    // Make the frame right handed.
+    u[2] = crossProd(u[0], u[1]);
+    normalize(u[2], u[2]);
+    OBB3d best = boxAlong(pt, u);
+    if (!refine)
+        return best;
+
+    std::vector<Point2d> flat(pt.size());
+    for (int k = 0; k < 3; ++k)
+    {
+        // Project onto the plane of the other two axes and fit a rectangle
+        const Point3d &a = u[(k + 1) % 3], &b = u[(k + 2) % 3];
+        for (size_t i = 0; i < pt.size(); ++i)
+            flat[i] = {dotProd(pt[i], a), dotProd(pt[i], b)};
+        const size_t h = quickHull(flat);
+        Point2d c, r[2];
+        float e[2];
+        minAreaRect(std::span<const Point2d>(flat).first(h), c, r, e);
+
+        Point3d axes[3];
+        axes[0] = u[k];
+        for (int j = 0; j < 2; ++j)
+            axes[1 + j] = {a.x * r[j].x + b.x * r[j].y,
+                           a.y * r[j].x + b.y * r[j].y,
+                           a.z * r[j].x + b.z * r[j].y};
+        const OBB3d box = boxAlong(pt, axes);
+        if (volume(box) < volume(best))
+            best = box;
+    }
+    return best;
+}
+
+static void intersectScalar(const OBB3d *a,
+                            const OBB3d *b,
+                            uint8_t *hit,
+                            size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        hit[i] = intersection(a[i], b[i]);
+}
+
+#ifdef GEOMETRY_X86
+
+// Gather component 'k' of eight consecutive boxes.
+GEOMETRY_AVX2 static inline __m256 gather(const float *base,
+                                          __m256i stride,
+                                          int k)
+{
+    return _mm256_i32gather_ps(base + k, stride, 4);
+}
+
+// Lanes where |dist| > ra + rb, that is where the axis separates the boxes.
+GEOMETRY_AVX2 static inline __m256 separates(__m256 dist,
+                                             __m256 ra,
+                                             __m256 rb)
+{
+    const __m256 absDist = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), dist);
+    return _mm256_cmp_ps(absDist, _mm256_add_ps(ra, rb), _CMP_GT_OQ);
+}
+
+GEOMETRY_AVX2 static void intersectAvx2(const OBB3d *a,
+                                        const OBB3d *b,
+                                        uint8_t *hit,
+                                        size_t n)
+{
+    static_assert(sizeof(OBB3d) == 15 * sizeof(float));
+    const __m256i stride = _mm256_setr_epi32(0, 15, 30, 45, 60, 75, 90, 105);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 eps = _mm256_set1_ps(EPSILON);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        // Lanes hold the boxes in SoA form, as in the scalar test.
+        const float *pa = &a[i].c.x, *pb = &b[i].c.x;
+        __m256 au[3][3], bu[3][3], ae[3], be[3], d[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                au[j][k] = gather(pa, stride, 3 + 3 * j + k);
+                bu[j][k] = gather(pb, stride, 3 + 3 * j + k);
+            }
+            ae[k] = gather(pa, stride, 12 + k);
+            be[k] = gather(pb, stride, 12 + k);
+            d[k] =
+                _mm256_sub_ps(gather(pb, stride, k), gather(pa, stride, k));
+        }
+
+        __m256 R[3][3], AbsR[3][3], t[3];
+        for (int r = 0; r < 3; ++r)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                __m256 dot = _mm256_mul_ps(au[r][0], bu[j][0]);
+                dot = _mm256_fmadd_ps(au[r][1], bu[j][1], dot);
+                R[r][j] = _mm256_fmadd_ps(au[r][2], bu[j][2], dot);
+                AbsR[r][j] =
+                    _mm256_add_ps(_mm256_andnot_ps(sign, R[r][j]), eps);
+            }
+            __m256 dot = _mm256_mul_ps(d[0], au[r][0]);
+            dot = _mm256_fmadd_ps(d[1], au[r][1], dot);
+            t[r] = _mm256_fmadd_ps(d[2], au[r][2], dot);
+        }
+
+        // Lanes get set as soon as an axis separates their pair.
+        __m256 separated = _mm256_setzero_ps();
+        for (int r = 0; r < 3; ++r)
+        {
+            __m256 rb = _mm256_mul_ps(be[0], AbsR[r][0]);
+            rb = _mm256_fmadd_ps(be[1], AbsR[r][1], rb);
+            rb = _mm256_fmadd_ps(be[2], AbsR[r][2], rb);
+            separated = _mm256_or_ps(separated, separates(t[r], ae[r], rb));
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+            __m256 ra = _mm256_mul_ps(ae[0], AbsR[0][j]);
+            ra = _mm256_fmadd_ps(ae[1], AbsR[1][j], ra);
+            ra = _mm256_fmadd_ps(ae[2], AbsR[2][j], ra);
+            __m256 dist = _mm256_mul_ps(t[0], R[0][j]);
+            dist = _mm256_fmadd_ps(t[1], R[1][j], dist);
+            dist = _mm256_fmadd_ps(t[2], R[2][j], dist);
+            separated = _mm256_or_ps(separated, separates(dist, ra, be[j]));
+        }
+        if (_mm256_movemask_ps(separated) != 0xff)
+        {
+            for (int r = 0; r < 3; ++r)
+            {
+                const int r1 = (r + 1) % 3, r2 = (r + 2) % 3;
+                for (int j = 0; j < 3; ++j)
+                {
+                    const int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+                    const __m256 ra =
+                        _mm256_fmadd_ps(ae[r1],
+                                        AbsR[r2][j],
+                                        _mm256_mul_ps(ae[r2], AbsR[r1][j]));
+                    const __m256 rb =
+                        _mm256_fmadd_ps(be[j1],
+                                        AbsR[r][j2],
+                                        _mm256_mul_ps(be[j2], AbsR[r][j1]));
+                    const __m256 dist =
+                        _mm256_fmsub_ps(t[r2],
+                                        R[r1][j],
+                                        _mm256_mul_ps(t[r1], R[r2][j]));
+                    separated =
+                        _mm256_or_ps(separated, separates(dist, ra, rb));
+                }
+            }
+        }
+
+        const int mask = _mm256_movemask_ps(separated);
+        for (int l = 0; l < 8; ++l)
+            hit[i + l] = (mask >> l & 1) == 0;
+    }
+    intersectScalar(a + i, b + i, hit + i, n - i);
+}
+
+GEOMETRY_AVX512 static inline __m512 gather16(const float *base,
+                                              __m512i stride,
+                                              int k)
+{
+    // The masked form with an explicit source: GCC's plain one reads an
+    // undefined register and warns under -Wmaybe-uninitialized.
+    return _mm512_mask_i32gather_ps(
+        _mm512_setzero_ps(), __mmask16(0xffff), stride, base + k, 4);
+}
+
+GEOMETRY_AVX512 static inline __mmask16 separates16(__m512 dist,
+                                                    __m512 ra,
+                                                    __m512 rb)
+{
+    return _mm512_cmp_ps_mask(
+        _mm512_abs_ps(dist), _mm512_add_ps(ra, rb), _CMP_GT_OQ);
+}
+
+// intersectAvx2() on sixteen pairs at a time, with the separated lanes kept
+// in a mask register.
+GEOMETRY_AVX512 static void intersectAvx512(const OBB3d *a,
+                                            const OBB3d *b,
+                                            uint8_t *hit,
+                                            size_t n)
+{
+    const __m512i stride = _mm512_setr_epi32(0, 15, 30, 45, 60, 75, 90, 105,
+                                             120, 135, 150, 165, 180, 195,
+                                             210, 225);
+    const __m512 eps = _mm512_set1_ps(EPSILON);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const float *pa = &a[i].c.x, *pb = &b[i].c.x;
+        __m512 au[3][3], bu[3][3], ae[3], be[3], d[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                au[j][k] = gather16(pa, stride, 3 + 3 * j + k);
+                bu[j][k] = gather16(pb, stride, 3 + 3 * j + k);
+            }
+            ae[k] = gather16(pa, stride, 12 + k);
+            be[k] = gather16(pb, stride, 12 + k);
+            d[k] = _mm512_sub_ps(gather16(pb, stride, k),
+                                 gather16(pa, stride, k));
+        }
+
+        __m512 R[3][3], AbsR[3][3], t[3];
+        for (int r = 0; r < 3; ++r)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                __m512 dot = _mm512_mul_ps(au[r][0], bu[j][0]);
+                dot = _mm512_fmadd_ps(au[r][1], bu[j][1], dot);
+                R[r][j] = _mm512_fmadd_ps(au[r][2], bu[j][2], dot);
+                AbsR[r][j] = _mm512_add_ps(_mm512_abs_ps(R[r][j]), eps);
+            }
+            __m512 dot = _mm512_mul_ps(d[0], au[r][0]);
+            dot = _mm512_fmadd_ps(d[1], au[r][1], dot);
+            t[r] = _mm512_fmadd_ps(d[2], au[r][2], dot);
+        }
+
+        __mmask16 separated = 0;
+        for (int r = 0; r < 3; ++r)
+        {
+            __m512 rb = _mm512_mul_ps(be[0], AbsR[r][0]);
+            rb = _mm512_fmadd_ps(be[1], AbsR[r][1], rb);
+            rb = _mm512_fmadd_ps(be[2], AbsR[r][2], rb);
+            separated |= separates16(t[r], ae[r], rb);
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+            __m512 ra = _mm512_mul_ps(ae[0], AbsR[0][j]);
+            ra = _mm512_fmadd_ps(ae[1], AbsR[1][j], ra);
+            ra = _mm512_fmadd_ps(ae[2], AbsR[2][j], ra);
+            __m512 dist = _mm512_mul_ps(t[0], R[0][j]);
+            dist = _mm512_fmadd_ps(t[1], R[1][j], dist);
+            dist = _mm512_fmadd_ps(t[2], R[2][j], dist);
+            separated |= separates16(dist, ra, be[j]);
+        }
+        if (separated != 0xffff)
+        {
+            for (int r = 0; r < 3; ++r)
+            {
+                const int r1 = (r + 1) % 3, r2 = (r + 2) % 3;
+                for (int j = 0; j < 3; ++j)
+                {
+                    const int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+                    const __m512 ra =
+                        _mm512_fmadd_ps(ae[r1],
+                                        AbsR[r2][j],
+                                        _mm512_mul_ps(ae[r2], AbsR[r1][j]));
+                    const __m512 rb =
+                        _mm512_fmadd_ps(be[j1],
+                                        AbsR[r][j2],
+                                        _mm512_mul_ps(be[j2], AbsR[r][j1]));
+                    const __m512 dist =
+                        _mm512_fmsub_ps(t[r2],
+                                        R[r1][j],
+                                        _mm512_mul_ps(t[r1], R[r2][j]));
+                    separated |= separates16(dist, ra, rb);
+                }
+            }
+        }
+
+        for (int l = 0; l < 16; ++l)
+            hit[i + l] = (separated >> l & 1) == 0;
+    }
+    intersectAvx2(a + i, b + i, hit + i, n - i);
+}
+
+#endif
+
+void intersection(std::span<const OBB3d> a,
+                  std::span<const OBB3d> b,
+                  std::span<uint8_t> hit,
+                  bool parallel)
+{
+    assert(a.size() == b.size() && a.size() == hit.size());
+    auto kernel = [&](size_t begin, size_t end) {
+#ifdef GEOMETRY_X86
+        if (cpuHasAvx512())
+            return intersectAvx512(a.data() + begin,
+                                   b.data() + begin,
+                                   hit.data() + begin,
+                                   end - begin);
+        if (cpuHasAvx2())
+            return intersectAvx2(a.data() + begin,
+                                 b.data() + begin,
+                                 hit.data() + begin,
+                                 end - begin);
+#endif
+        intersectScalar(a.data() + begin,
+                        b.data() + begin,
+                        hit.data() + begin,
+                        end - begin);
+    };
+    if (parallel)
+        parallelFor(a.size(), PARALLEL_GRAIN, kernel);
+    else
+        kernel(size_t(0), a.size());
+}
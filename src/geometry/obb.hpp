@@ -0,0 +1,24 @@
+#ifndef OBB_HPP_INCLUDED
+#define OBB_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include <cstdint>
+#include <span>
+
+// Box aligned with the principal axes of the points: the eigenvectors of
+// their covariance matrix. With 'refine', each principal axis in turn is
+// kept and the box is rotated about it to the minimum area rectangle of the
+// points' projected convex hull; the smallest of the four boxes is
+// returned. An empty span gives an empty box at the origin.
+OBB3d obbFromPoints(std::span<const Point3d> pt, bool refine = false);
+
+// Batched intersection(a[i], b[i]), stored as 0 or 1 in hit[i]. Sixteen
+// pairs at a time go through AVX-512, or eight through AVX2, when the CPU
+// has them, skipping the edge axes once all are separated by a face axis.
+// 'parallel' also splits large batches across threads.
+void intersection(std::span<const OBB3d> a,
+                  std::span<const OBB3d> b,
+                  std::span<uint8_t> hit,
+                  bool parallel = false);
+
+#endif
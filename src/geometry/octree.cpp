@@ -0,0 +1,116 @@
+#include "octree.hpp"
+#include <algorithm>
+#include <cassert>
+
+// Deepest level supported; keeps the traversal stack bounded.
+static constexpr int MAX_DEPTH_LIMIT = 30;
+
+LooseOctree::LooseOctree(const AABB3d &world, int maxDepth, float looseness)
+    : maxDepth_(std::clamp(maxDepth, 0, MAX_DEPTH_LIMIT)),
+      looseness_(std::max(looseness, 1.0f))
+{
+    const float half = std::max({world.r[0], world.r[1], world.r[2]});
+    nodes_.push_back({world.c, half, NULL_INDEX, NULL_INDEX, 0, NULL_INDEX});
+}
+
+int LooseOctree::childFor(int node, const Point3d &p)
+{
+    if (nodes_[node].firstChild == NULL_INDEX)
+    {
+        const int first = static_cast<int>(nodes_.size());
+        const OctNode n = nodes_[node];
+        const float h = 0.5f * n.half;
+        for (int i = 0; i < 8; ++i)
+        {
+            Point3d c{n.c.x + (i & 1 ? h : -h),
+                      n.c.y + (i & 2 ? h : -h),
+                      n.c.z + (i & 4 ? h : -h)};
+            nodes_.push_back({c, h, NULL_INDEX, NULL_INDEX, 0, node});
+        }
+        nodes_[node].firstChild = first;
+    }
+    const OctNode &n = nodes_[node];
+    const int octant =
+        (p.x >= n.c.x ? 1 : 0) | (p.y >= n.c.y ? 2 : 0) | (p.z >= n.c.z ? 4 : 0);
+    return n.firstChild + octant;
+}
+
+void LooseOctree::link(int object, int node)
+{
+    Object &o = objects_[object];
+    o.node = node;
+    o.prev = NULL_INDEX;
+    o.next = nodes_[node].firstObject;
+    if (o.next != NULL_INDEX)
+        objects_[o.next].prev = object;
+    nodes_[node].firstObject = object;
+    for (int n = node; n != NULL_INDEX; n = nodes_[n].parent)
+        ++nodes_[n].count;
+}
+
+void LooseOctree::unlink(int object)
+{
+    Object &o = objects_[object];
+    if (o.prev != NULL_INDEX)
+        objects_[o.prev].next = o.next;
+    else
+        nodes_[o.node].firstObject = o.next;
+    if (o.next != NULL_INDEX)
+        objects_[o.next].prev = o.prev;
+    for (int n = o.node; n != NULL_INDEX; n = nodes_[n].parent)
+        --nodes_[n].count;
+    o.node = NULL_INDEX;
+}
+
+int LooseOctree::insert(const AABB3d &box, uint32_t userData)
+{
+    int id;
+    if (freeObjects_ != NULL_INDEX)
+    {
+        id = freeObjects_;
+        freeObjects_ = objects_[id].next;
+    }
+    else
+    {
+        id = static_cast<int>(objects_.size());
+        objects_.emplace_back();
+    }
+    objects_[id].userData = userData;
+    objects_[id].node = NULL_INDEX;
+    update(id, box);
+    return id;
+}
+
+void LooseOctree::remove(int object)
+{
+    unlink(object);
+    objects_[object].next = freeObjects_;
+    freeObjects_ = object;
+}
+
+void LooseOctree::update(int object, const AABB3d &box)
+{
+    if (objects_[object].node != NULL_INDEX)
+        unlink(object);
+    objects_[object].box = box;
+
+    // A child whose cell holds the center can hold the box as long as the
+    // box radius fits into the slack of its loose bounds.
+    const float radius = std::max({box.r[0], box.r[1], box.r[2]});
+    const OctNode &root = nodes_[0];
+    const bool inWorld = std::abs(box.c.x - root.c.x) <= root.half &&
+                         std::abs(box.c.y - root.c.y) <= root.half &&
+                         std::abs(box.c.z - root.c.z) <= root.half;
+    int node = 0;
+    if (inWorld)
+    {
+        for (int depth = 0; depth < maxDepth_; ++depth)
+        {
+            const float childHalf = 0.5f * nodes_[node].half;
+            if (radius > (looseness_ - 1.0f) * childHalf)
+                break;
+            node = childFor(node, box.c);
+        }
+    }
+    link(object, node);
+}
@@ -0,0 +1,154 @@
+#ifndef OCTREE_HPP_INCLUDED
+#define OCTREE_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include "geometry.hpp"
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Node of the loose octree. The eight children of a node are allocated
+// together and stored consecutively from 'firstChild'.
+struct OctNode
+{
+    Point3d c;
+    // Half width of the node's cell; its loose bounds are 'looseness' times
+    // larger.
+    float half;
+    int firstChild;
+    // Head of the doubly linked list of objects stored in this node.
+    int firstObject;
+    // Objects stored in this node and all of its descendants.
+    uint32_t count;
+    int parent;
+};
+
+// Loose octree over AABBs. An object is stored in the deepest node whose
+// cell contains its center and whose loose bounds are large enough to
+// contain its box, so insertion and removal only walk one root to leaf path.
+// Nodes and objects live in flat arrays addressed by index.
+class LooseOctree
+{
+public:
+    static constexpr int NULL_INDEX = -1;
+
+    // 'world' is the root cell. Objects whose centers fall outside it are
+    // kept at the root, so an estimate is enough.
+    LooseOctree(const AABB3d &world, int maxDepth = 8, float looseness = 2.0f);
+
+    // Insert a box and return its object id.
+    int insert(const AABB3d &box, uint32_t userData);
+    void remove(int object);
+    void update(int object, const AABB3d &box);
+
+    uint32_t userData(int object) const
+    {
+        return objects_[object].userData;
+    }
+
+    const AABB3d &box(int object) const
+    {
+        return objects_[object].box;
+    }
+
+    // Node currently holding the object.
+    int nodeOf(int object) const
+    {
+        return objects_[object].node;
+    }
+
+    std::span<const OctNode> nodes() const
+    {
+        return nodes_;
+    }
+
+    size_t size() const
+    {
+        return nodes_[0].count;
+    }
+
+    // Call f(object) for every object whose box passes the region test.
+    template<typename F>
+    void query(const AABB3d &region, F &&f) const;
+    template<typename F>
+    void query(const Sphere &region, F &&f) const;
+    template<typename F>
+    void query(const Frustum &region, F &&f) const;
+private:
+    struct Object
+    {
+        AABB3d box;
+        uint32_t userData;
+        int node;
+        int prev;
+        int next;
+    };
+
+    static constexpr int STACK_SIZE = 8 * 32;
+
+    AABB3d looseBounds(const OctNode &n) const
+    {
+        const float h = n.half * looseness_;
+        return {n.c, {h, h, h}};
+    }
+
+    int childFor(int node, const Point3d &p);
+    void link(int object, int node);
+    void unlink(int object);
+
+    template<typename Region, typename F>
+    void visit(const Region &region, F &&f) const;
+
+    int maxDepth_;
+    float looseness_;
+    std::vector<OctNode> nodes_;
+    std::vector<Object> objects_;
+    int freeObjects_ = NULL_INDEX;
+};
+
+template<typename Region, typename F>
+void LooseOctree::visit(const Region &region, F &&f) const
+{
+    int stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const int index = stack[--top];
+        const OctNode &n = nodes_[index];
+        if (n.count == 0)
+            continue;
+        // The root also holds objects outside the world box, so its own list
+        // is scanned regardless of its bounds.
+        const bool inside = intersection(region, looseBounds(n));
+        if (!inside && index != 0)
+            continue;
+        for (int o = n.firstObject; o != NULL_INDEX; o = objects_[o].next)
+            if (intersection(region, objects_[o].box))
+                f(o);
+        if (inside && n.firstChild != NULL_INDEX)
+            for (int c = 0; c < 8; ++c)
+                stack[top++] = n.firstChild + c;
+    }
+}
+
+template<typename F>
+void LooseOctree::query(const AABB3d &region, F &&f) const
+{
+    visit(region, std::forward<F>(f));
+}
+
+template<typename F>
+void LooseOctree::query(const Sphere &region, F &&f) const
+{
+    visit(region, std::forward<F>(f));
+}
+
+template<typename F>
+void LooseOctree::query(const Frustum &region, F &&f) const
+{
+    visit(region, std::forward<F>(f));
+}
+
+#endif
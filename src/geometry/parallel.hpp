@@ -0,0 +1,55 @@
+#ifndef PARALLEL_HPP_INCLUDED
+#define PARALLEL_HPP_INCLUDED
+
+#include "scheduler.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+// The geometry kernels' parallel loops, run as tasks on the shared
+// Scheduler::global() pool.
+
+// Number of threads the geometry kernels are allowed to use.
+inline unsigned parallelism()
+{
+    return Scheduler::global().threads();
+}
+
+// Split [0, n) into at most parallelism() contiguous chunks of at least
+// 'grain' indices and call f(begin, end) once per chunk, so that callers
+// may keep one partial result per chunk. Idle threads steal chunks, the
+// calling thread among them.
+template<typename F>
+void parallelFor(size_t n, size_t grain, F &&f)
+{
+    if (n == 0)
+        return;
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunks =
+        std::min<size_t>(parallelism(), (n + grain - 1) / grain);
+    if (chunks <= 1)
+    {
+        f(size_t(0), n);
+        return;
+    }
+
+    const size_t step = (n + chunks - 1) / chunks;
+    Scheduler::global().parallelFor(
+        0,
+        chunks,
+        [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; ++c)
+                if (c * step < n)
+                    f(c * step, std::min(n, (c + 1) * step));
+        },
+        1);
+}
+
+// Run a() and b(), concurrently when another thread is free.
+template<typename A, typename B>
+void parallelInvoke(A &&a, B &&b)
+{
+    Scheduler::global().invoke(std::forward<A>(a), std::forward<B>(b));
+}
+
+#endif
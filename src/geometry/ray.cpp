@@ -0,0 +1,239 @@
+#include "ray.hpp"
+#include "simd.hpp"
+#include <algorithm>
+
+// The scalar and AVX2 kernels make the same comparisons in the same order,
+// so a ray gets the same answer alone and in a packet, up to the rounding of
+// fused multiply-adds. minps(a, b) and maxps(a, b) behave like
+// _mm256_min_ps and _mm256_max_ps: b if either is NaN.
+static inline float minps(float a, float b)
+{
+    return a < b ? a : b;
+}
+
+static inline float maxps(float a, float b)
+{
+    return a > b ? a : b;
+}
+
+// Division by a zero direction component gives +-inf, and 0 * inf is the
+// NaN of a ray lying in a slab plane. The operand order lets that NaN fall
+// through, keeping the slab open.
+static bool slab(const float (&o)[3],
+                 const float (&inv)[3],
+                 const float (&mn)[3],
+                 const float (&mx)[3],
+                 float tmax,
+                 float &tenter)
+{
+    float tmin = 0.0f;
+    for (int k = 0; k < 3; ++k)
+    {
+        const float t1 = (mn[k] - o[k]) * inv[k];
+        const float t2 = (mx[k] - o[k]) * inv[k];
+        tmin = maxps(minps(t2, t1), tmin);
+        tmax = minps(maxps(t1, t2), tmax);
+    }
+    tenter = tmin;
+    return tmin <= tmax;
+}
+
+static bool mollerTrumbore(const float (&o)[3],
+                           const float (&d)[3],
+                           const Triangle3d &tri,
+                           float tmax,
+                           float &t,
+                           float &u,
+                           float &v)
+{
+    const float e1[3] = {tri.b.x - tri.a.x, tri.b.y - tri.a.y,
+                         tri.b.z - tri.a.z};
+    const float e2[3] = {tri.c.x - tri.a.x, tri.c.y - tri.a.y,
+                         tri.c.z - tri.a.z};
+    const float s[3] = {o[0] - tri.a.x, o[1] - tri.a.y, o[2] - tri.a.z};
+    const float p[3] = {d[1] * e2[2] - d[2] * e2[1],
+                        d[2] * e2[0] - d[0] * e2[2],
+                        d[0] * e2[1] - d[1] * e2[0]};
+    const float q[3] = {s[1] * e1[2] - s[2] * e1[1],
+                        s[2] * e1[0] - s[0] * e1[2],
+                        s[0] * e1[1] - s[1] * e1[0]};
+    const float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    const float inv = 1.0f / det;
+    u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+    v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+    t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+    return det != 0.0f && u >= 0.0f && v >= 0.0f && u + v <= 1.0f &&
+           t >= 0.0f && t <= tmax;
+}
+
+#ifdef GEOMETRY_X86
+
+GEOMETRY_AVX2 static uint32_t slab8(const RayPacket &p,
+                                    const float (&mn)[3],
+                                    const float (&mx)[3],
+                                    float (&tenter)[RayPacket::WIDTH])
+{
+    __m256 tmin = _mm256_setzero_ps();
+    __m256 tmax = _mm256_load_ps(p.tmax);
+    for (int k = 0; k < 3; ++k)
+    {
+        const __m256 o = _mm256_load_ps(p.o[k]);
+        const __m256 inv = _mm256_load_ps(p.inv[k]);
+        const __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(mn[k]), o),
+                                        inv);
+        const __m256 t2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(mx[k]), o),
+                                        inv);
+        tmin = _mm256_max_ps(_mm256_min_ps(t2, t1), tmin);
+        tmax = _mm256_min_ps(_mm256_max_ps(t1, t2), tmax);
+    }
+    _mm256_storeu_ps(tenter, tmin);
+    return uint32_t(
+        _mm256_movemask_ps(_mm256_cmp_ps(tmin, tmax, _CMP_LE_OQ)));
+}
+
+GEOMETRY_AVX2 static inline __m256 dot3(const __m256 (&a)[3],
+                                        const __m256 (&b)[3])
+{
+    return _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(a[0], b[0]), _mm256_mul_ps(a[1], b[1])),
+        _mm256_mul_ps(a[2], b[2]));
+}
+
+GEOMETRY_AVX2 static inline void cross3(const __m256 (&a)[3],
+                                        const __m256 (&b)[3],
+                                        __m256 (&c)[3])
+{
+    c[0] = _mm256_sub_ps(_mm256_mul_ps(a[1], b[2]), _mm256_mul_ps(a[2], b[1]));
+    c[1] = _mm256_sub_ps(_mm256_mul_ps(a[2], b[0]), _mm256_mul_ps(a[0], b[2]));
+    c[2] = _mm256_sub_ps(_mm256_mul_ps(a[0], b[1]), _mm256_mul_ps(a[1], b[0]));
+}
+
+GEOMETRY_AVX2 static uint32_t mollerTrumbore8(const RayPacket &p,
+                                              const Triangle3d &tri,
+                                              float (&t)[RayPacket::WIDTH],
+                                              float (&u)[RayPacket::WIDTH],
+                                              float (&v)[RayPacket::WIDTH])
+{
+    const float *a = &tri.a.x, *b = &tri.b.x, *c = &tri.c.x;
+    __m256 e1[3], e2[3], s[3], d[3], pv[3], q[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        e1[k] = _mm256_set1_ps(b[k] - a[k]);
+        e2[k] = _mm256_set1_ps(c[k] - a[k]);
+        s[k] = _mm256_sub_ps(_mm256_load_ps(p.o[k]), _mm256_set1_ps(a[k]));
+        d[k] = _mm256_load_ps(p.d[k]);
+    }
+    cross3(d, e2, pv);
+    cross3(s, e1, q);
+    const __m256 det = dot3(e1, pv);
+    const __m256 inv = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+    const __m256 uu = _mm256_mul_ps(dot3(s, pv), inv);
+    const __m256 vv = _mm256_mul_ps(dot3(d, q), inv);
+    const __m256 tt = _mm256_mul_ps(dot3(e2, q), inv);
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 hit = _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ);
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(uu, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(vv, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit,
+                        _mm256_cmp_ps(_mm256_add_ps(uu, vv),
+                                      _mm256_set1_ps(1.0f),
+                                      _CMP_LE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(tt, zero, _CMP_GE_OQ));
+    hit = _mm256_and_ps(
+        hit, _mm256_cmp_ps(tt, _mm256_load_ps(p.tmax), _CMP_LE_OQ));
+    _mm256_storeu_ps(t, tt);
+    _mm256_storeu_ps(u, uu);
+    _mm256_storeu_ps(v, vv);
+    return uint32_t(_mm256_movemask_ps(hit));
+}
+
+#endif
+
+RayPacket::RayPacket(std::span<const Ray> rays, float tmax)
+    : count(static_cast<int>(std::min<size_t>(rays.size(), WIDTH)))
+{
+    for (int i = 0; i < WIDTH; ++i)
+    {
+        // Idle lanes end before they start
+        const Ray r = i < count ? rays[i] : Ray{{0, 0, 0}, {1, 1, 1}};
+        const float *ro = &r.o.x, *rd = &r.d.x;
+        for (int k = 0; k < 3; ++k)
+        {
+            o[k][i] = ro[k];
+            d[k][i] = rd[k];
+            inv[k][i] = 1.0f / rd[k];
+        }
+        this->tmax[i] = i < count ? tmax : -1.0f;
+    }
+}
+
+bool intersection(const Ray &r, const AABB3d &b, float tmax, float &tenter)
+{
+    const float o[3] = {r.o.x, r.o.y, r.o.z};
+    const float inv[3] = {1.0f / r.d.x, 1.0f / r.d.y, 1.0f / r.d.z};
+    const float mn[3] = {b.c.x - b.r[0], b.c.y - b.r[1], b.c.z - b.r[2]};
+    const float mx[3] = {b.c.x + b.r[0], b.c.y + b.r[1], b.c.z + b.r[2]};
+    return slab(o, inv, mn, mx, tmax, tenter);
+}
+
+bool intersection(const Ray &r,
+                  const Triangle3d &tri,
+                  float tmax,
+                  float &t,
+                  float &u,
+                  float &v)
+{
+    const float o[3] = {r.o.x, r.o.y, r.o.z};
+    const float d[3] = {r.d.x, r.d.y, r.d.z};
+    return mollerTrumbore(o, d, tri, tmax, t, u, v);
+}
+
+uint32_t intersection(const RayPacket &p,
+                      const float (&mn)[3],
+                      const float (&mx)[3],
+                      float (&tenter)[RayPacket::WIDTH])
+{
+#ifdef GEOMETRY_X86
+    if (cpuHasAvx2())
+        return slab8(p, mn, mx, tenter) & p.activeMask();
+#endif
+    uint32_t mask = 0;
+    for (int i = 0; i < p.count; ++i)
+    {
+        const float o[3] = {p.o[0][i], p.o[1][i], p.o[2][i]};
+        const float inv[3] = {p.inv[0][i], p.inv[1][i], p.inv[2][i]};
+        if (slab(o, inv, mn, mx, p.tmax[i], tenter[i]))
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+uint32_t intersection(const RayPacket &p,
+                      const AABB3d &b,
+                      float (&tenter)[RayPacket::WIDTH])
+{
+    const float mn[3] = {b.c.x - b.r[0], b.c.y - b.r[1], b.c.z - b.r[2]};
+    const float mx[3] = {b.c.x + b.r[0], b.c.y + b.r[1], b.c.z + b.r[2]};
+    return intersection(p, mn, mx, tenter);
+}
+
+uint32_t intersection(const RayPacket &p,
+                      const Triangle3d &tri,
+                      float (&t)[RayPacket::WIDTH],
+                      float (&u)[RayPacket::WIDTH],
+                      float (&v)[RayPacket::WIDTH])
+{
+#ifdef GEOMETRY_X86
+    if (cpuHasAvx2())
+        return mollerTrumbore8(p, tri, t, u, v) & p.activeMask();
+#endif
+    uint32_t mask = 0;
+    for (int i = 0; i < p.count; ++i)
+    {
+        const float o[3] = {p.o[0][i], p.o[1][i], p.o[2][i]};
+        const float d[3] = {p.d[0][i], p.d[1][i], p.d[2][i]};
+        if (mollerTrumbore(o, d, tri, p.tmax[i], t[i], u[i], v[i]))
+            mask |= 1u << i;
+    }
+    return mask;
+}
@@ -0,0 +1,63 @@
+#ifndef RAY_HPP_INCLUDED
+#define RAY_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include <cstdint>
+#include <span>
+
+// Up to WIDTH rays in SoA form, one lane each, with their inverse
+// directions precomputed for slab tests. The tests below run a whole packet
+// against one box or triangle, through AVX2 when the CPU has it, and return
+// a mask with bit i set for lane i. Lanes past 'count' never hit.
+struct alignas(32) RayPacket
+{
+    static constexpr int WIDTH = 8;
+
+    float o[3][WIDTH];
+    float d[3][WIDTH];
+    float inv[3][WIDTH];
+    // Lane i covers t in [0, tmax[i]]; closest hit searches shrink it.
+    float tmax[WIDTH];
+    int count = 0;
+
+    RayPacket() = default;
+    // Packs the first min(rays.size(), WIDTH) rays.
+    RayPacket(std::span<const Ray> rays, float tmax);
+
+    uint32_t activeMask() const
+    {
+        return (1u << count) - 1;
+    }
+};
+
+// Slab test: true if the ray enters 'b' at some t in [0, tmax], stored in
+// tenter. A ray starting inside enters at 0.
+bool intersection(const Ray &r, const AABB3d &b, float tmax, float &tenter);
+
+// Moller-Trumbore: true if the ray hits the triangle, from either side, at
+// some t in [0, tmax]. Stores t and the barycentric weights u of b and v of
+// c at the hit.
+bool intersection(const Ray &r,
+                  const Triangle3d &tri,
+                  float tmax,
+                  float &t,
+                  float &u,
+                  float &v);
+
+// The slab test for every lane of the packet, against box [mn, mx].
+uint32_t intersection(const RayPacket &p,
+                      const float (&mn)[3],
+                      const float (&mx)[3],
+                      float (&tenter)[RayPacket::WIDTH]);
+uint32_t intersection(const RayPacket &p,
+                      const AABB3d &b,
+                      float (&tenter)[RayPacket::WIDTH]);
+
+// Moller-Trumbore for every lane of the packet.
+uint32_t intersection(const RayPacket &p,
+                      const Triangle3d &tri,
+                      float (&t)[RayPacket::WIDTH],
+                      float (&u)[RayPacket::WIDTH],
+                      float (&v)[RayPacket::WIDTH]);
+
+#endif
@@ -0,0 +1,62 @@
+#include "simd.hpp"
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+SimdLevel detect()
+{
+#ifdef GEOMETRY_X86
+    // Runs during static initialization, possibly before libgcc's own.
+    __builtin_cpu_init();
+    // These also check that the OS saves the wider registers.
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512vl") &&
+        __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("fma"))
+        return SimdLevel::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::Avx2;
+#endif
+    return SimdLevel::Scalar;
+}
+} // namespace
+
+SimdLevel cpuSimdLevel()
+{
+    static const SimdLevel best = detect();
+    return best;
+}
+
+SimdLevel initialSimdLevel()
+{
+    const SimdLevel best = cpuSimdLevel();
+    const char *name = std::getenv("GEOMETRY_SIMD");
+    if (name == nullptr)
+        return best;
+    for (SimdLevel level :
+         {SimdLevel::Scalar, SimdLevel::Avx2, SimdLevel::Avx512})
+        if (std::strcmp(name, simdLevelName(level)) == 0)
+            return level < best ? level : best;
+    return best;
+}
+
+SimdLevel setSimdLevel(SimdLevel level)
+{
+    if (level > cpuSimdLevel())
+        level = cpuSimdLevel();
+    return currentSimdLevel.exchange(level, std::memory_order_relaxed);
+}
+
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar:
+        return "scalar";
+    case SimdLevel::Avx2:
+        return "avx2";
+    case SimdLevel::Avx512:
+        return "avx512";
+    }
+    return "unknown";
+}
@@ -0,0 +1,185 @@
+#ifndef SIMD_HPP_INCLUDED
+#define SIMD_HPP_INCLUDED
+
+#include <atomic>
+
+// Vector kernels are compiled per function with target attributes, so the
+// library itself needs no -mavx2 and picks a code path at run time from
+// simdLevel(). Kernels that gain from the wider registers also have
+// AVX-512 paths, which take whole groups of sixteen and leave the rest to
+// the AVX2 or scalar code.
+#if defined(__x86_64__) || defined(__i386__)
+#define GEOMETRY_X86 1
+#include <immintrin.h>
+#define GEOMETRY_AVX2 __attribute__((target("avx2,fma")))
+#define GEOMETRY_AVX512                                                        \
+    __attribute__((target("avx512f,avx512vl,avx512dq,avx2,fma")))
+// SSE is part of the baseline on x86-64, so it needs no run-time check.
+#ifdef __SSE__
+#define GEOMETRY_SSE 1
+#endif
+#endif
+
+#ifdef GEOMETRY_X86
+// Load eight consecutive xyz triples (24 floats) and deinterleave them into
+// one register per axis.
+GEOMETRY_AVX2 inline void
+loadXYZ8(const float *p, __m256 &x, __m256 &y, __m256 &z)
+{
+    const __m256 a0 = _mm256_loadu_ps(p);
+    const __m256 a1 = _mm256_loadu_ps(p + 8);
+    const __m256 a2 = _mm256_loadu_ps(p + 16);
+    // Pick each axis' lanes from the three loads, then restore their order.
+    __m256 tx = _mm256_blend_ps(_mm256_blend_ps(a0, a1, 0x92), a2, 0x24);
+    __m256 ty = _mm256_blend_ps(_mm256_blend_ps(a0, a1, 0x24), a2, 0x49);
+    __m256 tz = _mm256_blend_ps(_mm256_blend_ps(a0, a1, 0x49), a2, 0x92);
+    x = _mm256_permutevar8x32_ps(tx, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+    y = _mm256_permutevar8x32_ps(ty, _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6));
+    z = _mm256_permutevar8x32_ps(tz, _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+}
+
+// Inverse of loadXYZ8(): interleave one register per axis into eight
+// consecutive xyz triples.
+GEOMETRY_AVX2 inline void storeXYZ8(float *p, __m256 x, __m256 y, __m256 z)
+{
+    const __m256 tx =
+        _mm256_permutevar8x32_ps(x, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+    const __m256 ty =
+        _mm256_permutevar8x32_ps(y, _mm256_setr_epi32(5, 0, 3, 6, 1, 4, 7, 2));
+    const __m256 tz =
+        _mm256_permutevar8x32_ps(z, _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+    _mm256_storeu_ps(p,
+                     _mm256_blend_ps(_mm256_blend_ps(tx, ty, 0x92), tz, 0x24));
+    _mm256_storeu_ps(p + 8,
+                     _mm256_blend_ps(_mm256_blend_ps(tx, ty, 0x24), tz, 0x49));
+    _mm256_storeu_ps(p + 16,
+                     _mm256_blend_ps(_mm256_blend_ps(tx, ty, 0x49), tz, 0x92));
+}
+
+// Load eight consecutive xy pairs (16 floats) and deinterleave them.
+GEOMETRY_AVX2 inline void loadXY8(const float *p, __m256 &x, __m256 &y)
+{
+    const __m256 a0 = _mm256_loadu_ps(p);
+    const __m256 a1 = _mm256_loadu_ps(p + 8);
+    // Each 128-bit half picks its pairs: x0 x1 x4 x5 | x2 x3 x6 x7, then the
+    // middle 64-bit blocks trade places.
+    const __m256 tx = _mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+    const __m256 ty = _mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+    x = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(tx),
+                                               _MM_SHUFFLE(3, 1, 2, 0)));
+    y = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(ty),
+                                               _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+// Transpose the 4x4 block in each 128-bit half of r[0..3]: interleave pairs
+// of rows, then pairs of pairs.
+GEOMETRY_AVX2 inline void transpose4x4Halves(__m256 *r)
+{
+    const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    const __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+    const __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    r[0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    r[1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    r[2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    r[3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// Transpose the 8x8 matrix whose rows are r[0..7]: the 4x4 blocks in place,
+// then the off-diagonal blocks trade places.
+GEOMETRY_AVX2 inline void transpose8x8(__m256 (&r)[8])
+{
+    transpose4x4Halves(r);
+    transpose4x4Halves(r + 4);
+    for (int i = 0; i < 4; ++i)
+    {
+        const __m256 lo = r[i], hi = r[i + 4];
+        r[i] = _mm256_permute2f128_ps(lo, hi, 0x20);
+        r[i + 4] = _mm256_permute2f128_ps(lo, hi, 0x31);
+    }
+}
+
+// Load sixteen consecutive xyz triples (48 floats) and deinterleave them.
+// Element 3k + a of the input is lane k of axis a: a permute of the first
+// two loads places the elements below 32, a second one those from the third.
+GEOMETRY_AVX512 inline void
+loadXYZ16(const float *p, __m512 &x, __m512 &y, __m512 &z)
+{
+    const __m512 a0 = _mm512_loadu_ps(p);
+    const __m512 a1 = _mm512_loadu_ps(p + 16);
+    const __m512 a2 = _mm512_loadu_ps(p + 32);
+    const __m512 tx = _mm512_permutex2var_ps(
+        a0,
+        _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21,
+                          24, 27, 30, 0, 0, 0, 0, 0),
+        a1);
+    const __m512 ty = _mm512_permutex2var_ps(
+        a0,
+        _mm512_setr_epi32(1, 4, 7, 10, 13, 16, 19, 22,
+                          25, 28, 31, 0, 0, 0, 0, 0),
+        a1);
+    const __m512 tz = _mm512_permutex2var_ps(
+        a0,
+        _mm512_setr_epi32(2, 5, 8, 11, 14, 17, 20, 23,
+                          26, 29, 0, 0, 0, 0, 0, 0),
+        a1);
+    x = _mm512_permutex2var_ps(
+        tx,
+        _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 17, 20, 23, 26, 29),
+        a2);
+    y = _mm512_permutex2var_ps(
+        ty,
+        _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 18, 21, 24, 27, 30),
+        a2);
+    z = _mm512_permutex2var_ps(
+        tz,
+        _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 16, 19, 22, 25, 28, 31),
+        a2);
+}
+#endif
+
+// Code paths a kernel can have, in increasing order of vector width.
+enum class SimdLevel
+{
+    Scalar,
+    Avx2,
+    Avx512
+};
+
+// The best level this CPU supports, found through cpuid once.
+SimdLevel cpuSimdLevel();
+
+// cpuSimdLevel(), lowered to the one named by the GEOMETRY_SIMD
+// environment variable ("scalar", "avx2" or "avx512") if that is set.
+SimdLevel initialSimdLevel();
+
+// The level kernels dispatch on, starting at initialSimdLevel(). Defined
+// here so that the checks below inline to one relaxed load; until its
+// initializer has run it reads as Scalar, which every kernel has. Use
+// simdLevel() and setSimdLevel().
+inline std::atomic<SimdLevel> currentSimdLevel{initialSimdLevel()};
+
+inline SimdLevel simdLevel()
+{
+    return currentSimdLevel.load(std::memory_order_relaxed);
+}
+
+// Make kernels dispatch on 'level', or on cpuSimdLevel() if that is lower,
+// and return the level that was in effect. For tests and benchmarks that
+// compare the code paths.
+SimdLevel setSimdLevel(SimdLevel level);
+
+const char *simdLevelName(SimdLevel level);
+
+// Whether kernels should take their AVX2 or AVX-512 paths.
+inline bool cpuHasAvx2()
+{
+    return simdLevel() >= SimdLevel::Avx2;
+}
+
+inline bool cpuHasAvx512()
+{
+    return simdLevel() >= SimdLevel::Avx512;
+}
+
+#endif
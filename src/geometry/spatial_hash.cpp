@@ -0,0 +1,181 @@
+#include "spatial_hash.hpp"
+#include "parallel.hpp"
+#include <atomic>
+#include <bit>
+#include <cmath>
+
+static constexpr int CELL_LIMIT = (1 << 20) - 1;
+
+static int cellCoord(float v, float invCellSize)
+{
+    float c = std::floor(v * invCellSize);
+    c = std::clamp(c, float(-CELL_LIMIT), float(CELL_LIMIT));
+    return static_cast<int>(c);
+}
+
+SpatialHash::SpatialHash(float cellSize)
+    : cellSize_(cellSize), invCellSize_(1.0f / cellSize)
+{}
+
+SpatialHash::CellRange SpatialHash::cellRange(const AABB3d &box) const
+{
+    const float *c = &box.c.x;
+    CellRange r;
+    for (int a = 0; a < 3; ++a)
+    {
+        r.lo[a] = cellCoord(c[a] - box.r[a], invCellSize_);
+        r.hi[a] = cellCoord(c[a] + box.r[a], invCellSize_);
+    }
+    return r;
+}
+
+// 21 bits per axis, offset to be non-negative. Never equal to EMPTY.
+uint64_t SpatialHash::packKey(int x, int y, int z)
+{
+    auto bits = [](int v) { return uint64_t(v + CELL_LIMIT + 1) & 0x1fffff; };
+    return bits(x) | bits(y) << 21 | bits(z) << 42;
+}
+
+const SpatialHash::Slot *SpatialHash::find(uint64_t key) const
+{
+    // Fibonacci hashing into a power of two table, then linear probing.
+    const size_t mask = table_.size() - 1;
+    size_t i = (key * 0x9E3779B97F4A7C15ull) >> shift_;
+    while (true)
+    {
+        const Slot &s = table_[i];
+        if (s.key == key)
+            return &s;
+        if (s.key == EMPTY)
+            return nullptr;
+        i = (i + 1) & mask;
+    }
+}
+
+SpatialHash::Slot &SpatialHash::findOrInsert(uint64_t key)
+{
+    const size_t mask = table_.size() - 1;
+    size_t i = (key * 0x9E3779B97F4A7C15ull) >> shift_;
+    while (table_[i].key != key && table_[i].key != EMPTY)
+        i = (i + 1) & mask;
+    if (table_[i].key == EMPTY)
+    {
+        table_[i] = {key, 0, 0};
+        ++cellCount_;
+    }
+    return table_[i];
+}
+
+bool SpatialHash::overlap(uint32_t a, uint32_t b) const
+{
+    if (!spheres_.empty())
+        return intersection(spheres_[a], spheres_[b]);
+    return intersection(boxes_[a], boxes_[b]);
+}
+
+void SpatialHash::build(std::span<const AABB3d> boxes)
+{
+    boxes_.assign(boxes.begin(), boxes.end());
+    spheres_.clear();
+    insertAll();
+}
+
+void SpatialHash::build(std::span<const Sphere> spheres)
+{
+    spheres_.assign(spheres.begin(), spheres.end());
+    boxes_.resize(spheres.size());
+    for (size_t i = 0; i < spheres.size(); ++i)
+        boxes_[i] = {spheres[i].c, {spheres[i].r, spheres[i].r, spheres[i].r}};
+    insertAll();
+}
+
+void SpatialHash::insertAll()
+{
+    const auto n = static_cast<uint32_t>(boxes_.size());
+    ranges_.resize(n);
+    size_t total = 0;
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        ranges_[i] = cellRange(boxes_[i]);
+        const CellRange &r = ranges_[i];
+        total += size_t(r.hi[0] - r.lo[0] + 1) * (r.hi[1] - r.lo[1] + 1) *
+                 (r.hi[2] - r.lo[2] + 1);
+    }
+
+    // Keep the load factor at or below one half.
+    const size_t capacity = std::bit_ceil(std::max<size_t>(2 * total, 16));
+    shift_ = 64 - std::countr_zero(capacity);
+    table_.assign(capacity, Slot{EMPTY, 0, 0});
+    cellCount_ = 0;
+
+    auto forEachCell = [&](uint32_t i, auto &&f) {
+        const CellRange &r = ranges_[i];
+        for (int x = r.lo[0]; x <= r.hi[0]; ++x)
+            for (int y = r.lo[1]; y <= r.hi[1]; ++y)
+                for (int z = r.lo[2]; z <= r.hi[2]; ++z)
+                    f(findOrInsert(packKey(x, y, z)));
+    };
+
+    // Count objects per cell, turn counts into offsets, then scatter the
+    // ids so that every cell's objects are contiguous.
+    for (uint32_t i = 0; i < n; ++i)
+        forEachCell(i, [](Slot &s) { ++s.count; });
+    uint32_t offset = 0;
+    for (auto &s : table_)
+    {
+        if (s.key == EMPTY)
+            continue;
+        s.start = offset;
+        offset += s.count;
+        s.count = 0;
+    }
+    entries_.resize(total);
+    for (uint32_t i = 0; i < n; ++i)
+        forEachCell(i, [&](Slot &s) { entries_[s.start + s.count++] = i; });
+}
+
+std::vector<SpatialHash::Pair> SpatialHash::findPairs() const
+{
+    std::vector<std::vector<Pair>> partial(parallelism());
+    std::atomic<size_t> next{0};
+    parallelFor(table_.size(), 1024, [&](size_t begin, size_t end) {
+        auto &out = partial[next++];
+        for (size_t t = begin; t < end; ++t)
+        {
+            const Slot &s = table_[t];
+            if (s.key == EMPTY || s.count < 2)
+                continue;
+            const uint32_t *ids = entries_.data() + s.start;
+            // Decode the cell from its key.
+            const int cell[3] = {
+                int(s.key & 0x1fffff) - CELL_LIMIT - 1,
+                int(s.key >> 21 & 0x1fffff) - CELL_LIMIT - 1,
+                int(s.key >> 42 & 0x1fffff) - CELL_LIMIT - 1};
+            for (uint32_t i = 0; i < s.count; ++i)
+            {
+                const CellRange &ri = ranges_[ids[i]];
+                for (uint32_t j = i + 1; j < s.count; ++j)
+                {
+                    const CellRange &rj = ranges_[ids[j]];
+                    bool owner = true;
+                    for (int a = 0; a < 3; ++a)
+                        owner = owner &&
+                                cell[a] == std::max(ri.lo[a], rj.lo[a]);
+                    if (!owner || !overlap(ids[i], ids[j]))
+                        continue;
+                    out.emplace_back(std::min(ids[i], ids[j]),
+                                     std::max(ids[i], ids[j]));
+                }
+            }
+        }
+    });
+
+    size_t total = 0;
+    for (const auto &p : partial)
+        total += p.size();
+    std::vector<Pair> pairs;
+    pairs.reserve(total);
+    for (const auto &p : partial)
+        pairs.insert(pairs.end(), p.begin(), p.end());
+    return pairs;
+}
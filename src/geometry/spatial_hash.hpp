@@ -0,0 +1,112 @@
+#ifndef SPATIAL_HASH_HPP_INCLUDED
+#define SPATIAL_HASH_HPP_INCLUDED
+
+#include "geom_structs.hpp"
+#include "geometry.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Hashed uniform grid. Every object is inserted into each cell its box
+// overlaps, and the cells are kept in an open-addressing table whose slots
+// point into one flat array of object ids. Works best when objects are of
+// similar size and the cell size is close to their diameter.
+//
+// Cell coordinates are clamped to +-2^20, so the grid covers
+// 2^21 * cellSize along every axis.
+class SpatialHash
+{
+public:
+    using Pair = std::pair<uint32_t, uint32_t>;
+
+    explicit SpatialHash(float cellSize);
+
+    void build(std::span<const AABB3d> boxes);
+    // Spheres are binned by their bounding boxes and tested exactly.
+    void build(std::span<const Sphere> spheres);
+
+    float cellSize() const
+    {
+        return cellSize_;
+    }
+
+    size_t cellCount() const
+    {
+        return cellCount_;
+    }
+
+    // Calls f(index) once for every object whose box overlaps 'box'.
+    template<typename F>
+    void query(const AABB3d &box, F &&f) const;
+
+    // All overlapping pairs (i, j) with i < j, each reported once. Cells
+    // are scanned in parallel and a pair is only emitted by the cell that
+    // holds the lower corner of the two boxes' overlap, so no locking or
+    // post-pass is needed to remove duplicates.
+    std::vector<Pair> findPairs() const;
+private:
+    struct Slot
+    {
+        uint64_t key;
+        uint32_t start;
+        uint32_t count;
+    };
+
+    struct CellRange
+    {
+        int lo[3];
+        int hi[3];
+    };
+
+    static constexpr uint64_t EMPTY = ~uint64_t(0);
+
+    CellRange cellRange(const AABB3d &box) const;
+    static uint64_t packKey(int x, int y, int z);
+    const Slot *find(uint64_t key) const;
+    Slot &findOrInsert(uint64_t key);
+    bool overlap(uint32_t a, uint32_t b) const;
+    void insertAll();
+
+    float cellSize_;
+    float invCellSize_;
+    size_t cellCount_ = 0;
+    uint32_t shift_ = 64;
+    std::vector<Slot> table_;
+    std::vector<uint32_t> entries_;
+    std::vector<AABB3d> boxes_;
+    std::vector<Sphere> spheres_;
+    std::vector<CellRange> ranges_;
+};
+
+template<typename F>
+void SpatialHash::query(const AABB3d &box, F &&f) const
+{
+    if (table_.empty())
+        return;
+    const CellRange q = cellRange(box);
+    for (int x = q.lo[0]; x <= q.hi[0]; ++x)
+        for (int y = q.lo[1]; y <= q.hi[1]; ++y)
+            for (int z = q.lo[2]; z <= q.hi[2]; ++z)
+            {
+                const Slot *s = find(packKey(x, y, z));
+                if (s == nullptr)
+                    continue;
+                const int cell[3] = {x, y, z};
+                for (uint32_t e = s->start; e < s->start + s->count; ++e)
+                {
+                    const uint32_t i = entries_[e];
+                    // Report each object from the first cell it shares with
+                    // the query only.
+                    const CellRange &r = ranges_[i];
+                    bool first = true;
+                    for (int a = 0; a < 3; ++a)
+                        first = first && cell[a] == std::max(q.lo[a], r.lo[a]);
+                    if (first && intersection(boxes_[i], box))
+                        f(i);
+                }
+            }
+}
+
+#endif
@@ -0,0 +1,168 @@
+#include "math_utils.hpp"
+#include "simd.hpp"
+
+// Leaves of the recursive transposes in math_utils.hpp for float: whole 8x8
+// tiles through AVX2 or 4x4 tiles through SSE, the edges element by element.
+namespace
+{
+void transposeScalar(const float *src,
+                     size_t ss,
+                     float *dst,
+                     size_t ds,
+                     size_t rows,
+                     size_t cols)
+{
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            dst[j * ds + i] = src[i * ss + j];
+}
+
+void swapScalar(float *a, float *b, size_t ld, size_t rows, size_t cols)
+{
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            std::swap(a[i * ld + j], b[j * ld + i]);
+}
+
+#ifdef GEOMETRY_X86
+
+GEOMETRY_AVX2 inline void load8x8(const float *src, size_t ss, __m256 (&r)[8])
+{
+    for (int i = 0; i < 8; ++i)
+        r[i] = _mm256_loadu_ps(src + i * ss);
+}
+
+GEOMETRY_AVX2 inline void store8x8(float *dst, size_t ds, const __m256 (&r)[8])
+{
+    for (int i = 0; i < 8; ++i)
+        _mm256_storeu_ps(dst + i * ds, r[i]);
+}
+
+GEOMETRY_AVX2 void transposeAvx2(const float *src,
+                                 size_t ss,
+                                 float *dst,
+                                 size_t ds,
+                                 size_t rows,
+                                 size_t cols)
+{
+    const size_t r8 = rows & ~size_t(7), c8 = cols & ~size_t(7);
+    for (size_t i = 0; i < r8; i += 8)
+        for (size_t j = 0; j < c8; j += 8)
+        {
+            __m256 r[8];
+            load8x8(src + i * ss + j, ss, r);
+            transpose8x8(r);
+            store8x8(dst + j * ds + i, ds, r);
+        }
+    transposeScalar(src + c8, ss, dst + c8 * ds, ds, rows, cols - c8);
+    transposeScalar(src + r8 * ss, ss, dst + r8, ds, rows - r8, c8);
+}
+
+GEOMETRY_AVX2 void
+swapAvx2(float *a, float *b, size_t ld, size_t rows, size_t cols)
+{
+    const size_t r8 = rows & ~size_t(7), c8 = cols & ~size_t(7);
+    for (size_t i = 0; i < r8; i += 8)
+        for (size_t j = 0; j < c8; j += 8)
+        {
+            __m256 ra[8], rb[8];
+            load8x8(a + i * ld + j, ld, ra);
+            load8x8(b + j * ld + i, ld, rb);
+            transpose8x8(ra);
+            transpose8x8(rb);
+            store8x8(a + i * ld + j, ld, rb);
+            store8x8(b + j * ld + i, ld, ra);
+        }
+    swapScalar(a + c8, b + c8 * ld, ld, rows, cols - c8);
+    swapScalar(a + r8 * ld, b + r8, ld, rows - r8, c8);
+}
+
+GEOMETRY_AVX2 void diagAvx2(float *m, size_t ld, size_t n)
+{
+    const size_t n8 = n & ~size_t(7);
+    for (size_t i = 0; i < n8; i += 8)
+    {
+        __m256 r[8];
+        load8x8(m + i * ld + i, ld, r);
+        transpose8x8(r);
+        store8x8(m + i * ld + i, ld, r);
+        for (size_t j = i + 8; j < n8; j += 8)
+            swapAvx2(m + i * ld + j, m + j * ld + i, ld, 8, 8);
+    }
+    // The rows and columns past the last whole tile
+    swapScalar(m + n8, m + n8 * ld, ld, n8, n - n8);
+    for (size_t i = n8; i < n; ++i)
+        for (size_t j = i + 1; j < n; ++j)
+            std::swap(m[i * ld + j], m[j * ld + i]);
+}
+
+#endif
+
+#ifdef GEOMETRY_SSE
+
+void transposeSse(const float *src,
+                  size_t ss,
+                  float *dst,
+                  size_t ds,
+                  size_t rows,
+                  size_t cols)
+{
+    const size_t r4 = rows & ~size_t(3), c4 = cols & ~size_t(3);
+    for (size_t i = 0; i < r4; i += 4)
+        for (size_t j = 0; j < c4; j += 4)
+        {
+            const float *s = src + i * ss + j;
+            __m128 r0 = _mm_loadu_ps(s), r1 = _mm_loadu_ps(s + ss),
+                   r2 = _mm_loadu_ps(s + 2 * ss),
+                   r3 = _mm_loadu_ps(s + 3 * ss);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            float *d = dst + j * ds + i;
+            _mm_storeu_ps(d, r0);
+            _mm_storeu_ps(d + ds, r1);
+            _mm_storeu_ps(d + 2 * ds, r2);
+            _mm_storeu_ps(d + 3 * ds, r3);
+        }
+    transposeScalar(src + c4, ss, dst + c4 * ds, ds, rows, cols - c4);
+    transposeScalar(src + r4 * ss, ss, dst + r4, ds, rows - r4, c4);
+}
+
+#endif
+} // namespace
+
+void transpose(const float *src, float *dst, int rows, int cols)
+{
+    auto leaf = transposeScalar;
+#ifdef GEOMETRY_SSE
+    leaf = transposeSse;
+#endif
+#ifdef GEOMETRY_X86
+    if (cpuHasAvx2())
+        leaf = transposeAvx2;
+#endif
+    transposeRecursive(src,
+                       size_t(cols),
+                       dst,
+                       size_t(rows),
+                       size_t(rows),
+                       size_t(cols),
+                       leaf);
+}
+
+void transposeInPlace(float *m, int n)
+{
+#ifdef GEOMETRY_X86
+    if (cpuHasAvx2())
+        return transposeInPlaceRecursive(
+            m, size_t(n), size_t(n), diagAvx2, swapAvx2);
+#endif
+    transposeInPlaceRecursive(
+        m,
+        size_t(n),
+        size_t(n),
+        [](float *a, size_t ld, size_t n) {
+            for (size_t i = 0; i < n; ++i)
+                for (size_t j = i + 1; j < n; ++j)
+                    std::swap(a[i * ld + j], a[j * ld + i]);
+        },
+        swapScalar);
+}
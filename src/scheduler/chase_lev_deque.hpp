@@ -0,0 +1,133 @@
+#ifndef CHASE_LEV_DEQUE_HPP_INCLUDED
+#define CHASE_LEV_DEQUE_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Work-stealing deque after Chase and Lev, "Dynamic Circular Work-Stealing
+// Deque" (SPAA 2005), with the memory orderings of Le et al., "Correct and
+// Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013). The owning
+// thread pushes and pops at the bottom without locks or, unless the deque
+// is down to one item, read-modify-writes; any other thread may steal from
+// the top. The buffer doubles when full. Replaced buffers are kept until
+// the deque is destroyed, as a thief may still be reading one.
+template<typename T>
+class ChaseLevDeque
+{
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Items are stored in atomics");
+
+public:
+    explicit ChaseLevDeque(size_t capacity = 256)
+    {
+        size_t c = 1;
+        while (c < capacity)
+            c *= 2;
+        buffers_.push_back(std::make_unique<Buffer>(c));
+        buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+    }
+
+    ChaseLevDeque(const ChaseLevDeque &) = delete;
+    ChaseLevDeque &operator=(const ChaseLevDeque &) = delete;
+
+    // Owner only.
+    void push(T item)
+    {
+        const int64_t b = bottom_.load(std::memory_order_relaxed);
+        const int64_t t = top_.load(std::memory_order_acquire);
+        Buffer *a = buffer_.load(std::memory_order_relaxed);
+        if (b - t > int64_t(a->mask))
+            a = grow(a, t, b);
+        a->at(b).store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only: the item pushed last, or false if the deque is empty.
+    bool pop(T &item)
+    {
+        const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Buffer *a = buffer_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        item = a->at(b).load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // The last item: race thieves for it.
+            const bool won = top_.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread: the oldest item, or false if the deque is empty or another
+    // thread took the item first.
+    bool steal(T &item)
+    {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+        Buffer *a = buffer_.load(std::memory_order_acquire);
+        item = a->at(t).load(std::memory_order_relaxed);
+        return top_.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // A snapshot, exact only when read by the owner with no thieves about.
+    size_t size() const
+    {
+        const int64_t b = bottom_.load(std::memory_order_relaxed);
+        const int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? size_t(b - t) : 0;
+    }
+
+private:
+    struct Buffer
+    {
+        explicit Buffer(size_t capacity)
+            : mask(capacity - 1), items(new std::atomic<T>[capacity])
+        {
+        }
+
+        std::atomic<T> &at(int64_t i)
+        {
+            return items[size_t(i) & mask];
+        }
+
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> items;
+    };
+
+    Buffer *grow(Buffer *a, int64_t t, int64_t b)
+    {
+        buffers_.push_back(std::make_unique<Buffer>(2 * (a->mask + 1)));
+        Buffer *bigger = buffers_.back().get();
+        for (int64_t i = t; i < b; ++i)
+            bigger->at(i).store(a->at(i).load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+        buffer_.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Buffer *> buffer_{nullptr};
+    // Every buffer ever used, the current one last. Owner only.
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+};
+
+#endif
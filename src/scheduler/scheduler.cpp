@@ -0,0 +1,187 @@
+#include "scheduler.hpp"
+
+namespace
+{
+// Rounds an idle thread spins, then yields, before it sleeps.
+constexpr unsigned SPIN_ROUNDS = 32;
+constexpr unsigned YIELD_ROUNDS = 32;
+
+void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Spin, yield, then report that it is time to sleep.
+bool backOff(unsigned &idle)
+{
+    ++idle;
+    if (idle <= SPIN_ROUNDS)
+        cpuRelax();
+    else if (idle <= SPIN_ROUNDS + YIELD_ROUNDS)
+        std::this_thread::yield();
+    else
+        return true;
+    return false;
+}
+} // namespace
+
+Scheduler::Lease::Lease(Scheduler &s)
+{
+    if (currentOwner_ == &s)
+    {
+        slot_ = current_;
+        return;
+    }
+    for (unsigned k = 0; k < EXTERNAL_SLOTS; ++k)
+    {
+        Slot &c = *s.slots_[k];
+        if (!c.taken.load(std::memory_order_relaxed) &&
+            !c.taken.exchange(true, std::memory_order_acquire))
+        {
+            slot_ = &c;
+            external_ = true;
+            previous_ = current_;
+            previousOwner_ = currentOwner_;
+            current_ = slot_;
+            currentOwner_ = &s;
+            return;
+        }
+    }
+}
+
+Scheduler::Lease::~Lease()
+{
+    if (!external_)
+        return;
+    current_ = previous_;
+    currentOwner_ = previousOwner_;
+    slot_->taken.store(false, std::memory_order_release);
+}
+
+Scheduler::Scheduler(unsigned threads) : threads_(std::max(1u, threads))
+{
+    const unsigned slots = EXTERNAL_SLOTS + threads_ - 1;
+    for (unsigned k = 0; k < slots; ++k)
+    {
+        slots_.push_back(std::make_unique<Slot>());
+        slots_.back()->seed = 2654435761u * (k + 1);
+    }
+    for (unsigned k = EXTERNAL_SLOTS; k < slots; ++k)
+        workers_.emplace_back([this, k]() { work(*slots_[k]); });
+}
+
+Scheduler::~Scheduler()
+{
+    stop_.store(true);
+    epoch_.fetch_add(1);
+    epoch_.notify_all();
+    for (auto &w : workers_)
+        w.join();
+}
+
+Scheduler &Scheduler::global()
+{
+    static Scheduler scheduler;
+    return scheduler;
+}
+
+void Scheduler::spawn(Slot &slot, Task &t)
+{
+    slot.deque.push(&t);
+    // Pairs with the fence in work(): either a worker about to sleep sees
+    // the task, or this sees the worker and wakes it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) != 0)
+    {
+        epoch_.fetch_add(1, std::memory_order_release);
+        epoch_.notify_one();
+    }
+}
+
+void Scheduler::join(Slot &slot, Task &t)
+{
+    Task *top = nullptr;
+    if (slot.deque.pop(top))
+    {
+        // Tasks forked after t were joined before it.
+        assert(top == &t);
+        t.run(&t);
+        return;
+    }
+
+    // Stolen: run other tasks until the thief is done with it.
+    unsigned idle = 0;
+    while (!t.done.load(std::memory_order_acquire))
+    {
+        Task *other;
+        if (steal(slot, other))
+        {
+            other->run(other);
+            other->done.store(true, std::memory_order_release);
+            idle = 0;
+        }
+        else if (backOff(idle))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool Scheduler::steal(Slot &thief, Task *&t)
+{
+    const size_t n = slots_.size();
+    thief.seed = thief.seed * 1664525u + 1013904223u;
+    const size_t start = (thief.seed >> 8) % n;
+    for (size_t k = 0; k < n; ++k)
+        if (slots_[(start + k) % n]->deque.steal(t))
+            return true;
+    return false;
+}
+
+bool Scheduler::anyWork() const
+{
+    for (const auto &s : slots_)
+        if (s->deque.size() != 0)
+            return true;
+    return false;
+}
+
+void Scheduler::work(Slot &slot)
+{
+    current_ = &slot;
+    currentOwner_ = this;
+    unsigned idle = 0;
+    while (!stop_.load(std::memory_order_acquire))
+    {
+        Task *t;
+        if (steal(slot, t))
+        {
+            t->run(t);
+            t->done.store(true, std::memory_order_release);
+            idle = 0;
+            continue;
+        }
+        if (!backOff(idle))
+            continue;
+
+        const uint32_t epoch = epoch_.load(std::memory_order_acquire);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!anyWork() && !stop_.load(std::memory_order_acquire))
+            epoch_.wait(epoch, std::memory_order_acquire);
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+ScratchArena &scratchArena()
+{
+    thread_local std::unique_ptr<ScratchArena> arena;
+    if (!arena)
+        arena = std::make_unique<ScratchArena>();
+    return *arena;
+}
@@ -0,0 +1,332 @@
+#ifndef SCHEDULER_HPP_INCLUDED
+#define SCHEDULER_HPP_INCLUDED
+
+#include "arena.hpp"
+#include "chase_lev_deque.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fork-join work on a pool of threads that steal from each other. Every
+// thread taking part owns a ChaseLevDeque of tasks: forking pushes a task
+// at the bottom of its own deque, joining pops it back unless an idle
+// thread stole it from the top in the meantime, in which case the joining
+// thread runs other stolen tasks until it is done. Tasks live on the stack
+// of the frame that forks them, so forking allocates nothing.
+//
+// A thread outside the pool joins in through one of a few external slots;
+// if they are all taken, its calls run serially. Bodies must not throw.
+
+// A unit of work: run(this) executes it. Whoever runs a stolen task sets
+// 'done' afterwards.
+struct Task
+{
+    void (*run)(Task *) = nullptr;
+    std::atomic<bool> done{false};
+};
+
+class Scheduler
+{
+public:
+    // 'threads' counts the calling thread, so threads - 1 workers start.
+    explicit Scheduler(unsigned threads = std::thread::hardware_concurrency());
+    ~Scheduler();
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    // The pool the toolbox's parallel algorithms share, with one thread
+    // per hardware thread.
+    static Scheduler &global();
+
+    unsigned threads() const
+    {
+        return threads_;
+    }
+
+    // Calls f(b, e) over disjoint subranges covering [begin, end). Ranges
+    // larger than 'grain' are halved while other threads may be idle, that
+    // is while this thread's deque holds few unstolen halves, and are
+    // otherwise worked through 'grain' indices at a time, so that the split
+    // adapts to the load. A grain of 0 picks one from the size of the range
+    // and the number of threads.
+    template<typename F>
+    void parallelFor(size_t begin, size_t end, F &&f, size_t grain = 0);
+
+    // combine() of 'identity' and map(b, e) over blocks of 'grain' indices
+    // covering [begin, end). The blocks are combined in index order, so for
+    // a fixed grain the result does not depend on which thread mapped which
+    // block, even for a combine() that is only approximately associative,
+    // like floating point addition.
+    template<typename T, typename Map, typename Combine>
+    T parallelReduce(size_t begin,
+                     size_t end,
+                     T identity,
+                     Map &&map,
+                     Combine &&combine,
+                     size_t grain = 0);
+
+    // Runs a() and b(), b() possibly on another thread.
+    template<typename A, typename B>
+    void invoke(A &&a, B &&b);
+
+private:
+    struct Slot
+    {
+        ChaseLevDeque<Task *> deque;
+        // Held by an external thread.
+        std::atomic<bool> taken{false};
+        uint32_t seed = 0;
+    };
+
+    // The calling thread's slot for as long as it lives, or none.
+    class Lease
+    {
+    public:
+        explicit Lease(Scheduler &s);
+        ~Lease();
+
+        Slot *get() const
+        {
+            return slot_;
+        }
+
+    private:
+        Slot *slot_ = nullptr;
+        Slot *previous_ = nullptr;
+        Scheduler *previousOwner_ = nullptr;
+        bool external_ = false;
+    };
+
+    // Deque entries per slot above which ranges stop splitting.
+    static constexpr size_t SPLIT_DEPTH = 2;
+    // Pieces per thread that an automatic grain aims for.
+    static constexpr size_t CHUNKS_PER_THREAD = 8;
+    static constexpr unsigned EXTERNAL_SLOTS = 4;
+
+    template<typename F>
+    struct RangeTask : Task
+    {
+        RangeTask(Scheduler &s, size_t begin, size_t end, size_t grain, F &f)
+            : s(s), begin(begin), end(end), grain(grain), f(f)
+        {
+            run = [](Task *t) {
+                auto *r = static_cast<RangeTask *>(t);
+                r->s.runRange(*current_, r->begin, r->end, r->grain, r->f);
+            };
+        }
+
+        Scheduler &s;
+        size_t begin, end, grain;
+        F &f;
+    };
+
+    template<typename F>
+    struct CallTask : Task
+    {
+        explicit CallTask(F &f) : f(f)
+        {
+            run = [](Task *t) { static_cast<CallTask *>(t)->f(); };
+        }
+
+        F &f;
+    };
+
+    size_t autoGrain(size_t n, size_t grain) const
+    {
+        if (grain != 0)
+            return grain;
+        return std::max<size_t>(1, n / (CHUNKS_PER_THREAD * threads_));
+    }
+
+    template<typename F>
+    void runRange(Slot &slot, size_t begin, size_t end, size_t grain, F &f);
+
+    void spawn(Slot &slot, Task &t);
+    void join(Slot &slot, Task &t);
+    bool steal(Slot &thief, Task *&t);
+    bool anyWork() const;
+    void work(Slot &slot);
+
+    unsigned threads_;
+    // External slots first, then one per worker.
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::vector<std::thread> workers_;
+    std::atomic<bool> stop_{false};
+    // Bumped to wake sleeping workers when there is work.
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<unsigned> sleepers_{0};
+
+    static inline thread_local Slot *current_ = nullptr;
+    static inline thread_local Scheduler *currentOwner_ = nullptr;
+};
+
+template<typename F>
+void Scheduler::runRange(Slot &slot,
+                         size_t begin,
+                         size_t end,
+                         size_t grain,
+                         F &f)
+{
+    while (end - begin > grain)
+    {
+        if (slot.deque.size() < SPLIT_DEPTH)
+        {
+            const size_t mid = begin + (end - begin) / 2;
+            RangeTask<F> right(*this, mid, end, grain, f);
+            spawn(slot, right);
+            runRange(slot, begin, mid, grain, f);
+            join(slot, right);
+            return;
+        }
+        f(begin, begin + grain);
+        begin += grain;
+    }
+    f(begin, end);
+}
+
+template<typename F>
+void Scheduler::parallelFor(size_t begin, size_t end, F &&f, size_t grain)
+{
+    if (begin >= end)
+        return;
+    grain = autoGrain(end - begin, grain);
+    if (threads_ == 1 || end - begin <= grain)
+    {
+        f(begin, end);
+        return;
+    }
+    Lease lease(*this);
+    if (lease.get() == nullptr)
+        f(begin, end);
+    else
+        runRange(*lease.get(), begin, end, grain, f);
+}
+
+template<typename T, typename Map, typename Combine>
+T Scheduler::parallelReduce(size_t begin,
+                            size_t end,
+                            T identity,
+                            Map &&map,
+                            Combine &&combine,
+                            size_t grain)
+{
+    if (begin >= end)
+        return identity;
+    grain = autoGrain(end - begin, grain);
+    const size_t blocks = (end - begin + grain - 1) / grain;
+    if (blocks == 1)
+        return combine(std::move(identity), map(begin, end));
+
+    std::vector<T> partial(blocks, identity);
+    parallelFor(
+        0,
+        blocks,
+        [&](size_t first, size_t last) {
+            for (size_t k = first; k < last; ++k)
+                partial[k] = map(begin + k * grain,
+                                 std::min(end, begin + (k + 1) * grain));
+        },
+        1);
+    T result = std::move(identity);
+    for (T &p : partial)
+        result = combine(std::move(result), std::move(p));
+    return result;
+}
+
+template<typename A, typename B>
+void Scheduler::invoke(A &&a, B &&b)
+{
+    if (threads_ == 1)
+    {
+        a();
+        b();
+        return;
+    }
+    Lease lease(*this);
+    if (lease.get() == nullptr)
+    {
+        a();
+        b();
+        return;
+    }
+    CallTask<std::remove_reference_t<B>> task(b);
+    spawn(*lease.get(), task);
+    a();
+    join(*lease.get(), task);
+}
+
+// Scratch memory for task bodies: every thread has its own arena, made on
+// first use. Allocations must be freed in the reverse order, which
+// ScratchBuffer's scoping gives; tasks a thread runs while it waits to
+// join start and finish inside the wait, so they keep to that order too.
+// Requests beyond the arena's size go to the heap.
+inline constexpr size_t SCRATCH_BYTES = size_t(1) << 18;
+using ScratchArena = Arena<SCRATCH_BYTES>;
+
+ScratchArena &scratchArena();
+
+// n uninitialized T from the calling thread's scratch arena.
+template<typename T>
+class ScratchBuffer
+{
+    static_assert(std::is_trivially_destructible_v<T> &&
+                      alignof(T) <= alignof(std::max_align_t),
+                  "Scratch memory holds plain data");
+
+public:
+    explicit ScratchBuffer(size_t n)
+        : arena_(scratchArena()),
+          data_(reinterpret_cast<T *>(arena_.allocate(n * sizeof(T)))),
+          size_(n)
+    {
+    }
+
+    ~ScratchBuffer()
+    {
+        arena_.deallocate(reinterpret_cast<std::byte *>(data_),
+                          size_ * sizeof(T));
+    }
+
+    ScratchBuffer(const ScratchBuffer &) = delete;
+    ScratchBuffer &operator=(const ScratchBuffer &) = delete;
+
+    T *data()
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    T &operator[](size_t i)
+    {
+        return data_[i];
+    }
+
+    T *begin()
+    {
+        return data_;
+    }
+
+    T *end()
+    {
+        return data_ + size_;
+    }
+
+private:
+    ScratchArena &arena_;
+    T *data_;
+    size_t size_;
+};
+
+#endif
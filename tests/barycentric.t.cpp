@@ -0,0 +1,79 @@
+#include "barycentric.hpp"
+#include "doctest.h"
+#include "geometry.hpp"
+#include <random>
+#include <vector>
+
+TEST_CASE("Barycentric coordinates")
+{
+    std::mt19937 gen(40);
+    std::uniform_real_distribution<float> pos(-10.0f, 10.0f), w(-0.5f, 1.5f);
+
+    SUBCASE("Points from known weights")
+    {
+        for (int trial = 0; trial < 50; ++trial)
+        {
+            const Point3d a = {pos(gen), pos(gen), pos(gen)},
+                          b = {pos(gen), pos(gen), pos(gen)},
+                          c = {pos(gen), pos(gen), pos(gen)};
+            const BarycentricTriangle tri(a, b, c);
+
+            // Points in the plane from known weights, inside and outside
+            std::vector<Point3d> pts(37), expected(37), uvw(37);
+            for (size_t i = 0; i < pts.size(); ++i)
+            {
+                const float wv = w(gen), ww = w(gen), wu = 1.0f - wv - ww;
+                expected[i] = {wu, wv, ww};
+                pts[i] = {wu * a.x + wv * b.x + ww * c.x,
+                          wu * a.y + wv * b.y + ww * c.y,
+                          wu * a.z + wv * b.z + ww * c.z};
+            }
+            tri.coordinates(pts, uvw);
+            for (size_t i = 0; i < pts.size(); ++i)
+            {
+                float u1, v1, w1, u2, v2, w2, u3, v3, w3;
+                barycentric1(a, b, c, pts[i], u1, v1, w1);
+                barycentric2(a, b, c, pts[i], u2, v2, w2);
+                tri.coordinates(pts[i], u3, v3, w3);
+                const float e[3] = {
+                    expected[i].x, expected[i].y, expected[i].z};
+                const float got[4][3] = {{u1, v1, w1},
+                                         {u2, v2, w2},
+                                         {u3, v3, w3},
+                                         {uvw[i].x, uvw[i].y, uvw[i].z}};
+                for (const auto &g : got)
+                    for (int k = 0; k < 3; ++k)
+                        CHECK(g[k] == doctest::Approx(e[k]).epsilon(1e-3));
+                CHECK(uvw[i].x == doctest::Approx(u3).epsilon(1e-5));
+            }
+        }
+    }
+
+    SUBCASE("Points off the plane project onto it")
+    {
+        const BarycentricTriangle tri(Triangle3d{{0, 0, 0}, {2, 0, 0}, {0, 2, 0}});
+        float u, v, w;
+        tri.coordinates({0.5f, 1.0f, 7.0f}, u, v, w);
+        CHECK(u == doctest::Approx(0.25f));
+        CHECK(v == doctest::Approx(0.25f));
+        CHECK(w == doctest::Approx(0.5f));
+    }
+
+    SUBCASE("Parallel batches")
+    {
+        const BarycentricTriangle tri({1, 0, 0}, {0, 1, 0}, {0, 0, 1});
+        std::vector<Point3d> pts(100003), serial(pts.size()), par(pts.size());
+        for (auto &p : pts)
+            p = {pos(gen), pos(gen), pos(gen)};
+        tri.coordinates(pts, serial);
+        tri.coordinates(pts, par, true);
+        // Chunk boundaries move points between the FMA body and the scalar
+        // tail, which round differently.
+        size_t differ = 0;
+        for (size_t i = 0; i < pts.size(); ++i)
+            differ += serial[i].x != doctest::Approx(par[i].x).epsilon(1e-5) ||
+                      serial[i].y != doctest::Approx(par[i].y).epsilon(1e-5) ||
+                      serial[i].z != doctest::Approx(par[i].z).epsilon(1e-5);
+        CHECK(differ == 0);
+    }
+}
@@ -0,0 +1,129 @@
+#include "bounding_sphere.hpp"
+#include "doctest.h"
+#include "geometry.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+static bool encloses(const Sphere &s, const std::vector<Point3d> &pts)
+{
+    for (const auto &p : pts)
+    {
+        Point3d d = p - s.c;
+        if (std::sqrt(dotProd(d, d)) > s.r * (1.0f + 1e-5f))
+            return false;
+    }
+    return true;
+}
+
+static std::vector<Point3d> randomCloud(size_t n, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    std::vector<Point3d> pts(n);
+    for (auto &p : pts)
+        p = {5.0f + g(gen), -2.0f + 3.0f * g(gen), 0.5f * g(gen)};
+    return pts;
+}
+
+TEST_CASE("sphereOfSphereAndPt grows towards the point")
+{
+    Sphere s = {{0, 0, 0}, 1.0f};
+    sphereOfSphereAndPt(s, {0.5f, 0, 0});
+    CHECK(s.r == 1.0f);
+    sphereOfSphereAndPt(s, {3, 0, 0});
+    CHECK(s.r == doctest::Approx(2.0f));
+    CHECK(s.c.x == doctest::Approx(1.0f));
+    CHECK(s.c.y == 0.0f);
+}
+
+TEST_CASE("Bounding spheres of degenerate inputs")
+{
+    for (auto build : {ritterSphere, welzlSphere, sphereFromDistantPoints})
+    {
+        Sphere e = build({});
+        CHECK(e.r == 0.0f);
+
+        std::vector<Point3d> one = {{1, 2, 3}};
+        Sphere s = build(one);
+        CHECK(s.c.x == 1.0f);
+        CHECK(s.c.z == 3.0f);
+        CHECK(s.r == doctest::Approx(0.0f));
+
+        // Collinear and repeated points
+        std::vector<Point3d> line = {{0, 0, 0}, {2, 2, 2}, {1, 1, 1},
+                                     {2, 2, 2}, {0, 0, 0}, {0.5f, 0.5f, 0.5f}};
+        s = build(line);
+        CHECK(s.r == doctest::Approx(std::sqrt(3.0f)).epsilon(1e-4));
+        CHECK(encloses(s, line));
+    }
+}
+
+TEST_CASE("Welzl finds the minimum sphere")
+{
+    SUBCASE("Points on a known sphere")
+    {
+        // Samples of a sphere of radius 4 plus interior points.
+        std::mt19937 gen(9);
+        std::normal_distribution<float> g(0.0f, 1.0f);
+        std::vector<Point3d> pts;
+        for (int i = 0; i < 2000; ++i)
+        {
+            Point3d d = {g(gen), g(gen), g(gen)};
+            normalize(d, d);
+            const float r = i % 2 ? 4.0f : 3.0f;
+            pts.push_back({1 + r * d.x, 2 + r * d.y, -1 + r * d.z});
+        }
+        Sphere s = welzlSphere(pts);
+        CHECK(encloses(s, pts));
+        CHECK(s.r <= 4.0f * 1.0001f);
+        CHECK(s.r >= 3.99f);
+        CHECK(s.c.x == doctest::Approx(1.0f).epsilon(0.01));
+        CHECK(s.c.y == doctest::Approx(2.0f).epsilon(0.01));
+        CHECK(s.c.z == doctest::Approx(-1.0f).epsilon(0.01));
+    }
+
+    SUBCASE("Triangle and tetrahedron supports")
+    {
+        // Equilateral triangle: circumradius 1/sqrt(3) for unit sides.
+        const float h = std::sqrt(3.0f) / 2.0f;
+        std::vector<Point3d> tri = {{0, 0, 0}, {1, 0, 0}, {0.5f, h, 0},
+                                    {0.5f, 0.2f, 0}};
+        CHECK(welzlSphere(tri).r ==
+              doctest::Approx(1.0f / std::sqrt(3.0f)).epsilon(1e-4));
+
+        // Regular tetrahedron inscribed in the unit sphere.
+        std::vector<Point3d> tet = {{1, 1, 1}, {1, -1, -1}, {-1, 1, -1},
+                                    {-1, -1, 1}, {0, 0, 0}, {0.3f, 0, 0}};
+        Sphere s = welzlSphere(tet);
+        CHECK(s.r == doctest::Approx(std::sqrt(3.0f)).epsilon(1e-4));
+        CHECK(std::abs(s.c.x) < 1e-4f);
+        CHECK(encloses(s, tet));
+    }
+}
+
+TEST_CASE("Bounding sphere builders enclose the cloud")
+{
+    // Big enough for the multi threaded filter and for SIMD tails.
+    for (size_t n : {7, 1001, 300003})
+    {
+        auto pts = randomCloud(n, unsigned(n));
+        Sphere exact = welzlSphere(pts);
+        Sphere ritter = ritterSphere(pts);
+        Sphere iterative = ritterIterative(pts);
+        CHECK(encloses(exact, pts));
+        CHECK(encloses(ritter, pts));
+        CHECK(encloses(iterative, pts));
+        CHECK(exact.r <= iterative.r * 1.0001f);
+        CHECK(iterative.r <= ritter.r);
+
+        // Same as the textbook sequential pass over all points.
+        Sphere seq = sphereFromDistantPoints(pts);
+        for (const auto &p : pts)
+            sphereOfSphereAndPt(seq, p);
+        CHECK(ritter.c.x == seq.c.x);
+        CHECK(ritter.c.y == seq.c.y);
+        CHECK(ritter.c.z == seq.c.z);
+        CHECK(ritter.r == seq.r);
+    }
+}
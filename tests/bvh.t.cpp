@@ -0,0 +1,145 @@
+#include "bvh.hpp"
+#include "doctest.h"
+#include "geometry.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+static std::vector<AABB3d> randomBoxes(size_t n, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> ext(0.1f, 3.0f);
+    std::vector<AABB3d> boxes(n);
+    for (auto &b : boxes)
+        b = {{pos(gen), pos(gen), pos(gen)}, {ext(gen), ext(gen), ext(gen)}};
+    return boxes;
+}
+
+static bool rayHitsBox(const Ray &ray, const AABB3d &b, float tmax, float &t)
+{
+    float tmin = 0.0f;
+    const float o[3] = {ray.o.x, ray.o.y, ray.o.z};
+    const float d[3] = {ray.d.x, ray.d.y, ray.d.z};
+    const float c[3] = {b.c.x, b.c.y, b.c.z};
+    for (int i = 0; i < 3; ++i)
+    {
+        if (d[i] == 0.0f)
+        {
+            if (std::abs(o[i] - c[i]) > b.r[i])
+                return false;
+            continue;
+        }
+        float t1 = (c[i] - b.r[i] - o[i]) / d[i];
+        float t2 = (c[i] + b.r[i] - o[i]) / d[i];
+        tmin = std::max(tmin, std::min(t1, t2));
+        tmax = std::min(tmax, std::max(t1, t2));
+    }
+    t = tmin;
+    return tmin <= tmax;
+}
+
+TEST_CASE("BVH on empty input answers no queries")
+{
+    BVH bvh;
+    bvh.build(std::span<const AABB3d>{});
+    CHECK(bvh.empty());
+    int hits = 0;
+    bvh.query(AABB3d{{0, 0, 0}, {1, 1, 1}}, [&](uint32_t) { ++hits; });
+    CHECK(hits == 0);
+}
+
+TEST_CASE("BVH overlap query matches a linear scan")
+{
+    auto boxes = randomBoxes(2000, 1);
+    BVH bvh;
+    bvh.build(boxes);
+    CHECK(bvh.size() == boxes.size());
+
+    auto queries = randomBoxes(100, 2);
+    for (auto &q : queries)
+    {
+        q.r[0] *= 5.0f;
+        std::vector<uint32_t> expected, found;
+        for (uint32_t i = 0; i < boxes.size(); ++i)
+            if (intersection(boxes[i], q))
+                expected.push_back(i);
+        bvh.query(q, [&](uint32_t i) { found.push_back(i); });
+        std::sort(found.begin(), found.end());
+        CHECK(found == expected);
+    }
+}
+
+TEST_CASE("BVH point query finds containing boxes")
+{
+    std::vector<AABB3d> boxes = {{{0, 0, 0}, {1, 1, 1}},
+                                 {{5, 0, 0}, {1, 1, 1}},
+                                 {{0.5f, 0, 0}, {1, 1, 1}}};
+    BVH bvh;
+    bvh.build(boxes);
+    std::vector<uint32_t> found;
+    bvh.query(Point3d{1.2f, 0, 0}, [&](uint32_t i) { found.push_back(i); });
+    REQUIRE(found.size() == 1);
+    CHECK(found[0] == 2);
+}
+
+TEST_CASE("BVH handles coincident centroids")
+{
+    std::vector<AABB3d> boxes(100, AABB3d{{1, 2, 3}, {1, 1, 1}});
+    BVH bvh;
+    bvh.build(boxes);
+    int hits = 0;
+    bvh.query(Point3d{1, 2, 3}, [&](uint32_t) { ++hits; });
+    CHECK(hits == 100);
+}
+
+TEST_CASE("BVH ray queries match a linear scan")
+{
+    auto boxes = randomBoxes(2000, 3);
+    BVH bvh;
+    bvh.build(boxes);
+
+    std::mt19937 gen(4);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    for (int k = 0; k < 100; ++k)
+    {
+        Ray ray{{u(gen) * 150, u(gen) * 150, u(gen) * 150},
+                {u(gen), u(gen), k % 10 == 0 ? 0.0f : u(gen)}};
+        const float tmax = 400.0f;
+
+        std::vector<uint32_t> expected, found;
+        float bestT = tmax;
+        bool anyHit = false;
+        for (uint32_t i = 0; i < boxes.size(); ++i)
+        {
+            float t;
+            if (rayHitsBox(ray, boxes[i], tmax, t))
+            {
+                expected.push_back(i);
+                anyHit = true;
+                bestT = std::min(bestT, t);
+            }
+        }
+        bvh.raycast(ray, tmax, [&](uint32_t i, float) { found.push_back(i); });
+        std::sort(found.begin(), found.end());
+        CHECK(found == expected);
+
+        uint32_t index;
+        float t;
+        CHECK(bvh.closestHit(ray, tmax, index, t) == anyHit);
+        if (anyHit)
+            CHECK(t == doctest::Approx(bestT));
+    }
+}
+
+TEST_CASE("BVH built from spheres uses their bounding boxes")
+{
+    std::vector<Sphere> spheres = {{{0, 0, 0}, 1.0f}, {{10, 0, 0}, 2.0f}};
+    BVH bvh;
+    bvh.build(spheres);
+    std::vector<uint32_t> found;
+    bvh.query(AABB3d{{11.5f, 1.5f, 0}, {0.1f, 0.1f, 0.1f}},
+              [&](uint32_t i) { found.push_back(i); });
+    REQUIRE(found.size() == 1);
+    CHECK(found[0] == 1);
+}
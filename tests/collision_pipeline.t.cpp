@@ -0,0 +1,153 @@
+#include "collision_pipeline.hpp"
+#include "doctest.h"
+#include "geometry.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Rotation from a random unit quaternion.
+static void randomRotation(std::mt19937 &gen, float m[3][3])
+{
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    float q[4] = {g(gen), g(gen), g(gen), g(gen)};
+    const float len = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] +
+                                q[3] * q[3]);
+    const float w = q[0] / len, x = q[1] / len, y = q[2] / len,
+                z = q[3] / len;
+    const float r[3][3] = {
+        {1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y)},
+        {2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x)},
+        {2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y)}};
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            m[i][j] = r[i][j];
+}
+
+// n boxes off center in their own rotated frames, placed in a cube of
+// side 'extent'.
+static void randomScene(std::mt19937 &gen,
+                        size_t n,
+                        float extent,
+                        std::vector<OBB3d> &shapes,
+                        std::vector<Transform3d> &xf)
+{
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    shapes.resize(n);
+    xf.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        float r[3][3];
+        randomRotation(gen, r);
+        OBB3d &s = shapes[i];
+        s.c = {u(gen) - 0.5f, u(gen) - 0.5f, u(gen) - 0.5f};
+        for (int k = 0; k < 3; ++k)
+        {
+            s.u[k] = {r[0][k], r[1][k], r[2][k]};
+            s.e[k] = 0.2f + 0.8f * u(gen);
+        }
+        randomRotation(gen, xf[i].m);
+        for (int a = 0; a < 3; ++a)
+            xf[i].t[a] = extent * u(gen);
+    }
+}
+
+static OBB3d place(const OBB3d &s, const Transform3d &xf)
+{
+    auto rotate = [&](const Point3d &p) {
+        const float *v = &p.x;
+        float r[3];
+        for (int i = 0; i < 3; ++i)
+            r[i] = xf.m[i][0] * v[0] + xf.m[i][1] * v[1] + xf.m[i][2] * v[2];
+        return Point3d(r[0], r[1], r[2]);
+    };
+    OBB3d w = s;
+    w.c = rotate(s.c);
+    w.c = {w.c.x + xf.t[0], w.c.y + xf.t[1], w.c.z + xf.t[2]};
+    for (int k = 0; k < 3; ++k)
+        w.u[k] = rotate(s.u[k]);
+    return w;
+}
+
+static std::vector<ContactPair> bruteForce(const std::vector<OBB3d> &shapes,
+                                           const std::vector<Transform3d> &xf)
+{
+    std::vector<OBB3d> world(shapes.size());
+    for (size_t i = 0; i < shapes.size(); ++i)
+        world[i] = place(shapes[i], xf[i]);
+    std::vector<ContactPair> pairs;
+    for (uint32_t i = 0; i < world.size(); ++i)
+        for (uint32_t j = i + 1; j < world.size(); ++j)
+            if (intersection(world[i], world[j]))
+                pairs.push_back({i, j});
+    return pairs;
+}
+
+static bool samePairs(std::span<const ContactPair> a,
+                      const std::vector<ContactPair> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (a[i].a != b[i].a || a[i].b != b[i].b)
+            return false;
+    return true;
+}
+
+TEST_CASE("Collision pipeline finds every intersecting pair once")
+{
+    std::mt19937 gen(50);
+    CollisionPipeline pipeline;
+    // Sizes around the block and batch sizes, sparse and dense scenes.
+    for (size_t n : {size_t(0), size_t(1), size_t(2), size_t(255),
+                     size_t(257), size_t(1500)})
+        for (float extent : {5.0f, 40.0f})
+        {
+            INFO("n = ", n, ", extent = ", extent);
+            std::vector<OBB3d> shapes;
+            std::vector<Transform3d> xf;
+            randomScene(gen, n, extent, shapes, xf);
+            const auto contacts = pipeline.run(shapes, xf);
+            const auto expected = bruteForce(shapes, xf);
+            CHECK(samePairs(contacts, expected));
+            CHECK(pipeline.candidateCount() >= contacts.size());
+            CHECK(pipeline.worldShapes().size() == n);
+        }
+}
+
+TEST_CASE("Collision pipeline refits boxes between runs")
+{
+    std::mt19937 gen(50);
+    std::vector<OBB3d> shapes;
+    std::vector<Transform3d> xf;
+    randomScene(gen, 600, 20.0f, shapes, xf);
+    CollisionPipeline pipeline;
+
+    for (int step = 0; step < 4; ++step)
+    {
+        INFO("step ", step);
+        CHECK(samePairs(pipeline.run(shapes, xf), bruteForce(shapes, xf)));
+        // The world boxes contain the placed shapes.
+        for (size_t i = 0; i < shapes.size(); ++i)
+        {
+            const OBB3d w = place(shapes[i], xf[i]);
+            const AABB3d &b = pipeline.worldBoxes()[i];
+            for (int a = 0; a < 3; ++a)
+            {
+                float r = 0.0f;
+                for (int k = 0; k < 3; ++k)
+                    r += std::abs((&w.u[k].x)[a]) * w.e[k];
+                CHECK((&w.c.x)[a] - r >= (&b.c.x)[a] - b.r[a] - 1e-4f);
+                CHECK((&w.c.x)[a] + r <= (&b.c.x)[a] + b.r[a] + 1e-4f);
+            }
+        }
+        // Drift everything towards the origin, into more contacts.
+        for (auto &x : xf)
+            for (int a = 0; a < 3; ++a)
+                x.t[a] *= 0.7f;
+    }
+
+    // Stacked boxes all touch each other.
+    std::vector<OBB3d> same(40, shapes[0]);
+    std::vector<Transform3d> still(40, xf[0]);
+    CHECK(pipeline.run(same, still).size() == 40 * 39 / 2);
+}
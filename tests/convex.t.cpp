@@ -1,7 +1,10 @@
 #include "doctest.h"
 #include "geom_structs.hpp"
 #include "geometry.hpp"
+#include <limits>
+#include <random>
 #include <span>
+#include <vector>
 
 TEST_CASE("pointFarthestFromEdge basic test")
 {
@@ -61,4 +64,35 @@ TEST_CASE("pointFarthestFromEdge empty point set")
 
     std::span<Point2d> emptyPoints;
     CHECK(pointFarthestFromEdge(a, b, emptyPoints) == static_cast<size_t>(-1));
-}
\ No newline at end of file
+}
+
+TEST_CASE("pointFarthestFromEdge matches a sequential scan")
+{
+    // Integer coordinates give many ties, which must resolve as in a plain
+    // left to right scan whatever the lane or thread that saw them.
+    std::mt19937 gen(36);
+    std::uniform_int_distribution<int> u(-20, 20);
+    const Point2d a{-3, -7}, b{5, 2};
+    const Point2d ba = b - a, eperp{-ba.y, ba.x};
+    for (size_t n : {1, 7, 8, 9, 31, 64, 1000, 1 << 20})
+    {
+        std::vector<Point2d> pts(n);
+        for (auto &p : pts)
+            p = {float(u(gen)), float(u(gen))};
+        size_t expected = size_t(-1);
+        float maxVal = -std::numeric_limits<float>::max();
+        float rightMostVal = -std::numeric_limits<float>::max();
+        for (size_t i = 0; i < n; ++i)
+        {
+            const float d = dotProd(pts[i] - a, eperp);
+            const float r = dotProd(pts[i] - a, ba);
+            if (d > maxVal || (d == maxVal && r > rightMostVal))
+            {
+                expected = i;
+                maxVal = d;
+                rightMostVal = r;
+            }
+        }
+        CHECK(pointFarthestFromEdge(a, b, pts) == expected);
+    }
+}
@@ -0,0 +1,161 @@
+#include "dense_matrix.hpp"
+#include "doctest.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+template<typename T>
+static DenseMatrix<T> randomMatrix(size_t rows, size_t cols, std::mt19937 &gen)
+{
+    std::uniform_real_distribution<T> u(-1, 1);
+    DenseMatrix<T> m(rows, cols);
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            m[i][j] = u(gen);
+    return m;
+}
+
+// The blocked product against a plain triple loop in double, for shapes on
+// and off the tile and block sizes.
+template<typename T>
+static void checkProducts(T tolerance)
+{
+    std::mt19937 gen(45);
+    const size_t shapes[][3] = {{1, 1, 1},
+                                {6, 16, 8},
+                                {7, 13, 5},
+                                {130, 300, 70},
+                                {250, 520, 33},
+                                {3, 3, 2100},
+                                {61, 1, 17}};
+    for (const auto &s : shapes)
+    {
+        const auto a = randomMatrix<T>(s[0], s[1], gen);
+        const auto b = randomMatrix<T>(s[1], s[2], gen);
+        for (bool parallel : {false, true})
+        {
+            DenseMatrix<T> c(2, 2);
+            mult(a, b, c, parallel);
+            REQUIRE(c.rows() == s[0]);
+            REQUIRE(c.cols() == s[2]);
+            for (size_t i = 0; i < s[0]; ++i)
+                for (size_t j = 0; j < s[2]; ++j)
+                {
+                    double sum = 0.0;
+                    for (size_t k = 0; k < s[1]; ++k)
+                        sum += double(a[i][k]) * double(b[k][j]);
+                    CHECK(std::abs(c[i][j] - sum) <= tolerance * s[1]);
+                }
+        }
+    }
+}
+
+TEST_CASE("Dense matrix product")
+{
+    SUBCASE("float")
+    {
+        checkProducts<float>(1e-6f);
+    }
+
+    SUBCASE("double")
+    {
+        checkProducts<double>(1e-14);
+    }
+
+    SUBCASE("Empty shapes")
+    {
+        DenseMatrix<float> a(0, 4), b(4, 3), c;
+        mult(a, b, c);
+        CHECK(c.rows() == 0);
+        CHECK(c.cols() == 3);
+        DenseMatrix<float> d(2, 0), e(0, 3);
+        mult(d, e, c);
+        CHECK(c.rows() == 2);
+        CHECK(c.cols() == 3);
+        CHECK(c[1][2] == 0.0f);
+    }
+}
+
+// Largest |a x - b| over all columns, in double.
+template<typename T>
+static double residual(const DenseMatrix<T> &a,
+                       const DenseMatrix<T> &x,
+                       const DenseMatrix<T> &b)
+{
+    double worst = 0.0;
+    for (size_t i = 0; i < a.rows(); ++i)
+        for (size_t j = 0; j < b.cols(); ++j)
+        {
+            double sum = -double(b[i][j]);
+            for (size_t k = 0; k < a.cols(); ++k)
+                sum += double(a[i][k]) * double(x[k][j]);
+            worst = std::max(worst, std::abs(sum));
+        }
+    return worst;
+}
+
+// Solves through both factorizations for sizes on and off the panel width.
+template<typename T>
+static void checkFactorizations(T tolerance)
+{
+    std::mt19937 gen(47);
+    for (size_t n : {1, 5, 64, 65, 200})
+    {
+        const auto b = randomMatrix<T>(n, 3, gen);
+        for (bool parallel : {false, true})
+        {
+            const auto a = randomMatrix<T>(n, n, gen);
+            DenseMatrix<T> lu = a, x = b;
+            std::vector<size_t> pivot;
+            REQUIRE(luDecompose(lu, pivot, parallel));
+            luSolve(lu, pivot, x);
+            CHECK(residual(a, x, b) <= tolerance * n);
+
+            // B^T B + n I is symmetric positive definite.
+            const auto g = randomMatrix<T>(n, n, gen);
+            DenseMatrix<T> spd(n, n);
+            for (size_t i = 0; i < n; ++i)
+                for (size_t j = 0; j < n; ++j)
+                {
+                    T sum = i == j ? T(n) : T(0);
+                    for (size_t k = 0; k < n; ++k)
+                        sum += g[k][i] * g[k][j];
+                    spd[i][j] = sum;
+                }
+            DenseMatrix<T> l = spd;
+            x = b;
+            REQUIRE(cholesky(l, parallel));
+            choleskySolve(l, x);
+            CHECK(residual(spd, x, b) <= tolerance * n);
+        }
+    }
+}
+
+TEST_CASE("Dense LU and Cholesky")
+{
+    SUBCASE("float")
+    {
+        checkFactorizations<float>(1e-4f);
+    }
+
+    SUBCASE("double")
+    {
+        checkFactorizations<double>(1e-12);
+    }
+
+    SUBCASE("Singular and indefinite")
+    {
+        std::mt19937 gen(7);
+        auto a = randomMatrix<double>(70, 70, gen);
+        for (size_t j = 0; j < 70; ++j)
+            a[69][j] = 0.0;
+        std::vector<size_t> pivot;
+        CHECK_FALSE(luDecompose(a, pivot));
+
+        DenseMatrix<double> m(3, 3);
+        m[0][0] = 1.0;
+        m[1][1] = -1.0;
+        m[2][2] = 1.0;
+        CHECK_FALSE(cholesky(m));
+    }
+}
@@ -0,0 +1,119 @@
+#include "doctest.h"
+#include "dynamic_tree.hpp"
+#include "geometry.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+static std::vector<int> bruteForce(const DynamicAABBTree &tree,
+                                   const std::vector<int> &proxies,
+                                   const AABB3d &q)
+{
+    std::vector<int> hits;
+    for (int p : proxies)
+        if (p >= 0 && intersection(tree.fatAABB(p), q))
+            hits.push_back(p);
+    std::sort(hits.begin(), hits.end());
+    return hits;
+}
+
+static std::vector<int> treeQuery(const DynamicAABBTree &tree, const AABB3d &q)
+{
+    std::vector<int> hits;
+    tree.query(q, [&](int p) { hits.push_back(p); });
+    std::sort(hits.begin(), hits.end());
+    return hits;
+}
+
+TEST_CASE("Dynamic tree stores fat boxes")
+{
+    DynamicAABBTree tree(0.5f);
+    AABB3d box = {{1, 2, 3}, {1, 1, 1}};
+    int p = tree.createProxy(box, 42);
+    CHECK(tree.userData(p) == 42);
+    CHECK(tree.fatAABB(p).r[0] == doctest::Approx(1.5f));
+    CHECK(tree.proxyCount() == 1);
+    CHECK(tree.validate());
+
+    // Small motion stays within the fat box.
+    AABB3d moved = {{1.2f, 2, 3}, {1, 1, 1}};
+    CHECK_FALSE(tree.moveProxy(p, moved, {0.2f, 0, 0}));
+    // Large motion reinserts and predicts along the displacement.
+    AABB3d far = {{10, 2, 3}, {1, 1, 1}};
+    CHECK(tree.moveProxy(p, far, {2, 0, 0}));
+    CHECK(tree.fatAABB(p).c.x == doctest::Approx(11.0f));
+    CHECK(tree.fatAABB(p).r[0] == doctest::Approx(2.5f));
+    CHECK(tree.validate());
+}
+
+TEST_CASE("Dynamic tree insert, move and remove stay consistent")
+{
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> pos(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> ext(0.2f, 2.0f);
+    auto randomBox = [&]() {
+        return AABB3d{{pos(gen), pos(gen), pos(gen)},
+                      {ext(gen), ext(gen), ext(gen)}};
+    };
+
+    DynamicAABBTree tree;
+    std::vector<int> proxies;
+    for (uint32_t i = 0; i < 500; ++i)
+        proxies.push_back(tree.createProxy(randomBox(), i));
+    CHECK(tree.validate());
+    // Rotations keep the tree close to balanced.
+    CHECK(tree.height() < 30);
+
+    for (int i = 0; i < 500; i += 3)
+    {
+        tree.destroyProxy(proxies[i]);
+        proxies[i] = -1;
+    }
+    for (int i = 1; i < 500; i += 3)
+        tree.moveProxy(proxies[i], randomBox(), {1, -1, 0});
+    CHECK(tree.validate());
+    CHECK(tree.proxyCount() == 500 - 167);
+
+    for (int k = 0; k < 50; ++k)
+    {
+        AABB3d q = randomBox();
+        q.r[0] *= 4.0f;
+        CHECK(treeQuery(tree, q) == bruteForce(tree, proxies, q));
+    }
+}
+
+TEST_CASE("Dynamic tree refit after UpdateAABB")
+{
+    DynamicAABBTree tree(0.1f);
+    AABB3d local = {{0, 0, 0}, {1, 2, 3}};
+    float identity[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    std::vector<int> proxies;
+    for (int i = 0; i < 64; ++i)
+    {
+        float t[3] = {4.0f * i, 0, 0};
+        AABB3d world;
+        UpdateAABB(local, identity, t, world);
+        proxies.push_back(tree.createProxy(world, i));
+    }
+
+    // Rotate every object a quarter turn about z and shift it up.
+    float rot[3][3] = {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}};
+    for (int i = 0; i < 64; ++i)
+    {
+        float t[3] = {4.0f * i, 5.0f, 0};
+        tree.updateProxy(proxies[i], local, rot, t);
+    }
+    tree.refit();
+    CHECK(tree.validate());
+
+    for (int i = 0; i < 64; ++i)
+    {
+        const AABB3d &fat = tree.fatAABB(proxies[i]);
+        CHECK(fat.r[0] >= 2.0f);
+        CHECK(fat.r[1] >= 1.0f);
+        std::vector<int> hits;
+        tree.query(AABB3d{{4.0f * i, 5.9f, 0}, {0.01f, 0.01f, 0.01f}},
+                   [&](int p) { hits.push_back(p); });
+        CHECK(std::find(hits.begin(), hits.end(), proxies[i]) != hits.end());
+    }
+}
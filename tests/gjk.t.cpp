@@ -0,0 +1,228 @@
+#include "doctest.h"
+#include "geometry.hpp"
+#include "gjk.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+static std::vector<Point3d> corners(const AABB3d &b)
+{
+    std::vector<Point3d> pts;
+    for (int i = 0; i < 8; ++i)
+        pts.push_back({b.c.x + (i & 1 ? b.r[0] : -b.r[0]),
+                       b.c.y + (i & 2 ? b.r[1] : -b.r[1]),
+                       b.c.z + (i & 4 ? b.r[2] : -b.r[2])});
+    return pts;
+}
+
+static AABB3d randomBox(std::mt19937 &gen, float spread = 2.0f)
+{
+    std::uniform_real_distribution<float> c(-spread, spread), r(0.1f, 1.0f);
+    return {{c(gen), c(gen), c(gen)}, {r(gen), r(gen), r(gen)}};
+}
+
+TEST_CASE("GJK distance")
+{
+    SUBCASE("Spheres")
+    {
+        const Sphere a = {{0, 0, 0}, 1.0f}, b = {{3, 0, 0}, 0.5f};
+        Point3d pa, pb;
+        const float d = gjkDistance(a, b, pa, pb);
+        CHECK(d == doctest::Approx(1.5f).epsilon(1e-4));
+        CHECK(pa.x == doctest::Approx(1.0f).epsilon(1e-4));
+        CHECK(pb.x == doctest::Approx(2.5f).epsilon(1e-4));
+        CHECK(std::abs(pa.y) + std::abs(pa.z) < 1e-3f);
+        CHECK(gjkIntersect(a, Sphere{{1.4f, 0, 0}, 0.5f}));
+        CHECK_FALSE(gjkIntersect(a, b));
+    }
+
+    SUBCASE("Boxes against boxes and their corners")
+    {
+        std::mt19937 gen(38);
+        for (int trial = 0; trial < 300; ++trial)
+        {
+            const AABB3d a = randomBox(gen), b = randomBox(gen);
+            float gap2 = 0.0f;
+            const float *ca = &a.c.x, *cb = &b.c.x;
+            for (int k = 0; k < 3; ++k)
+            {
+                const float g =
+                    std::max(0.0f, std::abs(cb[k] - ca[k]) - a.r[k] - b.r[k]);
+                gap2 += g * g;
+            }
+            const auto pts = corners(a);
+            const ConvexShape hull(pts);
+            Point3d pa, pb;
+            const float d = gjkDistance(a, b, pa, pb);
+            CHECK(d == doctest::Approx(std::sqrt(gap2)).epsilon(1e-4));
+            CHECK(gjkDistance(hull, b, pa, pb) ==
+                  doctest::Approx(std::sqrt(gap2)).epsilon(1e-4));
+            if (gap2 > 1e-4f)
+            {
+                CHECK_FALSE(gjkIntersect(a, b));
+                CHECK(magnitute(pa - pb) == doctest::Approx(d).epsilon(1e-4));
+            }
+            else if (gap2 == 0.0f)
+                CHECK(gjkIntersect(hull, b));
+        }
+    }
+
+    SUBCASE("Oriented boxes agree with the separating axis test")
+    {
+        std::mt19937 gen(39);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        int checked = 0;
+        for (int trial = 0; trial < 300; ++trial)
+        {
+            OBB3d box[2];
+            for (auto &o : box)
+            {
+                Point3d axis = {u(gen), u(gen), u(gen)};
+                normalize(axis, axis);
+                Point3d other = crossProd(axis, {0.3f, 0.9f, 0.1f});
+                normalize(other, other);
+                o.c = {1.5f * u(gen), 1.5f * u(gen), 1.5f * u(gen)};
+                o.u[0] = axis;
+                o.u[1] = other;
+                o.u[2] = crossProd(axis, other);
+                for (float &e : o.e)
+                    e = 0.2f + 0.5f * (u(gen) + 1.0f);
+            }
+            Point3d pa, pb;
+            float depth;
+            Point3d n;
+            const float d = gjkDistance(box[0], box[1], pa, pb);
+            const bool deep = epaPenetration(box[0], box[1], depth, n, pa, pb);
+            // Leave out pairs that nearly touch
+            if (d > 0.0f ? d < 1e-3f : depth < 1e-3f)
+                continue;
+            ++checked;
+            CHECK(intersection(box[0], box[1]) == (d == 0.0f));
+            CHECK(gjkIntersect(box[0], box[1]) == (d == 0.0f));
+            CHECK(deep == (d == 0.0f));
+        }
+        CHECK(checked > 250);
+    }
+}
+
+TEST_CASE("EPA penetration")
+{
+    SUBCASE("Spheres")
+    {
+        const Sphere a = {{0, 0, 0}, 1.0f}, b = {{0, 1.2f, 0}, 0.5f};
+        float depth;
+        Point3d n, pa, pb;
+        REQUIRE(epaPenetration(a, b, depth, n, pa, pb));
+        CHECK(depth == doctest::Approx(0.3f).epsilon(1e-4));
+        CHECK(n.y == doctest::Approx(1.0f).epsilon(1e-4));
+        CHECK(pa.y == doctest::Approx(1.0f).epsilon(1e-4));
+        CHECK(pb.y == doctest::Approx(0.7f).epsilon(1e-4));
+        const Sphere apart = {{0, 1.6f, 0}, 0.5f};
+        CHECK_FALSE(epaPenetration(a, apart, depth, n, pa, pb));
+        REQUIRE(epaPenetration(a, a, depth, n, pa, pb));
+        CHECK(depth == doctest::Approx(2.0f));
+    }
+
+    SUBCASE("Sphere centred inside a box")
+    {
+        const AABB3d box = {{0, 0, 0}, {2, 1, 3}};
+        const Sphere s = {{0.5f, 0.7f, 0}, 0.5f};
+        float depth;
+        Point3d n, pa, pb;
+        REQUIRE(epaPenetration(box, s, depth, n, pa, pb));
+        CHECK(depth == doctest::Approx(0.8f).epsilon(1e-4));
+        CHECK(n.y == doctest::Approx(1.0f).epsilon(1e-4));
+        CHECK(pa.y == doctest::Approx(1.0f).epsilon(1e-4));
+        CHECK(pb.y == doctest::Approx(0.2f).epsilon(1e-4));
+    }
+
+    SUBCASE("Overlapping boxes")
+    {
+        std::mt19937 gen(40);
+        int checked = 0;
+        for (int trial = 0; trial < 300; ++trial)
+        {
+            const AABB3d a = randomBox(gen, 1.0f), b = randomBox(gen, 1.0f);
+            // Analytic answer: the axis of least overlap
+            float best = 1e30f;
+            int axis = 0;
+            const float *ca = &a.c.x, *cb = &b.c.x;
+            for (int k = 0; k < 3; ++k)
+            {
+                const float o = a.r[k] + b.r[k] - std::abs(cb[k] - ca[k]);
+                if (o < best)
+                {
+                    best = o;
+                    axis = k;
+                }
+            }
+            float depth;
+            Point3d n, pa, pb;
+            const auto pts = corners(b);
+            const ConvexShape hull(pts);
+            if (best <= 0.0f)
+            {
+                CHECK_FALSE(epaPenetration(a, hull, depth, n, pa, pb));
+                continue;
+            }
+            ++checked;
+            REQUIRE(epaPenetration(a, hull, depth, n, pa, pb));
+            CHECK(depth == doctest::Approx(best).epsilon(1e-4));
+            const float *nn = &n.x;
+            CHECK(std::abs(nn[axis]) == doctest::Approx(1.0f).epsilon(1e-4));
+            CHECK(nn[axis] * (cb[axis] - ca[axis]) >= 0.0f);
+            const Point3d sep = pa - pb;
+            CHECK(dotProd(sep, n) == doctest::Approx(depth).epsilon(1e-3));
+            // Moving b by depth * n leaves the boxes touching
+            const AABB3d bm = {
+                {cb[0] + depth * n.x, cb[1] + depth * n.y, cb[2] + depth * n.z},
+                {b.r[0], b.r[1], b.r[2]}};
+            Point3d qa, qb;
+            CHECK(gjkDistance(a, bm, qa, qb) < 1e-3f);
+        }
+        CHECK(checked > 100);
+    }
+
+    SUBCASE("Touching and identical shapes")
+    {
+        const AABB3d a = {{0, 0, 0}, {1, 2, 3}};
+        float depth;
+        Point3d n, pa, pb;
+        REQUIRE(epaPenetration(a, a, depth, n, pa, pb));
+        CHECK(depth == doctest::Approx(2.0f));
+        const AABB3d b = {{2, 0, 0}, {1, 1, 1}};
+        REQUIRE(epaPenetration(a, b, depth, n, pa, pb));
+        CHECK(depth == doctest::Approx(0.0f));
+    }
+}
+
+TEST_CASE("GJK warm start")
+{
+    // A sphere sliding past a box, with and without the previous simplex
+    const std::vector<Point3d> pts = corners({{0, 0, 0}, {1, 0.5f, 2}});
+    const ConvexShape hull(pts);
+    GjkSimplex cache, cold;
+    int warmIterations = 0, coldIterations = 0;
+    for (int frame = 0; frame < 200; ++frame)
+    {
+        const float t = 0.02f * frame;
+        const Sphere s = {{-2.0f + t, 1.0f + 0.3f * std::sin(t), 0.5f}, 0.4f};
+        Point3d pa, pb, qa, qb;
+        const float warm = gjkDistance(hull, s, pa, pb, &cache);
+        cold = GjkSimplex();
+        const float ref = gjkDistance(hull, s, qa, qb, &cold);
+        CHECK(warm == doctest::Approx(ref).epsilon(1e-4));
+        warmIterations += cache.iterations;
+        coldIterations += cold.iterations;
+
+        float depth, refDepth;
+        Point3d n, refN;
+        const bool hit = epaPenetration(hull, s, depth, n, pa, pb, &cache);
+        cold = GjkSimplex();
+        CHECK(hit == epaPenetration(hull, s, refDepth, refN, qa, qb, &cold));
+        if (hit)
+            CHECK(depth == doctest::Approx(refDepth).epsilon(1e-3));
+    }
+    CHECK(warmIterations < coldIterations);
+}
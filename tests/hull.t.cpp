@@ -0,0 +1,218 @@
+#include "doctest.h"
+#include "geometry.hpp"
+#include "hull.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Area of the smallest rectangle flush with one of the hull edges, by trying
+// every edge against every vertex.
+static float bruteMinArea(const std::vector<Point2d> &hull)
+{
+    float best = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < hull.size(); ++i)
+    {
+        Point2d d = hull[(i + 1) % hull.size()] - hull[i];
+        const float len = std::sqrt(dotProd(d, d));
+        d = {d.x / len, d.y / len};
+        const Point2d n = {-d.y, d.x};
+        float lo = 0, hi = 0, h = 0;
+        for (const auto &p : hull)
+        {
+            lo = std::min(lo, dotProd(p - hull[i], d));
+            hi = std::max(hi, dotProd(p - hull[i], d));
+            h = std::max(h, dotProd(p - hull[i], n));
+        }
+        best = std::min(best, (hi - lo) * h);
+    }
+    return best;
+}
+
+TEST_CASE("Monotone chain hull")
+{
+    SUBCASE("Square with inner and edge points")
+    {
+        std::vector<Point2d> pts;
+        for (int x = 0; x <= 4; ++x)
+            for (int y = 0; y <= 4; ++y)
+                pts.push_back({float(x), float(y)});
+        auto h = convexHull(pts);
+        REQUIRE(h.size() == 4);
+        CHECK((h[0].x == 0 && h[0].y == 0));
+        CHECK((h[1].x == 4 && h[1].y == 0));
+        CHECK((h[2].x == 4 && h[2].y == 4));
+        CHECK((h[3].x == 0 && h[3].y == 4));
+    }
+
+    SUBCASE("Degenerate inputs")
+    {
+        CHECK(convexHull({}).empty());
+        std::vector<Point2d> same(5, Point2d(1, 2));
+        CHECK(convexHull(same).size() == 1);
+        std::vector<Point2d> line = {{0, 0}, {2, 2}, {1, 1}, {3, 3}, {1, 1}};
+        auto h = convexHull(line);
+        REQUIRE(h.size() == 2);
+        CHECK(h[1].x == 3);
+    }
+
+    SUBCASE("Random clouds")
+    {
+        std::mt19937 gen(7);
+        std::normal_distribution<float> g(0.0f, 1.0f);
+        std::vector<Point2d> pts(5000);
+        for (auto &p : pts)
+            p = {g(gen), 0.3f * g(gen)};
+        auto h = convexHull(pts);
+        REQUIRE(h.size() >= 3);
+        for (size_t i = 0; i < h.size(); ++i)
+        {
+            const Point2d &a = h[i], &b = h[(i + 1) % h.size()];
+            // Strictly convex and counterclockwise
+            const Point2d &c = h[(i + 2) % h.size()];
+            CHECK(triaArea(a.x, a.y, b.x, b.y, c.x, c.y) > 0.0f);
+            for (const auto &p : pts)
+                REQUIRE(triaArea(a.x, a.y, b.x, b.y, p.x, p.y) >= -1e-5f);
+        }
+    }
+}
+
+// quickHull() on a copy of 'pts', checked against convexHull() and for
+// leaving a permutation of the input behind.
+static void checkQuickHull(const std::vector<Point2d> &pts)
+{
+    auto less = [](const Point2d &a, const Point2d &b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    };
+    std::vector<Point2d> q = pts;
+    const size_t n = quickHull(q);
+    const std::vector<Point2d> h = convexHull(pts);
+    REQUIRE(n == h.size());
+    for (size_t i = 0; i < n; ++i)
+    {
+        CHECK(q[i].x == h[i].x);
+        CHECK(q[i].y == h[i].y);
+    }
+    std::vector<Point2d> sorted = pts;
+    std::sort(sorted.begin(), sorted.end(), less);
+    std::sort(q.begin(), q.end(), less);
+    CHECK(std::equal(q.begin(), q.end(), sorted.begin(), [](auto &a, auto &b) {
+        return a.x == b.x && a.y == b.y;
+    }));
+}
+
+TEST_CASE("Quickhull")
+{
+    SUBCASE("Degenerate inputs")
+    {
+        checkQuickHull({});
+        checkQuickHull({{1, 2}});
+        checkQuickHull(std::vector<Point2d>(5, Point2d(1, 2)));
+        checkQuickHull({{0, 0}, {2, 2}, {1, 1}, {3, 3}, {1, 1}});
+        checkQuickHull({{3, 3}, {0, 0}});
+    }
+
+    SUBCASE("Integer grids with collinear and repeated points")
+    {
+        std::mt19937 gen(36);
+        for (int range : {1, 2, 5, 40})
+        {
+            std::uniform_int_distribution<int> u(-range, range);
+            std::vector<Point2d> pts(3000);
+            for (auto &p : pts)
+                p = {float(u(gen)), float(u(gen))};
+            checkQuickHull(pts);
+        }
+    }
+
+    SUBCASE("Random clouds")
+    {
+        std::mt19937 gen(37);
+        std::normal_distribution<float> g(0.0f, 1.0f);
+        std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+        for (size_t n : {3, 10, 1000, 200000})
+        {
+            std::vector<Point2d> pts(n);
+            for (auto &p : pts)
+                p = {g(gen), 0.3f * g(gen)};
+            checkQuickHull(pts);
+            // Every point on the hull
+            for (auto &p : pts)
+            {
+                const float t = angle(gen);
+                p = {std::round(1000.0f * std::cos(t)),
+                     std::round(1000.0f * std::sin(t))};
+            }
+            checkQuickHull(pts);
+        }
+    }
+}
+
+TEST_CASE("Minimum area rectangle")
+{
+    SUBCASE("Rotated rectangle")
+    {
+        const float a = 0.4f, ca = std::cos(a), sa = std::sin(a);
+        std::vector<Point2d> pts;
+        std::mt19937 gen(8);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        for (int i = 0; i < 200; ++i)
+        {
+            float x = 3.0f * u(gen), y = u(gen);
+            if (i < 4)
+            {
+                x = i & 1 ? 3.0f : -3.0f;
+                y = i & 2 ? 1.0f : -1.0f;
+            }
+            pts.push_back({5 + ca * x - sa * y, -2 + sa * x + ca * y});
+        }
+        Point2d c, axes[2];
+        float e[2];
+        const float area = minAreaRect(convexHull(pts), c, axes, e);
+        CHECK(area == doctest::Approx(12.0f).epsilon(1e-4));
+        CHECK(c.x == doctest::Approx(5.0f));
+        CHECK(c.y == doctest::Approx(-2.0f));
+        CHECK(std::max(e[0], e[1]) == doctest::Approx(3.0f));
+        CHECK(std::min(e[0], e[1]) == doctest::Approx(1.0f));
+        CHECK(std::abs(dotProd(axes[0], axes[1])) < 1e-6f);
+    }
+
+    SUBCASE("Matches a brute force search")
+    {
+        std::mt19937 gen(9);
+        std::normal_distribution<float> g(0.0f, 1.0f);
+        for (int trial = 0; trial < 20; ++trial)
+        {
+            std::vector<Point2d> pts(50 + 100 * trial);
+            for (auto &p : pts)
+            {
+                const float x = g(gen);
+                p = {x, 0.5f * g(gen) + 0.2f * x};
+            }
+            auto h = convexHull(pts);
+            Point2d c, axes[2];
+            float e[2];
+            const float area = minAreaRect(h, c, axes, e);
+            CHECK(area == doctest::Approx(bruteMinArea(h)).epsilon(1e-4));
+            CHECK(area == doctest::Approx(4.0f * e[0] * e[1]).epsilon(1e-4));
+            // Every point lies in the rectangle
+            for (const auto &p : pts)
+            {
+                CHECK(std::abs(dotProd(p - c, axes[0])) <= e[0] + 1e-4f);
+                CHECK(std::abs(dotProd(p - c, axes[1])) <= e[1] + 1e-4f);
+            }
+        }
+    }
+
+    SUBCASE("Degenerate hulls")
+    {
+        Point2d c, axes[2];
+        float e[2];
+        std::vector<Point2d> seg = {{0, 0}, {2, 0}};
+        CHECK(minAreaRect(seg, c, axes, e) == 0.0f);
+        CHECK(c.x == 1.0f);
+        CHECK(e[0] == 1.0f);
+        CHECK(minAreaRect({}, c, axes, e) == 0.0f);
+    }
+}
@@ -0,0 +1,162 @@
+#include "doctest.h"
+#include "geometry.hpp"
+#include "hull3d.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+// The hull is a closed triangle mesh with outward planes through its
+// vertices and every input point is behind every plane.
+static void checkHull(const ConvexHull3d &hull,
+                      const std::vector<Point3d> &pts,
+                      float tolerance)
+{
+    const auto &tris = hull.triangles();
+    REQUIRE(tris.size() >= 4);
+    std::map<std::pair<int, int>, int> edges;
+    for (const auto &t : tris)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            ++edges[{t.v[k], t.v[(k + 1) % 3]}];
+            CHECK(std::abs(dotProd(t.plane.n, pts[t.v[k]]) - t.plane.d) <=
+                  tolerance);
+        }
+        CHECK(std::abs(dotProd(t.plane.n, t.plane.n) - 1.0f) < 1e-4f);
+        float worst = -1.0f;
+        for (const auto &p : pts)
+            worst = std::max(worst, dotProd(t.plane.n, p) - t.plane.d);
+        CHECK(worst <= tolerance);
+    }
+    // Each edge once in each direction, and Euler's V - E + F = 2
+    for (const auto &[e, count] : edges)
+    {
+        CHECK(count == 1);
+        CHECK(edges.count({e.second, e.first}) == 1);
+    }
+    CHECK(hull.vertices().size() + tris.size() == edges.size() / 2 + 2);
+}
+
+TEST_CASE("Quickhull 3D")
+{
+    ConvexHull3d hull;
+
+    SUBCASE("Tetrahedron")
+    {
+        std::vector<Point3d> pts = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+        REQUIRE(hull.build(pts));
+        CHECK(hull.triangles().size() == 4);
+        CHECK(hull.vertices() == std::vector<int>{0, 1, 2, 3});
+        checkHull(hull, pts, 1e-6f);
+    }
+
+    SUBCASE("Cube with inner points")
+    {
+        std::vector<Point3d> pts;
+        std::mt19937 gen(37);
+        std::uniform_real_distribution<float> u(-0.9f, 0.9f);
+        for (int i = 0; i < 500; ++i)
+            pts.push_back({u(gen), u(gen), u(gen)});
+        for (int i = 0; i < 8; ++i)
+            pts.push_back({i & 1 ? 1.0f : -1.0f,
+                           i & 2 ? 1.0f : -1.0f,
+                           i & 4 ? 1.0f : -1.0f});
+        REQUIRE(hull.build(pts));
+        CHECK(hull.triangles().size() == 12);
+        REQUIRE(hull.vertices().size() == 8);
+        CHECK(hull.vertices().front() == 500);
+        for (const auto &t : hull.triangles())
+            CHECK(t.plane.d == doctest::Approx(1.0f));
+        checkHull(hull, pts, 1e-6f);
+    }
+
+    SUBCASE("Grid with coplanar and repeated points")
+    {
+        std::vector<Point3d> pts;
+        for (int x = 0; x <= 6; ++x)
+            for (int y = 0; y <= 6; ++y)
+                for (int z = 0; z <= 6; ++z)
+                    pts.push_back({float(x), float(y), float(z)});
+        pts.insert(pts.end(), pts.begin(), pts.begin() + 50);
+        REQUIRE(hull.build(pts));
+        checkHull(hull, pts, hull.epsilon());
+        // Only points on the surface, and all the corners
+        int corners = 0;
+        for (int v : hull.vertices())
+        {
+            const Point3d &p = pts[v];
+            auto onSide = [](float c) { return c == 0.0f || c == 6.0f; };
+            CHECK((onSide(p.x) || onSide(p.y) || onSide(p.z)));
+            corners += onSide(p.x) && onSide(p.y) && onSide(p.z);
+        }
+        CHECK(corners >= 8);
+    }
+
+    SUBCASE("Random clouds")
+    {
+        std::mt19937 gen(38);
+        std::normal_distribution<float> g(0.0f, 1.0f);
+        for (size_t n : {10, 100, 20000})
+        {
+            std::vector<Point3d> pts(n);
+            for (auto &p : pts)
+                p = {10.0f + g(gen), 0.5f * g(gen), 2.0f * g(gen)};
+            REQUIRE(hull.build(pts));
+            checkHull(hull, pts, 1e-4f);
+
+            // Points on a sphere are all vertices
+            for (auto &p : pts)
+            {
+                Point3d d = {g(gen), g(gen), g(gen)};
+                normalize(d, d);
+                p = {3.0f * d.x, 3.0f * d.y, 3.0f * d.z};
+            }
+            if (n > 1000)
+                pts.resize(1000);
+            REQUIRE(hull.build(pts));
+            CHECK(hull.vertices().size() == pts.size());
+            checkHull(hull, pts, 1e-4f);
+        }
+    }
+
+    SUBCASE("Reused builder gives the same hull")
+    {
+        std::mt19937 gen(39);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::vector<Point3d> big(5000), small(300);
+        for (auto &p : big)
+            p = {u(gen), u(gen), u(gen)};
+        for (auto &p : small)
+            p = {u(gen), u(gen), u(gen)};
+        ConvexHull3d fresh;
+        REQUIRE(fresh.build(small));
+        REQUIRE(hull.build(big));
+        REQUIRE(hull.build(small));
+        CHECK(hull.vertices() == fresh.vertices());
+        CHECK(hull.triangles().size() == fresh.triangles().size());
+    }
+
+    SUBCASE("Flat inputs")
+    {
+        CHECK_FALSE(hull.build({}));
+        std::vector<Point3d> pts = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}};
+        CHECK_FALSE(hull.build(pts));
+        std::mt19937 gen(40);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        pts.clear();
+        for (int i = 0; i < 100; ++i)
+        {
+            const float x = u(gen), y = u(gen);
+            pts.push_back({x, y, 2.0f * x - y + 1.0f});
+        }
+        CHECK_FALSE(hull.build(pts));
+        CHECK(hull.triangles().empty());
+        for (auto &p : pts)
+            p = {p.x, p.x, p.x};
+        CHECK_FALSE(hull.build(pts));
+        CHECK(hull.vertices().empty());
+    }
+}
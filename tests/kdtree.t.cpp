@@ -0,0 +1,124 @@
+#include "doctest.h"
+#include "kdtree.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+template<typename P>
+static float dist2(const P &a, const P &b)
+{
+    float d = 0.0f;
+    for (size_t k = 0; k < sizeof(P) / sizeof(float); ++k)
+        d += ((&a.x)[k] - (&b.x)[k]) * ((&a.x)[k] - (&b.x)[k]);
+    return d;
+}
+
+template<typename P>
+static P randomPoint(std::mt19937 &gen, float scale)
+{
+    std::uniform_real_distribution<float> u(-scale, scale);
+    P p;
+    for (size_t k = 0; k < sizeof(P) / sizeof(float); ++k)
+        (&p.x)[k] = u(gen);
+    return p;
+}
+
+// Every query agrees with brute force over the points.
+template<typename P>
+static void checkQueries(const std::vector<P> &pts, std::mt19937 &gen)
+{
+    KdTree<P> tree;
+    tree.build(pts);
+    REQUIRE(tree.size() == pts.size());
+    for (int trial = 0; trial < 40; ++trial)
+    {
+        const P q = randomPoint<P>(gen, 12.0f);
+        std::vector<float> all(pts.size());
+        for (size_t i = 0; i < pts.size(); ++i)
+            all[i] = dist2(pts[i], q);
+        std::vector<float> sorted = all;
+        std::sort(sorted.begin(), sorted.end());
+
+        for (size_t k : {1, 7, 40})
+        {
+            std::vector<KdNeighbor> out(k);
+            const size_t found = tree.nearest(q, out);
+            REQUIRE(found == std::min(k, pts.size()));
+            for (size_t i = 0; i < found; ++i)
+            {
+                CHECK(out[i].dist2 == doctest::Approx(sorted[i]));
+                CHECK(out[i].dist2 ==
+                      doctest::Approx(all[out[i].index]).epsilon(1e-5));
+            }
+        }
+
+        const float r = 3.0f;
+        std::vector<uint32_t> got, expected;
+        tree.radius(q, r, got);
+        for (size_t i = 0; i < pts.size(); ++i)
+            // Leave out points on the rounding edge of the sphere
+            if (std::abs(all[i] - r * r) > 1e-4f && all[i] < r * r)
+                expected.push_back(uint32_t(i));
+        std::sort(got.begin(), got.end());
+        for (uint32_t i : got)
+            CHECK(all[i] <= r * r * (1.0f + 1e-5f));
+        CHECK(std::includes(
+            got.begin(), got.end(), expected.begin(), expected.end()));
+
+        P mn = q, mx = q;
+        for (size_t k = 0; k < sizeof(P) / sizeof(float); ++k)
+        {
+            (&mn.x)[k] -= 2.0f + k;
+            (&mx.x)[k] += 1.0f;
+        }
+        got.clear();
+        expected.clear();
+        tree.box(mn, mx, got);
+        for (size_t i = 0; i < pts.size(); ++i)
+        {
+            bool inside = true;
+            for (size_t k = 0; k < sizeof(P) / sizeof(float); ++k)
+                inside = inside && (&pts[i].x)[k] >= (&mn.x)[k] &&
+                         (&pts[i].x)[k] <= (&mx.x)[k];
+            if (inside)
+                expected.push_back(uint32_t(i));
+        }
+        std::sort(got.begin(), got.end());
+        CHECK(got == expected);
+    }
+}
+
+TEST_CASE("k-d tree queries")
+{
+    std::mt19937 gen(41);
+
+    SUBCASE("3D")
+    {
+        for (size_t n : {0, 1, 5, 16, 17, 1000, 70000})
+        {
+            std::vector<Point3d> pts(n);
+            for (auto &p : pts)
+                p = randomPoint<Point3d>(gen, 10.0f);
+            checkQueries(pts, gen);
+        }
+    }
+
+    SUBCASE("2D")
+    {
+        for (size_t n : {3, 100, 5000})
+        {
+            std::vector<Point2d> pts(n);
+            for (auto &p : pts)
+                p = randomPoint<Point2d>(gen, 10.0f);
+            checkQueries(pts, gen);
+        }
+    }
+
+    SUBCASE("Repeated points and flat sets")
+    {
+        std::vector<Point3d> pts(3000);
+        for (size_t i = 0; i < pts.size(); ++i)
+            pts[i] = {float(i % 5), 0.0f, float(i % 3)};
+        checkQueries(pts, gen);
+    }
+}
@@ -0,0 +1,120 @@
+#include "bvh.hpp"
+#include "doctest.h"
+#include "geometry.hpp"
+#include "lbvh.hpp"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+TEST_CASE("Morton codes interleave the axes")
+{
+    CHECK(mortonCode30(0, 0, 0) == 0);
+    // Lowest cell step along each axis lands on bits 2, 1 and 0.
+    CHECK(mortonCode30(1.0f / 1024, 0, 0) == 4);
+    CHECK(mortonCode30(0, 1.0f / 1024, 0) == 2);
+    CHECK(mortonCode30(0, 0, 1.0f / 1024) == 1);
+    CHECK(mortonCode30(1, 1, 1) == (1u << 30) - 1);
+    CHECK(mortonCode63(1, 1, 1) == (uint64_t(1) << 63) - 1);
+    CHECK(mortonCode63(0.5f, 0, 0) == uint64_t(1) << 62);
+}
+
+TEST_CASE("Radix sort is a stable key sort")
+{
+    std::mt19937_64 gen(3);
+    for (size_t n : {0, 1, 100, 100000})
+    {
+        std::vector<uint64_t> keys(n);
+        std::vector<uint32_t> values(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            keys[i] = gen() % (n / 4 + 1) << 20;
+            values[i] = static_cast<uint32_t>(i);
+        }
+        std::vector<std::pair<uint64_t, uint32_t>> expected(n);
+        for (size_t i = 0; i < n; ++i)
+            expected[i] = {keys[i], values[i]};
+        std::stable_sort(
+            expected.begin(), expected.end(), [](auto &a, auto &b) {
+                return a.first < b.first;
+            });
+
+        radixSort(std::span<uint64_t>(keys), values);
+        bool same = true;
+        for (size_t i = 0; i < n; ++i)
+            same = same && keys[i] == expected[i].first &&
+                   values[i] == expected[i].second;
+        CHECK(same);
+    }
+
+    std::vector<uint32_t> keys = {5, 3, 0x30000, 3, 1};
+    std::vector<uint32_t> values = {0, 1, 2, 3, 4};
+    radixSort(std::span<uint32_t>(keys), values);
+    CHECK(keys == std::vector<uint32_t>{1, 3, 3, 5, 0x30000});
+    CHECK(values == std::vector<uint32_t>{4, 1, 3, 0, 2});
+}
+
+static void checkLinearBVH(const std::vector<AABB3d> &boxes, int bits)
+{
+    BVH bvh;
+    bvh.buildLinear(boxes, bits);
+    REQUIRE(bvh.size() == boxes.size());
+    CHECK(bvh.nodes().size() == 2 * boxes.size() - 1);
+
+    // Every node encloses its children.
+    bool nested = true;
+    for (const auto &n : bvh.nodes())
+    {
+        if (n.isLeaf())
+            continue;
+        for (uint32_t c = n.leftFirst; c < n.leftFirst + 2; ++c)
+            for (int a = 0; a < 3; ++a)
+                nested = nested && n.min[a] <= bvh.nodes()[c].min[a] &&
+                         n.max[a] >= bvh.nodes()[c].max[a];
+    }
+    CHECK(nested);
+
+    std::mt19937 gen(9);
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    for (int k = 0; k < 50; ++k)
+    {
+        AABB3d q = {{pos(gen), pos(gen), pos(gen)}, {10, 10, 10}};
+        std::vector<uint32_t> expected, found;
+        for (uint32_t i = 0; i < boxes.size(); ++i)
+            if (intersection(boxes[i], q))
+                expected.push_back(i);
+        bvh.query(q, [&](uint32_t i) { found.push_back(i); });
+        std::sort(found.begin(), found.end());
+        CHECK(found == expected);
+    }
+}
+
+TEST_CASE("Linear BVH queries match a linear scan")
+{
+    std::mt19937 gen(8);
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> ext(0.1f, 3.0f);
+    std::vector<AABB3d> boxes(3000);
+    for (auto &b : boxes)
+        b = {{pos(gen), pos(gen), pos(gen)}, {ext(gen), ext(gen), ext(gen)}};
+
+    SUBCASE("30-bit codes")
+    {
+        checkLinearBVH(boxes, 30);
+    }
+    SUBCASE("63-bit codes")
+    {
+        checkLinearBVH(boxes, 63);
+    }
+    SUBCASE("duplicate centers")
+    {
+        for (size_t i = 0; i < boxes.size(); i += 3)
+            boxes[i].c = boxes[0].c;
+        checkLinearBVH(boxes, 30);
+    }
+    SUBCASE("tiny inputs")
+    {
+        checkLinearBVH({boxes[0]}, 30);
+        checkLinearBVH({boxes[0], boxes[1]}, 63);
+    }
+}
@@ -2,14 +2,26 @@
 #include "geom_structs.hpp"
 #include "geometry.hpp"
 #include "math_utils.hpp"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <random>
+#include <vector>
 
 bool are_equal(double d1, double d2)
 {
     return std::abs(d1 - d2) < 0.6;
 }
 
+bool is_diagonal(const Matrix33 &m, float tol = 1e-4f)
+{
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            if (i != j && std::fabs(m[i][j]) > tol)
+                return false;
+    return true;
+}
+
 TEST_CASE("Transpose matrix")
 {
     constexpr int rows = 2, cols = 3;
@@ -27,6 +39,56 @@ TEST_CASE("Transpose matrix")
     }
 }
 
+// Out of place and in place transposes against the plain index formula,
+// for shapes on and off the tile and leaf sizes.
+template<typename T>
+static void checkTranspose()
+{
+    const int shapes[][2] = {
+        {1, 1}, {7, 9}, {8, 8}, {16, 3}, {33, 65}, {257, 130}, {1000, 3}};
+    for (const auto &s : shapes)
+    {
+        const int rows = s[0], cols = s[1];
+        std::vector<T> src(size_t(rows) * cols), dst(src.size());
+        for (size_t i = 0; i < src.size(); ++i)
+            src[i] = T(i);
+        transpose(src.data(), dst.data(), rows, cols);
+        bool same = true;
+        for (int i = 0; i < rows; ++i)
+            for (int j = 0; j < cols; ++j)
+                same = same && dst[size_t(j) * rows + i] == src[i * cols + j];
+        CHECK(same);
+    }
+    for (int n : {1, 5, 8, 31, 64, 100, 257})
+    {
+        std::vector<T> m(size_t(n) * n);
+        for (size_t i = 0; i < m.size(); ++i)
+            m[i] = T(i);
+        transposeInPlace(m.data(), n);
+        bool same = true;
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < n; ++j)
+                same = same && m[size_t(j) * n + i] == T(i * n + j);
+        CHECK(same);
+    }
+}
+
+TEST_CASE("Blocked transposes")
+{
+    SUBCASE("float")
+    {
+        checkTranspose<float>();
+    }
+    SUBCASE("double")
+    {
+        checkTranspose<double>();
+    }
+    SUBCASE("int")
+    {
+        checkTranspose<int>();
+    }
+}
+
 TEST_CASE("Matrix is diagonal")
 {
     constexpr int rows = 3, cols = 3;
@@ -73,6 +135,10 @@ TEST_CASE("Check matrix is symmetric")
 
     int matrix2[dim][dim] = {{1, 2, 1}, {1, 4, 5}, {3, 5, 6}};
     CHECK(!symmetric(matrix2, dim));
+
+    // Only the last pair differs
+    int matrix3[dim][dim] = {{1, 2, 3}, {2, 4, 5}, {3, 7, 6}};
+    CHECK(!symmetric(matrix3, dim));
 }
 
 TEST_CASE("Add matrix")
@@ -120,6 +186,80 @@ TEST_CASE("Matrix multiplication")
     CHECK(trg[1][1] == -1);
 }
 
+TEST_CASE("Matrix expressions match the step by step templates")
+{
+    std::mt19937 gen(44);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    float j[3][3], a[3][3], t[3][3], ja[3][3], jaj[3][3], d[3][3];
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+        {
+            j[r][c] = u(gen);
+            a[r][c] = u(gen);
+        }
+
+    // J^T a J, then 2 * (a + a^T) - a
+    transpose(&j[0][0], &t[0][0], 3, 3);
+    mult(t, a, ja);
+    mult(ja, j, jaj);
+    assign(d, transposed(expr(j)) * expr(a) * expr(j));
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            CHECK(d[r][c] == doctest::Approx(jaj[r][c]));
+    assign(d, 2.0f * (expr(a) + transposed(expr(a))) - expr(a));
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            CHECK(d[r][c] == doctest::Approx(a[r][c] + 2.0f * a[c][r]));
+
+    // Sizes past the unrolling limit take plain loops
+    double p[6][5], q[5][6], pq[6][6], e[6][6];
+    for (int r = 0; r < 6; ++r)
+        for (int c = 0; c < 5; ++c)
+            p[r][c] = q[c][r] = double(r) - 0.5 * c;
+    mult(p, q, pq);
+    assign(e, expr(p) * expr(q) + expr(pq));
+    for (int r = 0; r < 6; ++r)
+        for (int c = 0; c < 6; ++c)
+        {
+            double sum = 0.0;
+            for (int k = 0; k < 5; ++k)
+                sum += p[r][k] * q[k][c];
+            CHECK(pq[r][c] == doctest::Approx(sum));
+            CHECK(e[r][c] == doctest::Approx(2.0 * sum));
+        }
+
+    // Vector chains
+    const float va[3] = {1, 2, 3}, vb[3] = {4, 6, 8}, vc[3] = {1, -1, 2};
+    CHECK(dot(expr(vb) - expr(va), expr(vc)) == 9.0f);
+    float vd[3];
+    assign(vd, expr(j) * (expr(vb) - expr(va)));
+    CHECK(vd[1] == doctest::Approx(3 * j[1][0] + 4 * j[1][1] + 5 * j[1][2]));
+
+    // Matrix33 leaves and targets, the target in element-wise terms
+    Matrix33 m, n;
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            m[r][c] = a[r][c];
+    assign(n, transposed(expr(m)) * expr(m));
+    assign(n, expr(n) - expr(transposeMul(m, m)));
+    CHECK(is_diagonal(n, 1e-6f));
+    CHECK(n[0][0] == doctest::Approx(0.0f).scale(1.0f));
+
+    // Transposing the target in place goes through a MatValue
+    float s[3][3];
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            s[r][c] = a[r][c];
+    assign(s, MatValue<float, 3, 3>(transposed(expr(s))) + expr(s));
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            CHECK(s[r][c] == a[c][r] + a[r][c]);
+    assign(m, MatValue<float, 3, 3>(transposed(expr(m))));
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            CHECK(m[r][c] == a[c][r]);
+}
+
 TEST_CASE("Matrix Determinant")
 {
     int mat1[1][1] = {{5}};
@@ -170,17 +310,8 @@ TEST_CASE("Inverse of singular (non-invertible) matrix")
     CHECK(result == false);
 }
 
-bool is_diagonal(const Matrix33 &m, float tol = 1e-4f)
-{
-    for (int i = 0; i < 3; ++i)
-        for (int j = 0; j < 3; ++j)
-            if (i != j && std::fabs(m[i][j]) > tol)
-                return false;
-    return true;
-}
 
-
-TEST_CASE("Jacobi: identity matrix" * doctest::skip(true))
+TEST_CASE("Jacobi: identity matrix")
 {
     Matrix33 A;
     A[0][0] = 1.0f;
@@ -190,21 +321,12 @@ TEST_CASE("Jacobi: identity matrix" * doctest::skip(true))
     Matrix33 V;
     Jacobi(A, V);
 
-    printf("V[0][0]: %f\n", V[0][0]);
-    printf("V[0][1]: %f\n", V[0][1]);
-    printf("V[0][2]: %f\n", V[0][2]);
-    printf("V[1][0]: %f\n", V[1][0]);
-    printf("V[1][1]: %f\n", V[1][1]);
-    printf("V[1][2]: %f\n", V[1][2]);
-    printf("V[2][0]: %f\n", V[2][0]);
-    printf("V[2][1]: %f\n", V[2][1]);
-    printf("V[2][2]: %f\n", V[2][2]);
     CHECK(V.isorthogonal());
     auto D = V.transpose() * A * V;
     CHECK(D.isdiagonal());
 }
 
-TEST_CASE("Jacobi: diagonal matrix stays diagonal" * doctest::skip(true))
+TEST_CASE("Jacobi: diagonal matrix stays diagonal")
 {
     Matrix33 A;
     A[0][0] = 4.0f;
@@ -219,7 +341,7 @@ TEST_CASE("Jacobi: diagonal matrix stays diagonal" * doctest::skip(true))
     CHECK(V.isorthogonal());
 }
 
-TEST_CASE("Jacobi: symmetric matrix is diagonalized" * doctest::skip(true))
+TEST_CASE("Jacobi: symmetric matrix is diagonalized")
 {
     Matrix33 A;
     A[0][0] = 3.0f;
@@ -239,3 +361,250 @@ TEST_CASE("Jacobi: symmetric matrix is diagonalized" * doctest::skip(true))
     CHECK(D.isdiagonal());
     CHECK(V.isorthogonal());
 }
+
+TEST_CASE("Matrix33 product")
+{
+    Matrix33 a, b;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+        {
+            a[i][j] = float(3 * i + j + 1);
+            b[i][j] = i == j ? 2.0f : (j == 0 ? 1.0f : 0.0f);
+        }
+    Matrix33 c = a * b;
+    // Column 0 picks up the sum of each row, the others are doubled.
+    CHECK(c[0][0] == 2 + 2 + 3);
+    CHECK(c[1][0] == 8 + 5 + 6);
+    CHECK(c[2][1] == 16);
+    CHECK(c[2][2] == 18);
+}
+
+TEST_CASE("Matrix33 transposed products and point transforms")
+{
+    std::mt19937 gen(43);
+    std::uniform_real_distribution<float> u(-2.0f, 2.0f);
+    Matrix33 a, b;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+        {
+            a[i][j] = u(gen);
+            b[i][j] = u(gen);
+        }
+
+    const Matrix33 at = a.transpose();
+    const Matrix33 c = transposeMul(a, b), d = at * b;
+    for (int i = 0; i < 3; ++i)
+    {
+        // The padding stays zero
+        CHECK(at[i][3] == 0.0f);
+        CHECK(c[i][3] == 0.0f);
+        for (int j = 0; j < 3; ++j)
+        {
+            CHECK(at[i][j] == a[j][i]);
+            CHECK(c[i][j] == doctest::Approx(d[i][j]));
+        }
+    }
+
+    std::vector<Point3d> pts(1003), out(pts.size());
+    for (auto &p : pts)
+        p = {u(gen), u(gen), u(gen)};
+    for (bool parallel : {false, true})
+    {
+        transformPoints(a, pts, out, parallel);
+        for (size_t i = 0; i < pts.size(); ++i)
+        {
+            const Point3d p = pts[i], q = a * p;
+            CHECK(q.x == doctest::Approx(a[0][0] * p.x + a[0][1] * p.y +
+                                         a[0][2] * p.z));
+            CHECK(out[i].x == doctest::Approx(q.x));
+            CHECK(out[i].y == doctest::Approx(q.y));
+            CHECK(out[i].z == doctest::Approx(q.z));
+        }
+    }
+    // In place
+    std::vector<Point3d> in = pts;
+    transformPoints(a, in, in);
+    CHECK(in[1002].z == doctest::Approx(out[1002].z));
+}
+
+TEST_CASE("Jacobi: eigenvalues and eigenvectors")
+{
+    Matrix33 A;
+    const float a[3][3] = {{3, 2, 4}, {2, 0, 2}, {4, 2, 3}};
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            A[i][j] = a[i][j];
+
+    Matrix33 V;
+    float e[3];
+    Jacobi(A, V, e);
+
+    // Eigenvalues are 8, -1, -1 in some order.
+    float sorted[3] = {e[0], e[1], e[2]};
+    std::sort(sorted, sorted + 3);
+    CHECK(sorted[0] == doctest::Approx(-1.0f));
+    CHECK(sorted[1] == doctest::Approx(-1.0f));
+    CHECK(sorted[2] == doctest::Approx(8.0f));
+    // A v = e v for every column
+    for (int k = 0; k < 3; ++k)
+        for (int i = 0; i < 3; ++i)
+        {
+            float av = 0.0f;
+            for (int j = 0; j < 3; ++j)
+                av += A[i][j] * V[j][k];
+            CHECK(av == doctest::Approx(e[k] * V[i][k]).epsilon(1e-4));
+        }
+
+    // A scaled down covariance still gets decomposed.
+    Matrix33 small;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            small[i][j] = a[i][j] * 1e-6f;
+    Jacobi(small, V, e);
+    CHECK(is_diagonal(V.transpose() * small * V, 1e-10f));
+}
+
+TEST_CASE("Jacobi: batched decomposition")
+{
+    std::mt19937 gen(4);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    for (size_t n : {5, 8, 1003})
+    {
+        std::vector<Matrix33> a(n), v(n);
+        std::vector<Point3d> e(n);
+        for (size_t k = 0; k < n; ++k)
+        {
+            // B^T B is symmetric positive semidefinite, like a covariance.
+            Matrix33 b;
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    b[i][j] = u(gen);
+            a[k] = b.transpose() * b;
+        }
+        // Degenerate entries: zero, diagonal and rank one.
+        a[0] = Matrix33();
+        a[1] = Matrix33();
+        a[1][0][0] = 2.0f;
+        a[1][1][1] = 2.0f;
+        a[1][2][2] = 5.0f;
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                a[2][i][j] = float(i + 1) * float(j + 1);
+
+        for (bool parallel : {false, true})
+        {
+            Jacobi(a, v, e, parallel);
+            for (size_t k = 0; k < n; ++k)
+            {
+                CHECK(v[k].isorthogonal());
+                const float d[3] = {e[k].x, e[k].y, e[k].z};
+                Matrix33 D = v[k].transpose() * a[k] * v[k];
+                float scale = 1.0f;
+                for (int i = 0; i < 3; ++i)
+                    scale = std::max(scale, std::abs(d[i]));
+                CHECK(is_diagonal(D, 1e-5f * scale));
+                for (int i = 0; i < 3; ++i)
+                    CHECK(D[i][i] ==
+                          doctest::Approx(d[i]).epsilon(1e-4).scale(scale));
+            }
+        }
+    }
+}
+
+// Determinant of a 4x4 by expansion along the first row, in double.
+static double det4(const Matrix44 &a)
+{
+    double sum = 0.0;
+    for (int j = 0; j < 4; ++j)
+    {
+        double minor[3][3];
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0, k = 0; c < 4; ++c)
+                if (c != j)
+                    minor[r][k++] = a.m[r + 1][c];
+        sum += (j % 2 ? -1.0 : 1.0) * a.m[0][j] * det(minor);
+    }
+    return sum;
+}
+
+TEST_CASE("Batched determinants and inverses")
+{
+    std::mt19937 gen(47);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    for (size_t n : {3, 8, 21, 1003})
+    {
+        std::vector<Matrix33> a(n), ainv(n);
+        std::vector<Matrix44> b(n), binv(n);
+        std::vector<float> adet(n), bdet(n), d(n);
+        for (size_t k = 0; k < n; ++k)
+        {
+            // Diagonally dominant, so well away from singular.
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    a[k][i][j] = u(gen) + (i == j ? 3.0f : 0.0f);
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j)
+                    b[k].m[i][j] = u(gen) + (i == j ? 4.0f : 0.0f);
+        }
+        // A singular entry of each kind.
+        for (int j = 0; j < 3; ++j)
+            a[1][2][j] = 0.0f;
+        for (int j = 0; j < 4; ++j)
+            b[2].m[3][j] = 0.0f;
+
+        for (bool parallel : {false, true})
+        {
+            determinant(a, d, parallel);
+            inverse(a, ainv, adet, parallel);
+            for (size_t k = 0; k < n; ++k)
+            {
+                float m[3][3];
+                for (int i = 0; i < 3; ++i)
+                    for (int j = 0; j < 3; ++j)
+                        m[i][j] = a[k][i][j];
+                CHECK(d[k] == doctest::Approx(det(m)).epsilon(1e-5));
+                CHECK(adet[k] == doctest::Approx(d[k]).epsilon(1e-5));
+                const Matrix33 p = a[k] * ainv[k];
+                for (int i = 0; i < 3; ++i)
+                    for (int j = 0; j < 3; ++j)
+                        CHECK(p[i][j] ==
+                              doctest::Approx(k == 1 ? 0.0f : float(i == j))
+                                  .scale(1.0)
+                                  .epsilon(1e-5));
+            }
+
+            determinant(b, d, parallel);
+            inverse(b, binv, bdet, parallel);
+            for (size_t k = 0; k < n; ++k)
+            {
+                CHECK(d[k] == doctest::Approx(det4(b[k])).epsilon(1e-5));
+                CHECK(bdet[k] == doctest::Approx(d[k]).epsilon(1e-5));
+                for (int i = 0; i < 4; ++i)
+                    for (int j = 0; j < 4; ++j)
+                    {
+                        float p = 0.0f;
+                        for (int l = 0; l < 4; ++l)
+                            p += b[k].m[i][l] * binv[k].m[l][j];
+                        CHECK(p == doctest::Approx(k == 2 ? 0.0f
+                                                         : float(i == j))
+                                       .scale(1.0)
+                                       .epsilon(1e-5));
+                    }
+            }
+        }
+        CHECK(adet[1] == 0.0f);
+        CHECK(bdet[2] == 0.0f);
+
+        // In place.
+        inverse(b, b, bdet);
+        for (size_t k = 0; k < n; ++k)
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j)
+                    CHECK(b[k].m[i][j] == binv[k].m[i][j]);
+        inverse(a, a, adet);
+        for (size_t k = 0; k < n; ++k)
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    CHECK(a[k][i][j] == ainv[k][i][j]);
+    }
+}
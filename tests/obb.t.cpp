@@ -0,0 +1,205 @@
+#include "doctest.h"
+#include "geometry.hpp"
+#include "obb.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Orthonormal right handed frame from a random unit quaternion.
+static void randomFrame(std::mt19937 &gen, Point3d (&u)[3])
+{
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    float q[4] = {g(gen), g(gen), g(gen), g(gen)};
+    const float len = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] +
+                                q[3] * q[3]);
+    const float w = q[0] / len, x = q[1] / len, y = q[2] / len,
+                z = q[3] / len;
+    u[0] = {1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y)};
+    u[1] = {2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x)};
+    u[2] = crossProd(u[0], u[1]);
+}
+
+static bool contains(const OBB3d &b, const std::vector<Point3d> &pts)
+{
+    for (const auto &p : pts)
+        for (int k = 0; k < 3; ++k)
+            if (std::abs(dotProd(p - b.c, b.u[k])) > b.e[k] + 1e-4f)
+                return false;
+    return true;
+}
+
+// Largest gap between the projections of the two boxes' corners over the
+// 15 axes: positive when they are separated.
+static float separation(const OBB3d &a, const OBB3d &b)
+{
+    std::vector<Point3d> axes(a.u, a.u + 3);
+    axes.insert(axes.end(), b.u, b.u + 3);
+    for (const auto &ua : a.u)
+        for (const auto &ub : b.u)
+        {
+            Point3d n = crossProd(ua, ub);
+            if (dotProd(n, n) > 1e-6f)
+            {
+                normalize(n, n);
+                axes.push_back(n);
+            }
+        }
+    auto interval = [](const OBB3d &o, const Point3d &n, float &lo, float &hi) {
+        float r = 0.0f;
+        for (int k = 0; k < 3; ++k)
+            r += o.e[k] * std::abs(dotProd(o.u[k], n));
+        lo = dotProd(o.c, n) - r;
+        hi = dotProd(o.c, n) + r;
+    };
+    float best = -1e30f;
+    for (const auto &n : axes)
+    {
+        float alo, ahi, blo, bhi;
+        interval(a, n, alo, ahi);
+        interval(b, n, blo, bhi);
+        best = std::max(best, std::max(blo - ahi, alo - bhi));
+    }
+    return best;
+}
+
+TEST_CASE("OBB fitted to a rotated box")
+{
+    std::mt19937 gen(10);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    Point3d frame[3];
+    randomFrame(gen, frame);
+    const float ext[3] = {4.0f, 1.0f, 0.5f};
+    const Point3d center = {1, -2, 3};
+
+    std::vector<Point3d> pts;
+    for (int i = 0; i < 4000; ++i)
+    {
+        float s[3] = {u(gen), u(gen), u(gen)};
+        if (i < 8)
+            for (int k = 0; k < 3; ++k)
+                s[k] = i >> k & 1 ? 1.0f : -1.0f;
+        Point3d p = center;
+        for (int k = 0; k < 3; ++k)
+            p = {p.x + s[k] * ext[k] * frame[k].x,
+                 p.y + s[k] * ext[k] * frame[k].y,
+                 p.z + s[k] * ext[k] * frame[k].z};
+        pts.push_back(p);
+    }
+
+    for (bool refine : {false, true})
+    {
+        OBB3d b = obbFromPoints(pts, refine);
+        CHECK(contains(b, pts));
+        CHECK(b.c.x == doctest::Approx(1.0f).epsilon(0.01));
+        CHECK(b.c.y == doctest::Approx(-2.0f).epsilon(0.01));
+        CHECK(b.c.z == doctest::Approx(3.0f).epsilon(0.01));
+        CHECK(b.e[0] * b.e[1] * b.e[2] ==
+              doctest::Approx(4.0f * 1.0f * 0.5f).epsilon(0.02));
+        // Orthonormal, right handed
+        CHECK(dotProd(crossProd(b.u[0], b.u[1]), b.u[2]) ==
+              doctest::Approx(1.0f));
+        // Every true axis is matched by a fitted one
+        for (const auto &f : frame)
+        {
+            float best = 0.0f;
+            for (const auto &a : b.u)
+                best = std::max(best, std::abs(dotProd(f, a)));
+            CHECK(best > 0.999f);
+        }
+    }
+}
+
+TEST_CASE("OBB refinement never grows the box")
+{
+    std::mt19937 gen(11);
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    for (int trial = 0; trial < 10; ++trial)
+    {
+        // A flat slab with a lopsided cluster that tilts the covariance
+        std::vector<Point3d> pts;
+        for (int i = 0; i < 300; ++i)
+            pts.push_back({3 * g(gen), g(gen), 0.1f * g(gen)});
+        for (int i = 0; i < 100; ++i)
+            pts.push_back({4 + 0.2f * g(gen), 2 + 0.2f * g(gen), 0});
+        OBB3d pca = obbFromPoints(pts);
+        OBB3d refined = obbFromPoints(pts, true);
+        CHECK(contains(pca, pts));
+        CHECK(contains(refined, pts));
+        CHECK(refined.e[0] * refined.e[1] * refined.e[2] <=
+              pca.e[0] * pca.e[1] * pca.e[2]);
+    }
+
+    OBB3d empty = obbFromPoints({});
+    CHECK(empty.e[0] == 0.0f);
+    std::vector<Point3d> one = {{1, 2, 3}};
+    OBB3d point = obbFromPoints(one, true);
+    CHECK(point.c.x == doctest::Approx(1.0f));
+    CHECK(point.e[1] == 0.0f);
+}
+
+TEST_CASE("OBB separating axis test")
+{
+    OBB3d a = {{0, 0, 0}, {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, {1, 1, 1}};
+    OBB3d b = a;
+    CHECK(intersection(a, b));
+    b.c = {2.1f, 0, 0};
+    CHECK_FALSE(intersection(a, b));
+    b.c = {1.9f, 1.9f, 0};
+    CHECK(intersection(a, b));
+
+    // Edges crossing at right angles: only an edge-edge axis separates.
+    const float h = std::sqrt(0.5f);
+    OBB3d c = {{0, 0, 0}, {{h, h, 0}, {-h, h, 0}, {0, 0, 1}}, {1, 1, 0.1f}};
+    OBB3d d = {{0, 0, 0}, {{1, 0, 0}, {0, h, h}, {0, -h, h}}, {0.1f, 1, 1}};
+    d.c = {0.2f, 0, 2 * h + 0.1f + 0.05f};
+    CHECK(separation(c, d) > 0.0f);
+    CHECK_FALSE(intersection(c, d));
+    d.c.z -= 0.1f;
+    CHECK(separation(c, d) < 0.0f);
+    CHECK(intersection(c, d));
+}
+
+TEST_CASE("Batched OBB test matches the reference")
+{
+    std::mt19937 gen(12);
+    std::uniform_real_distribution<float> pos(-3.0f, 3.0f);
+    std::uniform_real_distribution<float> ext(0.2f, 2.0f);
+    const size_t n = 2003;
+    std::vector<OBB3d> a(n), b(n);
+    for (size_t i = 0; i < n; ++i)
+        for (OBB3d *o : {&a[i], &b[i]})
+        {
+            randomFrame(gen, o->u);
+            o->c = {pos(gen), pos(gen), pos(gen)};
+            o->e[0] = ext(gen);
+            o->e[1] = ext(gen);
+            o->e[2] = ext(gen);
+        }
+    // Some axis-parallel pairs, where edge cross products vanish.
+    for (size_t i = 0; i < n; i += 7)
+        for (int k = 0; k < 3; ++k)
+            b[i].u[k] = a[i].u[k];
+
+    std::vector<uint8_t> hit(n);
+    for (bool parallel : {false, true})
+    {
+        std::fill(hit.begin(), hit.end(), 2);
+        intersection(a, b, hit, parallel);
+        int checked = 0, overlapping = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            REQUIRE(hit[i] < 2);
+            const float s = separation(a[i], b[i]);
+            if (std::abs(s) < 1e-3f)
+                continue;
+            ++checked;
+            overlapping += s < 0.0f;
+            CHECK(intersection(a[i], b[i]) == (s < 0.0f));
+            CHECK(bool(hit[i]) == (s < 0.0f));
+        }
+        CHECK(checked > int(n) * 9 / 10);
+        CHECK(overlapping > 100);
+        CHECK(overlapping < checked - 100);
+    }
+}
@@ -0,0 +1,118 @@
+#include "doctest.h"
+#include "geometry.hpp"
+#include "octree.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+template<typename Region>
+static std::vector<int> collect(const LooseOctree &tree, const Region &r)
+{
+    std::vector<int> hits;
+    tree.query(r, [&](int o) { hits.push_back(o); });
+    std::sort(hits.begin(), hits.end());
+    return hits;
+}
+
+TEST_CASE("Loose octree places objects by size")
+{
+    LooseOctree tree(AABB3d{{0, 0, 0}, {64, 64, 64}}, 6, 2.0f);
+    int small = tree.insert(AABB3d{{10, 10, 10}, {0.5f, 0.5f, 0.5f}}, 1);
+    int large = tree.insert(AABB3d{{10, 10, 10}, {40, 40, 40}}, 2);
+    int outside = tree.insert(AABB3d{{1000, 0, 0}, {1, 1, 1}}, 3);
+
+    CHECK(tree.size() == 3);
+    CHECK(tree.nodeOf(large) == 0);
+    CHECK(tree.nodeOf(outside) == 0);
+    CHECK(tree.nodeOf(small) != 0);
+    // Loose bounds of the small object's node contain its box.
+    const OctNode &n = tree.nodes()[tree.nodeOf(small)];
+    CHECK(std::abs(10.0f - n.c.x) + 0.5f <= 2.0f * n.half);
+
+    CHECK(collect(tree, AABB3d{{1000, 0, 0}, {0.5f, 0.5f, 0.5f}}) ==
+          std::vector<int>{outside});
+    CHECK(collect(tree, Sphere{{10, 10, 10}, 0.1f}) ==
+          std::vector<int>{small, large});
+
+    tree.remove(small);
+    CHECK(tree.size() == 2);
+    CHECK(collect(tree, Sphere{{10, 10, 10}, 0.1f}) == std::vector<int>{large});
+}
+
+TEST_CASE("Loose octree queries match brute force")
+{
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> logExt(-3.0f, 1.5f);
+    auto randomBox = [&]() {
+        return AABB3d{{pos(gen), pos(gen), pos(gen)},
+                      {std::pow(10.0f, logExt(gen)),
+                       std::pow(10.0f, logExt(gen)),
+                       std::pow(10.0f, logExt(gen))}};
+    };
+
+    LooseOctree tree(AABB3d{{0, 0, 0}, {100, 100, 100}}, 10, 1.5f);
+    std::vector<AABB3d> boxes;
+    std::vector<int> ids;
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        boxes.push_back(randomBox());
+        ids.push_back(tree.insert(boxes.back(), i));
+    }
+    for (int i = 0; i < 1000; i += 2)
+    {
+        boxes[i] = randomBox();
+        tree.update(ids[i], boxes[i]);
+    }
+    for (int i = 1; i < 1000; i += 5)
+    {
+        tree.remove(ids[i]);
+        ids[i] = -1;
+    }
+
+    auto brute = [&](auto test) {
+        std::vector<int> hits;
+        for (int i = 0; i < 1000; ++i)
+            if (ids[i] >= 0 && test(boxes[i]))
+                hits.push_back(ids[i]);
+        std::sort(hits.begin(), hits.end());
+        return hits;
+    };
+
+    for (int k = 0; k < 20; ++k)
+    {
+        AABB3d q = randomBox();
+        q.r[0] += 10.0f;
+        CHECK(collect(tree, q) ==
+              brute([&](const AABB3d &b) { return intersection(b, q); }));
+
+        Sphere s{{pos(gen), pos(gen), pos(gen)}, 15.0f};
+        CHECK(collect(tree, s) ==
+              brute([&](const AABB3d &b) { return intersection(s, b); }));
+    }
+
+    // View volume looking down +z from the origin, 90 degree field of view.
+    const float k = 0.70710678f;
+    Frustum f{{{{0, 0, 1}, 1.0f},
+               {{0, 0, -1}, -60.0f},
+               {{k, 0, k}, 0.0f},
+               {{-k, 0, k}, 0.0f},
+               {{0, k, k}, 0.0f},
+               {{0, -k, k}, 0.0f}}};
+    auto visible = collect(tree, f);
+    CHECK(visible ==
+          brute([&](const AABB3d &b) { return intersection(f, b); }));
+    CHECK_FALSE(visible.empty());
+}
+
+TEST_CASE("Sphere - AABB and frustum - AABB tests")
+{
+    AABB3d b = {{0, 0, 0}, {1, 1, 1}};
+    CHECK(intersection(Sphere{{2, 0, 0}, 1.0f}, b));
+    CHECK_FALSE(intersection(Sphere{{2, 2, 0}, 1.0f}, b));
+    CHECK(intersection(Sphere{{1.5f, 1.5f, 0}, 0.75f}, b));
+
+    Plane p{{1, 0, 0}, 2.0f};
+    CHECK(behindPlane(b, p));
+    CHECK_FALSE(behindPlane(b, Plane{{1, 0, 0}, 0.5f}));
+}
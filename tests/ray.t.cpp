@@ -0,0 +1,209 @@
+#include "bvh.hpp"
+#include "doctest.h"
+#include "geometry.hpp"
+#include "ray.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+static std::vector<Triangle3d> randomTriangles(size_t n, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> pos(-50.0f, 50.0f), off(-3.0f, 3.0f);
+    std::vector<Triangle3d> tris(n);
+    for (auto &t : tris)
+    {
+        const Point3d c = {pos(gen), pos(gen), pos(gen)};
+        t.a = {c.x + off(gen), c.y + off(gen), c.z + off(gen)};
+        t.b = {c.x + off(gen), c.y + off(gen), c.z + off(gen)};
+        t.c = {c.x + off(gen), c.y + off(gen), c.z + off(gen)};
+    }
+    return tris;
+}
+
+static std::vector<Ray> randomRays(size_t n, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<Ray> rays(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        // Some rays run parallel to an axis plane
+        rays[i] = {{60.0f * u(gen), 60.0f * u(gen), 60.0f * u(gen)},
+                   {u(gen), u(gen), i % 7 == 0 ? 0.0f : u(gen)}};
+    }
+    return rays;
+}
+
+TEST_CASE("Ray against box")
+{
+    const AABB3d box = {{1, 2, 3}, {1, 1, 2}};
+    float t;
+    CHECK(intersection(Ray{{-5, 2, 3}, {1, 0, 0}}, box, 100.0f, t));
+    CHECK(t == doctest::Approx(5.0f));
+    CHECK_FALSE(intersection(Ray{{-5, 2, 3}, {1, 0, 0}}, box, 4.0f, t));
+    CHECK_FALSE(intersection(Ray{{-5, 2, 3}, {-1, 0, 0}}, box, 100.0f, t));
+    CHECK_FALSE(intersection(Ray{{-5, 3.5f, 3}, {1, 0, 0}}, box, 100.0f, t));
+    CHECK(intersection(Ray{{1, 2, 3}, {0, 0, 1}}, box, 100.0f, t));
+    CHECK(t == 0.0f);
+
+    SUBCASE("Packets agree with single rays")
+    {
+        const auto rays = randomRays(203, 39);
+        std::mt19937 gen(40);
+        std::uniform_real_distribution<float> pos(-30.0f, 30.0f), r(1, 20);
+        for (size_t first = 0; first < rays.size(); first += RayPacket::WIDTH)
+        {
+            const auto chunk = std::span(rays).subspan(
+                first, std::min<size_t>(RayPacket::WIDTH, rays.size() - first));
+            const RayPacket packet(chunk, 80.0f);
+            REQUIRE(packet.count == int(chunk.size()));
+            for (int k = 0; k < 20; ++k)
+            {
+                const AABB3d b = {{pos(gen), pos(gen), pos(gen)},
+                                  {r(gen), r(gen), r(gen)}};
+                float tenter[RayPacket::WIDTH];
+                const uint32_t mask = intersection(packet, b, tenter);
+                CHECK((mask & ~packet.activeMask()) == 0);
+                for (size_t i = 0; i < chunk.size(); ++i)
+                {
+                    const bool hit = intersection(chunk[i], b, 80.0f, t);
+                    CHECK(bool(mask >> i & 1) == hit);
+                    if (hit)
+                        CHECK(tenter[i] == t);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Ray against triangle")
+{
+    const Triangle3d tri = {{0, 0, 0}, {4, 0, 0}, {0, 4, 0}};
+    float t, u, v;
+    REQUIRE(intersection(Ray{{1, 2, 5}, {0, 0, -1}}, tri, 100.0f, t, u, v));
+    CHECK(t == doctest::Approx(5.0f));
+    CHECK(u == doctest::Approx(0.25f));
+    CHECK(v == doctest::Approx(0.5f));
+    // Back faces count too
+    CHECK(intersection(Ray{{1, 2, -5}, {0, 0, 1}}, tri, 100.0f, t, u, v));
+    CHECK_FALSE(intersection(Ray{{1, 2, 5}, {0, 0, -1}}, tri, 4.0f, t, u, v));
+    CHECK_FALSE(intersection(Ray{{1, 2, 5}, {0, 0, 1}}, tri, 100.0f, t, u, v));
+    CHECK_FALSE(intersection(Ray{{3, 3, 5}, {0, 0, -1}}, tri, 100.0f, t, u, v));
+    CHECK_FALSE(intersection(Ray{{1, 1, 0}, {1, 1, 0}}, tri, 100.0f, t, u, v));
+
+    SUBCASE("Packets agree with single rays")
+    {
+        // Rays aimed at points inside, or clearly outside, random triangles
+        const auto tris = randomTriangles(500, 41);
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<float> w(0.05f, 0.9f), dir(-1.0f, 1.0f);
+        int hits = 0;
+        for (const Triangle3d &tr : tris)
+        {
+            Ray rays[RayPacket::WIDTH];
+            bool expected[RayPacket::WIDTH];
+            for (int i = 0; i < RayPacket::WIDTH; ++i)
+            {
+                float wb = w(gen), wc = w(gen);
+                if (wb + wc > 0.95f)
+                    wb = 0.95f - wc;
+                expected[i] = i % 3 != 0;
+                if (!expected[i])
+                    wb = -0.1f - wb;
+                const float wa = 1.0f - wb - wc;
+                const Point3d target = {
+                    wa * tr.a.x + wb * tr.b.x + wc * tr.c.x,
+                    wa * tr.a.y + wb * tr.b.y + wc * tr.c.y,
+                    wa * tr.a.z + wb * tr.b.z + wc * tr.c.z};
+                // Grazing rays would leave t, u and v to rounding
+                const Point3d n = normal(tr.a, tr.b, tr.c);
+                Point3d d;
+                do
+                {
+                    d = {dir(gen), dir(gen), dir(gen)};
+                } while (std::abs(dotProd(d, n)) < 0.3f * magnitute(d));
+                const float s = 20.0f;
+                rays[i] = {{target.x - s * d.x, target.y - s * d.y,
+                            target.z - s * d.z},
+                           d};
+            }
+            const RayPacket packet(rays, 100.0f);
+            float pt[RayPacket::WIDTH], pu[RayPacket::WIDTH],
+                pv[RayPacket::WIDTH];
+            const uint32_t mask = intersection(packet, tr, pt, pu, pv);
+            for (int i = 0; i < RayPacket::WIDTH; ++i)
+            {
+                const bool hit = intersection(rays[i], tr, 100.0f, t, u, v);
+                CHECK(hit == expected[i]);
+                CHECK(bool(mask >> i & 1) == hit);
+                if (!hit)
+                    continue;
+                ++hits;
+                CHECK(t == doctest::Approx(20.0f).epsilon(1e-3));
+                CHECK(pt[i] == doctest::Approx(t).epsilon(1e-5));
+                CHECK(pu[i] == doctest::Approx(u).epsilon(1e-4));
+                CHECK(pv[i] == doctest::Approx(v).epsilon(1e-4));
+            }
+        }
+        CHECK(hits > 2000);
+    }
+}
+
+TEST_CASE("Packet traversal of a triangle BVH")
+{
+    const auto tris = randomTriangles(3000, 43);
+    BVH bvh;
+    bvh.build(tris);
+    const auto rays = randomRays(500, 44);
+    const float tmax = 200.0f;
+    int hits = 0;
+    for (size_t first = 0; first < rays.size(); first += RayPacket::WIDTH)
+    {
+        const auto chunk = std::span(rays).subspan(
+            first, std::min<size_t>(RayPacket::WIDTH, rays.size() - first));
+        RayPacket packet(chunk, tmax);
+
+        // Every candidate box, per lane, as single rays see them
+        std::vector<uint32_t> found[RayPacket::WIDTH];
+        bvh.raycast(packet, [&](uint32_t index, uint32_t mask) {
+            for (size_t i = 0; i < chunk.size(); ++i)
+                if (mask >> i & 1)
+                    found[i].push_back(index);
+        });
+        for (size_t i = 0; i < chunk.size(); ++i)
+        {
+            std::vector<uint32_t> expected;
+            bvh.raycast(chunk[i], tmax, [&](uint32_t index, float) {
+                expected.push_back(index);
+            });
+            std::sort(expected.begin(), expected.end());
+            std::sort(found[i].begin(), found[i].end());
+            CHECK(found[i] == expected);
+        }
+
+        uint32_t index[RayPacket::WIDTH];
+        const uint32_t mask = bvh.closestHit(tris, packet, index);
+        for (size_t i = 0; i < chunk.size(); ++i)
+        {
+            // Brute force over every triangle
+            float best = tmax, t, u, v;
+            bool any = false;
+            for (const Triangle3d &tr : tris)
+                if (intersection(chunk[i], tr, best, t, u, v))
+                {
+                    best = t;
+                    any = true;
+                }
+            REQUIRE(bool(mask >> i & 1) == any);
+            if (!any)
+                continue;
+            ++hits;
+            CHECK(packet.tmax[i] == doctest::Approx(best));
+            CHECK(intersection(chunk[i], tris[index[i]], tmax, t, u, v));
+            CHECK(t == doctest::Approx(best));
+        }
+    }
+    CHECK(hits > 50);
+}
@@ -0,0 +1,244 @@
+#include "chase_lev_deque.hpp"
+#include "doctest.h"
+#include "scheduler.hpp"
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Chase-Lev deque: owner end is LIFO, thief end FIFO")
+{
+    ChaseLevDeque<int> d(4);
+    int x = 0;
+    CHECK_FALSE(d.pop(x));
+    CHECK_FALSE(d.steal(x));
+    // Past the initial capacity, to grow the buffer.
+    for (int i = 0; i < 10; ++i)
+        d.push(i);
+    CHECK(d.size() == 10);
+    REQUIRE(d.pop(x));
+    CHECK(x == 9);
+    REQUIRE(d.steal(x));
+    CHECK(x == 0);
+    REQUIRE(d.steal(x));
+    CHECK(x == 1);
+    for (int i = 8; i >= 2; --i)
+    {
+        REQUIRE(d.pop(x));
+        CHECK(x == i);
+    }
+    CHECK_FALSE(d.pop(x));
+    CHECK(d.size() == 0);
+}
+
+TEST_CASE("Chase-Lev deque: every item is taken once under contention")
+{
+    constexpr int N = 200000;
+    ChaseLevDeque<int> d(16);
+    std::vector<std::atomic<int>> taken(N);
+    std::atomic<bool> done{false};
+    std::atomic<int> count{0};
+
+    std::vector<std::thread> thieves;
+    for (int k = 0; k < 3; ++k)
+        thieves.emplace_back([&]() {
+            int x;
+            while (!done.load() || d.size() != 0)
+                if (d.steal(x))
+                {
+                    taken[x].fetch_add(1);
+                    count.fetch_add(1);
+                }
+        });
+
+    // The owner pushes in bursts and pops some back, racing the thieves for
+    // the last items.
+    int x;
+    for (int i = 0; i < N; ++i)
+    {
+        d.push(i);
+        if (i % 3 == 0 && d.pop(x))
+        {
+            taken[x].fetch_add(1);
+            count.fetch_add(1);
+        }
+    }
+    while (d.pop(x))
+    {
+        taken[x].fetch_add(1);
+        count.fetch_add(1);
+    }
+    done.store(true);
+    for (auto &t : thieves)
+        t.join();
+
+    CHECK(count.load() == N);
+    int wrong = 0;
+    for (auto &t : taken)
+        wrong += t.load() != 1;
+    CHECK(wrong == 0);
+}
+
+TEST_CASE("Scheduler: parallelFor covers every index once")
+{
+    for (unsigned threads : {1u, 2u, 4u})
+    {
+        Scheduler s(threads);
+        CHECK(s.threads() == threads);
+        for (size_t n : {0, 1, 7, 1000, 100003})
+            for (size_t grain : {0, 1, 64, 5000})
+            {
+                std::vector<std::atomic<int>> hits(n);
+                std::atomic<int> empty{0};
+                s.parallelFor(
+                    0,
+                    n,
+                    [&](size_t b, size_t e) {
+                        empty += b >= e;
+                        for (size_t i = b; i < e; ++i)
+                            hits[i].fetch_add(1, std::memory_order_relaxed);
+                    },
+                    grain);
+                int wrong = 0;
+                for (auto &h : hits)
+                    wrong += h.load() != 1;
+                CHECK(wrong == 0);
+                CHECK(empty.load() == 0);
+            }
+    }
+}
+
+TEST_CASE("Scheduler: nested loops and invoke")
+{
+    Scheduler s(4);
+    constexpr size_t N = 64, M = 500;
+    std::vector<std::atomic<int>> hits(N * M);
+    s.parallelFor(0, N, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i)
+            s.parallelFor(0, M, [&](size_t b2, size_t e2) {
+                for (size_t j = b2; j < e2; ++j)
+                    hits[i * M + j].fetch_add(1);
+            });
+    });
+    int wrong = 0;
+    for (auto &h : hits)
+        wrong += h.load() != 1;
+    CHECK(wrong == 0);
+
+    // Recursive fork-join, many small tasks.
+    auto fib = [&](auto &&self, int n) -> long {
+        if (n < 2)
+            return n;
+        long a = 0, b = 0;
+        s.invoke([&]() { a = self(self, n - 1); },
+                 [&]() { b = self(self, n - 2); });
+        return a + b;
+    };
+    CHECK(fib(fib, 22) == 17711);
+}
+
+TEST_CASE("Scheduler: parallelReduce")
+{
+    Scheduler s(4);
+    const size_t n = 1000003;
+    const auto sum = s.parallelReduce(
+        size_t(0),
+        n,
+        uint64_t(0),
+        [](size_t b, size_t e) {
+            uint64_t t = 0;
+            for (size_t i = b; i < e; ++i)
+                t += i;
+            return t;
+        },
+        [](uint64_t a, uint64_t b) { return a + b; });
+    CHECK(sum == uint64_t(n) * (n - 1) / 2);
+
+    // Floating point sums combine in block order, whichever thread ran what.
+    std::vector<float> v(n);
+    for (size_t i = 0; i < n; ++i)
+        v[i] = 1.0f / float(i + 1);
+    auto fsum = [&]() {
+        return s.parallelReduce(
+            size_t(0),
+            n,
+            0.0f,
+            [&](size_t b, size_t e) {
+                return std::accumulate(v.begin() + b, v.begin() + e, 0.0f);
+            },
+            [](float a, float b) { return a + b; },
+            4096);
+    };
+    float serial = 0.0f;
+    for (size_t b = 0; b < n; b += 4096)
+        serial += std::accumulate(
+            v.begin() + b, v.begin() + std::min(n, b + 4096), 0.0f);
+    for (int k = 0; k < 5; ++k)
+        CHECK(fsum() == serial);
+
+    CHECK(s.parallelReduce(
+              size_t(5),
+              size_t(5),
+              7,
+              [](size_t, size_t) { return 1; },
+              [](int a, int b) { return a + b; }) == 7);
+}
+
+TEST_CASE("Scheduler: concurrent external callers")
+{
+    Scheduler s(3);
+    std::vector<std::thread> callers;
+    std::atomic<int> wrong{0};
+    // More callers than external slots: some run their loops serially.
+    for (int c = 0; c < 6; ++c)
+        callers.emplace_back([&]() {
+            for (int round = 0; round < 20; ++round)
+            {
+                std::vector<int> hits(20000);
+                s.parallelFor(0, hits.size(), [&](size_t b, size_t e) {
+                    for (size_t i = b; i < e; ++i)
+                        ++hits[i];
+                });
+                for (int h : hits)
+                    wrong += h != 1;
+            }
+        });
+    for (auto &c : callers)
+        c.join();
+    CHECK(wrong.load() == 0);
+}
+
+TEST_CASE("Scheduler: per-thread scratch arenas")
+{
+    Scheduler s(4);
+    std::atomic<int> bad{0};
+    s.parallelFor(
+        0,
+        256,
+        [&](size_t b, size_t e) {
+            ScratchArena &arena = scratchArena();
+            const size_t before = arena.used();
+            {
+                ScratchBuffer<int> buf(1000);
+                for (size_t i = 0; i < buf.size(); ++i)
+                    buf[i] = int(b + i);
+                // A nested loop may run other chunks on this thread while
+                // it waits; they must leave the arena as they found it.
+                s.parallelFor(0, 64, [&](size_t, size_t) {
+                    ScratchBuffer<double> inner(100);
+                    inner[0] = 1.0;
+                });
+                for (size_t i = 0; i < buf.size(); ++i)
+                    bad += buf[i] != int(b + i);
+                // Larger than the arena: from the heap.
+                ScratchBuffer<char> big(SCRATCH_BYTES + 1);
+                big[SCRATCH_BYTES] = 1;
+            }
+            bad += arena.used() != before;
+            (void)e;
+        },
+        1);
+    CHECK(bad.load() == 0);
+    CHECK(scratchArena().used() == 0);
+}
@@ -0,0 +1,311 @@
+#include "barycentric.hpp"
+#include "bounding_sphere.hpp"
+#include "dense_matrix.hpp"
+#include "doctest.h"
+#include "geometry.hpp"
+#include "kdtree.hpp"
+#include "math_utils.hpp"
+#include "obb.hpp"
+#include "ray.hpp"
+#include "simd.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Every kernel is run at each level this machine supports and compared with
+// its scalar results. Paths with FMA round differently, so floating point
+// results agree to a tolerance; indices and hit flags agree exactly.
+
+// Forces a dispatch level for as long as it lives.
+struct ForcedLevel
+{
+    explicit ForcedLevel(SimdLevel level) : saved(setSimdLevel(level)) {}
+    ~ForcedLevel()
+    {
+        setSimdLevel(saved);
+    }
+
+    SimdLevel saved;
+};
+
+// The levels above scalar that this machine can run.
+static std::vector<SimdLevel> vectorLevels()
+{
+    std::vector<SimdLevel> levels;
+    for (SimdLevel level : {SimdLevel::Avx2, SimdLevel::Avx512})
+        if (level <= cpuSimdLevel())
+            levels.push_back(level);
+    return levels;
+}
+
+// Calls f() at the scalar level and then at every vector level, passing
+// whether this is the scalar (reference) run.
+template<typename F>
+static void acrossLevels(F &&f)
+{
+    {
+        ForcedLevel forced(SimdLevel::Scalar);
+        f(true);
+    }
+    for (SimdLevel level : vectorLevels())
+    {
+        INFO("level ", simdLevelName(level));
+        ForcedLevel forced(level);
+        f(false);
+    }
+}
+
+static Point3d randomPoint(std::mt19937 &gen)
+{
+    std::uniform_real_distribution<float> u(-10.0f, 10.0f);
+    return {u(gen), u(gen), u(gen)};
+}
+
+static void checkNear(const Point3d &a, const Point3d &b)
+{
+    CHECK(a.x == doctest::Approx(b.x).epsilon(1e-5).scale(1.0));
+    CHECK(a.y == doctest::Approx(b.y).epsilon(1e-5).scale(1.0));
+    CHECK(a.z == doctest::Approx(b.z).epsilon(1e-5).scale(1.0));
+}
+
+TEST_CASE("SIMD dispatch level can be forced")
+{
+    const SimdLevel before = simdLevel();
+    {
+        ForcedLevel forced(SimdLevel::Scalar);
+        CHECK(simdLevel() == SimdLevel::Scalar);
+        CHECK_FALSE(cpuHasAvx2());
+        CHECK_FALSE(cpuHasAvx512());
+    }
+    CHECK(simdLevel() == before);
+
+    // Levels above what the CPU has are clamped.
+    ForcedLevel forced(SimdLevel::Avx512);
+    CHECK(simdLevel() == cpuSimdLevel());
+    CHECK(cpuHasAvx2() == (cpuSimdLevel() >= SimdLevel::Avx2));
+}
+
+TEST_CASE("SIMD paths agree: transforms")
+{
+    std::mt19937 gen(48);
+    const size_t n = 1000 + 13;
+    std::vector<Point3d> p(n), out(n), ref(n);
+    for (auto &q : p)
+        q = randomPoint(gen);
+    Matrix33 m;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            m[i][j] = float(i * 3 + j + 1) * 0.1f;
+    float mt[3][3];
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            mt[i][j] = m[i][j];
+    const float t[3] = {1.0f, -2.0f, 0.5f};
+    std::vector<AABB3d> boxes(n), moved(n), movedRef(n);
+    for (auto &b : boxes)
+        b = {randomPoint(gen), {1.0f, 2.0f, 0.5f}};
+
+    acrossLevels([&](bool scalar) {
+        transformPoints(m, p, scalar ? ref : out);
+        UpdateAABB(boxes, mt, t, scalar ? movedRef : moved);
+        if (scalar)
+            return;
+        for (size_t i = 0; i < n; ++i)
+        {
+            checkNear(out[i], ref[i]);
+            checkNear(moved[i].c, movedRef[i].c);
+            for (int a = 0; a < 3; ++a)
+                CHECK(moved[i].r[a] ==
+                      doctest::Approx(movedRef[i].r[a]).epsilon(1e-5));
+        }
+    });
+}
+
+TEST_CASE("SIMD paths agree: reductions")
+{
+    std::mt19937 gen(48);
+    std::vector<Point3d> p(100003);
+    for (auto &q : p)
+        q = randomPoint(gen);
+    // Repeated extremes test the lowest index rule.
+    p[70000] = p[90000] = {20.0f, -20.0f, 20.0f};
+
+    ExtremalPoints ref{};
+    Sphere sphereRef{};
+    acrossLevels([&](bool scalar) {
+        const ExtremalPoints e = extremalPoints(p);
+        const Sphere s = ritterSphere(p);
+        if (scalar)
+        {
+            ref = e;
+            sphereRef = s;
+            return;
+        }
+        for (int a = 0; a < 3; ++a)
+        {
+            CHECK(e.min[a] == ref.min[a]);
+            CHECK(e.max[a] == ref.max[a]);
+        }
+        checkNear(e.box.c, ref.box.c);
+        checkNear(s.c, sphereRef.c);
+        CHECK(s.r == doctest::Approx(sphereRef.r).epsilon(1e-5));
+    });
+}
+
+TEST_CASE("SIMD paths agree: dot products")
+{
+    std::mt19937 gen(48);
+    const size_t n = 517;
+    std::vector<Point3d> p(n), uvw(n), uvwRef(n);
+    std::vector<Point2d> p2(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        p[i] = randomPoint(gen);
+        p2[i] = {p[i].x, p[i].y};
+    }
+    const BarycentricTriangle tri(
+        {0.0f, 0.0f, 0.0f}, {1.0f, 0.2f, 0.1f}, {0.3f, 1.0f, -0.2f});
+    KdTree<Point3d> tree;
+    tree.build(p);
+    std::vector<KdNeighbor> nn(5), nnRef(5);
+    const Point3d q = {0.5f, -0.5f, 1.0f};
+    size_t farthestRef = 0;
+
+    acrossLevels([&](bool scalar) {
+        tri.coordinates(p, scalar ? uvwRef : uvw);
+        tree.nearest(q, scalar ? nnRef : nn);
+        const size_t farthest =
+            pointFarthestFromEdge({-1.0f, 0.0f}, {1.0f, 0.5f}, p2);
+        if (scalar)
+        {
+            farthestRef = farthest;
+            return;
+        }
+        for (size_t i = 0; i < n; ++i)
+            checkNear(uvw[i], uvwRef[i]);
+        for (size_t i = 0; i < nn.size(); ++i)
+            CHECK(nn[i].index == nnRef[i].index);
+        CHECK(farthest == farthestRef);
+    });
+}
+
+TEST_CASE("SIMD paths agree: intersections")
+{
+    std::mt19937 gen(48);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    const size_t n = 1000 + 7;
+    std::vector<OBB3d> a(n), b(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        // Boxes from random frames, close enough that about half overlap.
+        for (OBB3d *box : {&a[i], &b[i]})
+        {
+            Matrix33 r;
+            for (int k = 0; k < 3; ++k)
+                for (int j = 0; j < 3; ++j)
+                    r[k][j] = u(gen);
+            Matrix33 v;
+            Jacobi(r.transpose() * r, v);
+            box->c = {u(gen) * 3.0f, u(gen) * 3.0f, u(gen) * 3.0f};
+            for (int k = 0; k < 3; ++k)
+            {
+                box->u[k] = {v[0][k], v[1][k], v[2][k]};
+                box->e[k] = 0.5f + 0.5f * std::abs(u(gen));
+            }
+        }
+    }
+    std::vector<uint8_t> hit(n), hitRef(n);
+
+    std::vector<Ray> rays(RayPacket::WIDTH);
+    for (auto &r : rays)
+    {
+        r.o = randomPoint(gen);
+        normalize(randomPoint(gen), r.d);
+    }
+    const RayPacket packet(rays, 100.0f);
+    const AABB3d box = {{0.0f, 0.0f, 0.0f}, {4.0f, 4.0f, 4.0f}};
+    const Triangle3d tri = {
+        {-5.0f, -5.0f, 0.0f}, {5.0f, -5.0f, 0.0f}, {0.0f, 5.0f, 0.0f}};
+    float tenter[RayPacket::WIDTH], tenterRef[RayPacket::WIDTH];
+    float t[RayPacket::WIDTH], tRef[RayPacket::WIDTH];
+    float bu[RayPacket::WIDTH], bv[RayPacket::WIDTH];
+    uint32_t boxMaskRef = 0, triMaskRef = 0;
+
+    acrossLevels([&](bool scalar) {
+        intersection(a, b, scalar ? hitRef : hit);
+        const uint32_t boxMask =
+            intersection(packet, box, scalar ? tenterRef : tenter);
+        const uint32_t triMask =
+            intersection(packet, tri, scalar ? tRef : t, bu, bv);
+        if (scalar)
+        {
+            boxMaskRef = boxMask;
+            triMaskRef = triMask;
+            return;
+        }
+        CHECK(hit == hitRef);
+        CHECK(boxMask == boxMaskRef);
+        CHECK(triMask == triMaskRef);
+        for (int l = 0; l < RayPacket::WIDTH; ++l)
+        {
+            if (boxMask >> l & 1)
+                CHECK(tenter[l] == doctest::Approx(tenterRef[l]));
+            if (triMask >> l & 1)
+                CHECK(t[l] == doctest::Approx(tRef[l]));
+        }
+    });
+}
+
+TEST_CASE("SIMD paths agree: batched matrices")
+{
+    std::mt19937 gen(48);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    const size_t n = 100 + 5;
+    std::vector<Matrix33> a(n), v(n), vRef(n), inv(n), invRef(n);
+    std::vector<Point3d> e(n), eRef(n);
+    std::vector<float> det(n), detRef(n);
+    for (auto &m : a)
+    {
+        Matrix33 b;
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                b[i][j] = u(gen);
+        m = b.transpose() * b;
+        for (int i = 0; i < 3; ++i)
+            m[i][i] += 1.0f;
+    }
+    DenseMatrix<float> x(37, 41), y(41, 29), z, zRef;
+    for (size_t i = 0; i < x.rows(); ++i)
+        for (size_t j = 0; j < x.cols(); ++j)
+            x[i][j] = u(gen);
+    for (size_t i = 0; i < y.rows(); ++i)
+        for (size_t j = 0; j < y.cols(); ++j)
+            y[i][j] = u(gen);
+    std::vector<float> s(37 * 41), st(37 * 41), stRef(37 * 41);
+    for (auto &f : s)
+        f = u(gen);
+
+    acrossLevels([&](bool scalar) {
+        Jacobi(a, scalar ? vRef : v, scalar ? eRef : e);
+        inverse(a, scalar ? invRef : inv, scalar ? detRef : det);
+        mult(x, y, scalar ? zRef : z);
+        transpose(s.data(), scalar ? stRef.data() : st.data(), 37, 41);
+        if (scalar)
+            return;
+        for (size_t k = 0; k < n; ++k)
+        {
+            // Eigenvectors may flip sign; compare the eigenvalues.
+            checkNear(e[k], eRef[k]);
+            CHECK(det[k] == doctest::Approx(detRef[k]).epsilon(1e-5));
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    CHECK(inv[k][i][j] ==
+                          doctest::Approx(invRef[k][i][j]).epsilon(1e-4));
+        }
+        for (size_t i = 0; i < z.rows(); ++i)
+            for (size_t j = 0; j < z.cols(); ++j)
+                CHECK(z[i][j] ==
+                      doctest::Approx(zRef[i][j]).epsilon(1e-5).scale(1.0));
+        CHECK(st == stRef);
+    });
+}
@@ -0,0 +1,70 @@
+#include "doctest.h"
+#include "geometry.hpp"
+#include "spatial_hash.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+TEST_CASE("Spatial hash inserts spanning boxes into every cell")
+{
+    SpatialHash grid(1.0f);
+    std::vector<AABB3d> boxes = {{{0.5f, 0.5f, 0.5f}, {0.25f, 0.25f, 0.25f}},
+                                 {{1.0f, 1.0f, 1.0f}, {0.5f, 0.5f, 0.5f}}};
+    grid.build(boxes);
+    // The first box sits in one cell, the second straddles eight.
+    CHECK(grid.cellCount() == 8);
+
+    auto pairs = grid.findPairs();
+    REQUIRE(pairs.size() == 1);
+    CHECK(pairs[0] == SpatialHash::Pair{0, 1});
+
+    std::vector<uint32_t> hits;
+    grid.query(AABB3d{{1.4f, 1.4f, 1.4f}, {0.05f, 0.05f, 0.05f}},
+               [&](uint32_t i) { hits.push_back(i); });
+    REQUIRE(hits.size() == 1);
+    CHECK(hits[0] == 1);
+}
+
+TEST_CASE("Spatial hash pairs match brute force and are unique")
+{
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> pos(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> ext(0.1f, 1.5f);
+    std::vector<AABB3d> boxes(1500);
+    for (auto &b : boxes)
+        b = {{pos(gen), pos(gen), pos(gen)}, {ext(gen), ext(gen), ext(gen)}};
+
+    std::vector<SpatialHash::Pair> expected;
+    for (uint32_t i = 0; i < boxes.size(); ++i)
+        for (uint32_t j = i + 1; j < boxes.size(); ++j)
+            if (intersection(boxes[i], boxes[j]))
+                expected.emplace_back(i, j);
+
+    SpatialHash grid(2.0f);
+    grid.build(boxes);
+    auto pairs = grid.findPairs();
+    std::sort(pairs.begin(), pairs.end());
+    CHECK(pairs == expected);
+
+    AABB3d q = {{0, 0, 0}, {5, 5, 5}};
+    std::vector<uint32_t> hits, brute;
+    grid.query(q, [&](uint32_t i) { hits.push_back(i); });
+    for (uint32_t i = 0; i < boxes.size(); ++i)
+        if (intersection(boxes[i], q))
+            brute.push_back(i);
+    std::sort(hits.begin(), hits.end());
+    CHECK(hits == brute);
+}
+
+TEST_CASE("Spatial hash uses the exact sphere test")
+{
+    // Bounding boxes overlap at the corner, the spheres don't.
+    std::vector<Sphere> spheres = {{{0, 0, 0}, 1.0f}, {{1.8f, 1.8f, 0}, 1.0f},
+                                   {{0, 1.5f, 0}, 1.0f}};
+    SpatialHash grid(2.0f);
+    grid.build(spheres);
+    auto pairs = grid.findPairs();
+    std::sort(pairs.begin(), pairs.end());
+    std::vector<SpatialHash::Pair> expected = {{0, 2}, {1, 2}};
+    CHECK(pairs == expected);
+}
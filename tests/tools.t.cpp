@@ -1,6 +1,8 @@
 #include "doctest.h"
 #include "geom_structs.hpp"
 #include "geometry.hpp"
+#include <random>
+#include <vector>
 
 TEST_CASE("Identical boxes should intersect")
 {
@@ -99,6 +101,71 @@ TEST_CASE("UpdateAABB - Rotation and Scale")
     CHECK(b.r[2] == doctest::Approx(3.0f));
 }
 
+TEST_CASE("UpdateAABB - output may alias input")
+{
+    AABB3d a = {{1, 0, 0}, {1, 2, 3}};
+    float m[3][3] = {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}};
+    float t[3] = {0, 0, 0};
+
+    UpdateAABB(a, m, t, a);
+
+    CHECK(a.c.x == doctest::Approx(0.0f));
+    CHECK(a.c.y == doctest::Approx(1.0f));
+    CHECK(a.r[0] == doctest::Approx(2.0f));
+    CHECK(a.r[1] == doctest::Approx(1.0f));
+}
+
+TEST_CASE("UpdateAABB - batches match single box calls")
+{
+    std::mt19937 gen(2);
+    std::uniform_real_distribution<float> u(-2.0f, 2.0f);
+    // Not a multiple of the vector width, to cover the scalar tail.
+    const size_t n = 1003;
+    std::vector<AABB3d> local(n), expected(n), batch(n);
+    std::vector<Transform3d> xf(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        local[i] = {{u(gen), u(gen), u(gen)},
+                    {std::abs(u(gen)), std::abs(u(gen)), std::abs(u(gen))}};
+        for (auto &row : xf[i].m)
+            for (auto &v : row)
+                v = u(gen);
+        for (auto &v : xf[i].t)
+            v = u(gen);
+    }
+
+    auto same = [&]() {
+        bool ok = true;
+        for (size_t i = 0; i < n; ++i)
+        {
+            ok = ok && batch[i].c.x == doctest::Approx(expected[i].c.x) &&
+                 batch[i].c.y == doctest::Approx(expected[i].c.y) &&
+                 batch[i].c.z == doctest::Approx(expected[i].c.z);
+            for (int k = 0; k < 3; ++k)
+                ok = ok && batch[i].r[k] == doctest::Approx(expected[i].r[k]);
+        }
+        return ok;
+    };
+
+    for (bool parallel : {false, true})
+    {
+        for (size_t i = 0; i < n; ++i)
+            UpdateAABB(local[i], xf[0].m, xf[0].t, expected[i]);
+        UpdateAABB(local, xf[0].m, xf[0].t, batch, parallel);
+        CHECK(same());
+
+        for (size_t i = 0; i < n; ++i)
+            UpdateAABB(local[i], xf[i].m, xf[i].t, expected[i]);
+        UpdateAABB(local, xf, batch, parallel);
+        CHECK(same());
+    }
+
+    // In place
+    batch = local;
+    UpdateAABB(batch, xf, batch);
+    CHECK(same());
+}
+
 TEST_CASE("Sphere intersection tests")
 {
     Sphere a = {{0, 0, 0}, 1.0f};
@@ -133,3 +200,62 @@ TEST_CASE("Sphere intersection tests")
         CHECK(intersection(a, b) == true);
     }
 }
+
+TEST_CASE("mostSeparatePointsOnAABB picks the widest axis pair")
+{
+    std::vector<Point3d> pts = {
+        {0, 0, 0}, {10, 1, 0}, {5, -2, 1}, {-3, 0.5f, 0}, {4, 3, -1}};
+    int min, max;
+    mostSeparatePointsOnAABB(min, max, pts);
+    CHECK(min == 3);
+    CHECK(max == 1);
+
+    std::vector<Point3d> tall = {{0, -9, 0}, {1, 0, 0}, {0, 9, 0}};
+    mostSeparatePointsOnAABB(min, max, tall);
+    CHECK(min == 0);
+    CHECK(max == 2);
+}
+
+TEST_CASE("extremalPoints matches a scalar scan")
+{
+    std::mt19937 gen(6);
+    std::uniform_real_distribution<float> u(-100.0f, 100.0f);
+    for (size_t n : {1, 7, 8, 9, 1000, 300001})
+    {
+        std::vector<Point3d> pts(n);
+        for (auto &p : pts)
+            p = {u(gen), u(gen), u(gen)};
+        // Duplicate the extremes further on: the first occurrence must win.
+        if (n > 8)
+        {
+            pts[n - 1] = pts[n / 2];
+            pts[n - 2].x = 200.0f;
+            pts[n / 3].x = 200.0f;
+        }
+
+        int lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+        for (size_t i = 1; i < n; ++i)
+            for (int a = 0; a < 3; ++a)
+            {
+                if ((&pts[i].x)[a] < (&pts[lo[a]].x)[a])
+                    lo[a] = int(i);
+                if ((&pts[i].x)[a] > (&pts[hi[a]].x)[a])
+                    hi[a] = int(i);
+            }
+
+        ExtremalPoints e = extremalPoints(pts);
+        for (int a = 0; a < 3; ++a)
+        {
+            CHECK(e.min[a] == lo[a]);
+            CHECK(e.max[a] == hi[a]);
+            const float mn = (&pts[lo[a]].x)[a];
+            const float mx = (&pts[hi[a]].x)[a];
+            CHECK((&e.box.c.x)[a] == doctest::Approx(0.5f * (mn + mx)));
+            CHECK(e.box.r[a] == doctest::Approx(0.5f * (mx - mn)));
+        }
+    }
+
+    ExtremalPoints empty = extremalPoints({});
+    CHECK(empty.min[0] == -1);
+    CHECK(empty.max[2] == -1);
+}
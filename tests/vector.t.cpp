@@ -19,3 +19,21 @@ TEST_CASE("Cross product")
     CHECK(cprod.y == 6);
     CHECK(cprod.z == -3);
 }
+
+TEST_CASE("Vector core is usable in constant expressions")
+{
+    constexpr Point3d u{1, 2, 3};
+    constexpr Point3d v{4, 5, 6};
+    static_assert(dotProd(u, v) == 32);
+    static_assert(crossProd(u, v).y == 6);
+    static_assert((v - u).z == 3);
+    static_assert(dotProd(Point2d{1, 2} - Point2d{3, 1}, Point2d{1, 1}) == -1);
+    static_assert(triaArea(0, 0, 1, 0, 0, 1) == 1);
+
+    Point3d n{7, 7, 7};
+    normalize(Point3d{0, 0, 0}, n);
+    CHECK(n.x == 7);
+    normalize(Point3d{0, 3, 4}, n);
+    CHECK(n.y == doctest::Approx(0.6f));
+    CHECK(magnitute(n) == doctest::Approx(1.0f));
+}